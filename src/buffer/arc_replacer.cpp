@@ -0,0 +1,198 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// arc_replacer.cpp
+//
+// Identification: src/buffer/arc_replacer.cpp
+//
+// Copyright (c) 2015-2023, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/arc_replacer.h"
+
+#include <algorithm>
+
+#include "common/exception.h"
+
+namespace bustub {
+
+auto ArcReplacer::GhostList::Erase(page_id_t page_id) -> bool {
+  auto iter = index_.find(page_id);
+  if (iter == index_.end()) {
+    return false;
+  }
+  list_.erase(iter->second);
+  index_.erase(iter);
+  return true;
+}
+
+void ArcReplacer::GhostList::Push(page_id_t page_id) { index_[page_id] = list_.insert(list_.end(), page_id); }
+
+void ArcReplacer::GhostList::PopFront() {
+  index_.erase(list_.front());
+  list_.pop_front();
+}
+
+ArcReplacer::ArcReplacer(size_t num_frames) : capacity_(num_frames), frames_(num_frames) {}
+
+auto ArcReplacer::EvictFrom(std::list<frame_id_t> *list, GhostList *ghost, frame_id_t *frame_id,
+                            const std::function<bool(frame_id_t)> &can_evict) -> bool {
+  for (auto iter = list->begin(); iter != list->end(); ++iter) {
+    FrameEntry &entry = frames_[*iter];
+    if (!entry.is_evictable_ || !can_evict(*iter)) {
+      continue;
+    }
+    *frame_id = *iter;
+    list->erase(iter);
+    if (entry.page_id_ != INVALID_PAGE_ID) {
+      ghost->Push(entry.page_id_);
+    }
+    entry = FrameEntry();
+    evictable_size_--;
+    return true;
+  }
+  return false;
+}
+
+void ArcReplacer::TrimGhosts() {
+  while (t1_.size() + b1_.Size() > capacity_ && b1_.Size() > 0) {
+    b1_.PopFront();
+  }
+  while (t1_.size() + t2_.size() + b1_.Size() + b2_.Size() > 2 * capacity_ && b2_.Size() > 0) {
+    b2_.PopFront();
+  }
+}
+
+auto ArcReplacer::EvictIf(frame_id_t *frame_id, const std::function<bool(frame_id_t)> &can_evict) -> bool {
+  std::unique_lock<std::mutex> lock(latch_);
+  if (evictable_size_ == 0) {
+    return false;
+  }
+  bool evicted = t1_.size() > p_
+                     ? EvictFrom(&t1_, &b1_, frame_id, can_evict) || EvictFrom(&t2_, &b2_, frame_id, can_evict)
+                     : EvictFrom(&t2_, &b2_, frame_id, can_evict) || EvictFrom(&t1_, &b1_, frame_id, can_evict);
+  if (evicted) {
+    TrimGhosts();
+  }
+  return evicted;
+}
+
+void ArcReplacer::RecordAccess(frame_id_t frame_id, AccessType access_type) {
+  std::unique_lock<std::mutex> lock(latch_);
+  BUSTUB_ASSERT(frame_id >= 0 && static_cast<size_t>(frame_id) < frames_.size(), "arc: invalid frame id");
+  RecordAccessLocked(frame_id, access_type);
+}
+
+void ArcReplacer::RecordAccesses(const std::vector<AccessRecord> &records) {
+  std::unique_lock<std::mutex> lock(latch_);
+  // only the order of the records matters here, not their timestamps
+  for (const auto &record : records) {
+    BUSTUB_ASSERT(record.frame_id_ >= 0 && static_cast<size_t>(record.frame_id_) < frames_.size(),
+                  "arc: invalid frame id");
+    FrameEntry &entry = frames_[record.frame_id_];
+    if (entry.list_ != ArcList::NONE) {
+      RecordAccessLocked(record.frame_id_, record.access_type_);
+    }
+  }
+}
+
+void ArcReplacer::RecordAccessLocked(frame_id_t frame_id, AccessType access_type) {
+  FrameEntry &entry = frames_[frame_id];
+  bool is_scan = access_type == AccessType::Scan;
+  if (entry.list_ != ArcList::NONE) {
+    // hit: move to the most recently used end of T2
+    if (is_scan) {
+      return;
+    }
+    t2_.splice(t2_.end(), entry.list_ == ArcList::T1 ? t1_ : t2_, entry.pos_);
+    entry.list_ = ArcList::T2;
+    return;
+  }
+
+  // miss: a ghost hit tells which list should have been larger
+  bool ghost_hit = false;
+  if (entry.page_id_ != INVALID_PAGE_ID) {
+    size_t b1_size = b1_.Size();
+    size_t b2_size = b2_.Size();
+    if (b1_.Erase(entry.page_id_)) {
+      ghost_hit = true;
+      if (!is_scan) {
+        p_ = std::min(capacity_, p_ + std::max<size_t>(b2_size / b1_size, 1));
+      }
+    } else if (b2_.Erase(entry.page_id_)) {
+      ghost_hit = true;
+      if (!is_scan) {
+        size_t delta = std::max<size_t>(b1_size / b2_size, 1);
+        p_ = p_ > delta ? p_ - delta : 0;
+      }
+    }
+  }
+  if (ghost_hit && !is_scan) {
+    entry.pos_ = t2_.insert(t2_.end(), frame_id);
+    entry.list_ = ArcList::T2;
+  } else {
+    entry.pos_ = t1_.insert(t1_.end(), frame_id);
+    entry.list_ = ArcList::T1;
+  }
+  TrimGhosts();
+}
+
+void ArcReplacer::SetEvictable(frame_id_t frame_id, bool set_evictable) {
+  std::unique_lock<std::mutex> lock(latch_);
+  BUSTUB_ASSERT(frame_id >= 0 && static_cast<size_t>(frame_id) < frames_.size(), "arc: invalid frame id");
+  BUSTUB_ASSERT(frames_[frame_id].list_ != ArcList::NONE, "frame id doesn't exist");
+  SetEvictableLocked(frame_id, set_evictable);
+}
+
+void ArcReplacer::UpdateEvictable(frame_id_t frame_id, const std::function<bool(frame_id_t)> &is_evictable) {
+  std::unique_lock<std::mutex> lock(latch_);
+  BUSTUB_ASSERT(frame_id >= 0 && static_cast<size_t>(frame_id) < frames_.size(), "arc: invalid frame id");
+  FrameEntry &entry = frames_[frame_id];
+  if (entry.list_ != ArcList::NONE) {
+    SetEvictableLocked(frame_id, is_evictable(frame_id));
+  }
+}
+
+void ArcReplacer::SetEvictableLocked(frame_id_t frame_id, bool set_evictable) {
+  FrameEntry &entry = frames_[frame_id];
+  if (set_evictable == entry.is_evictable_) {
+    return;
+  }
+  entry.is_evictable_ = set_evictable;
+  if (set_evictable) {
+    evictable_size_++;
+  } else {
+    evictable_size_--;
+  }
+}
+
+void ArcReplacer::Remove(frame_id_t frame_id) {
+  std::unique_lock<std::mutex> lock(latch_);
+  BUSTUB_ASSERT(frame_id >= 0 && static_cast<size_t>(frame_id) < frames_.size(), "arc: invalid frame id");
+  FrameEntry &entry = frames_[frame_id];
+  if (entry.list_ == ArcList::NONE) {
+    return;
+  }
+  if (!entry.is_evictable_) {
+    throw Exception("error remove: remove the non-evictable frame");
+  }
+  // the page is gone for good, don't keep a ghost of it
+  (entry.list_ == ArcList::T1 ? t1_ : t2_).erase(entry.pos_);
+  entry = FrameEntry();
+  evictable_size_--;
+}
+
+void ArcReplacer::SetPage(frame_id_t frame_id, page_id_t page_id) {
+  std::unique_lock<std::mutex> lock(latch_);
+  BUSTUB_ASSERT(frame_id >= 0 && static_cast<size_t>(frame_id) < frames_.size(), "arc: invalid frame id");
+  frames_[frame_id].page_id_ = page_id;
+}
+
+auto ArcReplacer::Size() -> size_t {
+  std::unique_lock<std::mutex> lock(latch_);
+  return evictable_size_;
+}
+
+}  // namespace bustub
@@ -12,224 +12,325 @@
 
 #include "buffer/buffer_pool_manager.h"
 
+#include <algorithm>
+#include <chrono>  // NOLINT
+
 #include "common/exception.h"
 #include "common/logger.h"
 #include "common/macros.h"
+#include "fmt/format.h"
 #include "storage/page/page_guard.h"
 
 namespace bustub {
 
 BufferPoolManager::BufferPoolManager(size_t pool_size, DiskManager *disk_manager, size_t replacer_k,
-                                     LogManager *log_manager)
-    : pool_size_(pool_size), disk_manager_(disk_manager), log_manager_(log_manager) {
-  // we allocate a consecutive memory space for the buffer pool
-  pages_ = new Page[pool_size_];
-  replacer_ = std::make_unique<LRUKReplacer>(pool_size, replacer_k);
-  // Initially, every page is in the free list.
-  for (size_t i = 0; i < pool_size_; ++i) {
-    free_list_.emplace_back(static_cast<int>(i));
+                                     LogManager *log_manager, size_t num_instances, ReplacerType replacer_type,
+                                     size_t max_pool_size)
+    : pool_size_(pool_size),
+      disk_manager_(disk_manager),
+      max_pool_size_(max_pool_size == 0 ? pool_size : max_pool_size) {
+  BUSTUB_ASSERT(num_instances > 0 && num_instances <= pool_size, "bpm: every instance needs at least one frame");
+  BUSTUB_ASSERT(pool_size <= max_pool_size_, "bpm: pool larger than its maximum size");
+  // we allocate a consecutive memory space for the largest the buffer pool may grow to and hand each instance a
+  // slice of it, only the frames in use get memory
+  arena_ = std::make_unique<FrameArena>(max_pool_size_, max_pool_size_ > pool_size);
+  pages_ = arena_->GetFrames();
+  free_space_map_ = std::make_unique<FreeSpaceMap>(disk_manager, num_instances);
+  size_t offset = 0;
+  for (size_t i = 0; i < num_instances; ++i) {
+    size_t capacity = SliceOf(max_pool_size_, num_instances, i);
+    arena_->Commit(offset, SliceOf(pool_size, num_instances, i));
+    instances_.emplace_back(std::make_unique<BufferPoolManagerInstance>(
+        SliceOf(pool_size, num_instances, i), capacity, pages_ + offset, num_instances, i, disk_manager,
+        free_space_map_.get(), replacer_k, log_manager, replacer_type));
+    offset += capacity;
   }
 }
 
-BufferPoolManager::~BufferPoolManager() { delete[] pages_; }
+BufferPoolManager::~BufferPoolManager() {
+  if (flush_thread_ != nullptr) {
+    {
+      std::unique_lock<std::mutex> lock(flush_latch_);
+      enable_background_flush_ = false;
+    }
+    flush_cv_.notify_all();
+    flush_thread_->join();
+    delete flush_thread_;
+  }
+  {
+    std::unique_lock<std::mutex> lock(prefetch_latch_);
+    enable_prefetch_ = false;
+  }
+  prefetch_cv_.notify_all();
+  for (auto &thread : prefetch_threads_) {
+    thread.join();
+  }
+  instances_.clear();
+}
 
-auto BufferPoolManager::GetUsablePage(frame_id_t *frame_id, std::unique_lock<std::mutex> &lock) -> bool {
-  if (replacer_ == nullptr || disk_manager_ == nullptr || (free_list_.empty() && replacer_->Size() == 0)) {
+auto BufferPoolManager::Resize(size_t pool_size) -> bool {
+  if (pool_size < instances_.size() || pool_size > max_pool_size_) {
     return false;
   }
-  // get pages from the free list
-  Page *pg = nullptr;
-  if (!free_list_.empty()) {
-    // get new page_id, record frame id in lru_replacer
-    *frame_id = free_list_.front();
-    free_list_.pop_front();
-    pg = GetPages() + *frame_id;
-  } else if (replacer_->Evict(frame_id)) {  // get pages by replacer
-    pg = GetPages() + *frame_id;
-    if (pg->IsDirty()) {
-      disk_manager_->WritePage(pg->GetPageId(), pg->GetData());
+  std::scoped_lock lock(resize_latch_);
+  size_t offset = 0;
+  for (size_t i = 0; i < instances_.size(); ++i) {
+    size_t old_size = instances_[i]->GetPoolSize();
+    size_t new_size = SliceOf(pool_size, instances_.size(), i);
+    // the frames need their memory before they go on the free list, and keep it until they are dropped
+    if (new_size > old_size) {
+      arena_->Commit(offset + old_size, new_size - old_size);
     }
-    page_table_.erase(pg->GetPageId());
-  } else {
-    return false;
+    instances_[i]->Resize(new_size);
+    if (new_size < old_size) {
+      arena_->Release(offset + new_size, old_size - new_size);
+    }
+    offset += instances_[i]->GetCapacity();
   }
-  // write back dirty page
-
-  pg->pin_count_ = 1;  // TODO(hksong): may need change later
-  pg->is_dirty_ = false;
-  pg->ResetMemory();
-  replacer_->RecordAccess(*frame_id);
-  replacer_->SetEvictable(*frame_id, false);
+  pool_size_ = pool_size;
   return true;
 }
 
-auto BufferPoolManager::NewPage(page_id_t *page_id) -> Page * {
-  // init with big lock
-  std::unique_lock<std::mutex> lock(latch_);
-  frame_id_t frame_id = 0;
-  if (!GetUsablePage(&frame_id, lock)) {
-    // page_id = nullptr;
-    return nullptr;
-  }
-  Page *pg = GetPages() + frame_id;
-  // set page metadata record page
-  *page_id = AllocatePage();
-  pg->page_id_ = *page_id;
-  page_table_[*page_id] = frame_id;  // record it
-  lock.unlock();
-  // return page address
-  BUSTUB_ASSERT(pg->pin_count_ == 1 && pg->is_dirty_ == false && pg->page_id_ != INVALID_PAGE_ID,
-                "newpage: error new page");
-  return pg;
+void BufferPoolManager::StartBackgroundFlush(double high_watermark, double low_watermark) {
+  BUSTUB_ASSERT(0 <= low_watermark && low_watermark <= high_watermark, "bpm: invalid dirty watermarks");
+  BUSTUB_ENSURE(flush_thread_ == nullptr, "bpm: background flusher already started");
+  enable_background_flush_ = true;
+  flush_thread_ = new std::thread(&BufferPoolManager::RunBackgroundFlush, this, high_watermark, low_watermark);
 }
 
-auto BufferPoolManager::FetchPage(page_id_t page_id, [[maybe_unused]] AccessType access_type) -> Page * {
-  // init with big lock
-  std::unique_lock<std::mutex> lock(latch_);
-  auto iter = page_table_.find(page_id);
-  // can get pages directly from pool
-  if (iter != page_table_.end()) {
-    // bpin
-    frame_id_t frame_id = iter->second;
-    replacer_->RecordAccess(frame_id);
-    replacer_->SetEvictable(frame_id, false);
-    Page *pg = GetPages() + frame_id;
-    pg->pin_count_++;
-    return pg;
-  }
-  // need get it from other place(disk)
-  frame_id_t frame_id = -1;
-  if (!GetUsablePage(&frame_id, lock)) {
-    return nullptr;
-  }
-  BUSTUB_ASSERT(frame_id != -1, "fetchpage: wrong frame_id");
-  Page *pg = GetPages() + frame_id;
-  pg->page_id_ = page_id;
-  // read from disk
-  disk_manager_->ReadPage(page_id, pg->GetData());
-  page_table_[page_id] = frame_id;
-  lock.unlock();
-  BUSTUB_ASSERT(pg->pin_count_ == 1 && pg->is_dirty_ == false && pg->page_id_ != INVALID_PAGE_ID,
-                "fetchpage: error get page");
-  return pg;
+void BufferPoolManager::RunBackgroundFlush(double high_watermark, double low_watermark) {
+  std::unique_lock<std::mutex> lock(flush_latch_);
+  while (enable_background_flush_) {
+    flush_cv_.wait_for(lock, background_flush_interval, [this] { return !enable_background_flush_; });
+    if (!enable_background_flush_) {
+      break;
+    }
+    lock.unlock();
+    for (auto &instance : instances_) {
+      auto pool_size = static_cast<double>(instance->GetPoolSize());
+      if (static_cast<double>(instance->GetDirtyCount()) > high_watermark * pool_size) {
+        instance->CleanDirtyPages(static_cast<size_t>(low_watermark * pool_size));
+      }
+    }
+    lock.lock();
+  }
 }
 
-auto BufferPoolManager::UnpinPage(page_id_t page_id, bool is_dirty, [[maybe_unused]] AccessType access_type) -> bool {
-  // init with big lock
-  std::unique_lock<std::mutex> lock(latch_);
-  auto iter = page_table_.find(page_id);
-  if (iter == page_table_.end()) {
-    return false;
+void BufferPoolManager::StartPrefetch(size_t num_threads) {
+  BUSTUB_ENSURE(prefetch_threads_.empty(), "bpm: prefetch already started");
+  enable_prefetch_ = true;
+  for (size_t i = 0; i < num_threads; ++i) {
+    prefetch_threads_.emplace_back(&BufferPoolManager::RunPrefetch, this);
   }
-  frame_id_t frame_id = iter->second;
-  Page *pg = GetPages() + frame_id;
-  if (pg->GetPinCount() <= 0) {
-    return false;
+}
+
+void BufferPoolManager::PrefetchPages(page_id_t first_page_id, size_t count) {
+  if (first_page_id < 0) {
+    return;
   }
-  pg->pin_count_--;
-  if (!pg->IsDirty()) {
-    pg->is_dirty_ = is_dirty;
+  disk_manager_->AdviseSequentialRead(first_page_id, count);
+  {
+    std::unique_lock<std::mutex> lock(prefetch_latch_);
+    if (!enable_prefetch_) {
+      return;
+    }
+    for (size_t i = 0; i < count && prefetch_queue_.size() < pool_size_; ++i) {
+      prefetch_queue_.push_back(first_page_id + static_cast<page_id_t>(i));
+    }
   }
-  if (0 == pg->GetPinCount()) {
-    replacer_->SetEvictable(frame_id, true);
+  prefetch_cv_.notify_all();
+}
+
+void BufferPoolManager::RunPrefetch() {
+  std::unique_lock<std::mutex> lock(prefetch_latch_);
+  while (true) {
+    prefetch_cv_.wait(lock, [this] { return !enable_prefetch_ || !prefetch_queue_.empty(); });
+    if (!enable_prefetch_) {
+      break;
+    }
+    // queue the reads of a batch of pages, then start them together
+    std::vector<page_id_t> page_ids;
+    while (!prefetch_queue_.empty() && page_ids.size() < static_cast<size_t>(DISK_IO_QUEUE_DEPTH)) {
+      page_ids.push_back(prefetch_queue_.front());
+      prefetch_queue_.pop_front();
+    }
+    lock.unlock();
+    for (page_id_t page_id : page_ids) {
+      GetInstance(page_id)->PrefetchPage(page_id);
+    }
+    disk_manager_->SubmitIo();
+    lock.lock();
   }
-  return true;
 }
 
-auto BufferPoolManager::FlushPage(page_id_t page_id) -> bool {
-  std::unique_lock<std::mutex> lock(latch_);
-  auto iter = page_table_.find(page_id);
-  if (iter == page_table_.end()) {
-    return false;
+auto BufferPoolManager::NewPage(page_id_t *page_id) -> Page * {
+  // try every instance once, starting from a different one on each call
+  size_t start = next_instance_.fetch_add(1);
+  for (size_t i = 0; i < instances_.size(); ++i) {
+    Page *pg = instances_[(start + i) % instances_.size()]->NewPage(page_id);
+    if (pg != nullptr) {
+      return pg;
+    }
   }
-  Page *pg = GetPages() + iter->second;
-  disk_manager_->WritePage(pg->GetPageId(), pg->GetData());
-  pg->is_dirty_ = false;
-  return true;
+  return nullptr;
 }
 
-void BufferPoolManager::FlushAllPages() {
-  std::unique_lock<std::mutex> lock(latch_);
-  for (auto &iter : page_table_) {
-    Page *pg = GetPages() + iter.second;
-    disk_manager_->WritePage(pg->GetPageId(), pg->GetData());
-    pg->is_dirty_ = false;
-  }
-}
-
-auto BufferPoolManager::DeletePage(page_id_t page_id) -> bool {
-  // init with big lock
-  std::unique_lock<std::mutex> lock(latch_);
-  auto iter = page_table_.find(page_id);
-  // not in pool
-  if (iter == page_table_.end()) {
-    if (removed_pages_index_.find(page_id) == removed_pages_index_.end() && page_id < next_page_id_) {
-      removed_pages_.push_front(page_id);
-      removed_pages_index_.insert(page_id);
+void BufferPoolManager::CollectStats(BufferPoolStats *stats) {
+  for (auto &instance : instances_) {
+    stats->Merge(instance->GetStats());
+  }
+}
+
+void BufferPoolManager::ResetStats() {
+  for (auto &instance : instances_) {
+    instance->GetStats().Reset();
+  }
+}
+
+auto BufferPoolManager::StatsToString() -> std::string {
+  BufferPoolStats total;
+  CollectStats(&total);
+  std::string result = fmt::format("pool: {}\n", total.ToString());
+  for (size_t i = 0; i < instances_.size(); ++i) {
+    result += fmt::format("shard {}: {}\n", i, instances_[i]->GetStats().ToString());
+  }
+  return result;
+}
+
+auto BufferPoolManager::AllocateExtent(size_t num_pages) -> page_id_t {
+  return free_space_map_->AllocateExtent(num_pages);
+}
+
+auto BufferPoolManager::NewPageAt(page_id_t page_id) -> Page * { return GetInstance(page_id)->NewPageAt(page_id); }
+
+auto BufferPoolManager::FetchPage(page_id_t page_id, AccessType access_type) -> Page * {
+  BufferPoolManagerInstance *instance = GetInstance(page_id);
+  if (!LatencyHistogram::ShouldSample()) {
+    return instance->FetchPage(page_id, access_type);
+  }
+  auto start = std::chrono::steady_clock::now();
+  Page *pg = instance->FetchPage(page_id, access_type);
+  instance->GetStats().fetch_latency_.Record(std::chrono::steady_clock::now() - start);
+  return pg;
+}
+
+auto BufferPoolManager::FetchPage(page_id_t page_id, std::atomic<Page *> *swip, AccessType access_type) -> Page * {
+  if (swip == nullptr) {
+    return FetchPage(page_id, access_type);
+  }
+  BufferPoolManagerInstance *instance = GetInstance(page_id);
+  bool sample = LatencyHistogram::ShouldSample();
+  auto start = sample ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+  Page *frame = swip->load(std::memory_order_relaxed);
+  // the swip may point into another instance if its slot was reused for another page
+  auto frame_index = reinterpret_cast<uintptr_t>(frame) - reinterpret_cast<uintptr_t>(instance->GetPages());
+  if (frame != nullptr && frame_index < instance->GetCapacity() * sizeof(Page) &&
+      instance->PinFrame(static_cast<frame_id_t>(frame_index / sizeof(Page)), page_id, access_type)) {
+    if (sample) {
+      instance->GetStats().fetch_latency_.Record(std::chrono::steady_clock::now() - start);
     }
-    return true;
+    return frame;
   }
-  // in pool
-  frame_id_t frame_id = iter->second;
-  Page *pg = GetPages() + frame_id;
-  if (pg->GetPinCount() != 0) {
-    return false;
+  Page *pg = instance->FetchPage(page_id, access_type);
+  if (pg != nullptr) {
+    swip->store(pg, std::memory_order_relaxed);
   }
-  // write back
-  if (pg->is_dirty_) {
-    BUSTUB_ASSERT(page_id == pg->GetPageId(), "pageid is wrong");
-    disk_manager_->WritePage(page_id, pg->GetData());
-    pg->is_dirty_ = false;
-  }
-  replacer_->Remove(frame_id);
-  pg->ResetMemory();
-  pg->page_id_ = INVALID_PAGE_ID;
-  BUSTUB_ASSERT(pg->GetPageId() == INVALID_PAGE_ID && pg->GetPinCount() == 0 && pg->is_dirty_ == false,
-                "deletepage: delete wrong");
-  page_table_.erase(page_id);
-  removed_pages_index_.insert(page_id);
-  removed_pages_.push_front(page_id);
-  free_list_.push_back(frame_id);
-  DeallocatePage(page_id);
-  return true;
+  if (sample) {
+    instance->GetStats().fetch_latency_.Record(std::chrono::steady_clock::now() - start);
+  }
+  return pg;
 }
 
-auto BufferPoolManager::AllocatePage() -> page_id_t {
-  if (!removed_pages_.empty()) {
-    page_id_t page_id = removed_pages_.back();
-    removed_pages_index_.erase(page_id);
-    removed_pages_.pop_back();
-    return page_id;
+auto BufferPoolManager::UnpinPage(page_id_t page_id, bool is_dirty, AccessType access_type) -> bool {
+  return GetInstance(page_id)->UnpinPage(page_id, is_dirty, access_type);
+}
+
+auto BufferPoolManager::FlushPage(page_id_t page_id) -> bool { return GetInstance(page_id)->FlushPage(page_id); }
+
+void BufferPoolManager::FlushAllPages() {
+  std::vector<page_id_t> page_ids;
+  for (auto &instance : instances_) {
+    instance->CollectDirtyPages(&page_ids);
+  }
+  std::sort(page_ids.begin(), page_ids.end());
+  // batches span all instances, so that adjacent pages of different instances are written together. Pages evicted
+  // in the meantime have already been written back, pages cleaned in the meantime are skipped.
+  // A batch stays pinned until written, it takes at most a quarter of the pool so that concurrent misses still find
+  // victims.
+  size_t batch_pages = std::clamp<size_t>(pool_size_ / 4, 1, WRITE_BATCH_PAGES);
+  std::vector<std::vector<page_id_t>> instance_page_ids(instances_.size());
+  for (size_t first = 0; first < page_ids.size(); first += batch_pages) {
+    size_t end = std::min(first + batch_pages, page_ids.size());
+    for (size_t i = first; i < end; ++i) {
+      instance_page_ids[static_cast<size_t>(page_ids[i]) % instances_.size()].push_back(page_ids[i]);
+    }
+    std::vector<DiskManager::PageWrite> writes;
+    for (size_t i = 0; i < instances_.size(); ++i) {
+      instances_[i]->BeginFlush(instance_page_ids[i], &writes);
+      instance_page_ids[i].clear();
+    }
+    disk_manager_->WritePages(writes);
+    for (auto &instance : instances_) {
+      instance->EndFlush(writes);
+    }
   }
-  return next_page_id_++;
+  free_space_map_->Flush();
+  disk_manager_->SyncPages();
 }
 
-auto BufferPoolManager::FetchPageBasic(page_id_t page_id) -> BasicPageGuard {
+auto BufferPoolManager::DeletePage(page_id_t page_id) -> bool { return GetInstance(page_id)->DeletePage(page_id); }
+
+auto BufferPoolManager::FetchPageBasic(page_id_t page_id, AccessType access_type) -> BasicPageGuard {
   Page *p;
-  if (nullptr == (p = FetchPage(page_id))) {
+  if (nullptr == (p = FetchPage(page_id, access_type))) {
     return {this, nullptr};
   }
   return {this, p};
 }
 
-auto BufferPoolManager::FetchPageRead(page_id_t page_id) -> ReadPageGuard {
+auto BufferPoolManager::FetchPageRead(page_id_t page_id, AccessType access_type) -> ReadPageGuard {
   Page *p;
-  if (nullptr == (p = FetchPage(page_id))) {
+  if (nullptr == (p = FetchPage(page_id, access_type))) {
     return {this, nullptr};
   }
   p->RLatch();
   return {this, p};
 }
 
-auto BufferPoolManager::FetchPageWrite(page_id_t page_id) -> WritePageGuard {
+auto BufferPoolManager::FetchPageWrite(page_id_t page_id, AccessType access_type) -> WritePageGuard {
+  if (disk_manager_->IsReadOnly()) {
+    return {this, nullptr};
+  }
   Page *p;
-  if (nullptr == (p = FetchPage(page_id))) {
+  if (nullptr == (p = FetchPage(page_id, access_type))) {
     return {this, nullptr};
   }
   p->WLatch();
   return {this, p};
 }
 
+auto BufferPoolManager::FetchPageOptimistic(page_id_t page_id, AccessType access_type) -> OptimisticReadGuard {
+  return {this, FetchPage(page_id, access_type)};
+}
+
+auto BufferPoolManager::FetchPageWrite(page_id_t page_id, std::atomic<Page *> *swip, AccessType access_type)
+    -> WritePageGuard {
+  if (disk_manager_->IsReadOnly()) {
+    return {this, nullptr};
+  }
+  Page *p;
+  if (nullptr == (p = FetchPage(page_id, swip, access_type))) {
+    return {this, nullptr};
+  }
+  p->WLatch();
+  return {this, p};
+}
+
+auto BufferPoolManager::FetchPageOptimistic(page_id_t page_id, std::atomic<Page *> *swip, AccessType access_type)
+    -> OptimisticReadGuard {
+  return {this, FetchPage(page_id, swip, access_type)};
+}
+
 auto BufferPoolManager::NewPageGuarded(page_id_t *page_id) -> BasicPageGuard {
   Page *p;
   if (nullptr == (p = NewPage(page_id))) {
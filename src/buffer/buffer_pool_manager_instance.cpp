@@ -0,0 +1,792 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// buffer_pool_manager_instance.cpp
+//
+// Identification: src/buffer/buffer_pool_manager_instance.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/buffer_pool_manager_instance.h"
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <new>
+#include <thread>  // NOLINT
+
+#include "buffer/arc_replacer.h"
+#include "buffer/clock_replacer.h"
+#include "buffer/lru_k_replacer.h"
+#include "buffer/lru_replacer.h"
+#include "common/exception.h"
+#include "common/logger.h"
+#include "common/macros.h"
+
+namespace bustub {
+
+namespace {
+
+/** @return a number identifying the calling thread, used to pick its access stripe */
+auto ThreadHash() -> size_t {
+  static thread_local size_t hash = std::hash<std::thread::id>{}(std::this_thread::get_id());
+  return hash;
+}
+
+}  // namespace
+
+BufferPoolManagerInstance::BufferPoolManagerInstance(size_t pool_size, size_t capacity, Page *pages,
+                                                     size_t num_instances, size_t instance_index,
+                                                     DiskManager *disk_manager, FreeSpaceMap *free_space_map,
+                                                     size_t replacer_k, LogManager *log_manager,
+                                                     ReplacerType replacer_type)
+    : pool_size_(pool_size),
+      capacity_(capacity),
+      num_instances_(num_instances),
+      instance_index_(instance_index),
+      pages_(pages),
+      disk_manager_(disk_manager),
+      free_space_map_(free_space_map),
+      log_manager_(log_manager),
+      page_table_(capacity),
+      frame_meta_(capacity),
+      access_stripes_(ACCESS_STRIPES) {
+  BUSTUB_ASSERT(num_instances > 0 && instance_index < num_instances, "bpm instance: invalid instance index");
+  BUSTUB_ASSERT(pool_size > 0 && pool_size <= capacity, "bpm instance: invalid pool size");
+  switch (replacer_type) {
+    case ReplacerType::LRUK:
+      replacer_ = std::make_unique<LRUKReplacer>(capacity, replacer_k);
+      break;
+    case ReplacerType::LRU:
+      replacer_ = std::make_unique<LRUReplacer>(capacity);
+      break;
+    case ReplacerType::CLOCK:
+      replacer_ = std::make_unique<ClockReplacer>(capacity);
+      break;
+    case ReplacerType::ARC:
+      replacer_ = std::make_unique<ArcReplacer>(capacity);
+      break;
+  }
+  for (auto &stripe : access_stripes_) {
+    stripe.records_.reserve(ACCESS_BATCH);
+    stripe.page_ids_.reserve(ACCESS_BATCH);
+  }
+  drained_accesses_.reserve(ACCESS_STRIPES * ACCESS_BATCH);
+  // Initially, every page is in the free list.
+  for (size_t i = 0; i < pool_size; ++i) {
+    free_list_.emplace_back(static_cast<int>(i));
+  }
+}
+
+BufferPoolManagerInstance::~BufferPoolManagerInstance() {
+  std::unique_lock<std::mutex> lock(latch_);
+  reads_done_.wait(lock, [this] { return pending_reads_ == 0; });
+}
+
+auto BufferPoolManagerInstance::AcquireLatch() -> std::unique_lock<std::mutex> {
+  std::unique_lock<std::mutex> lock(latch_, std::try_to_lock);
+  if (!lock.owns_lock()) {
+    auto start = std::chrono::steady_clock::now();
+    lock.lock();
+    auto waited = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    stats_.latch_waits_.fetch_add(1, std::memory_order_relaxed);
+    stats_.latch_wait_ns_.fetch_add(waited.count(), std::memory_order_relaxed);
+  }
+  return lock;
+}
+
+auto BufferPoolManagerInstance::GetUsablePage(frame_id_t *frame_id, page_id_t page_id, AccessType access_type,
+                                              std::unique_lock<std::mutex> &lock) -> bool {
+  if (replacer_ == nullptr || disk_manager_ == nullptr) {
+    return false;
+  }
+  // get pages from the free list
+  Page *pg = nullptr;
+  if (!free_list_.empty()) {
+    // get new page_id, record frame id in lru_replacer
+    *frame_id = free_list_.front();
+    free_list_.pop_front();
+    pg = GetPages() + *frame_id;
+    frame_meta_[*frame_id].evicted_page_id_ = INVALID_PAGE_ID;
+  } else {  // get pages by replacer
+    // a prefetched page nobody asked for yet must not stand in the way of a page somebody needs now
+    while (!EvictFrame(frame_id)) {
+      if (!ReleaseOldestPrefetched()) {
+        return false;
+      }
+    }
+    pg = GetPages() + *frame_id;
+    page_table_.Erase(pg->GetPageId());
+    // the dirty victim is written back by the caller once the latch is released, until then fetchers of the old
+    // page have to wait for this frame
+    frame_meta_[*frame_id].evicted_page_id_ = pg->IsDirty() ? pg->GetPageId() : INVALID_PAGE_ID;
+    if (pg->IsDirty()) {
+      write_back_table_[pg->GetPageId()] = *frame_id;
+      dirty_count_--;
+    }
+  }
+  FrameMeta &meta = frame_meta_[*frame_id];
+  meta.state_ = FrameState::LOADING;
+
+  pg->page_id_ = page_id;
+  // a lock-free hit that lost the race for the frame may still hold a pin on it, it drops that pin by itself
+  pg->pin_count_++;
+  pg->is_dirty_ = false;
+  meta.evicting_ = false;
+  page_table_.Insert(page_id, *frame_id);
+  replacer_->SetPage(*frame_id, page_id);
+  replacer_->RecordAccess(*frame_id, access_type);
+  replacer_->SetEvictable(*frame_id, false);
+  return true;
+}
+
+auto BufferPoolManagerInstance::ClaimFrame(frame_id_t frame_id) -> bool {
+  frame_meta_[frame_id].evicting_ = true;
+  // a hit pins before it checks evicting_, so either it sees the flag or the pin is seen here
+  if (GetPages()[frame_id].GetPinCount() == 0) {
+    return true;
+  }
+  frame_meta_[frame_id].evicting_ = false;
+  return false;
+}
+
+auto BufferPoolManagerInstance::ClaimResidentFrame(frame_id_t frame_id) -> bool {
+  if (ClaimFrame(frame_id)) {
+    return true;
+  }
+  UpdateEvictable(frame_id);
+  return false;
+}
+
+void BufferPoolManagerInstance::UpdateEvictable(frame_id_t frame_id) {
+  replacer_->UpdateEvictable(frame_id, [this](frame_id_t frame) {
+    // a claimed frame is about to be removed from the replacer, which only takes evictable frames
+    const FrameMeta &meta = frame_meta_[frame];
+    return meta.evicting_ || (GetPages()[frame].GetPinCount() == 0 && !meta.prefetched_);
+  });
+}
+
+void BufferPoolManagerInstance::PinResident(frame_id_t frame_id) {
+  if (GetPages()[frame_id].pin_count_++ == 0) {
+    UpdateEvictable(frame_id);
+  }
+}
+
+void BufferPoolManagerInstance::UnpinResident(frame_id_t frame_id) {
+  if (--GetPages()[frame_id].pin_count_ == 0) {
+    UpdateEvictable(frame_id);
+  }
+}
+
+void BufferPoolManagerInstance::BufferAccess(frame_id_t frame_id, page_id_t page_id, AccessType access_type) {
+  AccessStripe &stripe = access_stripes_[ThreadHash() % ACCESS_STRIPES];
+  std::scoped_lock lock(stripe.latch_);
+  stripe.records_.push_back({frame_id, access_type, replacer_->Now()});
+  stripe.page_ids_.push_back(page_id);
+  if (stripe.records_.size() >= ACCESS_BATCH) {
+    FlushAccesses(&stripe);
+  }
+}
+
+void BufferPoolManagerInstance::DropStaleAccesses(AccessStripe *stripe) {
+  size_t kept = 0;
+  for (size_t i = 0; i < stripe->records_.size(); ++i) {
+    if (GetPages()[stripe->records_[i].frame_id_].GetPageId() == stripe->page_ids_[i]) {
+      stripe->records_[kept++] = stripe->records_[i];
+    }
+  }
+  stripe->records_.resize(kept);
+  stripe->page_ids_.clear();
+}
+
+void BufferPoolManagerInstance::FlushAccesses(AccessStripe *stripe) {
+  // without the latch a frame may change its page after the check, the replacer drops the accesses if it was evicted
+  DropStaleAccesses(stripe);
+  if (!stripe->records_.empty()) {
+    replacer_->RecordAccesses(stripe->records_);
+    stripe->records_.clear();
+  }
+}
+
+auto BufferPoolManagerInstance::EvictFrame(frame_id_t *frame_id) -> bool {
+  // rank the frames by every access so far, the stripes are ordered within but not among each other
+  for (auto &stripe : access_stripes_) {
+    std::scoped_lock stripe_lock(stripe.latch_);
+    DropStaleAccesses(&stripe);
+    drained_accesses_.insert(drained_accesses_.end(), stripe.records_.begin(), stripe.records_.end());
+    stripe.records_.clear();
+  }
+  if (!drained_accesses_.empty()) {
+    std::sort(drained_accesses_.begin(), drained_accesses_.end(),
+              [](const auto &a, const auto &b) { return a.timestamp_ < b.timestamp_; });
+    replacer_->RecordAccesses(drained_accesses_);
+    drained_accesses_.clear();
+  }
+  bool evicted = replacer_->EvictIf(frame_id, [this](frame_id_t candidate) {
+    // a retired frame is taken away from its page by Resize, not handed out again; a frame pinned since its last
+    // unpin is made non-evictable right after the pin
+    if (static_cast<size_t>(candidate) >= pool_size_ || GetPages()[candidate].GetPinCount() != 0) {
+      return false;
+    }
+    return ClaimFrame(candidate);
+  });
+  if (evicted) {
+    stats_.evictions_.fetch_add(1, std::memory_order_relaxed);
+  }
+  return evicted;
+}
+
+auto BufferPoolManagerInstance::LoadFrame(frame_id_t frame_id, bool read_from_disk,
+                                          std::unique_lock<std::mutex> &lock) -> bool {
+  Page *pg = GetPages() + frame_id;
+  FrameMeta &meta = frame_meta_[frame_id];
+  page_id_t evicted_page_id = meta.evicted_page_id_;
+  lock.unlock();
+
+  // the frame is pinned and LOADING, so nobody else touches its data while the latch is released
+  if (evicted_page_id != INVALID_PAGE_ID) {
+    disk_manager_->WritePage(evicted_page_id, pg->GetData());
+    stats_.write_backs_.fetch_add(1, std::memory_order_relaxed);
+  }
+  pg->ResetMemory();
+  bool read_ok = true;
+  if (read_from_disk) {
+    auto start = std::chrono::steady_clock::now();
+    // a page the disk manager keeps in memory is served from there, without a copy
+    if (const char *mapped = disk_manager_->GetMappedPage(pg->GetPageId()); mapped != nullptr) {
+      pg->MapData(mapped);
+    } else {
+      read_ok = disk_manager_->ReadPage(pg->GetPageId(), pg->GetData());
+    }
+    stats_.read_latency_.Record(std::chrono::steady_clock::now() - start);
+  }
+
+  lock.lock();
+  if (evicted_page_id != INVALID_PAGE_ID) {
+    write_back_table_.erase(evicted_page_id);
+    meta.evicted_page_id_ = INVALID_PAGE_ID;
+  }
+  if (!read_ok) {
+    FailLoad(frame_id);
+    ReleaseFailedFrame(frame_id);
+    return false;
+  }
+  meta.state_ = FrameState::READY;
+  meta.io_done_.notify_all();
+  return true;
+}
+
+void BufferPoolManagerInstance::FailLoad(frame_id_t frame_id) {
+  Page *pg = GetPages() + frame_id;
+  FrameMeta &meta = frame_meta_[frame_id];
+  // a corrupt page must not be handed out, later fetches read it again
+  page_table_.Erase(pg->GetPageId());
+  pg->page_id_ = INVALID_PAGE_ID;
+  pg->ResetMemory();
+  meta.state_ = FrameState::READY;
+  meta.io_done_.notify_all();
+}
+
+void BufferPoolManagerInstance::ReleaseFailedFrame(frame_id_t frame_id) {
+  UnpinResident(frame_id);
+  if (GetPages()[frame_id].GetPinCount() == 0 && ClaimResidentFrame(frame_id)) {
+    DropFrame(frame_id);
+  }
+}
+
+auto BufferPoolManagerInstance::NewPage(page_id_t *page_id) -> Page * {
+  if (disk_manager_ != nullptr && disk_manager_->IsReadOnly()) {
+    return nullptr;
+  }
+  auto lock = AcquireLatch();
+  page_id_t new_page_id = AllocatePage();
+  Page *pg = NewPageLocked(new_page_id, lock);
+  if (pg == nullptr) {
+    // hand the id back so that it is reused by the next allocation
+    DeallocatePage(new_page_id);
+    return nullptr;
+  }
+  *page_id = new_page_id;
+  return pg;
+}
+
+auto BufferPoolManagerInstance::NewPageAt(page_id_t page_id) -> Page * {
+  BUSTUB_ASSERT(static_cast<size_t>(page_id) % num_instances_ == instance_index_, "newpage: page of another instance");
+  BUSTUB_ASSERT(free_space_map_->IsAllocated(page_id), "newpage: page id not allocated");
+  if (disk_manager_ != nullptr && disk_manager_->IsReadOnly()) {
+    return nullptr;
+  }
+  auto lock = AcquireLatch();
+  frame_id_t frame_id = -1;
+  // a deleted page that was fetched again still lives in a frame under its old id, its content is garbage
+  if (page_table_.Find(page_id, &frame_id)) {
+    if (!ClaimResidentFrame(frame_id)) {
+      return nullptr;
+    }
+    DropFrame(frame_id);
+  }
+  return NewPageLocked(page_id, lock);
+}
+
+auto BufferPoolManagerInstance::NewPageLocked(page_id_t page_id, std::unique_lock<std::mutex> &lock) -> Page * {
+  frame_id_t frame_id = 0;
+  if (!GetUsablePage(&frame_id, page_id, AccessType::Unknown, lock)) {
+    return nullptr;
+  }
+  Page *pg = GetPages() + frame_id;
+  LoadFrame(frame_id, false, lock);
+  BUSTUB_ASSERT(pg->pin_count_ >= 1 && pg->page_id_ != INVALID_PAGE_ID, "newpage: error new page");
+  return pg;
+}
+
+auto BufferPoolManagerInstance::PinFrame(frame_id_t frame_id, page_id_t page_id, AccessType access_type) -> bool {
+  // pin first, then check that the frame still holds the page and nobody is about to take it away
+  Page *pg = GetPages() + frame_id;
+  FrameMeta &meta = frame_meta_[frame_id];
+  int pin_count = pg->pin_count_++;
+  if (!meta.evicting_ && pg->GetPageId() == page_id && meta.state_ == FrameState::READY && !meta.prefetched_) {
+    if (pin_count == 0) {
+      UpdateEvictable(frame_id);
+    }
+    BufferAccess(frame_id, page_id, access_type);
+    stats_.hits_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+  // a concurrent pin may have seen ours and made the frame non-evictable
+  UnpinResident(frame_id);
+  return false;
+}
+
+auto BufferPoolManagerInstance::FetchPage(page_id_t page_id, AccessType access_type) -> Page * {
+  frame_id_t frame_id = -1;
+  if (page_table_.Find(page_id, &frame_id) && PinFrame(frame_id, page_id, access_type)) {
+    return GetPages() + frame_id;
+  }
+
+  auto lock = AcquireLatch();
+  while (true) {
+    // can get pages directly from pool
+    if (page_table_.Find(page_id, &frame_id)) {
+      Page *pg = GetPages() + frame_id;
+      FrameMeta &meta = frame_meta_[frame_id];
+      if (meta.prefetched_) {
+        meta.prefetched_ = false;
+        num_prefetched_--;
+      }
+      PinResident(frame_id);
+      replacer_->RecordAccess(frame_id, access_type);
+      // another thread is still bringing the page in, wait for this frame only
+      if (meta.state_ != FrameState::READY) {
+        stats_.pin_waits_.fetch_add(1, std::memory_order_relaxed);
+        meta.io_done_.wait(lock, [&meta] { return meta.state_ == FrameState::READY; });
+        if (pg->GetPageId() != page_id) {
+          // the read failed
+          ReleaseFailedFrame(frame_id);
+          return nullptr;
+        }
+      }
+      stats_.hits_.fetch_add(1, std::memory_order_relaxed);
+      return pg;
+    }
+    // the page is being written back from a frame that was just evicted, read it only once that is done
+    auto write_back_iter = write_back_table_.find(page_id);
+    if (write_back_iter == write_back_table_.end()) {
+      break;
+    }
+    FrameMeta &meta = frame_meta_[write_back_iter->second];
+    stats_.pin_waits_.fetch_add(1, std::memory_order_relaxed);
+    meta.io_done_.wait(lock, [&meta, page_id] { return meta.evicted_page_id_ != page_id; });
+  }
+  // need get it from other place(disk)
+  frame_id = -1;
+  if (!GetUsablePage(&frame_id, page_id, access_type, lock)) {
+    return nullptr;
+  }
+  BUSTUB_ASSERT(frame_id != -1, "fetchpage: wrong frame_id");
+  stats_.misses_.fetch_add(1, std::memory_order_relaxed);
+  Page *pg = GetPages() + frame_id;
+  if (!LoadFrame(frame_id, true, lock)) {
+    return nullptr;
+  }
+  BUSTUB_ASSERT(pg->pin_count_ >= 1 && pg->page_id_ == page_id, "fetchpage: error get page");
+  return pg;
+}
+
+auto BufferPoolManagerInstance::UnpinPage(page_id_t page_id, bool is_dirty,
+                                          [[maybe_unused]] AccessType access_type) -> bool {
+  // the caller's pin keeps the page in its frame, so no latch is needed
+  frame_id_t frame_id = -1;
+  if (!page_table_.Find(page_id, &frame_id)) {
+    return false;
+  }
+  Page *pg = GetPages() + frame_id;
+  int pin_count = pg->GetPinCount();
+  if (pg->GetPageId() != page_id || pin_count <= 0) {
+    return false;
+  }
+  // a page of a read-only disk manager can't be written back, the pin is dropped without dirtying it
+  bool rejected = is_dirty && disk_manager_->IsReadOnly();
+  // mark the page dirty before dropping the pin, so that an evictor never sees it unpinned and clean
+  if (is_dirty && !rejected && !pg->is_dirty_.exchange(true)) {
+    dirty_count_++;
+  }
+  while (!pg->pin_count_.compare_exchange_weak(pin_count, pin_count - 1)) {
+    if (pin_count <= 0) {
+      return false;
+    }
+  }
+  if (pin_count == 1) {
+    UpdateEvictable(frame_id);
+  }
+  return !rejected;
+}
+
+auto BufferPoolManagerInstance::PrefetchPage(page_id_t page_id) -> bool {
+  auto lock = AcquireLatch();
+  if (!free_space_map_->IsAllocated(page_id)) {
+    return false;
+  }
+  frame_id_t frame_id = -1;
+  // resident, being loaded, or still being written back after an eviction: a fetch will find it soon enough
+  if (page_table_.Find(page_id, &frame_id) || write_back_table_.count(page_id) > 0) {
+    return true;
+  }
+  if (!GetUsablePage(&frame_id, page_id, AccessType::Scan, lock)) {
+    return false;
+  }
+  Page *pg = GetPages() + frame_id;
+  page_id_t evicted_page_id = frame_meta_[frame_id].evicted_page_id_;
+  pending_reads_++;
+  lock.unlock();
+
+  // the frame is pinned and LOADING until FinishPrefetch, so nobody else touches its data
+  if (evicted_page_id != INVALID_PAGE_ID) {
+    disk_manager_->WritePage(evicted_page_id, pg->GetData());
+    stats_.write_backs_.fetch_add(1, std::memory_order_relaxed);
+  }
+  pg->ResetMemory();
+  auto start = std::chrono::steady_clock::now();
+  if (const char *mapped = disk_manager_->GetMappedPage(page_id); mapped != nullptr) {
+    pg->MapData(mapped);
+    FinishPrefetch(frame_id, start, true);
+    return true;
+  }
+  disk_manager_->ReadPageAsync(page_id, pg->GetData(), [this, frame_id, start](bool read_ok) {
+    FinishPrefetch(frame_id, start, read_ok);
+  });
+  return true;
+}
+
+void BufferPoolManagerInstance::FinishPrefetch(frame_id_t frame_id, std::chrono::steady_clock::time_point start,
+                                               bool read_ok) {
+  stats_.read_latency_.Record(std::chrono::steady_clock::now() - start);
+  auto lock = AcquireLatch();
+  Page *pg = GetPages() + frame_id;
+  FrameMeta &meta = frame_meta_[frame_id];
+  if (meta.evicted_page_id_ != INVALID_PAGE_ID) {
+    write_back_table_.erase(meta.evicted_page_id_);
+    meta.evicted_page_id_ = INVALID_PAGE_ID;
+  }
+  if (!read_ok) {
+    FailLoad(frame_id);
+    ReleaseFailedFrame(frame_id);
+    if (--pending_reads_ == 0) {
+      reads_done_.notify_all();
+    }
+    return;
+  }
+  meta.state_ = FrameState::READY;
+  meta.io_done_.notify_all();
+  // flag the frame before dropping the pin, so that lock-free hits from now on take the latch and consume it
+  meta.prefetched_ = true;
+  UnpinResident(frame_id);
+  if (0 == pg->GetPinCount()) {
+    num_prefetched_++;
+    prefetched_frames_.emplace_back(frame_id, pg->GetPageId());
+    while (num_prefetched_ > pool_size_ / 2 && ReleaseOldestPrefetched()) {
+    }
+  } else {
+    // a fetcher that came along during the load has consumed the page already
+    meta.prefetched_ = false;
+    UpdateEvictable(frame_id);
+  }
+  if (--pending_reads_ == 0) {
+    reads_done_.notify_all();
+  }
+}
+
+auto BufferPoolManagerInstance::ReleaseOldestPrefetched() -> bool {
+  while (!prefetched_frames_.empty()) {
+    auto [frame_id, page_id] = prefetched_frames_.front();
+    prefetched_frames_.pop_front();
+    FrameMeta &meta = frame_meta_[frame_id];
+    if (!meta.prefetched_ || GetPages()[frame_id].GetPageId() != page_id) {
+      continue;
+    }
+    meta.prefetched_ = false;
+    num_prefetched_--;
+    UpdateEvictable(frame_id);
+    return true;
+  }
+  return false;
+}
+
+auto BufferPoolManagerInstance::FlushPageLocked(page_id_t page_id, bool only_dirty, bool latch_page,
+                                                std::unique_lock<std::mutex> &lock) -> bool {
+  frame_id_t frame_id = -1;
+  if (!page_table_.Find(page_id, &frame_id)) {
+    return false;
+  }
+  Page *pg = GetPages() + frame_id;
+  // pin the frame so that it can't be evicted while the latch is released for the write
+  PinResident(frame_id);
+  FrameMeta &meta = frame_meta_[frame_id];
+  meta.io_done_.wait(lock, [&meta] { return meta.state_ == FrameState::READY; });
+  if (pg->GetPageId() != page_id) {
+    // the read failed
+    ReleaseFailedFrame(frame_id);
+    return false;
+  }
+  bool need_write = !only_dirty || pg->IsDirty();
+  if (pg->IsDirty()) {
+    // a writer that still holds the page sets the flag again when it unpins
+    pg->is_dirty_ = false;
+    dirty_count_--;
+  }
+  if (need_write) {
+    lock.unlock();
+    if (latch_page) {
+      pg->RLatch();
+    }
+    disk_manager_->WritePage(page_id, pg->GetData());
+    stats_.flushes_.fetch_add(1, std::memory_order_relaxed);
+    if (latch_page) {
+      pg->RUnlatch();
+    }
+    lock.lock();
+  }
+  UnpinResident(frame_id);
+  return true;
+}
+
+auto BufferPoolManagerInstance::FlushPage(page_id_t page_id, bool only_dirty) -> bool {
+  auto lock = AcquireLatch();
+  return FlushPageLocked(page_id, only_dirty, false, lock);
+}
+
+void BufferPoolManagerInstance::FlushAllPages() {
+  std::vector<page_id_t> page_ids;
+  CollectDirtyPages(&page_ids);
+  std::sort(page_ids.begin(), page_ids.end());
+  // pages evicted in the meantime have already been written back, pages cleaned in the meantime are skipped
+  // a batch stays pinned until written, it takes at most a quarter of the pool so that concurrent misses still find
+  // victims
+  size_t batch_pages = std::clamp<size_t>(pool_size_ / 4, 1, WRITE_BATCH_PAGES);
+  for (size_t first = 0; first < page_ids.size(); first += batch_pages) {
+    size_t end = std::min(first + batch_pages, page_ids.size());
+    std::vector<page_id_t> batch(page_ids.begin() + first, page_ids.begin() + end);
+    std::vector<DiskManager::PageWrite> writes;
+    BeginFlush(batch, &writes);
+    disk_manager_->WritePages(writes);
+    EndFlush(writes);
+  }
+}
+
+void BufferPoolManagerInstance::BeginFlush(const std::vector<page_id_t> &page_ids,
+                                           std::vector<DiskManager::PageWrite> *writes) {
+  std::vector<frame_id_t> frame_ids;
+  auto lock = AcquireLatch();
+  PinDirtyPages(page_ids, writes, &frame_ids);
+}
+
+void BufferPoolManagerInstance::EndFlush(const std::vector<DiskManager::PageWrite> &writes) {
+  // the pins keep the pages in their frames, so no latch is needed
+  for (const auto &write : writes) {
+    frame_id_t frame_id = -1;
+    if (static_cast<size_t>(write.first) % num_instances_ == instance_index_ &&
+        page_table_.Find(write.first, &frame_id)) {
+      UnpinResident(frame_id);
+    }
+  }
+}
+
+void BufferPoolManagerInstance::PinDirtyPages(const std::vector<page_id_t> &page_ids,
+                                              std::vector<DiskManager::PageWrite> *writes,
+                                              std::vector<frame_id_t> *frame_ids) {
+  for (page_id_t page_id : page_ids) {
+    frame_id_t frame_id = -1;
+    if (!page_table_.Find(page_id, &frame_id)) {
+      continue;
+    }
+    // a dirty page is READY, loading clears the flag
+    Page *pg = GetPages() + frame_id;
+    if (!pg->IsDirty()) {
+      continue;
+    }
+    PinResident(frame_id);
+    pg->is_dirty_ = false;
+    dirty_count_--;
+    stats_.flushes_.fetch_add(1, std::memory_order_relaxed);
+    writes->emplace_back(page_id, pg->GetData());
+    frame_ids->push_back(frame_id);
+  }
+}
+
+void BufferPoolManagerInstance::CollectDirtyPages(std::vector<page_id_t> *page_ids) {
+  auto lock = AcquireLatch();
+  page_table_.ForEach([this, page_ids](page_id_t page_id, frame_id_t frame_id) {
+    if (GetPages()[frame_id].IsDirty()) {
+      page_ids->push_back(page_id);
+    }
+  });
+}
+
+auto BufferPoolManagerInstance::GetDirtyCount() -> size_t { return dirty_count_; }
+
+auto BufferPoolManagerInstance::CleanDirtyPages(size_t target_dirty) -> size_t {
+  auto lock = AcquireLatch();
+  if (dirty_count_ <= target_dirty) {
+    return 0;
+  }
+  // pinned pages are being worked on and will likely be dirtied again, leave them alone
+  std::vector<page_id_t> page_ids;
+  page_table_.ForEach([this, &page_ids](page_id_t page_id, frame_id_t frame_id) {
+    Page *pg = GetPages() + frame_id;
+    if (pg->IsDirty() && pg->GetPinCount() == 0) {
+      page_ids.push_back(page_id);
+    }
+  });
+  std::sort(page_ids.begin(), page_ids.end());
+  std::unique_ptr<char, void (*)(char *)> buffer(
+      static_cast<char *>(::operator new[](WRITE_BATCH_PAGES * BUSTUB_PAGE_SIZE, std::align_val_t{BUSTUB_PAGE_SIZE})),
+      [](char *data) { ::operator delete[](data, std::align_val_t{BUSTUB_PAGE_SIZE}); });
+  size_t batch_pages = std::clamp<size_t>(pool_size_ / 4, 1, WRITE_BATCH_PAGES);
+  size_t written = 0;
+  size_t first = 0;
+  while (first < page_ids.size() && dirty_count_ > target_dirty) {
+    size_t count =
+        std::min({page_ids.size() - first, static_cast<size_t>(dirty_count_ - target_dirty), batch_pages});
+    std::vector<page_id_t> batch(page_ids.begin() + first, page_ids.begin() + first + count);
+    first += count;
+    std::vector<DiskManager::PageWrite> writes;
+    std::vector<frame_id_t> frame_ids;
+    PinDirtyPages(batch, &writes, &frame_ids);
+    lock.unlock();
+    // one page latch at a time, a thread latching several pages must not wait for us while we wait for it
+    for (size_t i = 0; i < writes.size(); ++i) {
+      Page *pg = GetPages() + frame_ids[i];
+      char *copy = buffer.get() + i * BUSTUB_PAGE_SIZE;
+      pg->RLatch();
+      memcpy(copy, pg->GetData(), BUSTUB_PAGE_SIZE);
+      pg->RUnlatch();
+      writes[i].second = copy;
+    }
+    disk_manager_->WritePages(writes);
+    lock.lock();
+    for (frame_id_t frame_id : frame_ids) {
+      UnpinResident(frame_id);
+    }
+    written += writes.size();
+  }
+  return written;
+}
+
+auto BufferPoolManagerInstance::DeletePage(page_id_t page_id) -> bool {
+  // init with big lock
+  auto lock = AcquireLatch();
+  frame_id_t frame_id = -1;
+  // not in pool
+  if (!page_table_.Find(page_id, &frame_id)) {
+    if (static_cast<size_t>(page_id) % num_instances_ == instance_index_) {
+      DeallocatePage(page_id);
+    }
+    return true;
+  }
+  // in pool
+  if (!ClaimResidentFrame(frame_id)) {
+    return false;
+  }
+  DropFrame(frame_id);
+  DeallocatePage(page_id);
+  return true;
+}
+
+void BufferPoolManagerInstance::DropFrame(frame_id_t frame_id) {
+  Page *pg = GetPages() + frame_id;
+  page_id_t page_id = pg->GetPageId();
+  if (frame_meta_[frame_id].prefetched_) {
+    frame_meta_[frame_id].prefetched_ = false;
+    num_prefetched_--;
+  }
+  // write back
+  if (pg->is_dirty_) {
+    disk_manager_->WritePage(page_id, pg->GetData());
+    stats_.flushes_.fetch_add(1, std::memory_order_relaxed);
+    pg->is_dirty_ = false;
+    dirty_count_--;
+  }
+  // the claim keeps concurrent updates from making the frame non-evictable again
+  replacer_->SetEvictable(frame_id, true);
+  replacer_->Remove(frame_id);
+  pg->ResetMemory();
+  pg->page_id_ = INVALID_PAGE_ID;
+  BUSTUB_ASSERT(pg->GetPageId() == INVALID_PAGE_ID && pg->is_dirty_ == false, "deletepage: delete wrong");
+  page_table_.Erase(page_id);
+  frame_meta_[frame_id].evicting_ = false;
+  if (static_cast<size_t>(frame_id) < pool_size_) {
+    free_list_.push_back(frame_id);
+  }
+}
+
+void BufferPoolManagerInstance::Resize(size_t pool_size) {
+  BUSTUB_ASSERT(pool_size > 0 && pool_size <= capacity_, "bpm instance: invalid pool size");
+  auto lock = AcquireLatch();
+  size_t old_pool_size = pool_size_;
+  pool_size_ = pool_size;
+  if (pool_size >= old_pool_size) {
+    for (size_t i = old_pool_size; i < pool_size; ++i) {
+      free_list_.emplace_back(static_cast<frame_id_t>(i));
+    }
+    return;
+  }
+  // from now on the retired frames are neither handed out by the free list nor picked by eviction
+  free_list_.remove_if([pool_size](frame_id_t frame_id) { return static_cast<size_t>(frame_id) >= pool_size; });
+  for (size_t i = pool_size; i < old_pool_size; ++i) {
+    auto frame_id = static_cast<frame_id_t>(i);
+    Page *pg = GetPages() + frame_id;
+    while (pg->GetPageId() != INVALID_PAGE_ID) {
+      page_id_t page_id = pg->GetPageId();
+      // write back with the latch released, so that only a page dirtied again meanwhile is written under it
+      if (pg->IsDirty()) {
+        FlushPageLocked(page_id, true, true, lock);
+      }
+      if (pg->GetPageId() == page_id && ClaimResidentFrame(frame_id)) {
+        DropFrame(frame_id);
+        break;
+      }
+      // pinned or still loading, let the holder finish
+      lock.unlock();
+      std::this_thread::yield();
+      lock.lock();
+    }
+  }
+}
+
+auto BufferPoolManagerInstance::AllocatePage() -> page_id_t {
+  while (true) {
+    page_id_t page_id = free_space_map_->AllocatePage(instance_index_);
+    // a deleted page that was fetched again lives in a frame under its old id, don't hand that id out twice. The id
+    // stays allocated until the page is deleted again.
+    frame_id_t frame_id = -1;
+    if (!page_table_.Find(page_id, &frame_id)) {
+      return page_id;
+    }
+  }
+}
+
+}  // namespace bustub
@@ -0,0 +1,122 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// buffer_pool_stats.cpp
+//
+// Identification: src/buffer/buffer_pool_stats.cpp
+//
+// Copyright (c) 2015-2023, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/buffer_pool_stats.h"
+
+#include <algorithm>
+
+#include "fmt/format.h"
+
+namespace bustub {
+
+void LatencyHistogram::Record(std::chrono::nanoseconds latency) {
+  auto ns = static_cast<uint64_t>(std::max<int64_t>(latency.count(), 0));
+  size_t bucket = 0;
+  while (bucket + 1 < NUM_BUCKETS && (ns >> bucket) != 0) {
+    bucket++;
+  }
+  buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+  total_ns_.fetch_add(ns, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram &other) {
+  for (size_t i = 0; i < NUM_BUCKETS; ++i) {
+    buckets_[i].fetch_add(other.buckets_[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+  }
+  count_.fetch_add(other.count_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+  total_ns_.fetch_add(other.total_ns_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+void LatencyHistogram::Reset() {
+  for (auto &bucket : buckets_) {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+  count_.store(0, std::memory_order_relaxed);
+  total_ns_.store(0, std::memory_order_relaxed);
+}
+
+auto LatencyHistogram::GetMean() const -> uint64_t {
+  uint64_t count = GetCount();
+  return count == 0 ? 0 : total_ns_.load(std::memory_order_relaxed) / count;
+}
+
+auto LatencyHistogram::GetPercentile(double fraction) const -> uint64_t {
+  uint64_t total = 0;
+  for (const auto &bucket : buckets_) {
+    total += bucket.load(std::memory_order_relaxed);
+  }
+  if (total == 0) {
+    return 0;
+  }
+  auto rank = static_cast<uint64_t>(fraction * static_cast<double>(total));
+  uint64_t seen = 0;
+  for (size_t i = 0; i < NUM_BUCKETS; ++i) {
+    seen += buckets_[i].load(std::memory_order_relaxed);
+    if (seen > rank || seen == total) {
+      return i == 0 ? 0 : (static_cast<uint64_t>(1) << i) - 1;
+    }
+  }
+  return 0;
+}
+
+auto LatencyHistogram::ToString() const -> std::string {
+  return fmt::format("count={} mean={}ns p50={}ns p99={}ns max={}ns", GetCount(), GetMean(), GetPercentile(0.5),
+                     GetPercentile(0.99), GetPercentile(1.0));
+}
+
+auto LatencyHistogram::ShouldSample() -> bool {
+  if (BUFFER_POOL_STATS_SAMPLE_RATE == 0) {
+    return false;
+  }
+  thread_local uint32_t calls = 0;
+  return ++calls % BUFFER_POOL_STATS_SAMPLE_RATE == 0;
+}
+
+void BufferPoolStats::Merge(const BufferPoolStats &other) {
+  hits_ += other.hits_.load(std::memory_order_relaxed);
+  misses_ += other.misses_.load(std::memory_order_relaxed);
+  evictions_ += other.evictions_.load(std::memory_order_relaxed);
+  write_backs_ += other.write_backs_.load(std::memory_order_relaxed);
+  flushes_ += other.flushes_.load(std::memory_order_relaxed);
+  pin_waits_ += other.pin_waits_.load(std::memory_order_relaxed);
+  latch_waits_ += other.latch_waits_.load(std::memory_order_relaxed);
+  latch_wait_ns_ += other.latch_wait_ns_.load(std::memory_order_relaxed);
+  fetch_latency_.Merge(other.fetch_latency_);
+  read_latency_.Merge(other.read_latency_);
+}
+
+void BufferPoolStats::Reset() {
+  for (auto *counter :
+       {&hits_, &misses_, &evictions_, &write_backs_, &flushes_, &pin_waits_, &latch_waits_, &latch_wait_ns_}) {
+    counter->store(0, std::memory_order_relaxed);
+  }
+  fetch_latency_.Reset();
+  read_latency_.Reset();
+}
+
+auto BufferPoolStats::GetHitRate() const -> double {
+  auto hits = static_cast<double>(hits_.load(std::memory_order_relaxed));
+  auto fetches = hits + static_cast<double>(misses_.load(std::memory_order_relaxed));
+  return fetches == 0 ? 0.0 : hits / fetches;
+}
+
+auto BufferPoolStats::ToString() const -> std::string {
+  return fmt::format(
+      "hits={} misses={} hit_rate={:.4f} evictions={} write_backs={} flushes={} pin_waits={} latch_waits={} "
+      "latch_wait_ns={} fetch_latency=[{}] read_latency=[{}]",
+      hits_.load(), misses_.load(), GetHitRate(), evictions_.load(), write_backs_.load(), flushes_.load(),
+      pin_waits_.load(), latch_waits_.load(), latch_wait_ns_.load(), fetch_latency_.ToString(),
+      read_latency_.ToString());
+}
+
+}  // namespace bustub
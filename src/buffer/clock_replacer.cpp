@@ -11,19 +11,115 @@
 //===----------------------------------------------------------------------===//
 
 #include "buffer/clock_replacer.h"
+#include "common/exception.h"
 
 namespace bustub {
 
-ClockReplacer::ClockReplacer(size_t num_pages) {}
+ClockReplacer::ClockReplacer(size_t num_pages) : frames_(num_pages) {}
 
 ClockReplacer::~ClockReplacer() = default;
 
-auto ClockReplacer::Victim(frame_id_t *frame_id) -> bool { return false; }
+auto ClockReplacer::EvictIf(frame_id_t *frame_id, const std::function<bool(frame_id_t)> &can_evict) -> bool {
+  std::unique_lock<std::mutex> lock(latch_);
+  if (evictable_size_ == 0) {
+    return false;
+  }
+  // the first pass clears every reference bit in the way, so the second one finds a victim unless all are rejected
+  for (size_t step = 0; step < 2 * frames_.size(); ++step) {
+    FrameEntry &entry = frames_[hand_];
+    size_t cur = hand_;
+    hand_ = (hand_ + 1) % frames_.size();
+    if (!entry.is_evictable_) {
+      continue;
+    }
+    if (entry.ref_) {
+      entry.ref_ = false;
+      continue;
+    }
+    if (!can_evict(static_cast<frame_id_t>(cur))) {
+      continue;
+    }
+    *frame_id = static_cast<frame_id_t>(cur);
+    entry = FrameEntry();
+    evictable_size_--;
+    return true;
+  }
+  return false;
+}
 
-void ClockReplacer::Pin(frame_id_t frame_id) {}
+void ClockReplacer::RecordAccess(frame_id_t frame_id, AccessType access_type) {
+  std::unique_lock<std::mutex> lock(latch_);
+  BUSTUB_ASSERT(frame_id >= 0 && static_cast<size_t>(frame_id) < frames_.size(), "clock: invalid frame id");
+  RecordAccessLocked(frame_id, access_type);
+}
 
-void ClockReplacer::Unpin(frame_id_t frame_id) {}
+void ClockReplacer::RecordAccesses(const std::vector<AccessRecord> &records) {
+  std::unique_lock<std::mutex> lock(latch_);
+  // only the order of the records matters here, not their timestamps
+  for (const auto &record : records) {
+    BUSTUB_ASSERT(record.frame_id_ >= 0 && static_cast<size_t>(record.frame_id_) < frames_.size(),
+                  "clock: invalid frame id");
+    FrameEntry &entry = frames_[record.frame_id_];
+    if (entry.is_tracked_) {
+      RecordAccessLocked(record.frame_id_, record.access_type_);
+    }
+  }
+}
 
-auto ClockReplacer::Size() -> size_t { return 0; }
+void ClockReplacer::RecordAccessLocked(frame_id_t frame_id, AccessType access_type) {
+  FrameEntry &entry = frames_[frame_id];
+  entry.is_tracked_ = true;
+  if (access_type != AccessType::Scan) {
+    entry.ref_ = true;
+  }
+}
+
+void ClockReplacer::SetEvictable(frame_id_t frame_id, bool set_evictable) {
+  std::unique_lock<std::mutex> lock(latch_);
+  BUSTUB_ASSERT(frame_id >= 0 && static_cast<size_t>(frame_id) < frames_.size(), "clock: invalid frame id");
+  BUSTUB_ASSERT(frames_[frame_id].is_tracked_, "frame id doesn't exist");
+  SetEvictableLocked(frame_id, set_evictable);
+}
+
+void ClockReplacer::UpdateEvictable(frame_id_t frame_id, const std::function<bool(frame_id_t)> &is_evictable) {
+  std::unique_lock<std::mutex> lock(latch_);
+  BUSTUB_ASSERT(frame_id >= 0 && static_cast<size_t>(frame_id) < frames_.size(), "clock: invalid frame id");
+  FrameEntry &entry = frames_[frame_id];
+  if (entry.is_tracked_) {
+    SetEvictableLocked(frame_id, is_evictable(frame_id));
+  }
+}
+
+void ClockReplacer::SetEvictableLocked(frame_id_t frame_id, bool set_evictable) {
+  FrameEntry &entry = frames_[frame_id];
+  if (set_evictable == entry.is_evictable_) {
+    return;
+  }
+  entry.is_evictable_ = set_evictable;
+  if (set_evictable) {
+    evictable_size_++;
+  } else {
+    evictable_size_--;
+  }
+}
+
+void ClockReplacer::Remove(frame_id_t frame_id) {
+  std::unique_lock<std::mutex> lock(latch_);
+  BUSTUB_ASSERT(frame_id >= 0 && static_cast<size_t>(frame_id) < frames_.size(), "clock: invalid frame id");
+  FrameEntry &entry = frames_[frame_id];
+  if (!entry.is_tracked_) {
+    return;
+  }
+  if (!entry.is_evictable_) {
+    throw Exception("error remove: remove the non-evictable frame");
+  }
+  entry = FrameEntry();
+  evictable_size_--;
+}
+
+auto ClockReplacer::Size() -> size_t {
+  std::unique_lock<std::mutex> lock(latch_);
+  return evictable_size_;
+}
 
 } // namespace bustub
@@ -0,0 +1,113 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// frame_arena.cpp
+//
+// Identification: src/buffer/frame_arena.cpp
+//
+// Copyright (c) 2015-2023, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/frame_arena.h"
+
+#include <sys/mman.h>
+
+#include <cstring>
+#include <new>
+
+#include "common/exception.h"
+
+namespace bustub {
+
+FrameArena::FrameArena(size_t num_frames, bool can_grow) : num_frames_(num_frames), can_grow_(can_grow) {
+  frames_ = static_cast<Page *>(::operator new(num_frames_ * sizeof(Page)));
+#ifdef BUSTUB_PAGE_ARENA
+  data_size_ = num_frames_ * BUSTUB_PAGE_SIZE;
+  void *data = MAP_FAILED;
+#ifdef MAP_HUGETLB
+  if (!can_grow_ && data_size_ >= HUGE_PAGE_SIZE) {
+    // fails unless the administrator reserved enough huge pages, in which case we fall back to regular pages
+    size_t huge_size = (data_size_ + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    data = mmap(nullptr, huge_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (data != MAP_FAILED) {
+      data_size_ = huge_size;
+      huge_pages_ = true;
+    }
+  }
+#endif
+  if (data == MAP_FAILED) {
+    // the frames an arena that can grow doesn't use yet must not count against the commit limit
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS | (can_grow_ ? MAP_NORESERVE : 0);
+    data = mmap(nullptr, data_size_, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (data == MAP_FAILED) {
+      throw Exception(ExceptionType::OUT_OF_MEMORY, "frame arena: cannot map the buffer pool");
+    }
+#ifdef MADV_HUGEPAGE
+    if (data_size_ >= HUGE_PAGE_SIZE) {
+      // only a hint, transparent huge pages may be disabled
+      madvise(data, data_size_, MADV_HUGEPAGE);
+    }
+#endif
+  }
+  data_ = static_cast<char *>(data);
+  // anonymous mappings are zero-filled, so the frames need no reset
+  for (size_t i = 0; i < num_frames_; ++i) {
+    new (frames_ + i) Page(data_ + i * BUSTUB_PAGE_SIZE);
+  }
+#else
+  for (size_t i = 0; i < num_frames_; ++i) {
+    new (frames_ + i) Page(nullptr);
+  }
+  if (!can_grow_) {
+    Commit(0, num_frames_);
+  }
+#endif
+}
+
+void FrameArena::Commit(size_t first_frame, size_t num_frames) {
+  BUSTUB_ASSERT(first_frame + num_frames <= num_frames_, "frame arena: commit out of range");
+#ifndef BUSTUB_PAGE_ARENA
+  for (size_t i = first_frame; i < first_frame + num_frames; ++i) {
+    if (frames_[i].frame_data_ == nullptr) {
+      auto *data = new (std::align_val_t{BUSTUB_PAGE_SIZE}) char[BUSTUB_PAGE_SIZE];
+      memset(data, 0, BUSTUB_PAGE_SIZE);
+      frames_[i].frame_data_ = data;
+      frames_[i].data_ = data;
+      frames_[i].owns_data_ = true;
+    }
+  }
+#endif
+}
+
+void FrameArena::Release(size_t first_frame, size_t num_frames) {
+  BUSTUB_ASSERT(first_frame + num_frames <= num_frames_, "frame arena: release out of range");
+#ifdef BUSTUB_PAGE_ARENA
+  // explicitly reserved huge pages stay with the mapping anyway
+  if (!huge_pages_ && num_frames > 0) {
+    madvise(data_ + first_frame * BUSTUB_PAGE_SIZE, num_frames * BUSTUB_PAGE_SIZE, MADV_DONTNEED);
+  }
+#else
+  for (size_t i = first_frame; i < first_frame + num_frames; ++i) {
+    if (frames_[i].owns_data_) {
+      ::operator delete[](frames_[i].frame_data_, std::align_val_t{BUSTUB_PAGE_SIZE});
+      frames_[i].frame_data_ = nullptr;
+      frames_[i].data_ = nullptr;
+      frames_[i].owns_data_ = false;
+    }
+  }
+#endif
+}
+
+FrameArena::~FrameArena() {
+  for (size_t i = 0; i < num_frames_; ++i) {
+    frames_[i].~Page();
+  }
+  ::operator delete(frames_);
+#ifdef BUSTUB_PAGE_ARENA
+  munmap(data_, data_size_);
+#endif
+}
+
+}  // namespace bustub
@@ -11,150 +11,199 @@
 //===----------------------------------------------------------------------===//
 
 #include "buffer/lru_k_replacer.h"
-#include <cmath>
 #include "common/exception.h"
 
 namespace bustub {
-LRUKNode::LRUKNode(size_t k, frame_id_t fid) : k_(k), fid_(fid) {}
 
-// insert history
-auto LRUKNode::PushHistory(size_t time_val, std::unique_lock<std::mutex> &lock) -> bool {
-  if (history_.empty()) {
-    history_.push_back(time_val);
-    history_size_++;
-    return true;
+LRUKReplacer::LRUKReplacer(size_t num_frames, size_t k)
+    : node_store_(num_frames), history_(num_frames * k), replacer_size_(num_frames), k_(k) {
+  BUSTUB_ASSERT(k > 0, "lru-k: k must be positive");
+  for (size_t i = 0; i < num_frames; ++i) {
+    node_store_[i].Init(k, history_.data() + i * k);
   }
-  size_t old_time = history_.front();
-  if (old_time > time_val) {
-    return false;
+  heap_.reserve(num_frames);
+  rejected_.reserve(num_frames);
+}
+
+auto LRUKReplacer::EvictsBefore(frame_id_t a, frame_id_t b) const -> bool {
+  const LRUKNode &node_a = node_store_[a];
+  const LRUKNode &node_b = node_store_[b];
+  if (node_a.GetIsScan() != node_b.GetIsScan()) {
+    return node_a.GetIsScan();
   }
-  history_.push_back(time_val);
-  history_size_++;
-  if (history_size_ > k_) {
-    history_.pop_front();
-    history_size_--;
+  if (node_a.HasInfDistance() != node_b.HasInfDistance()) {
+    return node_a.HasInfDistance();
   }
-  return true;
+  // the same class: larger backward k-distance (or earlier first access) means an older timestamp
+  return node_a.GetOldestTimestamp() < node_b.GetOldestTimestamp();
 }
 
-auto LRUKNode::GetBackwardK(double &bk, size_t timeval, std::unique_lock<std::mutex> &lock) -> bool {
-  if (history_.empty() || history_.front() > timeval) {
-    return false;
-  }
-  bk = timeval - history_.front();
-  return true;
+void LRUKReplacer::HeapSwap(size_t i, size_t j) {
+  std::swap(heap_[i], heap_[j]);
+  node_store_[heap_[i]].SetHeapIndex(i);
+  node_store_[heap_[j]].SetHeapIndex(j);
 }
 
-LRUKReplacer::LRUKReplacer(size_t num_frames, size_t k) : replacer_size_(num_frames), k_(k) {}
+void LRUKReplacer::HeapSiftUp(size_t i) {
+  while (i > 0) {
+    size_t parent = (i - 1) / 2;
+    if (!EvictsBefore(heap_[i], heap_[parent])) {
+      break;
+    }
+    HeapSwap(i, parent);
+    i = parent;
+  }
+}
 
-auto LRUKReplacer::EvictInList(std::list<LRUKNode> &list, frame_id_t *frame_id, std::unique_lock<std::mutex> &lock)
-    -> bool {
-  // std::unique_lock<std::mutex> lock(latch_);
-  for (auto nodeidx = list.begin(); nodeidx != list.end(); ++nodeidx) {
-    if (nodeidx->GetIsEvictable(lock)) {
-      *frame_id = nodeidx->GetFrameId(lock);
-      curr_size_--;
-      node_store_.erase(*frame_id);
-      list.erase(nodeidx);
-      return true;
+void LRUKReplacer::HeapSiftDown(size_t i) {
+  while (true) {
+    size_t first = i;
+    size_t left = 2 * i + 1;
+    size_t right = left + 1;
+    if (left < heap_.size() && EvictsBefore(heap_[left], heap_[first])) {
+      first = left;
+    }
+    if (right < heap_.size() && EvictsBefore(heap_[right], heap_[first])) {
+      first = right;
     }
+    if (first == i) {
+      return;
+    }
+    HeapSwap(i, first);
+    i = first;
+  }
+}
+
+void LRUKReplacer::HeapPush(frame_id_t frame_id) {
+  heap_.push_back(frame_id);
+  node_store_[frame_id].SetHeapIndex(heap_.size() - 1);
+  HeapSiftUp(heap_.size() - 1);
+}
+
+void LRUKReplacer::HeapErase(frame_id_t frame_id) {
+  size_t i = node_store_[frame_id].GetHeapIndex();
+  BUSTUB_ASSERT(i < heap_.size() && heap_[i] == frame_id, "lru-k: frame is not in the heap");
+  HeapSwap(i, heap_.size() - 1);
+  heap_.pop_back();
+  node_store_[frame_id].SetHeapIndex(LRUKNode::NOT_IN_HEAP);
+  if (i < heap_.size()) {
+    HeapUpdate(heap_[i]);
   }
-  return false;
 }
 
-auto LRUKReplacer::Evict(frame_id_t *frame_id) -> bool {
+void LRUKReplacer::HeapUpdate(frame_id_t frame_id) {
+  size_t i = node_store_[frame_id].GetHeapIndex();
+  HeapSiftUp(i);
+  HeapSiftDown(node_store_[frame_id].GetHeapIndex());
+}
+
+auto LRUKReplacer::EvictIf(frame_id_t *frame_id, const std::function<bool(frame_id_t)> &can_evict) -> bool {
   std::unique_lock<std::mutex> lock(latch_);
-  if (0 == curr_size_) {
-    return false;
+  // rejected candidates are taken off the heap so that the next one surfaces, and put back afterwards
+  bool evicted = false;
+  while (!heap_.empty()) {
+    frame_id_t candidate = heap_.front();
+    HeapErase(candidate);
+    if (can_evict(candidate)) {
+      *frame_id = candidate;
+      node_store_[candidate].Reset();
+      evicted = true;
+      break;
+    }
+    rejected_.push_back(candidate);
   }
-  // find in young list
-  if (EvictInList(node_list_, frame_id, lock)) {
-    return true;
+  for (frame_id_t candidate : rejected_) {
+    HeapPush(candidate);
   }
-  // find in old list
-  return EvictInList(cache_list_, frame_id, lock);
+  rejected_.clear();
+  return evicted;
 }
 
-void LRUKReplacer::RecordAccess(frame_id_t frame_id, [[maybe_unused]] AccessType access_type) {
+void LRUKReplacer::RecordAccess(frame_id_t frame_id, AccessType access_type) {
   std::unique_lock<std::mutex> lock(latch_);
-  bool expr = (frame_id <= static_cast<int>(replacer_size_));
-  BUSTUB_ASSERT(expr, "replacer too big");
-  auto it = node_store_.find(frame_id);
-  current_timestamp_++;
-  // make and insert node
-  if (node_store_.end() == it) {
-    node_list_.emplace_back(k_, frame_id);
-    auto iter = std::prev(node_list_.end());
-    iter->PushHistory(current_timestamp_, lock);
-    node_store_[frame_id] = {iter, InWhichList::CLIST};
-    return;
-  }
+  BUSTUB_ASSERT(frame_id >= 0 && static_cast<size_t>(frame_id) < replacer_size_, "lru-k: invalid frame id");
+  RecordAccessLocked(frame_id, access_type, Now());
+}
 
-  auto iter = it->second.first;
-  size_t sz = iter->GetHistorySize(lock);
-  iter->PushHistory(current_timestamp_, lock);
-  // change and insert in node list
-  double bw_k = 0.0;
-  double bw_k_t = 0.0;
-
-  // insert it
-  std::list<LRUKNode> &list = (sz <= k_ - 1) ? node_list_ : cache_list_;
-  std::list<LRUKNode> &list_insert = (sz < k_ - 1) ? node_list_ : cache_list_;
-  BUSTUB_ASSERT(iter->GetBackwardK(bw_k, current_timestamp_, lock), "get bk error");
-  auto it_insert = list_insert.begin();
-  for (auto it_ori_r = list_insert.rbegin(); it_ori_r != list_insert.rend(); it_ori_r++) {
-    BUSTUB_ASSERT(it_ori_r->GetBackwardK(bw_k_t, current_timestamp_, lock), "get bk error");
-    if (bw_k <= bw_k_t) {
-      it_insert = it_ori_r.base();
-      break;
+void LRUKReplacer::RecordAccesses(const std::vector<AccessRecord> &records) {
+  std::unique_lock<std::mutex> lock(latch_);
+  for (const auto &record : records) {
+    BUSTUB_ASSERT(record.frame_id_ >= 0 && static_cast<size_t>(record.frame_id_) < replacer_size_,
+                  "lru-k: invalid frame id");
+    if (node_store_[record.frame_id_].GetHistorySize() > 0) {
+      RecordAccessLocked(record.frame_id_, record.access_type_, record.timestamp_);
     }
   }
-  double dt = 0;
+}
 
-  list_insert.splice(it_insert, list, iter);
-  for (auto i : cache_list_) {
-    i.GetBackwardK(dt, current_timestamp_, lock);
+void LRUKReplacer::RecordAccessLocked(frame_id_t frame_id, AccessType access_type, size_t timestamp) {
+  LRUKNode &node = node_store_[frame_id];
+  bool is_new = node.GetHistorySize() == 0;
+  if (access_type == AccessType::Scan) {
+    if (!is_new && !node.GetIsScan()) {
+      // a scan passing over a frame with regular accesses says nothing about its reuse
+      return;
+    }
+    node.ResetHistory(timestamp);
+    node.SetIsScan(true);
+  } else if (node.GetIsScan()) {
+    // promote out of the scan class, the scan accesses don't count
+    node.ResetHistory(timestamp);
+    node.SetIsScan(false);
+  } else {
+    node.PushHistory(timestamp);
   }
-  if (sz == k_ - 1) {
-    node_store_[frame_id] = {iter, InWhichList::NDLIST};
+  // a batched access may be older than the ones already recorded, so the key can move either way
+  if (node.GetIsEvictable()) {
+    HeapUpdate(frame_id);
   }
 }
 
 void LRUKReplacer::SetEvictable(frame_id_t frame_id, bool set_evictable) {
-  // init with a big lock
   std::unique_lock<std::mutex> lock(latch_);
-  auto it = node_store_.find(frame_id);
-  BUSTUB_ASSERT(it != node_store_.end(), "frame id doesn't exist");
+  BUSTUB_ASSERT(frame_id >= 0 && static_cast<size_t>(frame_id) < replacer_size_, "lru-k: invalid frame id");
+  BUSTUB_ASSERT(node_store_[frame_id].GetHistorySize() > 0, "frame id doesn't exist");
+  SetEvictableLocked(frame_id, set_evictable);
+}
+
+void LRUKReplacer::UpdateEvictable(frame_id_t frame_id, const std::function<bool(frame_id_t)> &is_evictable) {
+  std::unique_lock<std::mutex> lock(latch_);
+  BUSTUB_ASSERT(frame_id >= 0 && static_cast<size_t>(frame_id) < replacer_size_, "lru-k: invalid frame id");
+  if (node_store_[frame_id].GetHistorySize() > 0) {
+    SetEvictableLocked(frame_id, is_evictable(frame_id));
+  }
+}
 
-  auto iter = it->second.first;
-  if (set_evictable == iter->GetIsEvictable(lock)) {
+void LRUKReplacer::SetEvictableLocked(frame_id_t frame_id, bool set_evictable) {
+  LRUKNode &node = node_store_[frame_id];
+  if (set_evictable == node.GetIsEvictable()) {
     return;
   }
-  iter->SetIsEvictable(set_evictable, lock);
-  curr_size_ += (set_evictable ? 1 : -1);
+  node.SetIsEvictable(set_evictable);
+  if (set_evictable) {
+    HeapPush(frame_id);
+  } else {
+    HeapErase(frame_id);
+  }
 }
 
 void LRUKReplacer::Remove(frame_id_t frame_id) {
-  // init with a big lock
   std::unique_lock<std::mutex> lock(latch_);
-  auto it = node_store_.find(frame_id);
-  if (node_store_.end() == it) {
+  BUSTUB_ASSERT(frame_id >= 0 && static_cast<size_t>(frame_id) < replacer_size_, "lru-k: invalid frame id");
+  LRUKNode &node = node_store_[frame_id];
+  if (node.GetHistorySize() == 0) {
     return;
   }
-  auto iter = it->second.first;
-  if (!iter->GetIsEvictable(lock)) {
-    throw("error remove: remove the non-evictable frame");
-    return;
+  if (!node.GetIsEvictable()) {
+    throw Exception("error remove: remove the non-evictable frame");
   }
-  std::list<LRUKNode> &list = (it->second.second == InWhichList::NDLIST) ? cache_list_ : node_list_;
-  list.erase(iter);
-  node_store_.erase(it);
-  curr_size_--;
+  HeapErase(frame_id);
+  node.Reset();
 }
 
 auto LRUKReplacer::Size() -> size_t {
   std::unique_lock<std::mutex> lock(latch_);
-  return curr_size_;
+  return heap_.size();
 }
 
 }  // namespace bustub
@@ -11,19 +11,109 @@
 //===----------------------------------------------------------------------===//
 
 #include "buffer/lru_replacer.h"
+#include "common/exception.h"
 
 namespace bustub {
 
-LRUReplacer::LRUReplacer(size_t num_pages) {}
+LRUReplacer::LRUReplacer(size_t num_pages) : frames_(num_pages) {}
 
 LRUReplacer::~LRUReplacer() = default;
 
-auto LRUReplacer::Victim(frame_id_t *frame_id) -> bool { return false; }
+auto LRUReplacer::EvictIf(frame_id_t *frame_id, const std::function<bool(frame_id_t)> &can_evict) -> bool {
+  std::unique_lock<std::mutex> lock(latch_);
+  for (auto iter = lru_list_.begin(); iter != lru_list_.end(); ++iter) {
+    FrameEntry &entry = frames_[*iter];
+    if (!entry.is_evictable_ || !can_evict(*iter)) {
+      continue;
+    }
+    *frame_id = *iter;
+    lru_list_.erase(iter);
+    entry = FrameEntry();
+    evictable_size_--;
+    return true;
+  }
+  return false;
+}
 
-void LRUReplacer::Pin(frame_id_t frame_id) {}
+void LRUReplacer::RecordAccess(frame_id_t frame_id, AccessType access_type) {
+  std::unique_lock<std::mutex> lock(latch_);
+  BUSTUB_ASSERT(frame_id >= 0 && static_cast<size_t>(frame_id) < frames_.size(), "lru: invalid frame id");
+  RecordAccessLocked(frame_id, access_type);
+}
 
-void LRUReplacer::Unpin(frame_id_t frame_id) {}
+void LRUReplacer::RecordAccesses(const std::vector<AccessRecord> &records) {
+  std::unique_lock<std::mutex> lock(latch_);
+  // only the order of the records matters here, not their timestamps
+  for (const auto &record : records) {
+    BUSTUB_ASSERT(record.frame_id_ >= 0 && static_cast<size_t>(record.frame_id_) < frames_.size(),
+                  "lru: invalid frame id");
+    FrameEntry &entry = frames_[record.frame_id_];
+    if (entry.is_tracked_) {
+      RecordAccessLocked(record.frame_id_, record.access_type_);
+    }
+  }
+}
 
-auto LRUReplacer::Size() -> size_t { return 0; }
+void LRUReplacer::RecordAccessLocked(frame_id_t frame_id, AccessType access_type) {
+  FrameEntry &entry = frames_[frame_id];
+  if (!entry.is_tracked_) {
+    entry.is_tracked_ = true;
+    entry.pos_ = access_type == AccessType::Scan ? lru_list_.insert(lru_list_.begin(), frame_id)
+                                                 : lru_list_.insert(lru_list_.end(), frame_id);
+    return;
+  }
+  if (access_type != AccessType::Scan) {
+    lru_list_.splice(lru_list_.end(), lru_list_, entry.pos_);
+  }
+}
+
+void LRUReplacer::SetEvictable(frame_id_t frame_id, bool set_evictable) {
+  std::unique_lock<std::mutex> lock(latch_);
+  BUSTUB_ASSERT(frame_id >= 0 && static_cast<size_t>(frame_id) < frames_.size(), "lru: invalid frame id");
+  BUSTUB_ASSERT(frames_[frame_id].is_tracked_, "frame id doesn't exist");
+  SetEvictableLocked(frame_id, set_evictable);
+}
+
+void LRUReplacer::UpdateEvictable(frame_id_t frame_id, const std::function<bool(frame_id_t)> &is_evictable) {
+  std::unique_lock<std::mutex> lock(latch_);
+  BUSTUB_ASSERT(frame_id >= 0 && static_cast<size_t>(frame_id) < frames_.size(), "lru: invalid frame id");
+  FrameEntry &entry = frames_[frame_id];
+  if (entry.is_tracked_) {
+    SetEvictableLocked(frame_id, is_evictable(frame_id));
+  }
+}
+
+void LRUReplacer::SetEvictableLocked(frame_id_t frame_id, bool set_evictable) {
+  FrameEntry &entry = frames_[frame_id];
+  if (set_evictable == entry.is_evictable_) {
+    return;
+  }
+  entry.is_evictable_ = set_evictable;
+  if (set_evictable) {
+    evictable_size_++;
+  } else {
+    evictable_size_--;
+  }
+}
+
+void LRUReplacer::Remove(frame_id_t frame_id) {
+  std::unique_lock<std::mutex> lock(latch_);
+  BUSTUB_ASSERT(frame_id >= 0 && static_cast<size_t>(frame_id) < frames_.size(), "lru: invalid frame id");
+  FrameEntry &entry = frames_[frame_id];
+  if (!entry.is_tracked_) {
+    return;
+  }
+  if (!entry.is_evictable_) {
+    throw Exception("error remove: remove the non-evictable frame");
+  }
+  lru_list_.erase(entry.pos_);
+  entry = FrameEntry();
+  evictable_size_--;
+}
+
+auto LRUReplacer::Size() -> size_t {
+  std::unique_lock<std::mutex> lock(latch_);
+  return evictable_size_;
+}
 
 } // namespace bustub
@@ -0,0 +1,109 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// page_table.cpp
+//
+// Identification: src/buffer/page_table.cpp
+//
+// Copyright (c) 2015-2023, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/page_table.h"
+
+#include <thread>  // NOLINT
+
+namespace bustub {
+
+PageTable::PageTable(size_t num_frames) {
+  bits_ = 1;
+  while ((static_cast<size_t>(1) << bits_) < 2 * num_frames) {
+    bits_++;
+  }
+  mask_ = (static_cast<size_t>(1) << bits_) - 1;
+  slots_ = std::make_unique<std::atomic<uint64_t>[]>(mask_ + 1);
+  for (size_t i = 0; i <= mask_; ++i) {
+    slots_[i].store(EMPTY, std::memory_order_relaxed);
+  }
+}
+
+auto PageTable::Home(page_id_t page_id) const -> size_t {
+  // page ids of an instance share a stride, fibonacci hashing spreads them over the table
+  return static_cast<size_t>((static_cast<uint64_t>(static_cast<uint32_t>(page_id)) * 0x9E3779B97F4A7C15ULL) >>
+                             (64 - bits_));
+}
+
+auto PageTable::Probe(page_id_t page_id) const -> size_t {
+  for (size_t i = Home(page_id), probes = 0; probes <= mask_; i = (i + 1) & mask_, ++probes) {
+    uint64_t slot = slots_[i].load(std::memory_order_relaxed);
+    if (slot == EMPTY) {
+      return NO_SLOT;
+    }
+    if (PageOf(slot) == page_id) {
+      return i;
+    }
+  }
+  return NO_SLOT;
+}
+
+auto PageTable::Find(page_id_t page_id, frame_id_t *frame_id) const -> bool {
+  while (true) {
+    uint64_t version = version_.load(std::memory_order_acquire);
+    if ((version & 1) == 0) {
+      size_t i = Probe(page_id);
+      uint64_t slot = i == NO_SLOT ? EMPTY : slots_[i].load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (version_.load(std::memory_order_relaxed) == version) {
+        if (slot == EMPTY || PageOf(slot) != page_id) {
+          return false;
+        }
+        *frame_id = FrameOf(slot);
+        return true;
+      }
+    }
+    std::this_thread::yield();
+  }
+}
+
+void PageTable::Insert(page_id_t page_id, frame_id_t frame_id) {
+  version_.fetch_add(1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  size_t i = Home(page_id);
+  while (slots_[i].load(std::memory_order_relaxed) != EMPTY) {
+    BUSTUB_ASSERT(PageOf(slots_[i].load(std::memory_order_relaxed)) != page_id, "page table: page already mapped");
+    i = (i + 1) & mask_;
+  }
+  slots_[i].store(Pack(page_id, frame_id), std::memory_order_relaxed);
+  size_++;
+  version_.fetch_add(1, std::memory_order_release);
+}
+
+auto PageTable::Erase(page_id_t page_id) -> bool {
+  size_t i = Probe(page_id);
+  if (i == NO_SLOT) {
+    return false;
+  }
+  version_.fetch_add(1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  // backward shift deletion: move every following entry whose probe sequence passes the hole into it
+  for (size_t j = (i + 1) & mask_;; j = (j + 1) & mask_) {
+    uint64_t slot = slots_[j].load(std::memory_order_relaxed);
+    if (slot == EMPTY) {
+      break;
+    }
+    size_t home = Home(PageOf(slot));
+    // the entry may stay at j if its home lies cyclically in (i, j]
+    bool stays = i <= j ? (i < home && home <= j) : (i < home || home <= j);
+    if (!stays) {
+      slots_[i].store(slot, std::memory_order_relaxed);
+      i = j;
+    }
+  }
+  slots_[i].store(EMPTY, std::memory_order_relaxed);
+  size_--;
+  version_.fetch_add(1, std::memory_order_release);
+  return true;
+}
+
+}  // namespace bustub
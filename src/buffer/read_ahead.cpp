@@ -0,0 +1,51 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// read_ahead.cpp
+//
+// Identification: src/buffer/read_ahead.cpp
+//
+// Copyright (c) 2015-2023, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/read_ahead.h"
+
+#include <algorithm>
+
+#include "buffer/buffer_pool_manager.h"
+
+namespace bustub {
+
+ReadAhead::ReadAhead(BufferPoolManager *bpm) : bpm_(bpm) {
+  if (bpm_ != nullptr) {
+    max_window_ = std::min<size_t>(READ_AHEAD_MAX_PAGES, bpm_->GetPoolSize() / 4);
+  }
+}
+
+void ReadAhead::Advance(page_id_t page_id) {
+  if (bpm_ == nullptr || max_window_ == 0 || page_id == INVALID_PAGE_ID) {
+    return;
+  }
+  if (last_page_id_ != INVALID_PAGE_ID && page_id == last_page_id_ + 1) {
+    run_++;
+  } else {
+    run_ = 0;
+    window_ = 0;
+    prefetched_end_ = INVALID_PAGE_ID;
+  }
+  last_page_id_ = page_id;
+  if (run_ < static_cast<size_t>(READ_AHEAD_TRIGGER)) {
+    return;
+  }
+  if (prefetched_end_ != INVALID_PAGE_ID && page_id + static_cast<page_id_t>(window_ / 2) < prefetched_end_) {
+    return;
+  }
+  page_id_t first_page_id = prefetched_end_ == INVALID_PAGE_ID ? page_id + 1 : std::max(prefetched_end_, page_id + 1);
+  window_ = window_ == 0 ? std::min<size_t>(READ_AHEAD_MIN_PAGES, max_window_) : std::min(window_ * 2, max_window_);
+  bpm_->PrefetchPages(first_page_id, window_);
+  prefetched_end_ = first_page_id + static_cast<page_id_t>(window_);
+}
+
+}  // namespace bustub
@@ -76,7 +76,7 @@ void BustubInstance::HandleIndexStatement(Transaction *txn, const IndexStatement
   std::unique_lock<std::shared_mutex> l(catalog_lock_);
   auto info = catalog_->CreateIndex<IntegerKeyType, IntegerValueType, IntegerComparatorType>(
       txn, stmt.index_name_, stmt.table_->table_, stmt.table_->schema_, key_schema, col_ids, TWO_INTEGER_SIZE,
-      IntegerHashFunctionType{});
+      IntegerHashFunctionType{}, GetIndexPageFormat());
   l.unlock();
 
   if (info == nullptr) {
@@ -129,12 +129,76 @@ void BustubInstance::HandleExplainStatement(Transaction *txn, const ExplainState
 
 void BustubInstance::HandleVariableShowStatement(Transaction *txn, const VariableShowStatement &stmt,
                                                  ResultWriter &writer) {
+  if (stmt.variable_ == "bpm_stats" && buffer_pool_manager_ != nullptr) {
+    CmdDisplayBpmStats(writer);
+    return;
+  }
+  if (stmt.variable_ == "compression_ratio") {
+    WriteOneCell(fmt::format("{}={:.2f}", stmt.variable_, disk_manager_->GetCompressionRatio()), writer);
+    return;
+  }
+  if (stmt.variable_ == "buffer_pool_size" && buffer_pool_manager_ != nullptr) {
+    WriteOneCell(fmt::format("{}={}", stmt.variable_, buffer_pool_manager_->GetPoolSize()), writer);
+    return;
+  }
   auto content = GetSessionVariable(stmt.variable_);
   WriteOneCell(fmt::format("{}={}", stmt.variable_, content), writer);
 }
 
+void BustubInstance::CmdDisplayBpmStats(ResultWriter &writer) {
+  auto write_row = [&writer](const std::string &scope, const BufferPoolStats &stats) {
+    writer.BeginRow();
+    writer.WriteCell(scope);
+    writer.WriteCell(fmt::format("{}", stats.hits_.load()));
+    writer.WriteCell(fmt::format("{}", stats.misses_.load()));
+    writer.WriteCell(fmt::format("{:.4f}", stats.GetHitRate()));
+    writer.WriteCell(fmt::format("{}", stats.evictions_.load()));
+    writer.WriteCell(fmt::format("{}", stats.write_backs_.load()));
+    writer.WriteCell(fmt::format("{}", stats.flushes_.load()));
+    writer.WriteCell(fmt::format("{}", stats.pin_waits_.load()));
+    writer.WriteCell(fmt::format("{}", stats.latch_waits_.load()));
+    writer.WriteCell(fmt::format("{}", stats.latch_wait_ns_.load()));
+    writer.WriteCell(fmt::format("{}", stats.fetch_latency_.GetPercentile(0.5)));
+    writer.WriteCell(fmt::format("{}", stats.fetch_latency_.GetPercentile(0.99)));
+    writer.WriteCell(fmt::format("{}", stats.read_latency_.GetPercentile(0.5)));
+    writer.WriteCell(fmt::format("{}", stats.read_latency_.GetPercentile(0.99)));
+    writer.EndRow();
+  };
+  writer.BeginTable(false);
+  writer.BeginHeader();
+  for (const auto *header : {"scope", "hits", "misses", "hit_rate", "evictions", "write_backs", "flushes",
+                             "pin_waits", "latch_waits", "latch_wait_ns", "fetch_p50_ns", "fetch_p99_ns",
+                             "read_p50_ns", "read_p99_ns"}) {
+    writer.WriteHeaderCell(header);
+  }
+  writer.EndHeader();
+  BufferPoolStats total;
+  buffer_pool_manager_->CollectStats(&total);
+  write_row("pool", total);
+  for (size_t i = 0; i < buffer_pool_manager_->GetNumInstances(); ++i) {
+    write_row(fmt::format("shard {}", i), buffer_pool_manager_->GetInstanceStats(i));
+  }
+  writer.EndTable();
+}
+
 void BustubInstance::HandleVariableSetStatement(Transaction *txn, const VariableSetStatement &stmt,
                                                 ResultWriter &writer) {
+  if (stmt.variable_ == "compression_ratio" || stmt.variable_ == "bpm_stats") {
+    throw Exception(ExceptionType::INVALID, fmt::format("{} is read-only", stmt.variable_));
+  }
+  if (stmt.variable_ == "buffer_pool_size" && buffer_pool_manager_ != nullptr) {
+    size_t pool_size = 0;
+    try {
+      pool_size = std::stoul(stmt.value_);
+    } catch (const std::exception &e) {
+      throw Exception(ExceptionType::OUT_OF_RANGE, fmt::format("invalid buffer_pool_size {}", stmt.value_));
+    }
+    if (!buffer_pool_manager_->Resize(pool_size)) {
+      throw Exception(ExceptionType::OUT_OF_RANGE,
+                      fmt::format("buffer_pool_size must be between {} and {}", buffer_pool_manager_->GetNumInstances(),
+                                  buffer_pool_manager_->GetMaxPoolSize()));
+    }
+  }
   session_variables_[stmt.variable_] = stmt.value_;
 }
 
@@ -32,6 +32,7 @@
 #include "planner/planner.h"
 #include "recovery/checkpoint_manager.h"
 #include "recovery/log_manager.h"
+#include "storage/disk/async_disk_manager.h"
 #include "storage/disk/disk_manager.h"
 #include "storage/disk/disk_manager_memory.h"
 #include "type/value_factory.h"
@@ -49,16 +50,18 @@ BustubInstance::BustubInstance(const std::string &db_file_name) {
   enable_logging = false;
 
   // Storage related.
-  disk_manager_ = new DiskManager(db_file_name);
+  disk_manager_ = new AsyncDiskManager(db_file_name);
 
   // Log related.
   log_manager_ = new LogManager(disk_manager_);
 
   // We need more frames for GenerateTestTable to work. Therefore, we use 128
-  // instead of the default buffer pool size specified in `config.h`.
+  // instead of the default buffer pool size specified in `config.h`. `set
+  // buffer_pool_size` may grow the pool, its frames only get memory then.
   try {
-    buffer_pool_manager_ = new BufferPoolManager(128, disk_manager_,
-                                                 LRUK_REPLACER_K, log_manager_);
+    buffer_pool_manager_ = new BufferPoolManager(
+        128, disk_manager_, LRUK_REPLACER_K, log_manager_, 1,
+        ReplacerType::LRUK, 128 * BUFFER_POOL_GROWTH_FACTOR);
   } catch (NotImplementedException &e) {
     std::cerr << "BufferPoolManager is not implemented, only mock tables are "
                  "supported."
@@ -76,6 +79,10 @@ BustubInstance::BustubInstance(const std::string &db_file_name) {
 
 #ifndef __EMSCRIPTEN__
   lock_manager_->StartDeadlockDetection();
+  if (buffer_pool_manager_ != nullptr) {
+    buffer_pool_manager_->StartBackgroundFlush();
+    buffer_pool_manager_->StartPrefetch();
+  }
 #endif
 
   // Checkpoint related.
@@ -100,10 +107,12 @@ BustubInstance::BustubInstance() {
   log_manager_ = new LogManager(disk_manager_);
 
   // We need more frames for GenerateTestTable to work. Therefore, we use 128
-  // instead of the default buffer pool size specified in `config.h`.
+  // instead of the default buffer pool size specified in `config.h`. `set
+  // buffer_pool_size` may grow the pool, its frames only get memory then.
   try {
-    buffer_pool_manager_ = new BufferPoolManager(128, disk_manager_,
-                                                 LRUK_REPLACER_K, log_manager_);
+    buffer_pool_manager_ = new BufferPoolManager(
+        128, disk_manager_, LRUK_REPLACER_K, log_manager_, 1,
+        ReplacerType::LRUK, 128 * BUFFER_POOL_GROWTH_FACTOR);
   } catch (NotImplementedException &e) {
     std::cerr << "BufferPoolManager is not implemented, only mock tables are "
                  "supported."
@@ -121,6 +130,10 @@ BustubInstance::BustubInstance() {
 
 #ifndef __EMSCRIPTEN__
   lock_manager_->StartDeadlockDetection();
+  if (buffer_pool_manager_ != nullptr) {
+    buffer_pool_manager_->StartBackgroundFlush();
+    buffer_pool_manager_->StartPrefetch();
+  }
 #endif
 
   // Checkpoint related.
@@ -21,4 +21,7 @@ std::chrono::duration<int64_t> log_timeout = std::chrono::seconds(1);
 std::chrono::milliseconds cycle_detection_interval =
     std::chrono::milliseconds(50);
 
+std::chrono::milliseconds background_flush_interval =
+    std::chrono::milliseconds(10);
+
 } // namespace bustub
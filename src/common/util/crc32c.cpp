@@ -0,0 +1,124 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// crc32c.cpp
+//
+// Identification: src/common/util/crc32c.cpp
+//
+// Copyright (c) 2015-2023, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "common/util/crc32c.h"
+
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define BUSTUB_CRC32C_SSE42
+#include <nmmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#define BUSTUB_CRC32C_ARM
+#include <arm_acle.h>
+#endif
+
+namespace bustub {
+
+/** The reflected CRC-32C polynomial. */
+static constexpr uint32_t POLYNOMIAL = 0x82f63b78;
+
+/**
+ * Table k maps a byte to its checksum followed by k zero bytes, so that the
+ * software path consumes 8 bytes per step
+ */
+static constexpr auto MakeTables() -> std::array<std::array<uint32_t, 256>, 8> {
+  std::array<std::array<uint32_t, 256>, 8> tables{};
+  for (uint32_t i = 0; i < 256; ++i) {
+    uint32_t crc = i;
+    for (int bit = 0; bit < 8; ++bit) {
+      crc = (crc >> 1) ^ ((crc & 1) != 0 ? POLYNOMIAL : 0);
+    }
+    tables[0][i] = crc;
+  }
+  for (uint32_t i = 0; i < 256; ++i) {
+    for (size_t k = 1; k < 8; ++k) {
+      uint32_t prev = tables[k - 1][i];
+      tables[k][i] = (prev >> 8) ^ tables[0][prev & 0xff];
+    }
+  }
+  return tables;
+}
+
+static constexpr auto TABLES = MakeTables();
+
+static auto ComputeSoftware(const uint8_t *p, size_t length, uint32_t crc)
+    -> uint32_t {
+  for (; length >= 8; length -= 8, p += 8) {
+    uint64_t word;
+    memcpy(&word, p, sizeof(word));
+    word ^= crc;
+    crc = TABLES[7][word & 0xff] ^ TABLES[6][(word >> 8) & 0xff] ^
+          TABLES[5][(word >> 16) & 0xff] ^ TABLES[4][(word >> 24) & 0xff] ^
+          TABLES[3][(word >> 32) & 0xff] ^ TABLES[2][(word >> 40) & 0xff] ^
+          TABLES[1][(word >> 48) & 0xff] ^ TABLES[0][word >> 56];
+  }
+  for (; length > 0; --length, ++p) {
+    crc = (crc >> 8) ^ TABLES[0][(crc ^ *p) & 0xff];
+  }
+  return crc;
+}
+
+#if defined(BUSTUB_CRC32C_SSE42)
+__attribute__((target("sse4.2"))) static auto
+ComputeHardware(const uint8_t *p, size_t length, uint32_t crc) -> uint32_t {
+  uint64_t crc64 = crc;
+  for (; length >= 8; length -= 8, p += 8) {
+    uint64_t word;
+    memcpy(&word, p, sizeof(word));
+    crc64 = _mm_crc32_u64(crc64, word);
+  }
+  crc = static_cast<uint32_t>(crc64);
+  for (; length > 0; --length, ++p) {
+    crc = _mm_crc32_u8(crc, *p);
+  }
+  return crc;
+}
+#elif defined(BUSTUB_CRC32C_ARM)
+static auto ComputeHardware(const uint8_t *p, size_t length, uint32_t crc)
+    -> uint32_t {
+  for (; length >= 8; length -= 8, p += 8) {
+    uint64_t word;
+    memcpy(&word, p, sizeof(word));
+    crc = __crc32cd(crc, word);
+  }
+  for (; length > 0; --length, ++p) {
+    crc = __crc32cb(crc, *p);
+  }
+  return crc;
+}
+#endif
+
+auto Crc32c::IsHardwareAccelerated() -> bool {
+#if defined(BUSTUB_CRC32C_SSE42)
+  static const bool supported = __builtin_cpu_supports("sse4.2") != 0;
+  return supported;
+#elif defined(BUSTUB_CRC32C_ARM)
+  return true;
+#else
+  return false;
+#endif
+}
+
+auto Crc32c::Compute(const char *data, size_t length, uint32_t crc)
+    -> uint32_t {
+  const auto *p = reinterpret_cast<const uint8_t *>(data);
+#if defined(BUSTUB_CRC32C_SSE42) || defined(BUSTUB_CRC32C_ARM)
+  if (IsHardwareAccelerated()) {
+    return ~ComputeHardware(p, length, ~crc);
+  }
+#endif
+  return ~ComputeSoftware(p, length, ~crc);
+}
+
+} // namespace bustub
@@ -0,0 +1,115 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// arc_replacer.h
+//
+// Identification: src/include/buffer/arc_replacer.h
+//
+// Copyright (c) 2015-2023, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <list>
+#include <mutex> // NOLINT
+#include <unordered_map>
+#include <vector>
+
+#include "buffer/replacer.h"
+#include "common/config.h"
+
+namespace bustub {
+
+/**
+ * ArcReplacer implements the Adaptive Replacement Cache policy (Megiddo and
+ * Modha, FAST '03).
+ *
+ * Resident frames live in two LRU lists: T1 for pages seen once since they
+ * were loaded, T2 for pages seen at least twice. Two ghost lists, B1 and B2,
+ * remember the ids of the pages recently evicted from T1 and T2. A miss on a
+ * page in B1 means T1 was too small and grows the target size p of T1, a
+ * miss on a page in B2 shrinks it. Eviction takes the least recently used
+ * evictable frame of T1 while T1 is larger than p, of T2 otherwise, falling
+ * back to the other list when every frame of the chosen one is pinned.
+ *
+ * The replacer only sees frames, so the buffer pool has to report which page
+ * it loads into a frame through SetPage. Scan accesses to resident frames are
+ * not recorded, so a scan can't promote a page into T2.
+ */
+class ArcReplacer : public Replacer {
+public:
+  /**
+   * Create a new ArcReplacer.
+   * @param num_frames the maximum number of frames the ArcReplacer will be
+   * required to store
+   */
+  explicit ArcReplacer(size_t num_frames);
+
+  DISALLOW_COPY_AND_MOVE(ArcReplacer);
+
+  ~ArcReplacer() override = default;
+
+  auto EvictIf(frame_id_t *frame_id, const std::function<bool(frame_id_t)> &can_evict) -> bool override;
+
+  void RecordAccess(frame_id_t frame_id,
+                    AccessType access_type = AccessType::Unknown) override;
+
+  void RecordAccesses(const std::vector<AccessRecord> &records) override;
+
+  void SetEvictable(frame_id_t frame_id, bool set_evictable) override;
+
+  void UpdateEvictable(frame_id_t frame_id, const std::function<bool(frame_id_t)> &is_evictable) override;
+
+  void Remove(frame_id_t frame_id) override;
+
+  void SetPage(frame_id_t frame_id, page_id_t page_id) override;
+
+  auto Size() -> size_t override;
+
+private:
+  void RecordAccessLocked(frame_id_t frame_id, AccessType access_type);
+  void SetEvictableLocked(frame_id_t frame_id, bool set_evictable);
+
+  enum class ArcList { NONE = 0, T1, T2 };
+
+  struct FrameEntry {
+    ArcList list_{ArcList::NONE};
+    bool is_evictable_{false};
+    page_id_t page_id_{INVALID_PAGE_ID};
+    /** Position in t1_ or t2_, valid while the frame is tracked. */
+    std::list<frame_id_t>::iterator pos_;
+  };
+
+  /** A list of evicted page ids, least recently evicted first. */
+  struct GhostList {
+    std::list<page_id_t> list_;
+    std::unordered_map<page_id_t, std::list<page_id_t>::iterator> index_;
+
+    auto Size() const -> size_t { return list_.size(); }
+    auto Erase(page_id_t page_id) -> bool;
+    void Push(page_id_t page_id);
+    void PopFront();
+  };
+
+  /** @brief Evict the least recently used evictable frame of list that can_evict accepts, remembering its page in
+   * ghost. */
+  auto EvictFrom(std::list<frame_id_t> *list, GhostList *ghost, frame_id_t *frame_id,
+                 const std::function<bool(frame_id_t)> &can_evict) -> bool;
+  /** @brief Drop the oldest ghosts so that |T1| + |B1| <= c and the four lists hold at most 2c entries. */
+  void TrimGhosts();
+
+  const size_t capacity_;
+  /** Target size of T1. */
+  size_t p_{0};
+  std::list<frame_id_t> t1_;
+  std::list<frame_id_t> t2_;
+  GhostList b1_;
+  GhostList b2_;
+  std::vector<FrameEntry> frames_;
+  size_t evictable_size_{0};
+  std::mutex latch_;
+};
+
+} // namespace bustub
@@ -12,17 +12,23 @@
 
 #pragma once
 
+#include <atomic>
+#include <condition_variable>  // NOLINT
 #include <deque>
-#include <list>
 #include <memory>
-#include <mutex>  // NOLINT
-#include <unordered_map>
-#include <unordered_set>
+#include <mutex>   // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
 
-#include "buffer/lru_k_replacer.h"
+#include "buffer/buffer_pool_manager_instance.h"
+#include "buffer/buffer_pool_stats.h"
+#include "buffer/frame_arena.h"
+#include "buffer/replacer.h"
 #include "common/config.h"
 #include "recovery/log_manager.h"
 #include "storage/disk/disk_manager.h"
+#include "storage/disk/free_space_map.h"
 #include "storage/page/page.h"
 #include "storage/page/page_guard.h"
 
@@ -30,6 +36,17 @@ namespace bustub {
 
 /**
  * BufferPoolManager reads disk pages to and from its internal buffer pool.
+ *
+ * The pool is partitioned into `num_instances` BufferPoolManagerInstance shards. Every page id is owned by the
+ * shard `page_id % num_instances`, so requests for different pages usually take different latches. With a single
+ * instance the behavior is exactly that of one unpartitioned pool.
+ *
+ * The number of frames can be changed at runtime with Resize, up to the maximum given on construction. The frames
+ * of all sizes are reserved up front, so Page pointers stay valid across resizes, but only the frames in use hold
+ * memory.
+ *
+ * Page ids are allocated from a FreeSpaceMap, so the ids of deleted pages are reused. The map is loaded from the
+ * disk manager on construction and written back by FlushAllPages.
  */
 class BufferPoolManager {
  public:
@@ -40,21 +57,77 @@ class BufferPoolManager {
    * @param replacer_k the lookback constant k for the LRU-K replacer
    * @param log_manager the log manager (for testing only: nullptr = disable
    * logging). Please ignore this for P1.
+   * @param num_instances the number of shards the frames are split into, must not exceed pool_size
+   * @param replacer_type the replacement policy of every shard, replacer_k only matters for LRU-K
+   * @param max_pool_size the size the pool may grow to, 0 for pool_size
    */
   BufferPoolManager(size_t pool_size, DiskManager *disk_manager, size_t replacer_k = LRUK_REPLACER_K,
-                    LogManager *log_manager = nullptr);
+                    LogManager *log_manager = nullptr, size_t num_instances = 1,
+                    ReplacerType replacer_type = ReplacerType::LRUK, size_t max_pool_size = 0);
 
   /**
-   * @brief Destroy an existing BufferPoolManager.
+   * @brief Destroy an existing BufferPoolManager, stopping the background flusher if it runs.
    */
   ~BufferPoolManager();
 
+  /**
+   * @brief Start the background flusher. Every background_flush_interval it checks each instance, and once more
+   * than high_watermark of its frames are dirty it writes back dirty, unpinned pages until at most low_watermark are,
+   * so that eviction normally finds clean victims.
+   * @param high_watermark dirty frame ratio above which an instance is cleaned
+   * @param low_watermark dirty frame ratio at which cleaning stops
+   */
+  void StartBackgroundFlush(double high_watermark = BUFFER_POOL_DIRTY_HIGH_WATERMARK,
+                            double low_watermark = BUFFER_POOL_DIRTY_LOW_WATERMARK);
+
+  /**
+   * @brief Start the threads that serve PrefetchPages. Until then prefetch requests are ignored. A thread takes a
+   * batch of queued pages, queues their reads with the disk manager and submits them together, so a disk manager
+   * doing asynchronous I/O has the whole batch in flight at once.
+   * @param num_threads number of prefetch threads
+   */
+  void StartPrefetch(size_t num_threads = PREFETCH_THREADS);
+
+  /**
+   * @brief Asynchronously load the pages [first_page_id, first_page_id + count) into free or evictable frames, so
+   * that a scan about to reach them doesn't wait for the disk. This is only a hint: pages that are resident, were
+   * never allocated, or find no frame are skipped, and requests beyond what the pool can hold are dropped.
+   */
+  void PrefetchPages(page_id_t first_page_id, size_t count);
+
   /** @brief Return the size (number of frames) of the buffer pool. */
   auto GetPoolSize() -> size_t { return pool_size_; }
 
-  /** @brief Return the pointer to all the pages in the buffer pool. */
+  /** @brief Return the size the buffer pool may grow to. */
+  auto GetMaxPoolSize() -> size_t { return max_pool_size_; }
+
+  /**
+   * @brief Grow or shrink the buffer pool to pool_size frames while it is in use. Shrinking writes back and evicts
+   * the pages of the frames that go away, waiting for pinned ones to be unpinned, so the caller must not hold any
+   * pins. The memory of those frames is given back to the kernel.
+   * @param pool_size the new number of frames
+   * @return false if pool_size is below the number of instances or above GetMaxPoolSize(), nothing changes then
+   */
+  auto Resize(size_t pool_size) -> bool;
+
+  /** @brief Return the pointer to all the pages in the buffer pool, including the ones beyond the current size. */
   auto GetPages() -> Page * { return pages_; }
 
+  /** @brief Return the number of shards of the buffer pool. */
+  auto GetNumInstances() -> size_t { return instances_.size(); }
+
+  /** @brief Return the counters of one shard. */
+  auto GetInstanceStats(size_t index) -> const BufferPoolStats & { return instances_[index]->GetStats(); }
+
+  /** @brief Add the counters of every shard to stats. */
+  void CollectStats(BufferPoolStats *stats);
+
+  /** @brief Zero the counters of every shard. */
+  void ResetStats();
+
+  /** @return the counters of the whole pool on the first line, followed by one line per shard */
+  auto StatsToString() -> std::string;
+
   /**
    * TODO(P1): Add implementation
    *
@@ -74,8 +147,8 @@ class BufferPoolManager {
    * frame in the replacer for the lru-k algorithm to work.
    *
    * @param[out] page_id id of created page
-   * @return nullptr if no new pages could be created, otherwise pointer to new
-   * page
+   * @return nullptr if no new pages could be created, e.g. because the disk
+   * manager is read-only, otherwise pointer to new page
    */
   auto NewPage(page_id_t *page_id) -> Page *;
 
@@ -93,6 +166,24 @@ class BufferPoolManager {
    */
   auto NewPageGuarded(page_id_t *page_id) -> BasicPageGuard;
 
+  /**
+   * @brief Allocate num_pages contiguous page ids, which are physically sequential on disk, without creating the
+   * pages. Create them with NewPageAt, or hand unused ones back with DeletePage.
+   *
+   * @param num_pages number of page ids
+   * @return the first page id of the extent
+   */
+  auto AllocateExtent(size_t num_pages) -> page_id_t;
+
+  /**
+   * @brief Create a new page under an id allocated by AllocateExtent, see NewPage.
+   *
+   * @param page_id id of the page
+   * @return nullptr if all frames of the owning instance are pinned or the disk manager is read-only, otherwise
+   * pointer to the new page. The id stays allocated either way.
+   */
+  auto NewPageAt(page_id_t page_id) -> Page *;
+
   /**
    * TODO(P1): Add implementation
    *
@@ -110,9 +201,13 @@ class BufferPoolManager {
    * In addition, remember to disable eviction and record the access history of
    * the frame like you did for NewPage().
    *
+   * A page the disk manager keeps in memory, see DiskManager::GetMappedPage, is
+   * not copied: the frame points at the disk manager's copy, which must only be
+   * read, e.g. through read guards.
+   *
    * @param page_id id of page to be fetched
-   * @param access_type type of access to the page, only needed for leaderboard
-   * tests.
+   * @param access_type type of access to the page, AccessType::Scan keeps
+   * sequential scans from evicting the working set.
    * @return nullptr if page_id cannot be fetched, otherwise pointer to the
    * requested page
    */
@@ -127,13 +222,45 @@ class BufferPoolManager {
    * that, depending on the function called, a guard is returned.
    * If FetchPageRead or FetchPageWrite is called, it is expected that
    * the returned page already has a read or write latch held, respectively.
+   * FetchPageWrite returns an empty guard if the disk manager is read-only,
+   * see DiskManager::IsReadOnly.
    *
    * @param page_id, the id of the page to fetch
+   * @param access_type type of access to the page, see FetchPage
    * @return PageGuard holding the fetched page
    */
-  auto FetchPageBasic(page_id_t page_id) -> BasicPageGuard;
-  auto FetchPageRead(page_id_t page_id) -> ReadPageGuard;
-  auto FetchPageWrite(page_id_t page_id) -> WritePageGuard;
+  auto FetchPageBasic(page_id_t page_id, AccessType access_type = AccessType::Unknown) -> BasicPageGuard;
+  auto FetchPageRead(page_id_t page_id, AccessType access_type = AccessType::Unknown) -> ReadPageGuard;
+  auto FetchPageWrite(page_id_t page_id, AccessType access_type = AccessType::Unknown) -> WritePageGuard;
+
+  /**
+   * @brief Fetch a page for optimistic reading: the page is pinned but not latched, see OptimisticReadGuard.
+   *
+   * @param page_id, the id of the page to fetch
+   * @param access_type type of access to the page, see FetchPage
+   * @return OptimisticReadGuard holding the fetched page
+   */
+  auto FetchPageOptimistic(page_id_t page_id, AccessType access_type = AccessType::Unknown) -> OptimisticReadGuard;
+
+  /**
+   * @brief Fetch a page through a swip, a slot remembering the frame the page was last found in.
+   *
+   * If that frame still holds the page, it is pinned directly and the page table is skipped. Otherwise the page is
+   * fetched as usual and the swip is pointed at its frame. A swip is only a hint that is checked on every use, so
+   * nothing has to unswizzle it when the frame is evicted or reused.
+   *
+   * @param page_id id of page to be fetched
+   * @param swip the slot holding the frame page_id was last found in, nullptr to fetch without one
+   * @param access_type type of access to the page, see FetchPage
+   * @return nullptr if page_id cannot be fetched, otherwise pointer to the
+   * requested page
+   */
+  auto FetchPage(page_id_t page_id, std::atomic<Page *> *swip, AccessType access_type = AccessType::Unknown)
+      -> Page *;
+  auto FetchPageWrite(page_id_t page_id, std::atomic<Page *> *swip, AccessType access_type = AccessType::Unknown)
+      -> WritePageGuard;
+  auto FetchPageOptimistic(page_id_t page_id, std::atomic<Page *> *swip,
+                           AccessType access_type = AccessType::Unknown) -> OptimisticReadGuard;
 
   /**
    * TODO(P1): Add implementation
@@ -150,7 +277,9 @@ class BufferPoolManager {
    * @param access_type type of access to the page, only needed for leaderboard
    * tests.
    * @return false if the page is not in the page table or its pin count is <= 0
-   * before this call, true otherwise
+   * before this call, or if is_dirty is set and the disk manager is read-only,
+   * in which case the page is unpinned without being marked dirty; true
+   * otherwise
    */
   auto UnpinPage(page_id_t page_id, bool is_dirty, AccessType access_type = AccessType::Unknown) -> bool;
 
@@ -171,7 +300,11 @@ class BufferPoolManager {
   /**
    * TODO(P1): Add implementation
    *
-   * @brief Flush all the pages in the buffer pool to disk.
+   * @brief Flush all the dirty pages in the buffer pool to disk, in page id
+   * order. Clean pages are not written. The pages are handed to
+   * DiskManager::WritePages in batches, which coalesces adjacent ones, and the
+   * disk manager syncs once at the end. The changed pages of the free-space
+   * map are written as well.
    */
   void FlushAllPages();
 
@@ -187,6 +320,9 @@ class BufferPoolManager {
    * memory and metadata. Finally, you should call DeallocatePage() to imitate
    * freeing the page on the disk.
    *
+   * The id of the page goes back to the free-space map, also if the page is
+   * not in the buffer pool, and is handed out again by a later NewPage.
+   *
    * @param page_id id of page to be deleted
    * @return false if the page exists but could not be deleted, true if the page
    * didn't exist or deletion succeeded
@@ -194,47 +330,53 @@ class BufferPoolManager {
   auto DeletePage(page_id_t page_id) -> bool;
 
  private:
-  /** Number of pages in the buffer pool. */
-  const size_t pool_size_;
-  /** The next page id to be allocated  */
-  std::atomic<page_id_t> next_page_id_ = 0;
-  std::deque<page_id_t> removed_pages_;
-  std::unordered_set<page_id_t> removed_pages_index_;
+  /** @return the number of frames shard i of num_instances gets of a pool of num_frames frames */
+  static auto SliceOf(size_t num_frames, size_t num_instances, size_t i) -> size_t {
+    return num_frames / num_instances + (i < num_frames % num_instances ? 1 : 0);
+  }
 
-  /** Array of buffer pool pages. */
-  Page *pages_;
-  /** Pointer to the disk manager. */
+  /** @return the shard owning page_id */
+  auto GetInstance(page_id_t page_id) -> BufferPoolManagerInstance * {
+    return instances_[static_cast<size_t>(page_id) % instances_.size()].get();
+  }
+
+  /** Number of pages in the buffer pool. */
+  std::atomic<size_t> pool_size_;
+  /** The disk manager shared by all instances. */
   DiskManager *disk_manager_;
-  /** Pointer to the log manager. Please ignore this for P1. */
-  LogManager *log_manager_ __attribute__((__unused__));
-  /** Page table for keeping track of buffer pool pages. */
-  std::unordered_map<page_id_t, frame_id_t> page_table_;
-  /** Replacer to find unpinned pages for replacement. */
-  std::unique_ptr<LRUKReplacer> replacer_;
-  /** List of free frames that don't have any pages on them. */
-  std::list<frame_id_t> free_list_;
-  /** This latch protects shared data structures. We recommend updating this
-   * comment to describe what it protects. */
-  std::mutex latch_;
+  /** Number of pages the buffer pool may grow to. */
+  const size_t max_pool_size_;
+  /** Serializes Resize calls. */
+  std::mutex resize_latch_;
+  /** Owns the frames of the buffer pool. */
+  std::unique_ptr<FrameArena> arena_;
+  /** Array of buffer pool pages, sliced among the instances. */
+  Page *pages_;
+  /** Allocation state of the page ids, shared by the instances. */
+  std::unique_ptr<FreeSpaceMap> free_space_map_;
+  /** The shards of the buffer pool. */
+  std::vector<std::unique_ptr<BufferPoolManagerInstance>> instances_;
+  /** The instance NewPage starts probing from, advanced on every call to spread new pages over the shards. */
+  std::atomic<size_t> next_instance_{0};
 
-  /**
-   * @brief Allocate a page on disk. Caller should acquire the latch before
-   * calling this function.
-   * @return the id of the allocated page
-   */
-  auto AllocatePage() -> page_id_t;
+  /** Body of the background flusher thread. */
+  void RunBackgroundFlush(double high_watermark, double low_watermark);
 
-  /**
-   * @brief Deallocate a page on disk. Caller should acquire the latch before
-   * calling this function.
-   * @param page_id id of the page to deallocate
-   */
-  void DeallocatePage(__attribute__((unused)) page_id_t page_id) {
-    // This is a no-nop right now without a more complex data structure to track
-    // deallocated pages
-  }
+  /** The background flusher, if started. */
+  std::thread *flush_thread_{nullptr};
+  bool enable_background_flush_{false};
+  /** Protects enable_background_flush_ and wakes the flusher up on shutdown. */
+  std::mutex flush_latch_;
+  std::condition_variable flush_cv_;
+
+  /** Body of a prefetch thread. */
+  void RunPrefetch();
 
-  // TODO(student): You may add additional private members and helper functions
-  auto GetUsablePage(frame_id_t *frame_id, std::unique_lock<std::mutex> &lock) -> bool;
+  std::vector<std::thread> prefetch_threads_;
+  bool enable_prefetch_{false};
+  /** Pages waiting to be prefetched, protected by prefetch_latch_. */
+  std::deque<page_id_t> prefetch_queue_;
+  std::mutex prefetch_latch_;
+  std::condition_variable prefetch_cv_;
 };
 }  // namespace bustub
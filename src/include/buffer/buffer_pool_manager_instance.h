@@ -0,0 +1,452 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// buffer_pool_manager_instance.h
+//
+// Identification: src/include/buffer/buffer_pool_manager_instance.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <chrono>  // NOLINT
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <unordered_map>
+#include <vector>
+
+#include "buffer/buffer_pool_stats.h"
+#include "buffer/page_table.h"
+#include "buffer/replacer.h"
+#include "common/config.h"
+#include "recovery/log_manager.h"
+#include "storage/disk/disk_manager.h"
+#include "storage/disk/free_space_map.h"
+#include "storage/page/page.h"
+
+namespace bustub {
+
+/**
+ * BufferPoolManagerInstance is one shard of the buffer pool. It owns a slice of the frames together with its own
+ * page table, free list, replacer and latch, so that shards never contend with each other.
+ *
+ * Page ids are partitioned among the instances: instance `i` of `n` only allocates (and is only asked about) page
+ * ids with `page_id % n == i`. The ids come from the FreeSpaceMap shared by all instances.
+ *
+ * The latch is never held across disk I/O. A frame that is being filled is marked LOADING and stays pinned, so it
+ * can't be evicted, while the latch is released for the write-back of its dirty victim and the read of the new
+ * page. Fetchers of that page wait on the frame's condition variable; everyone else proceeds.
+ *
+ * Hits on resident pages take no latch at all. FetchPage looks the page up in the lock-free PageTable, bumps the
+ * atomic pin count and then checks that the frame still holds the page; UnpinPage only drops the pin count. Only the
+ * pins that take the count from or to zero tell the replacer, which decides about the frame under its own latch
+ * through Replacer::UpdateEvictable, so only unpinned frames are evictable. A victim is still claimed through
+ * FrameMeta::evicting_ and accepted only if nobody pinned it in the meantime. The accesses of lock-free hits are
+ * stamped with the replacer's clock and buffered in per-thread stripes. A stripe is flushed to the replacer when it
+ * fills up, and eviction drains all of them first, so the replacer ranks frames by the real access times.
+ *
+ * The instance owns `capacity` frames, of which the first `pool_size` are in use. Resize moves that boundary at
+ * runtime. The frames never move, so Page pointers held elsewhere stay valid; frames beyond the boundary are just
+ * kept off the free list and away from eviction.
+ */
+class BufferPoolManagerInstance {
+ public:
+  /**
+   * @brief Creates a new BufferPoolManagerInstance.
+   * @param pool_size the number of frames this instance starts with
+   * @param capacity the number of frames this instance may grow to
+   * @param pages the frames owned by this instance, must hold at least capacity pages
+   * @param num_instances total number of instances in the buffer pool
+   * @param instance_index index of this instance in the buffer pool
+   * @param disk_manager the disk manager
+   * @param free_space_map the free-space map page ids are allocated from
+   * @param replacer_k the lookback constant k for the LRU-K replacer
+   * @param log_manager the log manager (for testing only: nullptr = disable
+   * logging). Please ignore this for P1.
+   * @param replacer_type the replacement policy of this instance
+   */
+  BufferPoolManagerInstance(size_t pool_size, size_t capacity, Page *pages, size_t num_instances, size_t instance_index,
+                            DiskManager *disk_manager, FreeSpaceMap *free_space_map,
+                            size_t replacer_k = LRUK_REPLACER_K,
+                            LogManager *log_manager = nullptr, ReplacerType replacer_type = ReplacerType::LRUK);
+
+  DISALLOW_COPY_AND_MOVE(BufferPoolManagerInstance);
+
+  /**
+   * @brief Destroy an existing BufferPoolManagerInstance, waiting for its prefetch reads. The frames are owned by
+   * the caller.
+   */
+  ~BufferPoolManagerInstance();
+
+  /** @brief Return the size (number of frames) of this instance. */
+  auto GetPoolSize() -> size_t { return pool_size_; }
+
+  /** @brief Return the number of frames this instance may grow to. */
+  auto GetCapacity() -> size_t { return capacity_; }
+
+  /**
+   * @brief Change the number of frames in use. Growing puts the new frames on the free list. Shrinking takes the
+   * frames [pool_size, GetPoolSize()) away from their pages, writing dirty ones back; pinned frames are waited for
+   * with the latch released, so queries keep running, but the caller must not hold a pin on a page of this instance.
+   * @param pool_size the new number of frames, at least 1 and at most GetCapacity()
+   */
+  void Resize(size_t pool_size);
+
+  /** @brief Return the pointer to all the pages in this instance. */
+  auto GetPages() -> Page * { return pages_; }
+
+  /**
+   * @brief Create a new page in this instance. Set page_id to the new page's
+   * id, or nullptr if all frames are currently in use and not evictable (in
+   * another word, pinned).
+   *
+   * You should pick the replacement frame from either the free list or the
+   * replacer (always find from the free list first), and then call the
+   * AllocatePage() method to get a new page id. If the replacement frame has a
+   * dirty page, you should write it back to the disk first. You also need to
+   * reset the memory and metadata for the new page.
+   *
+   * @param[out] page_id id of created page
+   * @return nullptr if no new pages could be created, otherwise pointer to new
+   * page
+   */
+  auto NewPage(page_id_t *page_id) -> Page *;
+
+  /**
+   * @brief Create a new page under an id the caller allocated from the free-space map, see NewPage.
+   *
+   * @param page_id id of the page, owned by this instance
+   * @return nullptr if all frames are pinned, the id stays allocated then
+   */
+  auto NewPageAt(page_id_t page_id) -> Page *;
+
+  /**
+   * @brief Fetch the requested page from this instance. Return nullptr if
+   * page_id needs to be fetched from the disk but all frames are currently in
+   * use and not evictable (in another word, pinned).
+   *
+   * @param page_id id of page to be fetched
+   * @param access_type type of access to the page, AccessType::Scan keeps
+   * sequential scans from evicting the working set.
+   * @return nullptr if page_id cannot be fetched, otherwise pointer to the
+   * requested page
+   */
+  auto FetchPage(page_id_t page_id, AccessType access_type = AccessType::Unknown) -> Page *;
+
+  /**
+   * @brief Pin a frame without the latch or a page table lookup, if it holds page_id and the page is ready.
+   *
+   * @param frame_id the frame page_id was last seen in
+   * @param page_id id of the page
+   * @param access_type type of access to the page, see FetchPage
+   * @return false if the frame holds another page, is being loaded or evicted, or holds an unconsumed prefetched
+   * page, nothing is pinned then
+   */
+  auto PinFrame(frame_id_t frame_id, page_id_t page_id, AccessType access_type = AccessType::Unknown) -> bool;
+
+  /**
+   * @brief Unpin the target page from this instance. If page_id is not in the
+   * buffer pool or its pin count is already 0, return false.
+   *
+   * @param page_id id of page to be unpinned
+   * @param is_dirty true if the page should be marked as dirty, false otherwise
+   * @param access_type type of access to the page, only needed for leaderboard
+   * tests.
+   * @return false if the page is not in the page table or its pin count is <= 0
+   * before this call, true otherwise
+   */
+  auto UnpinPage(page_id_t page_id, bool is_dirty, AccessType access_type = AccessType::Unknown) -> bool;
+
+  /**
+   * @brief Read the target page into a free or evictable frame without pinning
+   * it, so that a later FetchPage hits. Until it is fetched, the frame is kept
+   * away from the replacer, so that loading the following prefetched pages
+   * doesn't evict it; at most half of the frames are held like this, the
+   * oldest going back to the replacer first.
+   *
+   * The read is queued with DiskManager::ReadPageAsync and the frame becomes
+   * readable once it completes; fetchers of the page wait for that. The caller
+   * submits the reads of a batch of prefetches with DiskManager::SubmitIo.
+   *
+   * @param page_id id of page to be loaded
+   * @return false if the page was never allocated, has been deleted, or no
+   * frame is available, true otherwise
+   */
+  auto PrefetchPage(page_id_t page_id) -> bool;
+
+  /**
+   * @brief Flush the target page to disk, REGARDLESS of the dirty flag unless
+   * only_dirty is set. Unset the dirty flag of the page after flushing.
+   *
+   * @param page_id id of page to be flushed, cannot be INVALID_PAGE_ID
+   * @param only_dirty skip the write if the page is clean
+   * @return false if the page could not be found in the page table, true
+   * otherwise
+   */
+  auto FlushPage(page_id_t page_id, bool only_dirty = false) -> bool;
+
+  /**
+   * @brief Flush the dirty pages of this instance to disk, in batches of at most WRITE_BATCH_PAGES.
+   */
+  void FlushAllPages();
+
+  /**
+   * @brief Append the ids of the dirty pages of this instance to page_ids.
+   */
+  void CollectDirtyPages(std::vector<page_id_t> *page_ids);
+
+  /**
+   * @brief First half of a batched flush: pin the dirty, resident pages among page_ids, clear their dirty flags and
+   * append them to writes. Other pages are skipped. Write the pages with DiskManager::WritePages, then hand the same
+   * writes to EndFlush. A writer that still holds a page sets its dirty flag again when it unpins.
+   * @param page_ids pages of this instance
+   * @param[out] writes the pages to write, pointing at the frames
+   */
+  void BeginFlush(const std::vector<page_id_t> &page_ids, std::vector<DiskManager::PageWrite> *writes);
+
+  /** @brief Second half of a batched flush: unpin the pages of this instance among writes. */
+  void EndFlush(const std::vector<DiskManager::PageWrite> &writes);
+
+  /** @return the number of dirty frames in this instance */
+  auto GetDirtyCount() -> size_t;
+
+  /** @return the counters of this instance */
+  auto GetStats() -> BufferPoolStats & { return stats_; }
+
+  /**
+   * @brief Write back dirty, unpinned pages until at most target_dirty frames are dirty, so that eviction finds
+   * clean victims. The pages are written in batches of at most WRITE_BATCH_PAGES; every page is copied under its read
+   * latch, so that the disk never sees a torn image, and written from the copy.
+   * @return the number of pages written
+   */
+  auto CleanDirtyPages(size_t target_dirty) -> size_t;
+
+  /**
+   * @brief Delete a page from this instance. If page_id is not in the buffer
+   * pool, do nothing and return true. If the page is pinned and cannot be
+   * deleted, return false immediately.
+   *
+   * @param page_id id of page to be deleted
+   * @return false if the page exists but could not be deleted, true if the page
+   * didn't exist or deletion succeeded
+   */
+  auto DeletePage(page_id_t page_id) -> bool;
+
+ private:
+  /** I/O state of a frame. */
+  enum class FrameState { READY = 0, LOADING };
+
+  /** Number of access stripes, the lock-free hits of a thread always go to the same one. */
+  static constexpr size_t ACCESS_STRIPES = 16;
+  /** Number of accesses a stripe buffers before it is flushed to the replacer. */
+  static constexpr size_t ACCESS_BATCH = 64;
+
+  /** Per-frame bookkeeping, written under latch_. The atomic fields are also read by lock-free hits. */
+  struct FrameMeta {
+    std::atomic<FrameState> state_{FrameState::READY};
+    /** Dirty page that used to live in this frame and is still being written back, or INVALID_PAGE_ID. */
+    page_id_t evicted_page_id_{INVALID_PAGE_ID};
+    /** Signalled when the write-back of the evicted page or the load of the frame is done. */
+    std::condition_variable io_done_;
+    /** The frame holds a prefetched page nobody has fetched yet, and is kept away from the replacer. */
+    std::atomic<bool> prefetched_{false};
+    /** Set while the frame is being taken away from its page; lock-free hits back off when they see it. */
+    std::atomic<bool> evicting_{false};
+  };
+
+  /** Accesses of lock-free hits the replacer hasn't been told about yet, oldest first. */
+  struct alignas(64) AccessStripe {
+    std::mutex latch_;
+    std::vector<Replacer::AccessRecord> records_;
+    /** The page of every access, accesses to frames that hold another page by now are dropped. */
+    std::vector<page_id_t> page_ids_;
+  };
+
+  /** Number of frames in use, the frames [pool_size_, capacity_) are retired. Written under latch_. */
+  std::atomic<size_t> pool_size_;
+  /** Number of frames this instance owns. */
+  const size_t capacity_;
+  /** Number of instances in the buffer pool. */
+  const size_t num_instances_;
+  /** Index of this instance in the buffer pool. */
+  const size_t instance_index_;
+  /** Array of buffer pool pages, owned by the BufferPoolManager. */
+  Page *pages_;
+  /** Pointer to the disk manager. */
+  DiskManager *disk_manager_;
+  /** The free-space map of the buffer pool, owned by the BufferPoolManager. */
+  FreeSpaceMap *free_space_map_;
+  /** Pointer to the log manager. Please ignore this for P1. */
+  LogManager *log_manager_ __attribute__((__unused__));
+  /** Page table for keeping track of buffer pool pages, written under latch_ and read without it. */
+  PageTable page_table_;
+  /** Replacer to find unpinned pages for replacement. */
+  std::unique_ptr<Replacer> replacer_;
+  /** List of free frames that don't have any pages on them. */
+  std::list<frame_id_t> free_list_;
+  /** I/O state of every frame. */
+  std::vector<FrameMeta> frame_meta_;
+  /** Evicted dirty pages whose write-back is in flight, mapped to the frame they are written from. */
+  std::unordered_map<page_id_t, frame_id_t> write_back_table_;
+  /** Number of resident frames whose dirty flag is set. */
+  std::atomic<size_t> dirty_count_{0};
+  /** Prefetched frames in the order they were loaded, with the page they were loaded for. Entries whose frame has
+   * been fetched or reused since are stale and skipped. */
+  std::deque<std::pair<frame_id_t, page_id_t>> prefetched_frames_;
+  /** Number of frames whose prefetched_ flag is set. */
+  size_t num_prefetched_{0};
+  /** Number of prefetch reads not completed yet. */
+  size_t pending_reads_{0};
+  /** Signalled when pending_reads_ drops to 0. */
+  std::condition_variable reads_done_;
+  /** Buffered accesses of lock-free hits, indexed by thread. */
+  std::vector<AccessStripe> access_stripes_;
+  /** The accesses of all stripes, collected by EvictFrame. Only used under latch_. */
+  std::vector<Replacer::AccessRecord> drained_accesses_;
+  /** Counters of this instance. */
+  BufferPoolStats stats_;
+  /** Serializes the writers of page_table_, free_list_, frame_meta_, write_back_table_, the prefetched frames and
+   * the metadata of the frames of this instance. */
+  std::mutex latch_;
+
+  /**
+   * @brief Acquire latch_, accounting the time spent blocked in stats_.
+   */
+  auto AcquireLatch() -> std::unique_lock<std::mutex>;
+
+  /**
+   * @brief Allocate a page on disk from the free-space map. Caller should acquire the latch before
+   * calling this function.
+   * @return the id of the allocated page
+   */
+  auto AllocatePage() -> page_id_t;
+
+  /**
+   * @brief Deallocate a page on disk, so that its id is handed out again. Caller should acquire the latch before
+   * calling this function.
+   * @param page_id id of the page to deallocate
+   */
+  void DeallocatePage(page_id_t page_id) { free_space_map_->DeallocatePage(page_id); }
+
+  /**
+   * @brief Create a new page under page_id, which must be allocated. Caller should hold the latch.
+   * @return nullptr if all frames are pinned
+   */
+  auto NewPageLocked(page_id_t page_id, std::unique_lock<std::mutex> &lock) -> Page *;
+
+  /**
+   * @brief Take a claimed frame away from its page and put it on the free list unless it is retired, writing the
+   * page back if it is dirty. Caller should hold the latch.
+   */
+  void DropFrame(frame_id_t frame_id);
+
+  /**
+   * @brief Pick a frame from the free list or the replacer, map page_id to it, pin it and mark it LOADING.
+   * Caller should hold the latch.
+   * @param[out] frame_id the picked frame
+   * @param page_id the page that is going to live in the frame
+   * @param access_type type of the access that brings the page in, passed on to the replacer
+   * @return false if every frame is pinned
+   */
+  auto GetUsablePage(frame_id_t *frame_id, page_id_t page_id, AccessType access_type,
+                     std::unique_lock<std::mutex> &lock) -> bool;
+
+  /**
+   * @brief Evict a frame through the replacer, once the buffered accesses of all stripes are recorded. Pinned frames
+   * are passed over. Caller should hold the latch.
+   * @param[out] frame_id the evicted frame, claimed through its evicting_ flag
+   * @return false if no frame could be evicted
+   */
+  auto EvictFrame(frame_id_t *frame_id) -> bool;
+
+  /**
+   * @brief Set the evicting_ flag of a frame if it is unpinned. Lock-free hits that pin the frame afterwards see the
+   * flag and back off. Caller should hold the latch and clear the flag once the frame is remapped.
+   * @return false if the frame is pinned, the flag is left clear then
+   */
+  auto ClaimFrame(frame_id_t frame_id) -> bool;
+
+  /**
+   * @brief ClaimFrame for callers that don't run under the replacer's latch. A failed claim updates the frame's
+   * evictability, which a concurrent pin may have decided on while the flag was set.
+   */
+  auto ClaimResidentFrame(frame_id_t frame_id) -> bool;
+
+  /**
+   * @brief Let the replacer decide whether a frame is evictable, from its pin count and state. Called after every
+   * change that may alter the decision; the last call wins.
+   */
+  void UpdateEvictable(frame_id_t frame_id);
+
+  /** @brief Pin a resident frame, making it non-evictable if it was unpinned. */
+  void PinResident(frame_id_t frame_id);
+
+  /** @brief Drop a pin on a resident frame, making it evictable once the last pin is gone. */
+  void UnpinResident(frame_id_t frame_id);
+
+  /** @brief Buffer the access of a lock-free hit in the calling thread's stripe. */
+  void BufferAccess(frame_id_t frame_id, page_id_t page_id, AccessType access_type);
+
+  /** @brief Record the buffered accesses of a stripe in the replacer. Caller should hold the stripe's latch. */
+  void FlushAccesses(AccessStripe *stripe);
+
+  /** @brief Drop the accesses of a stripe to pages that left their frame since. Caller should hold the stripe's latch. */
+  void DropStaleAccesses(AccessStripe *stripe);
+
+  /**
+   * @brief Finish a frame picked by GetUsablePage: write back its dirty victim, then zero it and optionally read
+   * the page from disk. The latch is released during the I/O and held again on return.
+   * @return false if the read failed, the frame is released then
+   */
+  auto LoadFrame(frame_id_t frame_id, bool read_from_disk, std::unique_lock<std::mutex> &lock) -> bool;
+
+  /**
+   * @brief Complete the prefetch read into a frame: let fetchers in and keep the frame away from the replacer until
+   * somebody fetches it. Runs as the completion callback of the read.
+   * @param read_ok false if the read failed, the frame is released then
+   */
+  void FinishPrefetch(frame_id_t frame_id, std::chrono::steady_clock::time_point start, bool read_ok);
+
+  /**
+   * @brief Take the page out of a frame whose read failed and wake the fetchers waiting for it, they come back
+   * empty-handed. Caller should hold the latch.
+   */
+  void FailLoad(frame_id_t frame_id);
+
+  /**
+   * @brief Drop a pin on a frame whose read failed. The last holder puts the frame on the free list, one that loses
+   * the claim to a passing lock-free hit leaves the empty frame to eviction. Caller should hold the latch.
+   */
+  void ReleaseFailedFrame(frame_id_t frame_id);
+
+  /**
+   * @brief Hand the oldest prefetched frame that nobody fetched over to the replacer. Caller should hold the latch.
+   * @return false if there is no such frame
+   */
+  auto ReleaseOldestPrefetched() -> bool;
+
+  /**
+   * @brief Pin the dirty, resident pages among page_ids and clear their dirty flags. Caller should hold the latch.
+   * @param[out] writes the pages, pointing at the frames
+   * @param[out] frame_ids their frames
+   */
+  void PinDirtyPages(const std::vector<page_id_t> &page_ids, std::vector<DiskManager::PageWrite> *writes,
+                     std::vector<frame_id_t> *frame_ids);
+
+  /**
+   * @brief Write a resident page to disk and clear its dirty flag. The frame stays pinned while the latch is released
+   * for the write.
+   * @param only_dirty skip the write if the page is clean
+   * @param latch_page hold the page's read latch during the write
+   * @return false if the page is not resident
+   */
+  auto FlushPageLocked(page_id_t page_id, bool only_dirty, bool latch_page, std::unique_lock<std::mutex> &lock)
+      -> bool;
+};
+}  // namespace bustub
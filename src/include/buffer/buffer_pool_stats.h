@@ -0,0 +1,123 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// buffer_pool_stats.h
+//
+// Identification: src/include/buffer/buffer_pool_stats.h
+//
+// Copyright (c) 2015-2023, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cstdint>
+#include <string>
+
+#include "common/config.h"
+#include "common/macros.h"
+
+namespace bustub {
+
+/**
+ * LatencyHistogram counts latencies in power-of-two buckets of nanoseconds. Recording is a few relaxed atomic
+ * increments, so it can be called from any thread without a latch; readers see a consistent enough picture for
+ * monitoring, not an exact snapshot.
+ */
+class LatencyHistogram {
+ public:
+  /** Bucket i counts latencies in [2^(i-1), 2^i) ns, bucket 0 counts 0 ns, the last one everything above. */
+  static constexpr size_t NUM_BUCKETS = 40;
+
+  LatencyHistogram() = default;
+
+  DISALLOW_COPY_AND_MOVE(LatencyHistogram);
+
+  ~LatencyHistogram() = default;
+
+  /** @brief Record one latency. */
+  void Record(std::chrono::nanoseconds latency);
+
+  /** @brief Add the latencies recorded by other to this histogram. */
+  void Merge(const LatencyHistogram &other);
+
+  /** @brief Forget every recorded latency. */
+  void Reset();
+
+  /** @return the number of recorded latencies */
+  auto GetCount() const -> uint64_t { return count_.load(std::memory_order_relaxed); }
+
+  /** @return the mean latency in ns, 0 if nothing was recorded */
+  auto GetMean() const -> uint64_t;
+
+  /**
+   * @param fraction a fraction in [0, 1], e.g. 0.99
+   * @return an upper bound of the latency in ns below which that fraction of the recorded latencies lie, 0 if
+   * nothing was recorded
+   */
+  auto GetPercentile(double fraction) const -> uint64_t;
+
+  /** @return "count=... mean=...ns p50=...ns p99=...ns max=...ns" */
+  auto ToString() const -> std::string;
+
+  /**
+   * @brief Decide whether the calling thread times its next operation, so that hot paths only pay for the clock on
+   * one in BUFFER_POOL_STATS_SAMPLE_RATE calls.
+   */
+  static auto ShouldSample() -> bool;
+
+ private:
+  std::array<std::atomic<uint64_t>, NUM_BUCKETS> buckets_{};
+  std::atomic<uint64_t> count_{0};
+  std::atomic<uint64_t> total_ns_{0};
+};
+
+/**
+ * BufferPoolStats are the counters of one buffer pool instance, or of a whole buffer pool once merged. All counters
+ * are relaxed atomics bumped on the paths they count.
+ */
+struct BufferPoolStats {
+  BufferPoolStats() = default;
+
+  DISALLOW_COPY_AND_MOVE(BufferPoolStats);
+
+  ~BufferPoolStats() = default;
+
+  /** Fetches served by a resident page. */
+  std::atomic<uint64_t> hits_{0};
+  /** Fetches that read the page from disk. */
+  std::atomic<uint64_t> misses_{0};
+  /** Frames taken away from their pages to make room for others. */
+  std::atomic<uint64_t> evictions_{0};
+  /** Dirty victims written back by eviction. */
+  std::atomic<uint64_t> write_backs_{0};
+  /** Pages written by flushes, the background flusher and deletion. */
+  std::atomic<uint64_t> flushes_{0};
+  /** Fetches that waited for another thread's I/O on the page. */
+  std::atomic<uint64_t> pin_waits_{0};
+  /** Acquisitions of the instance latch that had to block, and the time they blocked. */
+  std::atomic<uint64_t> latch_waits_{0};
+  std::atomic<uint64_t> latch_wait_ns_{0};
+  /** Latency of the sampled FetchPage calls. */
+  LatencyHistogram fetch_latency_;
+  /** Latency of DiskManager::ReadPage calls. */
+  LatencyHistogram read_latency_;
+
+  /** @brief Add the counters of other to these. */
+  void Merge(const BufferPoolStats &other);
+
+  /** @brief Zero every counter. */
+  void Reset();
+
+  /** @return the fraction of fetches that were hits, 0 if there were none */
+  auto GetHitRate() const -> double;
+
+  /** @return the counters and histograms on one line, "hits=... misses=... ..." */
+  auto ToString() const -> std::string;
+};
+
+}  // namespace bustub
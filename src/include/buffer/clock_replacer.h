@@ -24,6 +24,12 @@ namespace bustub {
 /**
  * ClockReplacer implements the clock replacement policy, which approximates the
  * Least Recently Used policy.
+ *
+ * Every frame has a reference bit that is set on access. The clock hand sweeps
+ * over the frames, clearing reference bits, and evicts the first evictable
+ * frame whose bit is already clear. A frame brought in by a scan starts with a
+ * clear bit, and later scan accesses don't set it, so scanned frames are
+ * reclaimed on the hand's next pass.
  */
 class ClockReplacer : public Replacer {
 public:
@@ -34,21 +40,43 @@ public:
    */
   explicit ClockReplacer(size_t num_pages);
 
+  DISALLOW_COPY_AND_MOVE(ClockReplacer);
+
   /**
    * Destroys the ClockReplacer.
    */
   ~ClockReplacer() override;
 
-  auto Victim(frame_id_t *frame_id) -> bool override;
+  auto EvictIf(frame_id_t *frame_id, const std::function<bool(frame_id_t)> &can_evict) -> bool override;
+
+  void RecordAccess(frame_id_t frame_id,
+                    AccessType access_type = AccessType::Unknown) override;
+
+  void RecordAccesses(const std::vector<AccessRecord> &records) override;
 
-  void Pin(frame_id_t frame_id) override;
+  void SetEvictable(frame_id_t frame_id, bool set_evictable) override;
 
-  void Unpin(frame_id_t frame_id) override;
+  void UpdateEvictable(frame_id_t frame_id, const std::function<bool(frame_id_t)> &is_evictable) override;
+
+  void Remove(frame_id_t frame_id) override;
 
   auto Size() -> size_t override;
 
 private:
-  // TODO(student): implement me!
+  void RecordAccessLocked(frame_id_t frame_id, AccessType access_type);
+  void SetEvictableLocked(frame_id_t frame_id, bool set_evictable);
+
+  struct FrameEntry {
+    bool is_tracked_{false};
+    bool is_evictable_{false};
+    bool ref_{false};
+  };
+
+  std::vector<FrameEntry> frames_;
+  /** The frame the clock hand points at. */
+  size_t hand_{0};
+  size_t evictable_size_{0};
+  std::mutex latch_;
 };
 
 } // namespace bustub
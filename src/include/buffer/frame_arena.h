@@ -0,0 +1,81 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// frame_arena.h
+//
+// Identification: src/include/buffer/frame_arena.h
+//
+// Copyright (c) 2015-2023, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstddef>
+
+#include "common/macros.h"
+#include "storage/page/page.h"
+
+namespace bustub {
+
+/**
+ * FrameArena owns the frames of a buffer pool.
+ *
+ * When BusTub is built with BUSTUB_PAGE_ARENA (the default outside of ASAN debug builds), the data of all frames is
+ * one anonymous mapping, so every frame is aligned to BUSTUB_PAGE_SIZE, as O_DIRECT requires. Fixed-size pools of
+ * at least one huge page are mapped with MAP_HUGETLB where the kernel has huge pages reserved, and otherwise advised
+ * with MADV_HUGEPAGE, which keeps the TLB footprint of large pools small. The mapping is only touched when a frame is
+ * first used, so its memory comes from the NUMA node of the thread that first loads a page into it.
+ *
+ * Without BUSTUB_PAGE_ARENA, every frame allocates its data on the heap on its own, so that ASAN reports an access
+ * past the end of a page instead of silently touching the next frame.
+ *
+ * An arena that can grow is sized for the largest the pool may grow to, but only the frames the pool uses hold
+ * memory: Commit gives frames their memory before the pool starts using them, and Release hands it back once the
+ * pool stops. Such an arena never uses MAP_HUGETLB, whose huge pages are reserved for the whole mapping up front.
+ */
+class FrameArena {
+ public:
+  /** Size of the huge pages the arena tries to use. */
+  static constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+  /**
+   * @brief Allocate num_frames zeroed frames.
+   * @param can_grow leave the frames without memory until they are committed, see Commit
+   */
+  explicit FrameArena(size_t num_frames, bool can_grow = false);
+
+  DISALLOW_COPY_AND_MOVE(FrameArena);
+
+  ~FrameArena();
+
+  /** @return the frames, an array of num_frames pages */
+  auto GetFrames() -> Page * { return frames_; }
+
+  /**
+   * @brief Give the frames [first_frame, first_frame + num_frames) their memory, zeroed. Frames that have it keep
+   * it. With BUSTUB_PAGE_ARENA the memory is already mapped and only faulted in when first touched.
+   */
+  void Commit(size_t first_frame, size_t num_frames);
+
+  /**
+   * @brief Give the memory of the frames [first_frame, first_frame + num_frames) back, they must not be used until
+   * committed again. The Page objects stay valid. Explicitly reserved huge pages are kept.
+   */
+  void Release(size_t first_frame, size_t num_frames);
+
+  /** @return true if the frame data is backed by explicitly reserved huge pages */
+  auto UsesHugePages() const -> bool { return huge_pages_; }
+
+ private:
+  size_t num_frames_;
+  bool can_grow_;
+  Page *frames_{nullptr};
+  /** Start and length of the data mapping, nullptr without BUSTUB_PAGE_ARENA. */
+  char *data_{nullptr};
+  size_t data_size_{0};
+  bool huge_pages_{false};
+};
+
+}  // namespace bustub
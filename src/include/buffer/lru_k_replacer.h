@@ -13,48 +13,98 @@
 #pragma once
 
 #include <limits>
-#include <list>
 #include <mutex>  // NOLINT
-#include <unordered_map>
 #include <utility>
 #include <vector>
 
+#include "buffer/replacer.h"
 #include "common/config.h"
 #include "common/macros.h"
 
 namespace bustub {
 
-enum class AccessType { Unknown = 0, Get, Scan };
-
-enum class InWhichList { NDLIST = 0, CLIST = 1 };
+/**
+ * LRUKNode is the preallocated access record of one frame. The last K access timestamps live in a fixed ring
+ * buffer owned by the replacer, so recording an access never allocates.
+ */
 class LRUKNode {
  public:
-  explicit LRUKNode(size_t k, frame_id_t fid);
+  LRUKNode() = default;
+
+  void Init(size_t k, size_t *history) {
+    k_ = k;
+    history_ = history;
+  }
+
+  /**
+   * @brief Record an access at time_val, dropping the oldest timestamp once K are stored. Batched accesses may arrive
+   * out of order, so the timestamp is inserted at its place and the history stays sorted.
+   */
+  void PushHistory(size_t time_val) {
+    if (history_size_ == k_) {
+      if (time_val < history_[head_]) {
+        return;
+      }
+      head_ = (head_ + 1) % k_;
+      history_size_--;
+    }
+    size_t pos = history_size_;
+    while (pos > 0 && history_[(head_ + pos - 1) % k_] > time_val) {
+      history_[(head_ + pos) % k_] = history_[(head_ + pos - 1) % k_];
+      pos--;
+    }
+    history_[(head_ + pos) % k_] = time_val;
+    history_size_++;
+  }
+
+  /** @brief Replace the whole access history with a single access at time_val. */
+  void ResetHistory(size_t time_val) {
+    head_ = 0;
+    history_size_ = 1;
+    history_[0] = time_val;
+  }
+
+  /** @return the oldest stored timestamp, i.e. the K-th previous access once the frame has K accesses */
+  auto GetOldestTimestamp() const -> size_t { return history_[head_]; }
+
+  auto GetHistorySize() const -> size_t { return history_size_; }
+
+  /** @return true if the frame has less than K accesses, i.e. its backward k-distance is +inf */
+  auto HasInfDistance() const -> bool { return history_size_ < k_; }
 
-  void SetIsEvictable(bool is_evictable, std::unique_lock<std::mutex> &lock) { is_evictable_ = is_evictable; }
+  auto GetIsEvictable() const -> bool { return is_evictable_; }
 
-  auto GetIsEvictable(std::unique_lock<std::mutex> &lock) -> bool { return is_evictable_; }
+  void SetIsEvictable(bool is_evictable) { is_evictable_ = is_evictable; }
 
-  auto GetFrameId(std::unique_lock<std::mutex> &lock) -> frame_id_t { return fid_; }
+  /** @return true if the frame has only been touched by scans since it was loaded */
+  auto GetIsScan() const -> bool { return is_scan_; }
 
-  auto GetHistorySize(std::unique_lock<std::mutex> &lock) -> size_t { return history_size_; }
+  void SetIsScan(bool is_scan) { is_scan_ = is_scan; }
 
-  auto PushHistory(size_t time_val, std::unique_lock<std::mutex> &lock) -> bool;
+  auto GetHeapIndex() const -> size_t { return heap_index_; }
 
-  auto GetBackwardK(double &bk, size_t timeval, std::unique_lock<std::mutex> &lock) -> bool;
+  void SetHeapIndex(size_t heap_index) { heap_index_ = heap_index; }
 
-  ~LRUKNode() = default;
+  /** @brief Forget the access history, the frame becomes untracked. */
+  void Reset() {
+    head_ = 0;
+    history_size_ = 0;
+    is_evictable_ = false;
+    is_scan_ = false;
+  }
+
+  static constexpr size_t NOT_IN_HEAP = std::numeric_limits<size_t>::max();
 
  private:
-  /** History of last seen K timestamps of this page. Least recent timestamp
-   * stored in front. */
-  // Remove maybe_unused if you start using them. Feel free to change the member
-  // variables as you want.
-  std::list<size_t> history_;
+  /** Ring buffer of the last K access timestamps, the oldest one at head_. */
+  size_t *history_{nullptr};
+  size_t head_{0};
   size_t history_size_{0};
-  size_t k_;
-  frame_id_t fid_;
+  size_t k_{0};
   bool is_evictable_{false};
+  bool is_scan_{false};
+  /** Position of the frame in the replacer's eviction heap, NOT_IN_HEAP if it is not evictable. */
+  size_t heap_index_{NOT_IN_HEAP};
 };
 
 /**
@@ -67,8 +117,22 @@ class LRUKNode {
  * A frame with less than k historical references is given
  * +inf as its backward k-distance. When multipe frames have +inf backward
  * k-distance, classical LRU algorithm is used to choose victim.
+ *
+ * Evictable frames are kept in a binary min-heap ordered by (finite distance,
+ * oldest stored timestamp), so the victim is always at the top. Frames with
+ * +inf distance sort before all others, and among them the oldest timestamp is
+ * the first access. RecordAccess and SetEvictable are O(log n), Evict is
+ * O(log n) and nothing is allocated after construction.
+ *
+ * Scans are kept from flushing the working set, in the spirit of 2Q: a frame
+ * that has only seen AccessType::Scan accesses since it was loaded sits in a
+ * probationary class that is evicted before everything else, oldest scan
+ * first, so a sequential scan recycles its own frames. A scan touching a frame
+ * that already has regular accesses is not recorded, so it can't shorten the
+ * frame's k-distance either. The first regular access to a scanned frame
+ * promotes it, starting its history afresh.
  */
-class LRUKReplacer {
+class LRUKReplacer : public Replacer {
  public:
   /**
    *
@@ -87,7 +151,7 @@ class LRUKReplacer {
    *
    * @brief Destroys the LRUReplacer.
    */
-  ~LRUKReplacer() = default;
+  ~LRUKReplacer() override = default;
 
   /**
    * TODO(P1): Add implementation
@@ -101,13 +165,15 @@ class LRUKReplacer {
    * evict frame with earliest timestamp based on LRU.
    *
    * Successful eviction of a frame should decrement the size of replacer and
-   * remove the frame's access history.
+   * remove the frame's access history. Frames rejected by can_evict are
+   * skipped and stay in the heap.
    *
    * @param[out] frame_id id of frame that is evicted.
+   * @param can_evict decides whether a candidate may be evicted now
    * @return true if a frame is evicted successfully, false if no frames can be
    * evicted.
    */
-  auto Evict(frame_id_t *frame_id) -> bool;
+  auto EvictIf(frame_id_t *frame_id, const std::function<bool(frame_id_t)> &can_evict) -> bool override;
 
   /**
    * TODO(P1): Add implementation
@@ -120,11 +186,19 @@ class LRUKReplacer {
    * exception. You can also use BUSTUB_ASSERT to abort the process if frame id
    * is invalid.
    *
+   * A Scan access only counts for frames that have not seen any other kind of
+   * access, see the class comment.
+   *
    * @param frame_id id of frame that received a new access.
-   * @param access_type type of access that was received. This parameter is only
-   * needed for leaderboard tests.
+   * @param access_type type of access that was received.
    */
-  void RecordAccess(frame_id_t frame_id, AccessType access_type = AccessType::Unknown);
+  void RecordAccess(frame_id_t frame_id, AccessType access_type = AccessType::Unknown) override;
+
+  /**
+   * @brief Record accesses at their timestamps, see RecordAccess. Records of frames that are not tracked are
+   * dropped.
+   */
+  void RecordAccesses(const std::vector<AccessRecord> &records) override;
 
   /**
    * TODO(P1): Add implementation
@@ -145,7 +219,9 @@ class LRUKReplacer {
    * @param frame_id id of frame whose 'evictable' status will be modified
    * @param set_evictable whether the given frame is evictable or not
    */
-  void SetEvictable(frame_id_t frame_id, bool set_evictable);
+  void SetEvictable(frame_id_t frame_id, bool set_evictable) override;
+
+  void UpdateEvictable(frame_id_t frame_id, const std::function<bool(frame_id_t)> &is_evictable) override;
 
   /**
    * TODO(P1): Add implementation
@@ -165,7 +241,7 @@ class LRUKReplacer {
    *
    * @param frame_id id of frame to be removed
    */
-  void Remove(frame_id_t frame_id);
+  void Remove(frame_id_t frame_id) override;
 
   /**
    * TODO(P1): Add implementation
@@ -174,24 +250,32 @@ class LRUKReplacer {
    *
    * @return size_t
    */
-  auto Size() -> size_t;
+  auto Size() -> size_t override;
 
  private:
-  // TODO(student): implement me! You can replace these member variables as you
-  // like. Remove maybe_unused if you start using them.
-  std::list<LRUKNode> node_list_;
-  std::list<LRUKNode> cache_list_;
-  std::unordered_map<frame_id_t, std::pair<std::list<LRUKNode>::iterator, InWhichList>> node_store_;
-  std::list<LRUKNode>::iterator young_list_;
-  size_t current_timestamp_{0};
-  size_t curr_size_{0};
+  /** @return true if frame a should be evicted before frame b */
+  auto EvictsBefore(frame_id_t a, frame_id_t b) const -> bool;
+  void HeapSwap(size_t i, size_t j);
+  void HeapSiftUp(size_t i);
+  void HeapSiftDown(size_t i);
+  void HeapPush(frame_id_t frame_id);
+  void HeapErase(frame_id_t frame_id);
+  /** @brief Restore the heap order after the key of frame_id changed. */
+  void HeapUpdate(frame_id_t frame_id);
+  void RecordAccessLocked(frame_id_t frame_id, AccessType access_type, size_t timestamp);
+  void SetEvictableLocked(frame_id_t frame_id, bool set_evictable);
+
+  /** Access records of all frames, indexed by frame id. */
+  std::vector<LRUKNode> node_store_;
+  /** Ring buffers of all frames, K slots per frame. */
+  std::vector<size_t> history_;
+  /** Min-heap of the evictable frames, the next victim on top. */
+  std::vector<frame_id_t> heap_;
+  /** Candidates rejected during the current EvictIf, kept as a member so that eviction doesn't allocate. */
+  std::vector<frame_id_t> rejected_;
   size_t replacer_size_;
   size_t k_;
   std::mutex latch_;
-  std::mutex node_latch_;
-  std::mutex cache_latch_;
-
-  auto EvictInList(std::list<LRUKNode> &list, frame_id_t *frame_id, std::unique_lock<std::mutex> &lock) -> bool;
 };
 
 }  // namespace bustub
@@ -23,6 +23,13 @@ namespace bustub {
 
 /**
  * LRUReplacer implements the Least Recently Used replacement policy.
+ *
+ * Tracked frames are kept in one list ordered by their last access, the least
+ * recently used one at the front. Eviction takes the first evictable frame from
+ * the front, so it only has to step over the pinned frames. A frame brought in
+ * by a scan is placed at the front instead of the back, so that the scan
+ * recycles its own frames; later scan accesses to a tracked frame don't move
+ * it.
  */
 class LRUReplacer : public Replacer {
 public:
@@ -33,21 +40,44 @@ public:
    */
   explicit LRUReplacer(size_t num_pages);
 
+  DISALLOW_COPY_AND_MOVE(LRUReplacer);
+
   /**
    * Destroys the LRUReplacer.
    */
   ~LRUReplacer() override;
 
-  auto Victim(frame_id_t *frame_id) -> bool override;
+  auto EvictIf(frame_id_t *frame_id, const std::function<bool(frame_id_t)> &can_evict) -> bool override;
+
+  void RecordAccess(frame_id_t frame_id,
+                    AccessType access_type = AccessType::Unknown) override;
+
+  void RecordAccesses(const std::vector<AccessRecord> &records) override;
 
-  void Pin(frame_id_t frame_id) override;
+  void SetEvictable(frame_id_t frame_id, bool set_evictable) override;
 
-  void Unpin(frame_id_t frame_id) override;
+  void UpdateEvictable(frame_id_t frame_id, const std::function<bool(frame_id_t)> &is_evictable) override;
+
+  void Remove(frame_id_t frame_id) override;
 
   auto Size() -> size_t override;
 
 private:
-  // TODO(student): implement me!
+  void RecordAccessLocked(frame_id_t frame_id, AccessType access_type);
+  void SetEvictableLocked(frame_id_t frame_id, bool set_evictable);
+
+  struct FrameEntry {
+    bool is_tracked_{false};
+    bool is_evictable_{false};
+    /** Position in lru_list_, valid while the frame is tracked. */
+    std::list<frame_id_t>::iterator pos_;
+  };
+
+  /** Tracked frames, least recently used first. */
+  std::list<frame_id_t> lru_list_;
+  std::vector<FrameEntry> frames_;
+  size_t evictable_size_{0};
+  std::mutex latch_;
 };
 
 } // namespace bustub
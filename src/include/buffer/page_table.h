@@ -0,0 +1,108 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// page_table.h
+//
+// Identification: src/include/buffer/page_table.h
+//
+// Copyright (c) 2015-2023, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "common/config.h"
+#include "common/macros.h"
+
+namespace bustub {
+
+/**
+ * PageTable maps the ids of the resident pages of a buffer pool instance to their frames.
+ *
+ * It is an open-addressing table with linear probing and a fixed capacity of at least twice the number of frames,
+ * so it never grows. Every slot is one 64-bit atomic holding a page id and a frame id. Writers must be serialized by
+ * the caller. Readers take no lock: Find is validated against a version counter that writers bump before and after
+ * every change, seqlock style, and retries when a writer got in the way. Erase shifts the following entries back
+ * instead of leaving tombstones, so lookups never slow down as pages come and go.
+ *
+ * A mapping returned by Find may be stale by the time the caller uses it, so lock-free callers have to validate it
+ * against the frame itself.
+ */
+class PageTable {
+ public:
+  /**
+   * @brief Create a page table for an instance with num_frames frames.
+   */
+  explicit PageTable(size_t num_frames);
+
+  DISALLOW_COPY_AND_MOVE(PageTable);
+
+  ~PageTable() = default;
+
+  /**
+   * @brief Look up the frame of a page. Safe to call concurrently with writers.
+   * @param page_id id of the page
+   * @param[out] frame_id the frame the page lives in
+   * @return true if the page was resident at some instant during the call
+   */
+  auto Find(page_id_t page_id, frame_id_t *frame_id) const -> bool;
+
+  /**
+   * @brief Map page_id to frame_id. The page must not be mapped yet. Writers must be serialized.
+   */
+  void Insert(page_id_t page_id, frame_id_t frame_id);
+
+  /**
+   * @brief Remove the mapping of page_id. Writers must be serialized.
+   * @return false if the page was not mapped
+   */
+  auto Erase(page_id_t page_id) -> bool;
+
+  /** @return the number of mapped pages */
+  auto Size() const -> size_t { return size_; }
+
+  /**
+   * @brief Call f(page_id, frame_id) for every mapping. Must not run concurrently with writers.
+   */
+  template <typename F>
+  void ForEach(F &&f) const {
+    for (size_t i = 0; i <= mask_; ++i) {
+      uint64_t slot = slots_[i].load(std::memory_order_relaxed);
+      if (slot != EMPTY) {
+        f(PageOf(slot), FrameOf(slot));
+      }
+    }
+  }
+
+ private:
+  static constexpr uint64_t EMPTY = ~static_cast<uint64_t>(0);
+  static constexpr size_t NO_SLOT = ~static_cast<size_t>(0);
+
+  static auto Pack(page_id_t page_id, frame_id_t frame_id) -> uint64_t {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(page_id)) << 32) | static_cast<uint32_t>(frame_id);
+  }
+  static auto PageOf(uint64_t slot) -> page_id_t { return static_cast<page_id_t>(slot >> 32); }
+  static auto FrameOf(uint64_t slot) -> frame_id_t { return static_cast<frame_id_t>(slot & 0xffffffff); }
+
+  /** @return the slot where the probe sequence of page_id starts */
+  auto Home(page_id_t page_id) const -> size_t;
+
+  /** @return the slot holding page_id, or NO_SLOT if the page is not mapped. Only exact without concurrent writers. */
+  auto Probe(page_id_t page_id) const -> size_t;
+
+  std::unique_ptr<std::atomic<uint64_t>[]> slots_;
+  /** Number of slots minus one, the number of slots is a power of two. */
+  size_t mask_;
+  /** log2 of the number of slots. */
+  size_t bits_;
+  size_t size_{0};
+  /** Odd while a writer is changing the slots. */
+  std::atomic<uint64_t> version_{0};
+};
+
+}  // namespace bustub
@@ -0,0 +1,51 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// read_ahead.h
+//
+// Identification: src/include/buffer/read_ahead.h
+//
+// Copyright (c) 2015-2023, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstddef>
+
+#include "common/config.h"
+
+namespace bustub {
+
+class BufferPoolManager;
+
+/**
+ * ReadAhead detects a scan walking a page chain whose next pages have consecutive ids, as table heaps and freshly
+ * built B+ tree leaf chains usually do, and prefetches the pages ahead of it.
+ *
+ * Once the scan has followed READ_AHEAD_TRIGGER consecutive ids, READ_AHEAD_MIN_PAGES pages past the current one are
+ * prefetched. Whenever the scan gets halfway through what has been prefetched, the next window is requested at
+ * twice the size, up to READ_AHEAD_MAX_PAGES or a quarter of the pool. A jump to a non-consecutive page starts over.
+ */
+class ReadAhead {
+ public:
+  explicit ReadAhead(BufferPoolManager *bpm = nullptr);
+
+  /**
+   * @brief Report that the scan moved on to page_id.
+   */
+  void Advance(page_id_t page_id);
+
+ private:
+  BufferPoolManager *bpm_;
+  size_t max_window_{0};
+  page_id_t last_page_id_{INVALID_PAGE_ID};
+  /** Number of consecutive page ids followed so far. */
+  size_t run_{0};
+  size_t window_{0};
+  /** One past the last page requested, INVALID_PAGE_ID before the first request. */
+  page_id_t prefetched_end_{INVALID_PAGE_ID};
+};
+
+}  // namespace bustub
@@ -12,41 +12,128 @@
 
 #pragma once
 
+#include <atomic>
+#include <functional>
+#include <vector>
+
 #include "common/config.h"
+#include "common/macros.h"
 
 namespace bustub {
 
+enum class AccessType { Unknown = 0, Get, Scan };
+
+/** The replacement policies a buffer pool can be built with. */
+enum class ReplacerType { LRUK = 0, LRU, CLOCK, ARC };
+
 /**
- * Replacer is an abstract class that tracks page usage.
+ * Replacer is an abstract class that tracks frame usage and picks the frame to
+ * evict when the buffer pool runs out of free frames.
+ *
+ * A frame is tracked from its first RecordAccess until it is evicted or
+ * removed. Only frames marked evictable are eviction candidates, and Size()
+ * counts exactly those. The buffer pool marks a frame evictable when its pin
+ * count drops to zero. Pins taken without the buffer pool latch decide that
+ * through UpdateEvictable, and can report their accesses later, in batches,
+ * through RecordAccesses.
  */
 class Replacer {
 public:
+  /** An access recorded away from the replacer, reported later through RecordAccesses. */
+  struct AccessRecord {
+    frame_id_t frame_id_;
+    AccessType access_type_;
+    /** When the access happened, taken from Now(). */
+    size_t timestamp_;
+  };
+
   Replacer() = default;
+  DISALLOW_COPY_AND_MOVE(Replacer);
   virtual ~Replacer() = default;
 
   /**
-   * Remove the victim frame as defined by the replacement policy.
-   * @param[out] frame_id id of frame that was removed, nullptr if no victim was
-   * found
-   * @return true if a victim frame was found, false otherwise
+   * Evict the frame the replacement policy ranks first among the evictable
+   * frames can_evict accepts, and forget its access history. Rejected frames
+   * keep their place and history. can_evict runs with the replacer's latch
+   * held, so it must not call back into the replacer.
+   * @param[out] frame_id id of the evicted frame
+   * @param can_evict decides whether a candidate may be evicted now
+   * @return true if a frame was evicted, false if no frame is evictable or
+   * every one was rejected
    */
-  virtual auto Victim(frame_id_t *frame_id) -> bool = 0;
+  virtual auto EvictIf(frame_id_t *frame_id, const std::function<bool(frame_id_t)> &can_evict) -> bool = 0;
 
   /**
-   * Pins a frame, indicating that it should not be victimized until it is
-   * unpinned.
-   * @param frame_id the id of the frame to pin
+   * Evict a frame as defined by the replacement policy and forget its access
+   * history.
+   * @param[out] frame_id id of the evicted frame
+   * @return true if a frame was evicted, false if no frame is evictable
    */
-  virtual void Pin(frame_id_t frame_id) = 0;
+  auto Evict(frame_id_t *frame_id) -> bool {
+    return EvictIf(frame_id, [](frame_id_t) { return true; });
+  }
+
+  /**
+   * Record an access to the given frame, starting to track it if it is not
+   * tracked yet. AccessType::Scan marks accesses of sequential scans, which
+   * policies may keep from displacing the working set.
+   * @param frame_id id of the accessed frame
+   * @param access_type type of the access
+   */
+  virtual void RecordAccess(frame_id_t frame_id, AccessType access_type) = 0;
+
+  /**
+   * Record a batch of accesses at the times they happened, under one
+   * acquisition of the replacer's latch. Policies that don't keep timestamps
+   * apply the records in order, so callers sort them by timestamp. Records of
+   * untracked frames are dropped, their pages were evicted since.
+   * @param records the accesses, their timestamps taken from Now()
+   */
+  virtual void RecordAccesses(const std::vector<AccessRecord> &records) = 0;
+
+  /** @return the current time of the replacer's logical clock, advancing it. Lock-free. */
+  auto Now() -> size_t { return clock_.fetch_add(1, std::memory_order_relaxed) + 1; }
 
   /**
-   * Unpins a frame, indicating that it can now be victimized.
-   * @param frame_id the id of the frame to unpin
+   * Mark a tracked frame as evictable or not, e.g. when its pin count drops
+   * to zero or leaves it.
+   * @param frame_id id of the frame
+   * @param set_evictable whether the frame may be evicted
    */
-  virtual void Unpin(frame_id_t frame_id) = 0;
+  virtual void SetEvictable(frame_id_t frame_id, bool set_evictable) = 0;
 
-  /** @return the number of elements in the replacer that can be victimized */
+  /**
+   * Mark a tracked frame as evictable if is_evictable accepts it and as not
+   * evictable otherwise. is_evictable runs under the replacer's latch, so of
+   * several racing updates the last one decides on the latest state. Untracked
+   * frames are ignored.
+   * @param frame_id id of the frame
+   * @param is_evictable decides whether the frame may be evicted
+   */
+  virtual void UpdateEvictable(frame_id_t frame_id, const std::function<bool(frame_id_t)> &is_evictable) = 0;
+
+  /**
+   * Stop tracking an evictable frame without evicting it, e.g. because its
+   * page was deleted. Untracked frames are ignored, non-evictable ones throw.
+   * @param frame_id id of the frame
+   */
+  virtual void Remove(frame_id_t frame_id) = 0;
+
+  /**
+   * Tell the replacer which page is being loaded into a frame, before the
+   * first RecordAccess of that frame. Only policies that remember evicted
+   * pages need it.
+   * @param frame_id id of the frame
+   * @param page_id id of the page now living in the frame
+   */
+  virtual void SetPage([[maybe_unused]] frame_id_t frame_id, [[maybe_unused]] page_id_t page_id) {}
+
+  /** @return the number of evictable frames */
   virtual auto Size() -> size_t = 0;
+
+private:
+  /** Logical clock handing out access timestamps. */
+  std::atomic<size_t> clock_{0};
 };
 
 } // namespace bustub
@@ -203,6 +203,7 @@ public:
    * @param key_attrs Key attributes
    * @param keysize Size of the key
    * @param hash_function The hash function for the index
+   * @param page_format The format of the index's B+ tree pages
    * @return A (non-owning) pointer to the metadata of the new table
    */
   template <class KeyType, class ValueType, class KeyComparator>
@@ -210,7 +211,9 @@ public:
                    const std::string &table_name, const Schema &schema,
                    const Schema &key_schema,
                    const std::vector<uint32_t> &key_attrs, std::size_t keysize,
-                   HashFunction<KeyType> hash_function) -> IndexInfo * {
+                   HashFunction<KeyType> hash_function,
+                   IndexPageFormat page_format = DEFAULT_INDEX_PAGE_FORMAT)
+      -> IndexInfo * {
     // Reject the creation request for nonexistent table
     if (table_names_.find(table_name) == table_names_.end()) {
       return NULL_INDEX_INFO;
@@ -240,16 +243,22 @@ public:
     // TODO(chi): support both hash index and btree index
     auto index =
         std::make_unique<BPlusTreeIndex<KeyType, ValueType, KeyComparator>>(
-            std::move(meta), bpm_);
+            std::move(meta), bpm_, page_format);
 
-    // Populate the index with all tuples in table heap
+    // Populate the index with all tuples in table heap, the tree is built
+    // bottom-up from the sorted keys, which are normalized like those the
+    // index builds itself
     auto *table_meta = GetTable(table_name);
+    std::vector<std::pair<KeyType, ValueType>> entries;
     for (auto iter = table_meta->table_->MakeIterator(); !iter.IsEnd();
          ++iter) {
       auto [meta, tuple] = iter.GetTuple();
-      index->InsertEntry(tuple.KeyFromTuple(schema, key_schema, key_attrs),
-                         tuple.GetRid(), txn);
+      KeyType index_key;
+      index_key.SetFromKey(tuple.KeyFromTuple(schema, key_schema, key_attrs),
+                           index->GetKeySchema());
+      entries.emplace_back(index_key, tuple.GetRid());
     }
+    index->BulkLoad(&entries, txn);
 
     // Get the next OID for the new index
     const auto index_oid = next_index_oid_.fetch_add(1);
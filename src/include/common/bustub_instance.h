@@ -289,10 +289,25 @@ public:
     return variable == "1" || variable == "true" || variable == "yes";
   }
 
+  /** @return the page format of the indexes this session creates */
+  auto GetIndexPageFormat() -> IndexPageFormat {
+    auto variable =
+        StringUtil::Lower(GetSessionVariable("compress_index_pages"));
+    if (variable.empty()) {
+      return DEFAULT_INDEX_PAGE_FORMAT;
+    }
+    return variable == "1" || variable == "true" || variable == "yes"
+               ? IndexPageFormat::COMPRESSED
+               : IndexPageFormat::PLAIN;
+  }
+
 private:
   void CmdDisplayTables(ResultWriter &writer);
   void CmdDisplayIndices(ResultWriter &writer);
   void CmdDisplayHelp(ResultWriter &writer);
+  /** Write the counters of the buffer pool, one row for the pool and one per
+   * shard. Serves `show bpm_stats`. */
+  void CmdDisplayBpmStats(ResultWriter &writer);
   void WriteOneCell(const std::string &cell, ResultWriter &writer);
 
   void HandleCreateStatement(Transaction *txn, const CreateStatement &stmt,
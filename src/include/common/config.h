@@ -21,6 +21,10 @@ namespace bustub {
 /** Cycle detection is performed every CYCLE_DETECTION_INTERVAL milliseconds. */
 extern std::chrono::milliseconds cycle_detection_interval;
 
+/** The background flusher of the buffer pool checks the dirty ratio every
+ * BACKGROUND_FLUSH_INTERVAL milliseconds. */
+extern std::chrono::milliseconds background_flush_interval;
+
 /** True if logging should be enabled, false otherwise. */
 extern std::atomic<bool> enable_logging;
 
@@ -38,6 +42,42 @@ static constexpr int LOG_BUFFER_SIZE =
     ((BUFFER_POOL_SIZE + 1) * BUSTUB_PAGE_SIZE); // size of a log buffer in byte
 static constexpr int BUCKET_SIZE = 50;     // size of extendible hash bucket
 static constexpr int LRUK_REPLACER_K = 10; // lookback window for lru-k replacer
+static constexpr double BUFFER_POOL_DIRTY_HIGH_WATERMARK =
+    0.3; // dirty frame ratio above which the background flusher cleans frames
+static constexpr double BUFFER_POOL_DIRTY_LOW_WATERMARK =
+    0.1; // dirty frame ratio at which the background flusher stops
+static constexpr int PREFETCH_THREADS = 2; // threads loading prefetched pages
+static constexpr int READ_AHEAD_TRIGGER =
+    2; // consecutive page ids a scan follows before read-ahead kicks in
+static constexpr int READ_AHEAD_MIN_PAGES = 4;  // first read-ahead window
+static constexpr int READ_AHEAD_MAX_PAGES = 64; // largest read-ahead window
+static constexpr int BTREE_SWIP_ROWS =
+    1024; // inner nodes per B+ tree that remember the frames of their
+          // children, 0 disables pointer swizzling
+static constexpr double BTREE_BULK_LOAD_FILL_FACTOR =
+    0.9; // fraction of a B+ tree page filled by a bulk load, the rest is
+         // left for later inserts
+static constexpr bool BTREE_COMPRESS_INDEX_PAGES =
+    false; // new index B+ trees elide common key prefixes and zero suffixes
+           // in their pages, see IndexPageFormat; a session turns it on for
+           // the indexes it creates with `set compress_index_pages=yes`
+static constexpr int BUFFER_POOL_STATS_SAMPLE_RATE =
+    16; // one in n FetchPage calls per thread is timed, 0 disables timing
+static constexpr int TABLE_HEAP_EXTENT_PAGES =
+    16; // contiguous page ids a table heap reserves at a time
+static constexpr int BUFFER_POOL_GROWTH_FACTOR =
+    4; // the buffer pool of a BustubInstance can be resized up to this multiple
+       // of its initial size
+static constexpr int DISK_IO_QUEUE_DEPTH =
+    64; // asynchronous page requests an AsyncDiskManager keeps in flight
+static constexpr int DISK_IO_THREADS =
+    4; // worker threads of AsyncDiskManager when io_uring is unavailable
+static constexpr int WRITE_BATCH_PAGES =
+    64; // dirty pages the buffer pool writes back with one WritePages call
+static constexpr size_t COMPRESSION_SECTOR_SIZE =
+    512; // compressed pages are stored in extents of sectors of this size
+static constexpr size_t DOUBLEWRITE_PAGES =
+    64; // pages the doublewrite buffer stages at a time
 
 using frame_id_t = int32_t;   // frame id type
 using page_id_t = int32_t;    // page id type
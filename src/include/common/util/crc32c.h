@@ -0,0 +1,37 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// crc32c.h
+//
+// Identification: src/include/common/util/crc32c.h
+//
+// Copyright (c) 2015-2023, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace bustub {
+
+/**
+ * Crc32c computes CRC-32C (Castagnoli) checksums, with the crc32 instruction
+ * of SSE 4.2 or ARMv8 where the CPU has it and a table otherwise.
+ */
+class Crc32c {
+public:
+  /**
+   * @param crc the checksum of the bytes before data, to extend it
+   * @return the checksum of data
+   */
+  static auto Compute(const char *data, size_t length, uint32_t crc = 0)
+      -> uint32_t;
+
+  /** @return true if Compute uses a crc32 instruction */
+  static auto IsHardwareAccelerated() -> bool;
+};
+
+} // namespace bustub
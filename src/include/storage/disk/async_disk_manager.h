@@ -0,0 +1,154 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// async_disk_manager.h
+//
+// Identification: src/include/storage/disk/async_disk_manager.h
+//
+// Copyright (c) 2015-2023, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <condition_variable> // NOLINT
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex> // NOLINT
+#include <string>
+#include <thread> // NOLINT
+#include <vector>
+
+#include "common/config.h"
+#include "common/macros.h"
+#include "storage/disk/disk_manager.h"
+
+namespace bustub {
+
+/** The way AsyncDiskManager performs asynchronous page I/O. */
+enum class IoBackend {
+  /** io_uring if the kernel allows it, the thread pool otherwise. */
+  AUTO,
+  IO_URING,
+  THREAD_POOL
+};
+
+/**
+ * AsyncDiskManager keeps many asynchronous page requests in flight. Blocking
+ * page I/O is done by DiskManager.
+ *
+ * With io_uring, queued requests are placed in the submission ring and
+ * SubmitIo passes all of them to the kernel in one system call. A completion
+ * thread reaps finished requests and runs their callbacks. At most queue_depth
+ * requests are queued or in flight at once, queueing more blocks until one
+ * completes.
+ *
+ * Where io_uring is unavailable, SubmitIo hands the queued requests to a pool
+ * of DISK_IO_THREADS workers doing pread and pwrite, which run the callbacks.
+ *
+ * With direct I/O, requests on page buffers that are not aligned to
+ * BUSTUB_PAGE_SIZE are done right away on the calling thread. Compressed
+ * pages don't live at fixed offsets and writes through a doublewrite buffer
+ * are staged first, so with either of them the thread pool is used.
+ */
+class AsyncDiskManager : public DiskManager {
+public:
+  /**
+   * Creates a new disk manager that writes to the specified database file.
+   * @param db_file the file name of the database file to write to
+   * @param backend the way asynchronous I/O is done, io_uring falls back to
+   * the thread pool if the kernel refuses it
+   * @param queue_depth the number of requests queued or in flight at once
+   * @param direct_io open the database file with O_DIRECT
+   * @param sync_policy when written pages are made durable
+   * @param compression how the pages of a new database are stored
+   * @param doublewrite stage written pages in a doublewrite buffer
+   */
+  explicit AsyncDiskManager(
+      const std::string &db_file, IoBackend backend = IoBackend::AUTO,
+      size_t queue_depth = DISK_IO_QUEUE_DEPTH, bool direct_io = false,
+      SyncPolicy sync_policy = SyncPolicy::ON_SYNC,
+      PageCompression compression = PageCompression::NONE,
+      bool doublewrite = false);
+
+  DISALLOW_COPY_AND_MOVE(AsyncDiskManager);
+
+  /** Waits for every submitted request and submits the queued ones first. */
+  ~AsyncDiskManager() override;
+
+  void WritePageAsync(page_id_t page_id, const char *page_data,
+                      IoCallback callback) override;
+
+  void ReadPageAsync(page_id_t page_id, char *page_data,
+                     IoCallback callback) override;
+
+  void SubmitIo() override;
+
+  /** @return the backend in use, never AUTO */
+  auto GetBackend() const -> IoBackend { return backend_; }
+
+private:
+  struct IoRequest {
+    bool is_write_;
+    page_id_t page_id_;
+    char *data_;
+    IoCallback callback_;
+    /** CRC-32C of the page a write was submitted with. */
+    uint32_t checksum_{0};
+  };
+  /** The mapped rings of an io_uring instance. */
+  struct Ring;
+
+  /** @brief Do the I/O of a request with pread or pwrite. */
+  auto DoIo(const IoRequest &request) -> bool {
+    if (!request.is_write_) {
+      return ReadPageFromFile(request.page_id_, request.data_);
+    }
+    if (UsesDoublewrite()) {
+      WriteThroughDoublewrite({{request.page_id_, request.data_}});
+      return true;
+    }
+    return WritePageToFile(request.page_id_, request.data_, request.checksum_);
+  }
+  /** @brief Queue a request with the backend in use. */
+  void Enqueue(IoRequest request);
+
+  /** @brief Set up io_uring, false if the kernel refuses it. */
+  auto SetUpRing(size_t queue_depth) -> bool;
+  /** @brief Pass the requests in the submission ring to the kernel. Caller
+   * should hold queue_latch_. */
+  void SubmitRingLocked();
+  /** Body of the completion thread of io_uring. */
+  void RunCompletion();
+
+  /** Body of a worker of the thread pool. */
+  void RunWorker();
+
+  IoBackend backend_;
+  const size_t queue_depth_;
+
+  /** Protects everything below. */
+  std::mutex queue_latch_;
+  /** Signalled when requests complete. */
+  std::condition_variable completed_;
+
+  std::unique_ptr<Ring> ring_;
+  /** Requests placed in the submission ring but not submitted yet. */
+  size_t queued_{0};
+  /** Requests submitted to the kernel that have not completed yet. */
+  size_t in_flight_{0};
+  std::thread completion_thread_;
+
+  /** Requests queued but not submitted to the workers yet. */
+  std::vector<IoRequest> staged_;
+  /** Requests submitted to the workers. */
+  std::deque<IoRequest> pending_;
+  /** Signalled when requests are submitted to the workers. */
+  std::condition_variable submitted_;
+  std::vector<std::thread> workers_;
+  bool stop_{false};
+};
+
+} // namespace bustub
@@ -0,0 +1,173 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// compressed_page_store.h
+//
+// Identification: src/include/storage/disk/compressed_page_store.h
+//
+// Copyright (c) 2015-2023, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstdint>
+#include <mutex> // NOLINT
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "common/config.h"
+#include "common/macros.h"
+
+namespace bustub {
+
+/** How DiskManager stores data pages in the database file. */
+enum class PageCompression {
+  /** Page k lives at offset k * BUSTUB_PAGE_SIZE. */
+  NONE,
+  /** Pages are compressed in the LZ4 block format and live in extents. */
+  LZ4
+};
+
+/**
+ * CompressedPageStore keeps compressed data pages in the database file of a
+ * DiskManager. Sparse pages, e.g. half-empty table pages, shrink to a few
+ * sectors.
+ *
+ * A page is compressed on its own and stored in an extent, a run of
+ * COMPRESSION_SECTOR_SIZE sectors of the database file. Pages that don't
+ * compress by at least a sector are stored raw. The extent of every page is
+ * recorded in a map file next to the database file; the page-to-extent map
+ * itself is kept in memory.
+ *
+ * A rewritten page never overwrites its extent: it moves to a new one. A
+ * durable store keeps the new map entries in memory until Sync, which makes
+ * the database file durable, then writes the entries and makes the map file
+ * durable, so every map entry on disk points at a whole page. The old extents
+ * are reused only after that. A store that is not durable writes the map
+ * entries right away, reuses old extents at once and never syncs. Free
+ * extents are kept per size and reused before the file grows.
+ *
+ * Reads and writes of different pages run in parallel, the latch only covers
+ * the map. Like DiskManager, the store expects a page never to be written
+ * while it is read or written by another thread.
+ */
+class CompressedPageStore {
+public:
+  /** Number of sectors a raw page takes. */
+  static constexpr size_t SECTORS_PER_PAGE =
+      BUSTUB_PAGE_SIZE / COMPRESSION_SECTOR_SIZE;
+  /** Map entries a durable store keeps in memory before WritePage syncs by
+   * itself. */
+  static constexpr size_t MAX_PENDING_ENTRIES = 256;
+
+  /**
+   * Open the map file, or create it for an empty store.
+   * @param map_file the file name of the map file
+   * @param compression the codec of a new store, an existing one keeps its own
+   * @param durable keep new map entries in memory until Sync, otherwise
+   * write them right away and never sync
+   */
+  CompressedPageStore(const std::string &map_file, PageCompression compression,
+                      bool durable = true);
+
+  DISALLOW_COPY_AND_MOVE(CompressedPageStore);
+
+  ~CompressedPageStore();
+
+  /**
+   * Compress a page and write it to the database file.
+   * @param db_fd file descriptor of the database file
+   * @return false if the write failed
+   */
+  auto WritePage(int db_fd, page_id_t page_id, const char *page_data) -> bool;
+
+  /**
+   * Read a page from the database file and decompress it, zeros if it was
+   * never written.
+   * @param db_fd file descriptor of the database file
+   * @return false if the read failed or the page is corrupt
+   */
+  auto ReadPage(int db_fd, page_id_t page_id, char *page_data) -> bool;
+
+  /**
+   * Make the pages written so far durable, then write their map entries and
+   * make the map file durable, and reuse the extents of rewritten pages.
+   * @param db_fd file descriptor of the database file
+   */
+  void Sync(int db_fd);
+
+  /** @return one past the highest page id ever written */
+  auto GetNumPages() -> page_id_t;
+
+  /** @return the size of the written pages divided by the size of their
+   * extents, 1 if nothing was written */
+  auto GetCompressionRatio() -> double;
+
+  /**
+   * @return true if map_file is the map file of a compressed database
+   */
+  static auto Exists(const std::string &map_file) -> bool;
+
+  /**
+   * Compress src in the LZ4 block format.
+   * @return the compressed size, 0 if it doesn't fit in dst_capacity
+   */
+  static auto Compress(const char *src, size_t src_size, char *dst,
+                       size_t dst_capacity) -> size_t;
+
+  /**
+   * Decompress an LZ4 block into exactly dst_size bytes.
+   * @return false if the block is malformed or of a different size
+   */
+  static auto Decompress(const char *src, size_t src_size, char *dst,
+                         size_t dst_size) -> bool;
+
+private:
+  /** Where a page lives, as recorded in the map file. */
+  struct PageExtent {
+    /** First sector of the extent. */
+    uint32_t sector_;
+    /** Bytes of the stored page, BUSTUB_PAGE_SIZE if raw, 0 if the page was
+     * never written. */
+    uint16_t length_;
+    /** Sectors of the extent. */
+    uint16_t sectors_;
+  };
+  static_assert(sizeof(PageExtent) == 8);
+  static_assert(BUSTUB_PAGE_SIZE % COMPRESSION_SECTOR_SIZE == 0);
+  static_assert(BUSTUB_PAGE_SIZE <= UINT16_MAX);
+
+  /** @brief Find sectors free sectors. Caller should hold latch_. */
+  auto AllocateExtent(size_t sectors) -> uint32_t;
+  /** @brief Hand sectors back. Caller should hold latch_. */
+  void FreeExtent(uint32_t sector, size_t sectors);
+  /** @brief Record the extents of pages in the map file, with one write per
+   * run of adjacent pages. */
+  auto WriteEntries(std::vector<std::pair<page_id_t, PageExtent>> entries)
+      -> bool;
+
+  int map_fd_{-1};
+  const bool durable_;
+  /** Serializes Sync, so that older entries never overwrite newer ones. */
+  std::mutex sync_latch_;
+
+  /** Protects everything below. */
+  std::mutex latch_;
+  std::vector<PageExtent> extents_;
+  /** First sectors of free extents, indexed by their number of sectors. */
+  std::vector<std::vector<uint32_t>> free_extents_;
+  /** Map entries not written yet, in the order the pages were written. */
+  std::vector<std::pair<page_id_t, PageExtent>> pending_entries_;
+  /** Old extents of rewritten pages, free once the map file is synced. */
+  std::vector<PageExtent> unsynced_extents_;
+  /** One past the last sector in use. */
+  uint32_t end_sector_{0};
+  /** Bytes of the written pages before and after compression. */
+  uint64_t page_bytes_{0};
+  uint64_t stored_bytes_{0};
+};
+
+} // namespace bustub
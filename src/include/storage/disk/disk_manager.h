@@ -14,35 +14,104 @@
 
 #include <atomic>
 #include <fstream>
+#include <functional>
 #include <future> // NOLINT
+#include <memory>
 #include <mutex>  // NOLINT
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "common/config.h"
+#include "storage/disk/compressed_page_store.h"
+#include "storage/disk/doublewrite_buffer.h"
 
 namespace bustub {
 
+/** When DiskManager makes written pages durable with fdatasync. */
+enum class SyncPolicy {
+  /** Never, the kernel writes pages back when it sees fit. */
+  NONE,
+  /** When SyncPages is called, e.g. by BufferPoolManager::FlushAllPages. */
+  ON_SYNC,
+  /** After every page write. */
+  EVERY_WRITE
+};
+
 /**
  * DiskManager takes care of the allocation and deallocation of pages within a
  * database. It performs the reading and writing of pages to and from disk,
  * providing a logical file layer within the context of a database management
  * system.
+ *
+ * Data pages are read and written with pread and pwrite at their offsets, so
+ * threads do page I/O at the same time without a latch. The number of pages
+ * the file spans is kept in memory, reads past it are answered with zeros
+ * without touching the file. Writes reach the kernel right away and are made
+ * durable according to the SyncPolicy. With direct I/O the file is opened with
+ * O_DIRECT, bypassing the page cache; page buffers that are not aligned to
+ * BUSTUB_PAGE_SIZE go through an aligned buffer of the calling thread.
+ *
+ * With page compression, every page is compressed on its own and stored in an
+ * extent of the database file, see CompressedPageStore. The layout belongs to
+ * the database: a database created with compression stays compressed, which
+ * the map file next to it records. Compressed files are not opened with
+ * O_DIRECT.
+ *
+ * The CRC-32C of every data page is computed when it is written, kept in a
+ * checksum file next to the database file, and verified when the page is
+ * read. The checksums of a batch of pages are written with one write per run
+ * of adjacent pages. Without a doublewrite buffer a crash between the write of
+ * a page and of its checksum can leave an intact page with a stale checksum,
+ * so a mismatch is only counted and logged. With one, every batch of pages is
+ * first staged durably in the doublewrite buffer, see DoublewriteBuffer, pages
+ * that fail their checksum after a crash are repaired from there when the
+ * database is opened, and a mismatch found later fails the read.
+ *
+ * Besides the blocking ReadPage and WritePage, pages can be read and written
+ * asynchronously: ReadPageAsync and WritePageAsync queue a request, SubmitIo
+ * hands the queued requests to the device in one go, and each request's
+ * callback runs once it has completed. This class completes every request
+ * right away on the calling thread; AsyncDiskManager keeps many of them in
+ * flight.
  */
 class DiskManager {
 public:
+  /**
+   * Called once an asynchronous request has completed, with false if the I/O
+   * failed. Runs on whatever thread completes the request, so it must not
+   * block on anything that waits for I/O.
+   */
+  using IoCallback = std::function<void(bool)>;
+
+  /** A page to write: its id and raw data. */
+  using PageWrite = std::pair<page_id_t, const char *>;
+
   /**
    * Creates a new disk manager that writes to the specified database file.
    * @param db_file the file name of the database file to write to
+   * @param direct_io open the database file with O_DIRECT, ignored where the
+   * file system doesn't support it
+   * @param sync_policy when written pages are made durable
+   * @param compression how the pages of a new database are stored, an
+   * existing database keeps its own layout
+   * @param doublewrite stage written pages in a doublewrite buffer so that
+   * torn pages can be repaired, which syncs every batch twice
    */
-  explicit DiskManager(const std::string &db_file);
+  explicit DiskManager(const std::string &db_file, bool direct_io = false,
+                       SyncPolicy sync_policy = SyncPolicy::ON_SYNC,
+                       PageCompression compression = PageCompression::NONE,
+                       bool doublewrite = false);
 
-  /** FOR TEST / LEADERBOARD ONLY, used by DiskManagerMemory */
+  /** FOR TEST / LEADERBOARD ONLY, used by DiskManagerMemory. MmapDiskManager
+   * opens its files itself. */
   DiskManager() = default;
 
-  virtual ~DiskManager() = default;
+  virtual ~DiskManager();
 
   /**
-   * Shut down the disk manager and close all the file resources.
+   * Shut down the disk manager and close all the file resources. Outstanding
+   * asynchronous requests must have completed.
    */
   void ShutDown();
 
@@ -57,8 +126,119 @@ public:
    * Read a page from the database file.
    * @param page_id id of the page
    * @param[out] page_data output buffer
+   * @return false if the read failed, or the page doesn't match its checksum
+   * and a doublewrite buffer is in use
+   */
+  virtual auto ReadPage(page_id_t page_id, char *page_data) -> bool;
+
+  /**
+   * Write many pages at once. The pages are sorted by id and every run of
+   * adjacent pages is written with one pwritev. With the EVERY_WRITE policy
+   * the file is synced once at the end rather than after every page.
+   * @param pages the pages to write, in any order
+   */
+  virtual void WritePages(std::vector<PageWrite> pages);
+
+  /**
+   * Queue a write of a page. page_data must stay valid and unchanged until the
+   * callback runs.
+   * @param page_id id of the page
+   * @param page_data raw page data
+   * @param callback called once the page is written
+   */
+  virtual void WritePageAsync(page_id_t page_id, const char *page_data,
+                              IoCallback callback);
+
+  /**
+   * Queue a read of a page. page_data must not be touched until the callback
+   * runs.
+   * @param page_id id of the page
+   * @param[out] page_data output buffer
+   * @param callback called once the page is read
+   */
+  virtual void ReadPageAsync(page_id_t page_id, char *page_data,
+                             IoCallback callback);
+
+  /**
+   * Start the requests queued by this and other threads. Requests that are
+   * never submitted may never complete.
+   */
+  virtual void SubmitIo() {}
+
+  /**
+   * @return true if data pages can't be written, the buffer pool then refuses
+   * to create or dirty pages
+   */
+  virtual auto IsReadOnly() -> bool { return false; }
+
+  /**
+   * Point at a page the disk manager keeps in memory, e.g. in a mapping of the
+   * database file, so that the buffer pool can serve it without a copy. Such a
+   * page must only be read.
+   * @param page_id id of the page
+   * @return the page data, nullptr if the page has to be read with ReadPage
+   */
+  virtual auto GetMappedPage([[maybe_unused]] page_id_t page_id)
+      -> const char * {
+    return nullptr;
+  }
+
+  /**
+   * Hint that the pages [first_page_id, first_page_id + count) are about to
+   * be read in order, e.g. by a scan.
+   */
+  virtual void AdviseSequentialRead([[maybe_unused]] page_id_t first_page_id,
+                                    [[maybe_unused]] size_t count) {}
+
+  /**
+   * Write a page of the free-space map. Map pages are kept in a file of their
+   * own, next to the database file, and have ids of their own.
+   * @param map_page_id id of the map page
+   * @param page_data raw page data
+   */
+  virtual void WriteMapPage(page_id_t map_page_id, const char *page_data);
+
+  /**
+   * Read a page of the free-space map.
+   * @param map_page_id id of the map page
+   * @param[out] page_data output buffer
+   * @return false if the map page was never written
+   */
+  virtual auto ReadMapPage(page_id_t map_page_id, char *page_data) -> bool;
+
+  /**
+   * Make the pages written so far durable. Does nothing unless the sync
+   * policy is ON_SYNC.
    */
-  virtual void ReadPage(page_id_t page_id, char *page_data);
+  virtual void SyncPages();
+
+  /** @return the number of pages the database file spans */
+  virtual auto GetNumPages() -> page_id_t;
+
+  /** @return true if the database file was opened with O_DIRECT */
+  auto UsesDirectIo() const -> bool { return direct_io_; }
+
+  /** @return true if data pages are stored compressed */
+  auto UsesCompression() const -> bool {
+    return compressed_store_ != nullptr;
+  }
+
+  /**
+   * @return the size of the written pages divided by the space they take in
+   * the database file, 1 without compression
+   */
+  auto GetCompressionRatio() -> double;
+
+  /** @return true if written pages go through a doublewrite buffer */
+  auto UsesDoublewrite() const -> bool { return doublewrite_ != nullptr; }
+
+  /** @return the number of page reads that failed their checksum */
+  auto GetNumChecksumFailures() const -> uint64_t {
+    return checksum_failures_;
+  }
+
+  /** @return the number of torn pages repaired when the database was opened */
+  auto GetNumRepairedPages() const -> size_t { return repaired_pages_; }
 
   /**
    * Flush the entire log buffer into disk.
@@ -96,18 +276,80 @@ public:
 
 protected:
   auto GetFileSize(const std::string &file_name) -> int;
+  /**
+   * @brief pwrite a whole page at its offset and apply the sync policy.
+   * @return false if the write failed
+   */
+  auto WritePageToFile(page_id_t page_id, const char *page_data) -> bool;
+  /**
+   * @brief Like WritePageToFile, but record the given checksum of the page,
+   * computed before the write was queued.
+   */
+  auto WritePageToFile(page_id_t page_id, const char *page_data,
+                       uint32_t checksum) -> bool;
+  /**
+   * @brief pread a whole page at its offset, zeros past the end of the file.
+   * @return false if the read failed or VerifyChecksum rejects the page
+   */
+  auto ReadPageFromFile(page_id_t page_id, char *page_data) -> bool;
+  /**
+   * @brief Write pages through the doublewrite buffer, a batch at a time.
+   * The pages are not counted as writes.
+   */
+  void WriteThroughDoublewrite(std::vector<PageWrite> pages);
+  /** @brief Remember the checksum of a page that was written. */
+  void RecordChecksum(page_id_t page_id, uint32_t checksum);
+  /** @brief Remember the checksums of a batch of pages that were written. */
+  void RecordChecksums(std::vector<std::pair<page_id_t, uint32_t>> checksums);
+  /** @brief Write the data of a page in place, or as a compressed extent,
+   * without recording its checksum. */
+  auto WritePageData(page_id_t page_id, const char *page_data) -> bool;
+  /** @return false if the page doesn't match its recorded checksum and a
+   * doublewrite buffer is in use */
+  auto VerifyChecksum(page_id_t page_id, const char *page_data) -> bool;
+  /** @brief Account for a completed page write: grow the cached number of
+   * pages and sync if the policy says so. */
+  void PageWritten(page_id_t page_id);
+
   // stream to write log file
   std::fstream log_io_;
   std::string log_name_;
-  // stream to write db file
-  std::fstream db_io_;
+  // file descriptor of the db file
+  int db_fd_{-1};
   std::string file_name_;
+  // number of pages the db file spans
+  std::atomic<page_id_t> num_pages_{0};
+  // the extents of compressed pages, nullptr without compression
+  std::unique_ptr<CompressedPageStore> compressed_store_;
+  // checksums of the data pages, 0 where unknown, and the file keeping them
+  std::vector<uint32_t> checksums_;
+  int checksum_fd_{-1};
+  std::mutex checksum_latch_;
+  std::atomic<uint64_t> checksum_failures_{0};
+  // nullptr without a doublewrite buffer, the latch serializes its batches
+  std::unique_ptr<DoublewriteBuffer> doublewrite_;
+  std::mutex doublewrite_latch_;
+  size_t repaired_pages_{0};
+  bool direct_io_{false};
+  SyncPolicy sync_policy_{SyncPolicy::NONE};
+  // stream to write the free-space map file
+  std::fstream fsm_io_;
+  std::string fsm_name_;
   int num_flushes_{0};
-  int num_writes_{0};
+  std::atomic<int> num_writes_{0};
   bool flush_log_{false};
   std::future<void> *flush_log_f_{nullptr};
-  // With multiple buffer pool instances, need to protect file access
-  std::mutex db_io_latch_;
+  // the free-space map stream has a single cursor
+  std::mutex fsm_io_latch_;
+
+private:
+  /** @brief Write pages in place, coalescing adjacent ones. */
+  void WritePagesInPlace(std::vector<PageWrite> pages);
+  /** @brief Write the intact pages of the doublewrite buffer whose page in
+   * the database file fails its checksum. */
+  void RepairTornPages();
+  /** @brief fdatasync every file written along with the data pages. */
+  void SyncFiles();
 };
 
 } // namespace bustub
@@ -10,6 +10,7 @@
 //
 //===----------------------------------------------------------------------===//
 #include <array>
+#include <atomic>
 #include <cstring>
 #include <fstream>
 #include <future> // NOLINT
@@ -51,7 +52,7 @@ public:
    * @param page_id id of the page
    * @param[out] page_data output buffer
    */
-  void ReadPage(page_id_t page_id, char *page_data) override;
+  auto ReadPage(page_id_t page_id, char *page_data) -> bool override;
 
 private:
   char *memory_;
@@ -71,6 +72,7 @@ public:
    * @param page_data raw page data
    */
   void WritePage(page_id_t page_id, const char *page_data) override {
+    num_page_writes_++;
     if (latency_ > 0) {
       std::this_thread::sleep_for(std::chrono::milliseconds(latency_));
     }
@@ -94,7 +96,8 @@ public:
    * @param page_id id of the page
    * @param[out] page_data output buffer
    */
-  void ReadPage(page_id_t page_id, char *page_data) override {
+  auto ReadPage(page_id_t page_id, char *page_data) -> bool override {
+    num_reads_++;
     if (latency_ > 0) {
       std::this_thread::sleep_for(std::chrono::milliseconds(latency_));
     }
@@ -102,27 +105,71 @@ public:
     std::unique_lock<std::mutex> l(mutex_);
     if (page_id >= static_cast<int>(data_.size()) || page_id < 0) {
       LOG_WARN("page not exist");
-      return;
+      return true;
     }
     if (data_[page_id] == nullptr) {
       LOG_WARN("page not exist");
-      return;
+      return true;
     }
     std::shared_ptr<ProtectedPage> ptr = data_[page_id];
     std::shared_lock<std::shared_mutex> l_page(ptr->second);
     l.unlock();
 
     memcpy(page_data, ptr->first.data(), BUSTUB_PAGE_SIZE);
+    return true;
+  }
+
+  /**
+   * Write a page of the free-space map.
+   * @param map_page_id id of the map page
+   * @param page_data raw page data
+   */
+  void WriteMapPage(page_id_t map_page_id, const char *page_data) override {
+    std::unique_lock<std::mutex> l(mutex_);
+    if (map_page_id >= static_cast<int>(map_data_.size())) {
+      map_data_.resize(map_page_id + 1);
+    }
+    memcpy(map_data_[map_page_id].data(), page_data, BUSTUB_PAGE_SIZE);
+  }
+
+  /**
+   * Read a page of the free-space map.
+   * @param map_page_id id of the map page
+   * @param[out] page_data output buffer
+   * @return false if the map page was never written
+   */
+  auto ReadMapPage(page_id_t map_page_id, char *page_data) -> bool override {
+    std::unique_lock<std::mutex> l(mutex_);
+    if (map_page_id >= static_cast<int>(map_data_.size()) || map_page_id < 0) {
+      return false;
+    }
+    memcpy(page_data, map_data_[map_page_id].data(), BUSTUB_PAGE_SIZE);
+    return true;
+  }
+
+  /** @return the number of data pages, up to the highest one written */
+  auto GetNumPages() -> page_id_t override {
+    std::unique_lock<std::mutex> l(mutex_);
+    return static_cast<page_id_t>(data_.size());
   }
 
   void SetLatency(size_t latency_ms) { latency_ = latency_ms; }
 
+  /** @return the number of ReadPage calls so far, i.e. the buffer pool misses */
+  auto GetNumReads() const -> uint64_t { return num_reads_; }
+
+  /** @return the number of WritePage calls so far */
+  auto GetNumPageWrites() const -> uint64_t { return num_page_writes_; }
+
 private:
   std::mutex mutex_;
   using Page = std::array<char, BUSTUB_PAGE_SIZE>;
   using ProtectedPage = std::pair<Page, std::shared_mutex>;
   std::vector<std::shared_ptr<ProtectedPage>> data_;
+  std::vector<Page> map_data_;
   size_t latency_{0};
+  std::atomic<uint64_t> num_reads_{0};
+  std::atomic<uint64_t> num_page_writes_{0};
 };
 
 } // namespace bustub
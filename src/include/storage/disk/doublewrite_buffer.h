@@ -0,0 +1,89 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// doublewrite_buffer.h
+//
+// Identification: src/include/storage/disk/doublewrite_buffer.h
+//
+// Copyright (c) 2015-2023, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "common/config.h"
+#include "common/macros.h"
+
+namespace bustub {
+
+/**
+ * DoublewriteBuffer keeps a durable copy of the pages being written in place,
+ * so that a page torn by a crash in the middle of its write can be repaired.
+ *
+ * The buffer is a file of its own: a header page listing the id and CRC-32C
+ * of every staged page, followed by one slot per page. Stage writes a batch
+ * of up to DOUBLEWRITE_PAGES pages and the header in one pwritev and syncs the
+ * file. Only then may the pages be written in place, and the next batch may
+ * only be staged once those writes are durable. Recover hands out the staged
+ * copies that were written completely.
+ *
+ * The buffer has no latch, its user serializes the batches.
+ */
+class DoublewriteBuffer {
+public:
+  /** A page to stage: its id and raw data. */
+  using PageCopy = std::pair<page_id_t, const char *>;
+
+  /**
+   * Open the buffer file, or create it.
+   * @param file the file name of the buffer file
+   */
+  explicit DoublewriteBuffer(const std::string &file);
+
+  DISALLOW_COPY_AND_MOVE(DoublewriteBuffer);
+
+  ~DoublewriteBuffer();
+
+  /**
+   * Durably write copies of a batch of pages.
+   * @param pages at most DOUBLEWRITE_PAGES pages
+   * @return false if the copies could not be written
+   */
+  auto Stage(const std::vector<PageCopy> &pages) -> bool;
+
+  /**
+   * Call repair with every staged page whose copy is intact.
+   * @return the number of intact copies
+   */
+  auto Recover(const std::function<void(page_id_t, const char *)> &repair)
+      -> size_t;
+
+  /** Forget the staged pages, e.g. once the ones recovered are repaired. */
+  void Clear();
+
+private:
+  struct Entry {
+    page_id_t page_id_;
+    uint32_t checksum_;
+  };
+  /** The layout of the header page. */
+  struct Header {
+    uint32_t magic_;
+    uint32_t num_pages_;
+    /** CRC-32C of the entries. */
+    uint32_t checksum_;
+    Entry entries_[DOUBLEWRITE_PAGES];
+  };
+  static_assert(sizeof(Header) <= BUSTUB_PAGE_SIZE);
+
+  int fd_{-1};
+};
+
+} // namespace bustub
@@ -0,0 +1,118 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// free_space_map.h
+//
+// Identification: src/include/storage/disk/free_space_map.h
+//
+// Copyright (c) 2015-2023, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstdint>
+#include <mutex> // NOLINT
+#include <vector>
+
+#include "common/config.h"
+#include "common/macros.h"
+#include "storage/disk/disk_manager.h"
+
+namespace bustub {
+
+/**
+ * FreeSpaceMap tracks which page ids of the database file are in use, one bit
+ * per page, so that deleted pages are handed out again, also after a restart.
+ *
+ * The bitmap is kept in memory and persisted in map pages, which the disk
+ * manager stores apart from the data pages (DiskManager::WriteMapPage), so
+ * data page ids stay dense. Map page k holds the bits of the page ids
+ * [k * BITS_PER_MAP_PAGE, (k + 1) * BITS_PER_MAP_PAGE) behind a small header
+ * recording the end of the allocated range. Flush writes the map pages that
+ * changed since the last flush.
+ *
+ * The map is not logged: pages allocated after the last flush are recovered
+ * from the size of the database file, pages freed after it stay allocated.
+ *
+ * Single pages are allocated per shard, the lowest free id congruent to the
+ * shard modulo the number of shards, to match the page id partitioning of the
+ * buffer pool. Extents are runs of contiguous page ids that are physically
+ * sequential in the database file.
+ */
+class FreeSpaceMap {
+public:
+  /** Number of page ids covered by one map page. */
+  static constexpr size_t BITS_PER_MAP_PAGE = (BUSTUB_PAGE_SIZE - 8) * 8;
+
+  /**
+   * Load the free-space map of the database of disk_manager, or start an empty
+   * one if it has none.
+   * @param disk_manager the disk manager the map pages are read from and
+   * written to
+   * @param num_shards number of shards single page ids are partitioned into
+   */
+  FreeSpaceMap(DiskManager *disk_manager, size_t num_shards);
+
+  DISALLOW_COPY_AND_MOVE(FreeSpaceMap);
+
+  ~FreeSpaceMap() = default;
+
+  /**
+   * @brief Allocate the lowest free page id with page_id % num_shards == shard.
+   * @return the allocated page id
+   */
+  auto AllocatePage(size_t shard) -> page_id_t;
+
+  /**
+   * @brief Allocate the lowest run of num_pages free, contiguous page ids,
+   * regardless of their shards.
+   * @return the first page id of the run
+   */
+  auto AllocateExtent(size_t num_pages) -> page_id_t;
+
+  /** @brief Mark a page id free. Freeing a free page id does nothing. */
+  void DeallocatePage(page_id_t page_id);
+
+  /** @return true if page_id is allocated */
+  auto IsAllocated(page_id_t page_id) -> bool;
+
+  /** @brief Write the map pages changed since the last flush. */
+  void Flush();
+
+private:
+  /** Magic number identifying a map page. */
+  static constexpr uint32_t MAP_PAGE_MAGIC = 0x46534d31;
+  static constexpr size_t WORDS_PER_MAP_PAGE = BITS_PER_MAP_PAGE / 64;
+
+  /** Layout of a map page. */
+  struct MapPage {
+    uint32_t magic_;
+    /** One past the highest page id allocated when the page was written. */
+    page_id_t end_;
+    uint64_t words_[WORDS_PER_MAP_PAGE];
+  };
+  static_assert(sizeof(MapPage) == BUSTUB_PAGE_SIZE);
+
+  auto TestBit(page_id_t page_id) const -> bool;
+  /** @brief Set or clear the bit of page_id, growing the bitmap as needed and
+   * marking its map page dirty. */
+  void SetBit(page_id_t page_id, bool allocated);
+
+  DiskManager *disk_manager_;
+  const size_t num_shards_;
+  /** The bitmap, bit i of word w is page id w * 64 + i. */
+  std::vector<uint64_t> words_;
+  /** Map pages whose bits changed since the last flush. */
+  std::vector<bool> dirty_;
+  /** One past the highest page id ever allocated. */
+  page_id_t end_{0};
+  /** Per shard, no page id of the shard below it is free. */
+  std::vector<page_id_t> shard_hint_;
+  /** No page id below it is free. */
+  page_id_t extent_hint_{0};
+  std::mutex latch_;
+};
+
+} // namespace bustub
@@ -0,0 +1,80 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// mmap_disk_manager.h
+//
+// Identification: src/include/storage/disk/mmap_disk_manager.h
+//
+// Copyright (c) 2015-2023, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "common/config.h"
+#include "common/macros.h"
+#include "storage/disk/disk_manager.h"
+
+namespace bustub {
+
+/**
+ * MmapDiskManager serves a database file read-only through a shared mapping,
+ * e.g. for a reporting replica. Reads come from the OS page cache, so scan
+ * heavy workloads don't keep every page twice, once in the page cache and
+ * once in the buffer pool.
+ *
+ * ReadPage copies a page out of the mapping. With zero_copy, GetMappedPage
+ * hands the buffer pool a pointer into the mapping instead, and fetched pages
+ * must only be read; writing one faults. Prefetch requests of the buffer pool
+ * are passed to the kernel as sequential read-ahead hints.
+ *
+ * The file is mapped as large as it is when the disk manager is created, pages
+ * past that read as zeros, and it must not shrink while mapped. The disk
+ * manager is read-only, see IsReadOnly, so the buffer pool never dirties a
+ * page; a data page written anyway is dropped, the free-space map is kept in
+ * memory only. Compressed database files can't be mapped.
+ */
+class MmapDiskManager : public DiskManager {
+public:
+  /**
+   * Maps the specified database file.
+   * @param db_file the file name of the database file to read from
+   * @param zero_copy let the buffer pool point at pages in the mapping rather
+   * than copying them
+   */
+  explicit MmapDiskManager(const std::string &db_file, bool zero_copy = false);
+
+  DISALLOW_COPY_AND_MOVE(MmapDiskManager);
+
+  ~MmapDiskManager() override;
+
+  /** @brief Drops the page, the database file is read-only. */
+  void WritePage(page_id_t page_id, const char *page_data) override;
+
+  auto ReadPage(page_id_t page_id, char *page_data) -> bool override;
+
+  /** @brief Drops the pages, the database file is read-only. */
+  void WritePages(std::vector<PageWrite> pages) override;
+
+  auto IsReadOnly() -> bool override { return true; }
+
+  /** @brief Does nothing, the free-space map of a read-only file is rebuilt
+   * in memory. */
+  void WriteMapPage(page_id_t map_page_id, const char *page_data) override;
+
+  auto GetMappedPage(page_id_t page_id) -> const char * override;
+
+  void AdviseSequentialRead(page_id_t first_page_id, size_t count) override;
+
+private:
+  char *mapping_{nullptr};
+  /** Number of whole pages in the mapping. */
+  page_id_t mapped_pages_{0};
+  bool zero_copy_;
+};
+
+} // namespace bustub
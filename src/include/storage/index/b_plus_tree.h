@@ -11,8 +11,10 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
 #include <deque>
 #include <iostream>
+#include <memory>
 #include <optional>
 #include <queue>
 #include <shared_mutex>
@@ -97,17 +99,34 @@ class BPlusTree {
   using LeafPage = BPlusTreeLeafPage<KeyType, ValueType, KeyComparator>;
 
  public:
+  /**
+   * @param page_format format of the tree's pages. A tree of compressed pages keeps up to twice as many keys in a page
+   * as their prefix and suffix truncation allows, and pushes up the shortest separator that tells the halves of a
+   * split leaf apart. It rebalances lazily: an underfull page merges with a sibling if their keys fit into one page
+   * and otherwise stays as it is, even empty. The comparator must be normalized.
+   */
   explicit BPlusTree(std::string name, page_id_t header_page_id, BufferPoolManager *buffer_pool_manager,
                      const KeyComparator &comparator, int leaf_max_size = LEAF_PAGE_SIZE,
-                     int internal_max_size = INTERNAL_PAGE_SIZE);
+                     int internal_max_size = INTERNAL_PAGE_SIZE, IndexPageFormat page_format = IndexPageFormat::PLAIN);
 
   // Returns true if this B+ tree has no keys and values.
   auto IsEmpty() const -> bool;
 
   // Insert a key-value pair into this B+ tree.
   auto Insert(const KeyType &key, const ValueType &value, Transaction *txn = nullptr) -> bool;
-  auto InsertOptimistic(const KeyType &key, const ValueType &value, Transaction *txn = nullptr) -> bool;
-  auto Insertpessimistic(const KeyType &key, const ValueType &value, Transaction *txn = nullptr) -> bool;
+  /**
+   * @brief Build an empty tree bottom-up from key-value pairs sorted by key, instead of inserting them one by one.
+   * Leaves are filled up to fill_factor of their capacity and laid out on contiguous page ids, then every inner level
+   * is built from the first keys of the level below. Compressed pages are filled up to fill_factor of their capacity
+   * for the keys they get, and the leaves get separators instead of their first keys.
+   *
+   * @param pairs key-value pairs with strictly increasing keys
+   * @param fill_factor fraction of a page that is filled, clamped to [0.5, 1]
+   * @return false if the tree is not empty, the keys are not strictly increasing, or a page can't be created; the
+   * pages built so far are deleted then and the tree stays empty
+   */
+  auto BulkLoad(const std::vector<MappingType> &pairs, double fill_factor = BTREE_BULK_LOAD_FILL_FACTOR) -> bool;
+
   // Remove a key and its value from this B+ tree.
   void Remove(const KeyType &key, Transaction *txn);
 
@@ -163,6 +182,67 @@ class BPlusTree {
    */
   auto ToPrintableBPlusTree(page_id_t root_id) -> PrintableBPlusTree;
 
+  /**
+   * @brief Find the leaf that may hold key. The header and the inner nodes are read optimistically, without latches,
+   * and the descent restarts whenever a writer changed one of them on the way.
+   *
+   * @param[out] leaf_guard read or write guard on the leaf
+   * @return false if the tree is empty
+   */
+  template <class LeafGuard>
+  auto FindLeafOptimistic(const KeyType &key, LeafGuard *leaf_guard) -> bool;
+
+  /**
+   * @brief Insert with only the leaf write-latched, see FindLeafOptimistic.
+   *
+   * @return whether the pair was inserted, nullopt if the tree is empty or the leaf is full, then the insert is left
+   * to InsertPessimistic
+   */
+  auto InsertOptimistic(const KeyType &key, const ValueType &value, Transaction *txn) -> std::optional<bool>;
+
+  /** @brief Insert with the header and the inner nodes that may split write-latched. */
+  auto InsertPessimistic(const KeyType &key, const ValueType &value, Transaction *txn) -> bool;
+
+  /**
+   * @brief Remove with only the leaf write-latched, see FindLeafOptimistic.
+   *
+   * @return false if the leaf would underflow, then the removal is left to RemovePessimistic
+   */
+  auto RemoveOptimistic(const KeyType &key, Transaction *txn) -> bool;
+
+  /** @brief Remove with the header and the inner nodes that may merge write-latched. */
+  void RemovePessimistic(const KeyType &key, Transaction *txn);
+
+  /**
+   * @brief The swip of a child of an inner node, see BufferPoolManager::FetchPage. Swip rows are shared by the inner
+   * nodes whose page ids collide, which only costs page table lookups.
+   *
+   * @param page_id id of the inner node
+   * @param index index of the child in the inner node
+   * @return the swip, or nullptr if pointer swizzling is disabled
+   */
+  auto ChildSwip(page_id_t page_id, int index) -> std::atomic<Page *> *;
+
+  /**
+   * @brief The number of nodes a bulk-loaded level is spread over: every node holds at least fill_factor of max_size
+   * entries, unless that would overfill a node or there are fewer entries.
+   */
+  static auto BulkLoadNodes(size_t num_entries, int max_size, double fill_factor) -> size_t;
+
+  /**
+   * @brief The sizes of the nodes a bulk-loaded level of entries is spread over, see BulkLoadNodes. A compressed level
+   * gets as many nodes as filling each up to fill_factor of its capacity for their keys takes, and the entries are
+   * spread evenly over them.
+   *
+   * @param scratch an empty page of the level's type, for its capacity
+   */
+  template <class PageType, class PairType>
+  auto BulkLoadSizes(const std::vector<PairType> &entries, const PageType *scratch, double fill_factor) const
+      -> std::vector<int>;
+
+  /** @return the shortest key that is greater than left and not greater than right, for memcmp-ordered keys */
+  static auto SeparatorKey(const KeyType &left, const KeyType &right) -> KeyType;
+
   auto InsertLeafPage(Context &ctx, MappingType &mapping, bool &need_split_root, Transaction *txn) -> bool;
 
   auto InsertInternalPage(Context &ctx, const KeyType &key, page_id_t value, bool &need_split_root, Transaction *txn)
@@ -178,7 +258,13 @@ class BPlusTree {
   std::vector<std::string> log;  // NOLINT
   int leaf_max_size_;
   int internal_max_size_;
+  IndexPageFormat page_format_;
   page_id_t header_page_id_;
+  /** Swip of the root page. */
+  std::atomic<Page *> root_swip_{nullptr};
+  /** Child swips of the inner nodes, swip_rows_ rows of internal_max_size_ + 1 swips. */
+  std::unique_ptr<std::atomic<Page *>[]> swips_;
+  size_t swip_rows_{0};
   std::mutex little_latch_;
   std::mutex opt_letch_;
   // bool is_empty_{true};
@@ -24,11 +24,21 @@ namespace bustub {
 
 #define BPLUSTREE_INDEX_TYPE BPlusTreeIndex<KeyType, ValueType, KeyComparator>
 
+/** The page format of an index created without asking for one. */
+static constexpr IndexPageFormat DEFAULT_INDEX_PAGE_FORMAT =
+    BTREE_COMPRESS_INDEX_PAGES ? IndexPageFormat::COMPRESSED
+                               : IndexPageFormat::PLAIN;
+
+/**
+ * BPlusTreeIndex keys the tree by normalized keys, see Tuple::NormalizeKeyTo,
+ * which compare byte by byte.
+ */
 INDEX_TEMPLATE_ARGUMENTS
 class BPlusTreeIndex : public Index {
 public:
   BPlusTreeIndex(std::unique_ptr<IndexMetadata> &&metadata,
-                 BufferPoolManager *buffer_pool_manager);
+                 BufferPoolManager *buffer_pool_manager,
+                 IndexPageFormat page_format = DEFAULT_INDEX_PAGE_FORMAT);
 
   auto InsertEntry(const Tuple &key, RID rid, Transaction *transaction)
       -> bool override;
@@ -39,6 +49,14 @@ public:
   void ScanKey(const Tuple &key, std::vector<RID> *result,
                Transaction *transaction) override;
 
+  /**
+   * Fill an empty index with entries in bulk. The entries are sorted by key
+   * and, like InsertEntry, only the first entry of a key is kept.
+   * @param entries the key-RID pairs, reordered in place
+   * @param transaction the transaction context
+   */
+  void BulkLoad(std::vector<MappingType> *entries, Transaction *transaction);
+
   auto GetBeginIterator() -> INDEXITERATOR_TYPE;
 
   auto GetBeginIterator(const KeyType &key) -> INDEXITERATOR_TYPE;
@@ -34,6 +34,12 @@ public:
     memcpy(data_, tuple.GetData(), tuple.GetLength());
   }
 
+  // normalize the key so that it compares byte by byte, see
+  // Tuple::NormalizeKeyTo
+  inline void SetFromKey(const Tuple &tuple, const Schema *key_schema) {
+    tuple.NormalizeKeyTo(key_schema, data_, KeySize);
+  }
+
   // NOTE: for test purpose only
   inline void SetFromInteger(int64_t key) {
     memset(data_, 0, KeySize);
@@ -73,6 +79,15 @@ public:
   char data_[KeySize];
 };
 
+/** How the columns of a GenericKey are stored. */
+enum class KeyEncoding {
+  /** A tuple of the key schema, set by SetFromKey(tuple). Keys compare column
+   * by column as Values. */
+  TUPLE,
+  /** Normalized by SetFromKey(tuple, key_schema). Keys compare with memcmp. */
+  NORMALIZED
+};
+
 /**
  * Function object returns true if lhs < rhs, used for trees
  */
@@ -80,6 +95,21 @@ template <size_t KeySize> class GenericComparator {
 public:
   inline auto operator()(const GenericKey<KeySize> &lhs,
                          const GenericKey<KeySize> &rhs) const -> int {
+    if (encoding_ == KeyEncoding::NORMALIZED) {
+      if constexpr (KeySize == sizeof(uint64_t)) {
+        // a big-endian 8-byte key compares like the integer it holds
+        uint64_t lhs_bits;
+        uint64_t rhs_bits;
+        memcpy(&lhs_bits, lhs.data_, sizeof(uint64_t));
+        memcpy(&rhs_bits, rhs.data_, sizeof(uint64_t));
+        lhs_bits = __builtin_bswap64(lhs_bits);
+        rhs_bits = __builtin_bswap64(rhs_bits);
+        return static_cast<int>(lhs_bits > rhs_bits) -
+               static_cast<int>(lhs_bits < rhs_bits);
+      } else {
+        return memcmp(lhs.data_, rhs.data_, KeySize);
+      }
+    }
     uint32_t column_count = key_schema_->GetColumnCount();
 
     for (uint32_t i = 0; i < column_count; i++) {
@@ -98,13 +128,60 @@ public:
   }
 
   GenericComparator(const GenericComparator &other)
-      : key_schema_{other.key_schema_} {}
+      : key_schema_{other.key_schema_}, encoding_{other.encoding_},
+        integer_key_width_{other.integer_key_width_} {}
 
   // constructor
-  explicit GenericComparator(Schema *key_schema) : key_schema_(key_schema) {}
+  explicit GenericComparator(Schema *key_schema,
+                             KeyEncoding encoding = KeyEncoding::TUPLE)
+      : key_schema_(key_schema), encoding_(encoding) {
+    if (encoding_ == KeyEncoding::NORMALIZED) {
+      // the whole key is a big-endian unsigned integer
+      integer_key_width_ = KeySize <= sizeof(uint64_t) ? KeySize : 0;
+      return;
+    }
+    if (key_schema_->GetColumnCount() != 1) {
+      return;
+    }
+    switch (key_schema_->GetColumn(0).GetType()) {
+    case TypeId::TINYINT:
+      integer_key_width_ = sizeof(int8_t);
+      break;
+    case TypeId::SMALLINT:
+      integer_key_width_ = sizeof(int16_t);
+      break;
+    case TypeId::INTEGER:
+      integer_key_width_ = sizeof(int32_t);
+      break;
+    case TypeId::BIGINT:
+      integer_key_width_ = sizeof(int64_t);
+      break;
+    default:
+      break;
+    }
+    if (integer_key_width_ > KeySize) {
+      integer_key_width_ = 0;
+    }
+  }
+
+  /**
+   * @return the width of the integer at the start of the key if keys compare
+   * like the integers they hold, 0 otherwise. The integer is little-endian and
+   * signed, or big-endian and unsigned if IsNormalized.
+   */
+  inline auto GetIntegerKeyWidth() const -> size_t {
+    return integer_key_width_;
+  }
+
+  /** @return true if the keys are normalized */
+  inline auto IsNormalized() const -> bool {
+    return encoding_ == KeyEncoding::NORMALIZED;
+  }
 
 private:
   Schema *key_schema_;
+  KeyEncoding encoding_;
+  size_t integer_key_width_{0};
 };
 
 } // namespace bustub
@@ -13,7 +13,9 @@
  * For range scan of b+ tree
  */
 #pragma once
+#include "buffer/read_ahead.h"
 #include "storage/page/b_plus_tree_leaf_page.h"
+#include "storage/page/page_guard.h"
 
 namespace bustub {
 
@@ -23,7 +25,14 @@ class IndexIterator {
  public:
   using LeafPage = BPlusTreeLeafPage<KeyType, ValueType, KeyComparator>;
   // you may define your own constructor based on your member variables
-  IndexIterator(int idx, int max_idx_per_page, uint64_t uuid, BufferPoolManager *bpm, LeafPage *start_page);
+  /**
+   * @param start_guard pins the leaf start_page points into, the iterator keeps the current leaf pinned (but not
+   * latched) so that it can't be evicted under it
+   */
+  IndexIterator(int idx, int max_idx_per_page, uint64_t uuid, BufferPoolManager *bpm, const LeafPage *start_page,
+                BasicPageGuard start_guard = {});
+  IndexIterator(IndexIterator &&that) noexcept = default;
+  auto operator=(IndexIterator &&that) noexcept -> IndexIterator & = default;
   ~IndexIterator();  // NOLINT
 
   auto IsEnd() -> bool;
@@ -51,12 +60,17 @@ class IndexIterator {
   }
 
  private:
+  /** Moves on to the next leaf with pairs once the current one is done, or to the end. */
+  void SkipFinishedPages();
+
   // add your own private member variables here
   int idx_;
   int max_idx_per_page_;
   uint64_t uuid_;
   BufferPoolManager *bpm_;
-  LeafPage *cur_page_;
+  const LeafPage *cur_page_;
+  BasicPageGuard cur_guard_;
+  ReadAhead read_ahead_;
   bool is_end_page_{false};
   MappingType end_node_;
   MappingType value_node_;
@@ -32,6 +32,9 @@ namespace bustub {
  *  --------------------------------------------------------------------------
  * | HEADER | KEY(1)+PAGE_ID(1) | KEY(2)+PAGE_ID(2) | ... | KEY(n)+PAGE_ID(n) |
  *  --------------------------------------------------------------------------
+ *
+ * An internal page in the compressed format stores its keys truncated, see
+ * BPlusTreePage. Its first key is left out of the prefix.
  */
 INDEX_TEMPLATE_ARGUMENTS
 class BPlusTreeInternalPage : public BPlusTreePage {
@@ -45,8 +48,9 @@ class BPlusTreeInternalPage : public BPlusTreePage {
    * called after the creation of a new page to make a valid
    * BPlusTreeInternalPage
    * @param max_size Maximal size of the page
+   * @param format format of the keys
    */
-  void Init(int max_size = INTERNAL_PAGE_SIZE);
+  void Init(int max_size = INTERNAL_PAGE_SIZE, IndexPageFormat format = IndexPageFormat::PLAIN);
 
   /**
    * @param index The index of the key to get. Index must be non-zero.
@@ -64,6 +68,15 @@ class BPlusTreeInternalPage : public BPlusTreePage {
   void InsertKeyAndValueAt(int index, const KeyType &key, const ValueType &value);
   void DeleteKeyAndValueAt(int index);
 
+  /** @return true if a key and a child can be inserted without a split */
+  auto HasRoomFor(const KeyType &key) const -> bool;
+
+  /** @return the number of children the page holds if its keys are those of pairs */
+  auto CapacityFor(const MappingType *pairs, int size) const -> int;
+
+  /** Replaces the keys and children of the page, which must fit (see CapacityFor). */
+  void SetKeysAndValues(const MappingType *pairs, int size);
+
   /**
    *
    * @param value the value to search for
@@ -103,39 +116,21 @@ class BPlusTreeInternalPage : public BPlusTreePage {
     return kstr;
   }
 
-  auto GetIndexLargerThanKey(int i, const KeyType key, KeyComparator comporator) const -> int {
-    int start = i;
-    int end = GetSize() - 1;
-    while (start <= end) {
-      int mid_idx = start + (end - start) / 2;
-      KeyType mid_key = array_[mid_idx].first;
-      int cmp = comporator(mid_key, key);
-      if (cmp < 0) {
-        start = mid_idx + 1;
-      } else if (cmp > 0) {
-        end = mid_idx - 1;
-      } else {
-        return mid_idx + 1;
-      }
-    }
-    return start;
+  /** @return the index of the first key from index i on that is greater than key */
+  auto GetIndexLargerThanKey(int i, const KeyType &key, const KeyComparator &comparator) const -> int {
+    return Search(i, GetSize(), key, comparator, true);
   }
 
-  auto GetIndexEqualToKey(int &i, const KeyType key, KeyComparator comporator) const -> bool {
-    int start = i;
-    int end = GetSize() - 1;
-    while (start <= end) {
-      int mid_idx = start + (end - start) / 2;
-      KeyType mid_key = array_[mid_idx].first;
-      int cmp = comporator(mid_key, key);
-      if (cmp < 0) {
-        start = mid_idx + 1;
-      } else if (cmp > 0) {
-        end = mid_idx - 1;
-      } else {
-        i = mid_idx;
-        return true;
-      }
+  /**
+   * @param[in,out] i the index to search from, set to the index of key if found
+   * @return true if key is in the page
+   */
+  auto GetIndexEqualToKey(int &i, const KeyType &key, const KeyComparator &comparator) const -> bool {
+    int index = Search(i, GetSize(), key, comparator, false);
+    // the key at index is not less than key, so it's equal unless it's greater
+    if (index < GetSize() && Search(index, index + 1, key, comparator, true) == index + 1) {
+      i = index;
+      return true;
     }
     return false;
   }
@@ -144,19 +139,25 @@ class BPlusTreeInternalPage : public BPlusTreePage {
     // solution 1
     int end = GetSize();
     for (; i < end; ++i) {
-      if (value == array_[i].second) {
+      if (value == ValueAt(i)) {
         return i;
       }
     }
     return -1;
   }
 
-  auto MemMove(B_PLUS_TREE_INTERNAL_PAGE_TYPE *src, int src_idx, int dest_idx, int len) {
-    std::memmove(reinterpret_cast<char *>(&array_[dest_idx]), reinterpret_cast<char *>(&src->array_[src_idx]),
-                 len * sizeof(array_[0]));
+ private:
+  auto Search(int begin, int end, const KeyType &key, const KeyComparator &comparator, bool upper) const -> int {
+    if (IsCompressed()) {
+      return SearchCompressedKey(Data(), begin, end, reinterpret_cast<const char *>(&key), sizeof(KeyType),
+                                 sizeof(ValueType), upper);
+    }
+    return SearchKey(array_, begin, end, key, comparator, upper);
   }
 
- private:
+  auto Data() const -> const char * { return reinterpret_cast<const char *>(array_); }
+  auto Data() -> char * { return reinterpret_cast<char *>(array_); }
+
   // Flexible array member for page data.
   MappingType array_[0];
 };
@@ -39,6 +39,9 @@ namespace bustub {
  *  -----------------------------------------------
  * |  NextPageId (4)
  *  -----------------------------------------------
+ *
+ * A leaf page in the compressed format stores its keys truncated, see
+ * BPlusTreePage.
  */
 INDEX_TEMPLATE_ARGUMENTS
 class BPlusTreeLeafPage : public BPlusTreePage {
@@ -51,8 +54,9 @@ class BPlusTreeLeafPage : public BPlusTreePage {
    * After creating a new leaf page from buffer pool, must call initialize
    * method to set default values
    * @param max_size Max size of the leaf node
+   * @param format format of the keys
    */
-  void Init(int max_size = LEAF_PAGE_SIZE);
+  void Init(int max_size = LEAF_PAGE_SIZE, IndexPageFormat format = IndexPageFormat::PLAIN);
 
   // helper methods
   auto GetNextPageId() const -> page_id_t;
@@ -63,6 +67,16 @@ class BPlusTreeLeafPage : public BPlusTreePage {
   void SetValueAt(int index, const ValueType &value);
   void InsertKeyAndValueAt(int index, const KeyType &key, const ValueType &value);
   void DeleteKeyAndValueAt(int index);
+
+  /** @return true if a pair with key can be inserted without a split */
+  auto HasRoomFor(const KeyType &key) const -> bool;
+
+  /** @return the number of pairs the page holds if its keys are those of pairs */
+  auto CapacityFor(const MappingType *pairs, int size) const -> int;
+
+  /** Replaces the pairs of the page, which must fit (see CapacityFor). */
+  void SetKeysAndValues(const MappingType *pairs, int size);
+
   /**
    * @brief for test only return a string representing all keys in
    * this leaf page formatted as "(key1,key2,key3,...)"
@@ -88,49 +102,37 @@ class BPlusTreeLeafPage : public BPlusTreePage {
     return kstr;
   }
 
-  auto GetIndexLargerThanKey(int i, const KeyType key, KeyComparator comporator) const -> int {
-    int start = i;
-    int end = GetSize() - 1;
-    while (start <= end) {
-      int mid_idx = start + (end - start) / 2;
-      KeyType mid_key = array_[mid_idx].first;
-      int cmp = comporator(mid_key, key);
-      if (cmp < 0) {
-        start = mid_idx + 1;
-      } else if (cmp > 0) {
-        end = mid_idx - 1;
-      } else {
-        return mid_idx + 1;
-      }
-    }
-    return start;
+  /** @return the index of the first key from index i on that is greater than key */
+  auto GetIndexLargerThanKey(int i, const KeyType &key, const KeyComparator &comparator) const -> int {
+    return Search(i, GetSize(), key, comparator, true);
   }
 
-  auto GetIndexEqualToKey(int &i, const KeyType key, KeyComparator comporator) const -> bool {
-    int start = i;
-    int end = GetSize() - 1;
-    while (start <= end) {
-      int mid_idx = start + (end - start) / 2;
-      KeyType mid_key = array_[mid_idx].first;
-      int cmp = comporator(mid_key, key);
-      if (cmp < 0) {
-        start = mid_idx + 1;
-      } else if (cmp > 0) {
-        end = mid_idx - 1;
-      } else {
-        i = mid_idx;
-        return true;
-      }
+  /**
+   * @param[in,out] i the index to search from, set to the index of key if found
+   * @return true if key is in the page
+   */
+  auto GetIndexEqualToKey(int &i, const KeyType &key, const KeyComparator &comparator) const -> bool {
+    int index = Search(i, GetSize(), key, comparator, false);
+    // the key at index is not less than key, so it's equal unless it's greater
+    if (index < GetSize() && Search(index, index + 1, key, comparator, true) == index + 1) {
+      i = index;
+      return true;
     }
     return false;
   }
 
-  auto MemMove(B_PLUS_TREE_LEAF_PAGE_TYPE *src, int src_idx, int dest_idx, int len) {
-    std::memmove(reinterpret_cast<char *>(&array_[dest_idx]), reinterpret_cast<char *>(&src->array_[src_idx]),
-                 len * sizeof(array_[0]));
+ private:
+  auto Search(int begin, int end, const KeyType &key, const KeyComparator &comparator, bool upper) const -> int {
+    if (IsCompressed()) {
+      return SearchCompressedKey(Data(), begin, end, reinterpret_cast<const char *>(&key), sizeof(KeyType),
+                                 sizeof(ValueType), upper);
+    }
+    return SearchKey(array_, begin, end, key, comparator, upper);
   }
 
- private:
+  auto Data() const -> const char * { return reinterpret_cast<const char *>(array_); }
+  auto Data() -> char * { return reinterpret_cast<char *>(array_); }
+
   page_id_t next_page_id_;
   // Flexible array member for page data.
   MappingType array_[0];
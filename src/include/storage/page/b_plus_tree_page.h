@@ -10,10 +10,12 @@
 //===----------------------------------------------------------------------===//
 #pragma once
 
+#include <algorithm>
 #include <cassert>
 #include <climits>
 #include <cstdlib>
 #include <string>
+#include <type_traits>
 
 #include "buffer/buffer_pool_manager.h"
 #include "storage/index/generic_key.h"
@@ -25,7 +27,16 @@ namespace bustub {
 #define INDEX_TEMPLATE_ARGUMENTS template <typename KeyType, typename ValueType, typename KeyComparator>
 
 // define page type enum
-enum class IndexPageType { INVALID_INDEX_PAGE = 0, LEAF_PAGE, INTERNAL_PAGE };
+enum class IndexPageType : uint8_t { INVALID_INDEX_PAGE = 0, LEAF_PAGE, INTERNAL_PAGE };
+
+/** How the pages of a B+ tree store their keys. */
+enum class IndexPageFormat {
+  /** Every key in full, in an array of key-value pairs. */
+  PLAIN,
+  /** Keys truncated to the bytes that tell them apart within the page, see BPlusTreePage. Only for keys that compare
+   * with memcmp (KeyEncoding::NORMALIZED). */
+  COMPRESSED
+};
 
 /**
  * Both internal and leaf page are inherited from this page.
@@ -35,8 +46,17 @@ enum class IndexPageType { INVALID_INDEX_PAGE = 0, LEAF_PAGE, INTERNAL_PAGE };
  *
  * Header format (size in byte, 12 bytes in total):
  * ----------------------------------------------------------------------------
- * | PageType (4) | CurrentSize (4) | MaxSize (4) |
+ * | PageType (1) | Compressed (1) | PrefixSize (1) | SuffixSize (1) | CurrentSize (4) | MaxSize (4) |
+ * ----------------------------------------------------------------------------
+ *
+ * A compressed page stores the prefix that all of its keys share once, and of every key only the suffix up to the
+ * last non-zero byte of the page's longest key, the rest of a key is zeros. The pairs of a page are the same size,
+ * which shrinks with the keys:
  * ----------------------------------------------------------------------------
+ * | HEADER | PREFIX | SUFFIX(1) + VALUE(1) | SUFFIX(2) + VALUE(2) | ... | SUFFIX(n) + VALUE(n) |
+ * ----------------------------------------------------------------------------
+ * The prefix and the suffix size grow and shrink as keys come and go. Whatever the keys, a compressed page holds at
+ * least MaxSize pairs, and at most 2 * MaxSize - 1 so that both halves of a split fit into any page.
  */
 class BPlusTreePage {
  public:
@@ -57,9 +77,135 @@ class BPlusTreePage {
   void SetMaxSize(int max_size);
   auto GetMinSize() const -> int;
 
+  /** @return true if the page is in the compressed format */
+  auto IsCompressed() const -> bool;
+
+  /** @return true if SearchKey counts integer keys with AVX2 */
+  static auto UsesAvx2Search() -> bool;
+
+ protected:
+  /**
+   * @brief Find the first of the keys in [begin, end) that is not less than key, or that is greater than key if upper,
+   * like std::lower_bound and std::upper_bound. The halving steps are branch-free. A key of a single integer column, or
+   * a normalized key of at most 8 bytes, is compared as the integer it holds instead of through the comparator, and the
+   * last few such keys are counted in one go, with AVX2 where the CPU has it.
+   *
+   * @param array the key-value pairs of a page, sorted by key
+   */
+  template <typename PairType, typename KeyType, typename KeyComparator>
+  static auto SearchKey(const PairType *array, int begin, int end, const KeyType &key, const KeyComparator &comparator,
+                        bool upper) -> int {
+    if constexpr (std::is_same_v<KeyComparator, GenericComparator<sizeof(KeyType)>>) {
+      size_t width = comparator.GetIntegerKeyWidth();
+      if (width != 0) {
+        return SearchIntegerKey(reinterpret_cast<const char *>(array), sizeof(PairType), begin, end, key.data_, width,
+                                comparator.IsNormalized(), upper);
+      }
+    }
+    int n = end - begin;
+    if (n <= 0) {
+      return begin;
+    }
+    while (n > 1) {
+      int half = n / 2;
+      int cmp = comparator(array[begin + half].first, key);
+      begin += half * static_cast<int>(upper ? cmp <= 0 : cmp < 0);
+      n -= half;
+    }
+    int cmp = comparator(array[begin].first, key);
+    return begin + static_cast<int>(upper ? cmp <= 0 : cmp < 0);
+  }
+
+  /**
+   * @brief SearchKey over keys that hold an integer of width bytes.
+   *
+   * @param keys the first key, the following ones are stride bytes apart
+   * @param key the key to search for
+   * @param big_endian the integers are big-endian and unsigned instead of little-endian and signed
+   */
+  static auto SearchIntegerKey(const char *keys, size_t stride, int begin, int end, const char *key, size_t width,
+                               bool big_endian, bool upper) -> int;
+
+  /*
+   * Helpers of the compressed format. data is where the page's pairs start, right after its header, and first is the
+   * index of its first key, which is 1 for internal pages.
+   */
+
+  /** Sizes of the prefix and the suffixes of the keys of a compressed page. */
+  struct KeyLayout {
+    size_t prefix_size_;
+    size_t suffix_size_;
+  };
+
+  /** Sets the format of an empty page. */
+  void SetCompressed(bool compressed);
+
+  /** @return the bytes of key up to its last non-zero one */
+  static auto SignificantSize(const char *key, size_t key_size) -> size_t;
+
+  /** @return the layout of sorted keys from first to last, none of which has more than significant_size bytes */
+  static auto LayoutOf(const char *first, const char *last, size_t significant_size) -> KeyLayout;
+
+  /** @return the layout of the keys of sorted pairs from index first on */
+  template <typename PairType>
+  static auto LayoutOfPairs(const PairType *pairs, int first, int size) -> KeyLayout {
+    if (size <= first) {
+      return {0, 0};
+    }
+    constexpr size_t key_size = sizeof(pairs[0].first);
+    size_t significant_size = 0;
+    for (int i = first; i < size; ++i) {
+      significant_size =
+          std::max(significant_size, SignificantSize(reinterpret_cast<const char *>(&pairs[i].first), key_size));
+    }
+    return LayoutOf(reinterpret_cast<const char *>(&pairs[first].first),
+                    reinterpret_cast<const char *>(&pairs[size - 1].first), significant_size);
+  }
+
+  /** @return the layout of the page's keys together with key */
+  auto LayoutWith(const char *data, int first, const char *key, size_t key_size) const -> KeyLayout;
+
+  /** @return the number of pairs the page holds with the layout */
+  auto CompressedCapacity(const char *data, KeyLayout layout, size_t value_size) const -> int;
+
+  /** Sets the layout of an empty page, prefix holds the new prefix. */
+  void ResetKeyLayout(char *data, KeyLayout layout, const char *prefix);
+
+  /** Re-encodes the page's pairs for a layout that covers all of their keys, prefix holds the new prefix. */
+  void ChangeKeyLayout(char *data, KeyLayout layout, const char *prefix, size_t value_size);
+
+  /** @return the offset of the pair at index from data */
+  auto CompressedOffset(size_t value_size, int index) const -> size_t {
+    return prefix_size_ + static_cast<size_t>(index) * (suffix_size_ + value_size);
+  }
+
+  void ReadCompressedKey(const char *data, int index, char *key, size_t key_size, size_t value_size) const;
+
+  /** Writes the suffix of key, which must share the page's prefix, to the pair at index. */
+  void WriteCompressedKey(char *data, int index, const char *key, size_t value_size) const;
+
+  /** WriteCompressedKey for any key, the layout changes to cover key if needed. */
+  void SetCompressedKey(char *data, int first, int index, const char *key, size_t key_size, size_t value_size);
+
+  void ReadCompressedValue(const char *data, int index, char *value, size_t value_size) const;
+  void WriteCompressedValue(char *data, int index, const char *value, size_t value_size) const;
+
+  /** Inserts a pair at index and changes the layout to cover key if needed, the page must have room for it. */
+  void InsertCompressedPair(char *data, int first, int index, const char *key, size_t key_size, const char *value,
+                            size_t value_size);
+
+  void DeleteCompressedPair(char *data, int index, size_t value_size);
+
+  /** @brief SearchKey over the keys of a compressed page. */
+  auto SearchCompressedKey(const char *data, int begin, int end, const char *key, size_t key_size, size_t value_size,
+                           bool upper) const -> int;
+
  private:
   // member variable, attributes that both internal and leaf page share
   IndexPageType page_type_ __attribute__((__unused__));
+  bool compressed_ __attribute__((__unused__));
+  uint8_t prefix_size_ __attribute__((__unused__));
+  uint8_t suffix_size_ __attribute__((__unused__));
   int size_ __attribute__((__unused__));
   int max_size_ __attribute__((__unused__));
 };
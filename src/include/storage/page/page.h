@@ -12,8 +12,10 @@
 
 #pragma once
 
+#include <atomic>
 #include <cstring>
 #include <iostream>
+#include <new>
 
 #include "common/config.h"
 #include "common/rwlatch.h"
@@ -30,19 +32,34 @@ class Page {
   // There is book-keeping information inside the page that should only be
   // relevant to the buffer pool manager.
   friend class BufferPoolManager;
+  friend class BufferPoolManagerInstance;
+  friend class FrameArena;
 
 public:
-  /** Constructor. Zeros out the page data. */
+  /** Constructor. Zeros out the page data, which is aligned to the page size
+   * so that it can be read and written with O_DIRECT. */
   Page() {
-    data_ = new char[BUSTUB_PAGE_SIZE];
+    frame_data_ =
+        new (std::align_val_t{BUSTUB_PAGE_SIZE}) char[BUSTUB_PAGE_SIZE];
     ResetMemory();
   }
 
+  /** Constructor for a frame whose data is owned by someone else, e.g. the
+   * frame arena of the buffer pool. The data is expected to be zeroed. */
+  explicit Page(char *data)
+      : data_(data), frame_data_(data), owns_data_(false) {}
+
   /** Default destructor. */
-  ~Page() { delete[] data_; }
+  ~Page() {
+    if (owns_data_) {
+      ::operator delete[](frame_data_, std::align_val_t{BUSTUB_PAGE_SIZE});
+    }
+  }
 
   /** @return the actual data contained within this page */
-  inline auto GetData() -> char * { return data_; }
+  inline auto GetData() -> char * {
+    return data_.load(std::memory_order_acquire);
+  }
 
   /** @return the page id of this page */
   inline auto GetPageId() -> page_id_t { return page_id_; }
@@ -54,11 +71,19 @@ public:
    * disk, false otherwise */
   inline auto IsDirty() -> bool { return is_dirty_; }
 
-  /** Acquire the page write latch. */
-  inline void WLatch() { rwlatch_.WLock(); }
+  /** Acquire the page write latch. The page version turns odd until the
+   * latch is released. */
+  inline void WLatch() {
+    rwlatch_.WLock();
+    version_.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+  }
 
   /** Release the page write latch. */
-  inline void WUnlatch() { rwlatch_.WUnlock(); }
+  inline void WUnlatch() {
+    version_.fetch_add(1, std::memory_order_release);
+    rwlatch_.WUnlock();
+  }
 
   /** Acquire the page read latch. */
   inline void RLatch() { rwlatch_.RLock(); }
@@ -66,6 +91,18 @@ public:
   /** Release the page read latch. */
   inline void RUnlatch() { rwlatch_.RUnlock(); }
 
+  /** @return the page version, odd while a writer holds the page latch. */
+  inline auto GetVersion() -> uint64_t {
+    return version_.load(std::memory_order_acquire);
+  }
+
+  /** @return true if no writer latched the page since GetVersion() returned
+   * version, i.e. everything read from the page in between is consistent. */
+  inline auto ValidateVersion(uint64_t version) -> bool {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return version_.load(std::memory_order_relaxed) == version;
+  }
+
   /** @return the page LSN. */
   inline auto GetLSN() -> lsn_t {
     return *reinterpret_cast<lsn_t *>(GetData() + OFFSET_LSN);
@@ -85,24 +122,43 @@ protected:
   static constexpr size_t OFFSET_LSN = 4;
 
 private:
-  /** Zeroes out the data that is held within the page. */
+  /** Zeroes out the data that is held within the page, which is the frame's
+   * own again if the page was mapped. */
   inline void ResetMemory() {
-    memset(data_, OFFSET_PAGE_START, BUSTUB_PAGE_SIZE);
+    memset(frame_data_, OFFSET_PAGE_START, BUSTUB_PAGE_SIZE);
+    data_.store(frame_data_, std::memory_order_release);
+  }
+
+  /** Serve the page from memory of the disk manager instead of the frame,
+   * until the next ResetMemory. */
+  inline void MapData(const char *data) {
+    data_.store(const_cast<char *>(data), std::memory_order_release);
   }
 
   /** The actual data that is stored within a page. */
   // Usually this should be stored as `char data_[BUSTUB_PAGE_SIZE]{};`. But to
-  // enable ASAN to detect page overflow, we store it as a ptr.
-  char *data_;
+  // enable ASAN to detect page overflow, we store it as a ptr. It is atomic
+  // because mapping a page swaps it while optimistic readers and lock-free
+  // hits may load it.
+  std::atomic<char *> data_;
+  /** The frame's own buffer, data_ points elsewhere while the page is
+   * mapped. */
+  char *frame_data_;
+  /** False if frame_data_ lives in memory the page doesn't own. */
+  bool owns_data_ = true;
+  // The book-keeping fields are atomic because the buffer pool pins and unpins
+  // resident pages without taking its latch.
   /** The ID of this page. */
-  page_id_t page_id_ = INVALID_PAGE_ID;
+  std::atomic<page_id_t> page_id_ = INVALID_PAGE_ID;
   /** The pin count of this page. */
-  int pin_count_ = 0;
+  std::atomic<int> pin_count_ = 0;
   /** True if the page is dirty, i.e. it is different from its corresponding
    * page on disk. */
-  bool is_dirty_ = false;
+  std::atomic<bool> is_dirty_ = false;
   /** Page latch. */
   ReaderWriterLatch rwlatch_;
+  /** Bumped when the write latch is taken and again when it is released. */
+  std::atomic<uint64_t> version_ = 0;
 };
 
 } // namespace bustub
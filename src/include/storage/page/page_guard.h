@@ -81,6 +81,7 @@ class BasicPageGuard {
  private:
   friend class ReadPageGuard;
   friend class WritePageGuard;
+  friend class OptimisticReadGuard;
 
   BufferPoolManager *bpm_{nullptr};
   Page *page_{nullptr};
@@ -143,6 +144,8 @@ class ReadPageGuard {
   }
 
  private:
+  friend class OptimisticReadGuard;
+
   // You may choose to get rid of this and add your own private variables.
   BasicPageGuard guard_;
 };
@@ -210,8 +213,63 @@ class WritePageGuard {
   }
 
  private:
+  friend class OptimisticReadGuard;
+
   // You may choose to get rid of this and add your own private variables.
   BasicPageGuard guard_;
 };
 
+/**
+ * OptimisticReadGuard reads a page without taking its latch. The page stays pinned, so its frame can't be reused,
+ * but writers are free to change the data under the guard: nothing read through it can be trusted, and it may even
+ * be torn, until Validate() confirms that no writer latched the page since the guard was taken. Readers that lose
+ * the race restart instead of blocking writers.
+ */
+class OptimisticReadGuard {
+ public:
+  OptimisticReadGuard() = default;
+  /** Waits for a writer that holds the page to finish, then records the page version. */
+  OptimisticReadGuard(BufferPoolManager *bpm, Page *page);
+  OptimisticReadGuard(const OptimisticReadGuard &) = delete;
+  auto operator=(const OptimisticReadGuard &) -> OptimisticReadGuard & = delete;
+  OptimisticReadGuard(OptimisticReadGuard &&that) noexcept;
+  auto operator=(OptimisticReadGuard &&that) noexcept -> OptimisticReadGuard &;
+
+  /** @brief Unpin the page. */
+  void Drop();
+
+  ~OptimisticReadGuard();
+
+  /** @return true if everything read through the guard so far is consistent */
+  auto Validate() -> bool { return guard_.page_->ValidateVersion(version_); }
+
+  /**
+   * @brief Take the page read latch and hand the pin over to a ReadPageGuard, if no writer got in since this guard
+   * was taken. This guard is dropped either way.
+   * @param[out] guard the latched guard
+   * @return false if the page changed, guard is left untouched then
+   */
+  auto UpgradeRead(ReadPageGuard *guard) -> bool;
+
+  /**
+   * @brief Like UpgradeRead, but take the page write latch and hand the pin over to a WritePageGuard.
+   * @param[out] guard the latched guard
+   * @return false if the page changed, guard is left untouched then
+   */
+  auto UpgradeWrite(WritePageGuard *guard) -> bool;
+
+  auto PageId() -> page_id_t { return guard_.PageId(); }
+
+  auto GetData() -> const char * { return guard_.GetData(); }
+
+  template <class T>
+  auto As() -> const T * {
+    return guard_.As<T>();
+  }
+
+ private:
+  BasicPageGuard guard_;
+  uint64_t version_{0};
+};
+
 }  // namespace bustub
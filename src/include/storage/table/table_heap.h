@@ -30,12 +30,16 @@ namespace bustub {
 /**
  * TableHeap represents a physical table on disk.
  * This is just a doubly-linked list of pages.
+ *
+ * Pages are taken from extents of TABLE_HEAP_EXTENT_PAGES contiguous page ids,
+ * so that a table is laid out sequentially on disk and scans read it in order.
  */
 class TableHeap {
   friend class TableIterator;
 
 public:
-  ~TableHeap() = default;
+  /** Hand the unused page ids of the current extent back. */
+  ~TableHeap();
 
   /**
    * Create a table heap without a transaction. (open table)
@@ -66,9 +70,10 @@ public:
   /**
    * Read a tuple from the table.
    * @param rid rid of the tuple to read
+   * @param access_type type of access to the page, AccessType::Scan for sequential scans
    * @return the meta and tuple
    */
-  auto GetTuple(RID rid) -> std::pair<TupleMeta, Tuple>;
+  auto GetTuple(RID rid, AccessType access_type = AccessType::Unknown) -> std::pair<TupleMeta, Tuple>;
 
   /**
    * Read a tuple meta from the table. Note: if you want to get tuple and meta
@@ -102,8 +107,19 @@ private:
   BufferPoolManager *bpm_;
   page_id_t first_page_id_{INVALID_PAGE_ID};
 
+  /**
+   * Create the next page of the table, from the current extent or a new one.
+   * @param[out] page_id id of the new page
+   * @return nullptr if the page could not be created
+   */
+  auto NewTablePage(page_id_t *page_id) -> Page *;
+
   std::mutex latch_;
   page_id_t last_page_id_{INVALID_PAGE_ID}; /* protected by latch_ */
+  /* the unused page ids [extent_next_, extent_end_) of the current extent,
+   * protected by latch_ */
+  page_id_t extent_next_{INVALID_PAGE_ID};
+  page_id_t extent_end_{INVALID_PAGE_ID};
 };
 
 } // namespace bustub
@@ -16,6 +16,7 @@
 #include <memory>
 #include <utility>
 
+#include "buffer/read_ahead.h"
 #include "common/macros.h"
 #include "common/rid.h"
 #include "concurrency/transaction.h"
@@ -55,6 +56,9 @@ private:
   // scan. Otherwise we will have dead loops when updating while scanning. (In
   // project 4, update should be implemented as deletion + insertion.)
   RID stop_at_rid_;
+
+  /** Prefetches the pages ahead of the scan while the heap's pages have consecutive ids. */
+  ReadAhead read_ahead_;
 };
 
 } // namespace bustub
@@ -97,6 +97,11 @@ public:
   auto KeyFromTuple(const Schema &schema, const Schema &key_schema,
                     const std::vector<uint32_t> &key_attrs) -> Tuple;
 
+  // Encodes a key tuple into size bytes that compare with memcmp like the key
+  // values do, see tuple.cpp for the encoding. Throws if the key doesn't fit.
+  void NormalizeKeyTo(const Schema *key_schema, char *storage,
+                      uint32_t size) const;
+
   // Is the column value null ?
   inline auto IsNull(const Schema *schema, uint32_t column_idx) const -> bool {
     Value value = GetValue(schema, column_idx);
@@ -0,0 +1,338 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// async_disk_manager.cpp
+//
+// Identification: src/storage/disk/async_disk_manager.cpp
+//
+// Copyright (c) 2015-2023, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/disk/async_disk_manager.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iterator>
+#include <utility>
+#include <unistd.h>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define BUSTUB_HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+#include "common/exception.h"
+#include "common/logger.h"
+#include "common/util/crc32c.h"
+
+namespace bustub {
+
+#ifdef BUSTUB_HAVE_IO_URING
+struct AsyncDiskManager::Ring {
+  ~Ring() {
+    if (sqes_ != nullptr) {
+      munmap(sqes_, sqes_size_);
+    }
+    if (cq_ptr_ != nullptr && cq_ptr_ != sq_ptr_) {
+      munmap(cq_ptr_, cq_size_);
+    }
+    if (sq_ptr_ != nullptr) {
+      munmap(sq_ptr_, sq_size_);
+    }
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+  }
+
+  int fd_{-1};
+  void *sq_ptr_{nullptr};
+  size_t sq_size_{0};
+  void *cq_ptr_{nullptr};
+  size_t cq_size_{0};
+  io_uring_sqe *sqes_{nullptr};
+  size_t sqes_size_{0};
+  unsigned *sq_tail_{nullptr};
+  unsigned *sq_mask_{nullptr};
+  unsigned *sq_array_{nullptr};
+  unsigned *cq_head_{nullptr};
+  unsigned *cq_tail_{nullptr};
+  unsigned *cq_mask_{nullptr};
+  io_uring_cqe *cqes_{nullptr};
+};
+
+static auto IoUringEnter(int ring_fd, unsigned to_submit,
+                         unsigned min_complete, unsigned flags) -> int {
+  return static_cast<int>(syscall(__NR_io_uring_enter, ring_fd, to_submit,
+                                  min_complete, flags, nullptr, 0));
+}
+#else
+struct AsyncDiskManager::Ring {};
+#endif
+
+AsyncDiskManager::AsyncDiskManager(const std::string &db_file,
+                                   IoBackend backend, size_t queue_depth,
+                                   bool direct_io, SyncPolicy sync_policy,
+                                   PageCompression compression,
+                                   bool doublewrite)
+    : DiskManager(db_file, direct_io, sync_policy, compression, doublewrite),
+      backend_(backend), queue_depth_(queue_depth) {
+  BUSTUB_ASSERT(queue_depth > 0, "async disk manager: empty queue");
+  if (backend_ != IoBackend::THREAD_POOL && !UsesCompression() &&
+      !UsesDoublewrite() && SetUpRing(queue_depth)) {
+    backend_ = IoBackend::IO_URING;
+    completion_thread_ = std::thread(&AsyncDiskManager::RunCompletion, this);
+    return;
+  }
+  backend_ = IoBackend::THREAD_POOL;
+  for (int i = 0; i < DISK_IO_THREADS; ++i) {
+    workers_.emplace_back(&AsyncDiskManager::RunWorker, this);
+  }
+}
+
+AsyncDiskManager::~AsyncDiskManager() {
+  if (backend_ == IoBackend::IO_URING) {
+#ifdef BUSTUB_HAVE_IO_URING
+    {
+      std::unique_lock<std::mutex> lock(queue_latch_);
+      SubmitRingLocked();
+      completed_.wait(lock, [this] { return in_flight_ == 0; });
+      // a no-op without a request tells the completion thread to stop
+      unsigned tail = *ring_->sq_tail_;
+      unsigned index = tail & *ring_->sq_mask_;
+      memset(&ring_->sqes_[index], 0, sizeof(io_uring_sqe));
+      ring_->sqes_[index].opcode = IORING_OP_NOP;
+      ring_->sq_array_[index] = index;
+      __atomic_store_n(ring_->sq_tail_, tail + 1, __ATOMIC_RELEASE);
+      while (IoUringEnter(ring_->fd_, 1, 0, 0) < 0 && errno == EINTR) {
+      }
+    }
+    completion_thread_.join();
+#endif
+  } else {
+    {
+      std::scoped_lock lock(queue_latch_);
+      std::move(staged_.begin(), staged_.end(), std::back_inserter(pending_));
+      staged_.clear();
+      stop_ = true;
+    }
+    submitted_.notify_all();
+    for (auto &worker : workers_) {
+      worker.join();
+    }
+  }
+}
+
+void AsyncDiskManager::WritePageAsync(page_id_t page_id, const char *page_data,
+                                      IoCallback callback) {
+  num_writes_ += 1;
+  // the buffer stays unchanged until the callback, so the checksum taken now
+  // covers the bytes written by either backend
+  Enqueue({true, page_id, const_cast<char *>(page_data), std::move(callback),
+           Crc32c::Compute(page_data, BUSTUB_PAGE_SIZE)});
+}
+
+void AsyncDiskManager::ReadPageAsync(page_id_t page_id, char *page_data,
+                                     IoCallback callback) {
+  Enqueue({false, page_id, page_data, std::move(callback)});
+}
+
+void AsyncDiskManager::SubmitIo() {
+  std::scoped_lock lock(queue_latch_);
+  if (backend_ == IoBackend::IO_URING) {
+    SubmitRingLocked();
+    return;
+  }
+  if (staged_.empty()) {
+    return;
+  }
+  std::move(staged_.begin(), staged_.end(), std::back_inserter(pending_));
+  staged_.clear();
+  submitted_.notify_all();
+}
+
+void AsyncDiskManager::Enqueue(IoRequest request) {
+  if (direct_io_ &&
+      reinterpret_cast<uintptr_t>(request.data_) % BUSTUB_PAGE_SIZE != 0) {
+    // O_DIRECT needs an aligned buffer, DoIo bounces through one
+    request.callback_(DoIo(request));
+    return;
+  }
+  std::unique_lock<std::mutex> lock(queue_latch_);
+  if (backend_ == IoBackend::THREAD_POOL) {
+    staged_.push_back(std::move(request));
+    return;
+  }
+#ifdef BUSTUB_HAVE_IO_URING
+  while (queued_ + in_flight_ >= queue_depth_) {
+    // the ring is full, start what is queued so that slots free up
+    SubmitRingLocked();
+    completed_.wait(lock);
+  }
+  unsigned tail = *ring_->sq_tail_;
+  unsigned index = tail & *ring_->sq_mask_;
+  io_uring_sqe *sqe = &ring_->sqes_[index];
+  memset(sqe, 0, sizeof(io_uring_sqe));
+  sqe->opcode = request.is_write_ ? IORING_OP_WRITE : IORING_OP_READ;
+  sqe->fd = db_fd_;
+  sqe->addr = reinterpret_cast<uint64_t>(request.data_);
+  sqe->len = BUSTUB_PAGE_SIZE;
+  sqe->off = static_cast<uint64_t>(request.page_id_) * BUSTUB_PAGE_SIZE;
+  sqe->user_data =
+      reinterpret_cast<uint64_t>(new IoRequest(std::move(request)));
+  ring_->sq_array_[index] = index;
+  __atomic_store_n(ring_->sq_tail_, tail + 1, __ATOMIC_RELEASE);
+  queued_++;
+#endif
+}
+
+auto AsyncDiskManager::SetUpRing(size_t queue_depth) -> bool {
+#ifdef BUSTUB_HAVE_IO_URING
+  io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  int ring_fd = static_cast<int>(syscall(
+      __NR_io_uring_setup, static_cast<unsigned>(queue_depth), &params));
+  if (ring_fd < 0) {
+    LOG_DEBUG("io_uring unavailable, falling back to a thread pool");
+    return false;
+  }
+  auto ring = std::make_unique<Ring>();
+  ring->fd_ = ring_fd;
+  ring->sq_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  ring->cq_size_ =
+      params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if (single_mmap) {
+    ring->sq_size_ = ring->cq_size_ = std::max(ring->sq_size_, ring->cq_size_);
+  }
+  void *sq_ptr = mmap(nullptr, ring->sq_size_, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+  if (sq_ptr == MAP_FAILED) {
+    return false;
+  }
+  ring->sq_ptr_ = sq_ptr;
+  void *cq_ptr = sq_ptr;
+  if (!single_mmap) {
+    cq_ptr = mmap(nullptr, ring->cq_size_, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+    if (cq_ptr == MAP_FAILED) {
+      return false;
+    }
+  }
+  ring->cq_ptr_ = cq_ptr;
+  ring->sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+  void *sqes = mmap(nullptr, ring->sqes_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED) {
+    return false;
+  }
+  ring->sqes_ = static_cast<io_uring_sqe *>(sqes);
+  auto *sq = static_cast<char *>(sq_ptr);
+  auto *cq = static_cast<char *>(cq_ptr);
+  ring->sq_tail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+  ring->sq_mask_ = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+  ring->sq_array_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+  ring->cq_head_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+  ring->cq_tail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+  ring->cq_mask_ = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+  ring->cqes_ = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+  ring_ = std::move(ring);
+  return true;
+#else
+  return false;
+#endif
+}
+
+void AsyncDiskManager::SubmitRingLocked() {
+#ifdef BUSTUB_HAVE_IO_URING
+  while (queued_ > 0) {
+    int submitted =
+        IoUringEnter(ring_->fd_, static_cast<unsigned>(queued_), 0, 0);
+    if (submitted < 0) {
+      if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+        continue;
+      }
+      throw Exception("io_uring_enter failed");
+    }
+    queued_ -= static_cast<size_t>(submitted);
+    in_flight_ += static_cast<size_t>(submitted);
+  }
+#endif
+}
+
+void AsyncDiskManager::RunCompletion() {
+#ifdef BUSTUB_HAVE_IO_URING
+  std::vector<std::pair<std::unique_ptr<IoRequest>, int>> done;
+  bool stop = false;
+  while (!stop) {
+    if (IoUringEnter(ring_->fd_, 0, 1, IORING_ENTER_GETEVENTS) < 0 &&
+        errno != EINTR) {
+      throw Exception("io_uring_enter failed");
+    }
+    // only this thread moves the head, the kernel moves the tail
+    unsigned head = *ring_->cq_head_;
+    unsigned tail = __atomic_load_n(ring_->cq_tail_, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head) {
+      const io_uring_cqe &cqe = ring_->cqes_[head & *ring_->cq_mask_];
+      if (cqe.user_data == 0) {
+        stop = true;
+        continue;
+      }
+      done.emplace_back(reinterpret_cast<IoRequest *>(cqe.user_data),
+                        cqe.res);
+    }
+    __atomic_store_n(ring_->cq_head_, head, __ATOMIC_RELEASE);
+    for (auto &[request, res] : done) {
+      bool ok;
+      if (request->is_write_) {
+        ok = res == BUSTUB_PAGE_SIZE;
+        if (ok) {
+          RecordChecksum(request->page_id_, request->checksum_);
+          PageWritten(request->page_id_);
+        } else {
+          LOG_DEBUG("I/O error while writing");
+        }
+      } else {
+        ok = res >= 0;
+        if (ok && res < BUSTUB_PAGE_SIZE) {
+          // reading past the end of the file yields zeros
+          memset(request->data_ + res, 0, BUSTUB_PAGE_SIZE - res);
+        }
+        if (!ok) {
+          LOG_DEBUG("I/O error while reading");
+        } else {
+          ok = VerifyChecksum(request->page_id_, request->data_);
+        }
+      }
+      request->callback_(ok);
+    }
+    {
+      std::scoped_lock lock(queue_latch_);
+      in_flight_ -= done.size();
+    }
+    completed_.notify_all();
+    done.clear();
+  }
+#endif
+}
+
+void AsyncDiskManager::RunWorker() {
+  std::unique_lock<std::mutex> lock(queue_latch_);
+  while (true) {
+    submitted_.wait(lock, [this] { return stop_ || !pending_.empty(); });
+    if (pending_.empty()) {
+      return;
+    }
+    IoRequest request = std::move(pending_.front());
+    pending_.pop_front();
+    lock.unlock();
+    request.callback_(DoIo(request));
+    lock.lock();
+  }
+}
+
+} // namespace bustub
@@ -0,0 +1,509 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// compressed_page_store.cpp
+//
+// Identification: src/storage/disk/compressed_page_store.cpp
+//
+// Copyright (c) 2015-2023, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/disk/compressed_page_store.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+#include "common/exception.h"
+#include "common/logger.h"
+
+namespace bustub {
+
+/** First 4 bytes of a map file, "BPMC". */
+static constexpr uint32_t MAP_FILE_MAGIC = 0x434d5042;
+
+/** Smallest match of the LZ4 block format. */
+static constexpr size_t MIN_MATCH = 4;
+/** The last match starts at least this many bytes before the end. */
+static constexpr size_t MF_LIMIT = 12;
+/** The block ends with at least this many literals. */
+static constexpr size_t LAST_LITERALS = 5;
+static constexpr size_t MAX_OFFSET = 65535;
+static constexpr int HASH_BITS = 12;
+
+static auto Read32(const uint8_t *p) -> uint32_t {
+  uint32_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+static auto Hash(uint32_t sequence) -> size_t {
+  return (sequence * 2654435761U) >> (32 - HASH_BITS);
+}
+
+/**
+ * Writes a length of the LZ4 block format past the 4 bits of its token
+ */
+static auto WriteLength(size_t length, uint8_t **op, const uint8_t *oend)
+    -> bool {
+  for (; length >= 255; length -= 255) {
+    if (*op >= oend) {
+      return false;
+    }
+    *(*op)++ = 255;
+  }
+  if (*op >= oend) {
+    return false;
+  }
+  *(*op)++ = static_cast<uint8_t>(length);
+  return true;
+}
+
+static auto ReadLength(size_t *length, const uint8_t **ip,
+                       const uint8_t *iend) -> bool {
+  uint8_t byte;
+  do {
+    if (*ip >= iend) {
+      return false;
+    }
+    byte = *(*ip)++;
+    *length += byte;
+  } while (byte == 255);
+  return true;
+}
+
+/**
+ * Writes a sequence: literals [anchor, anchor + literals), then a match of
+ * match_length bytes offset bytes back, none if match_length is 0
+ */
+static auto WriteSequence(const uint8_t *anchor, size_t literals,
+                          size_t offset, size_t match_length, uint8_t **op,
+                          const uint8_t *oend) -> bool {
+  if (*op >= oend) {
+    return false;
+  }
+  uint8_t *token = (*op)++;
+  *token = static_cast<uint8_t>(std::min<size_t>(literals, 15) << 4);
+  if (literals >= 15 && !WriteLength(literals - 15, op, oend)) {
+    return false;
+  }
+  if (static_cast<size_t>(oend - *op) < literals) {
+    return false;
+  }
+  memcpy(*op, anchor, literals);
+  *op += literals;
+  if (match_length == 0) {
+    return true;
+  }
+  if (oend - *op < 2) {
+    return false;
+  }
+  *(*op)++ = static_cast<uint8_t>(offset);
+  *(*op)++ = static_cast<uint8_t>(offset >> 8);
+  size_t length = match_length - MIN_MATCH;
+  *token |= static_cast<uint8_t>(std::min<size_t>(length, 15));
+  return length < 15 || WriteLength(length - 15, op, oend);
+}
+
+auto CompressedPageStore::Compress(const char *src, size_t src_size,
+                                   char *dst, size_t dst_capacity) -> size_t {
+  const auto *base = reinterpret_cast<const uint8_t *>(src);
+  const uint8_t *iend = base + src_size;
+  const uint8_t *anchor = base;
+  auto *op = reinterpret_cast<uint8_t *>(dst);
+  const uint8_t *oend = op + dst_capacity;
+  std::array<int32_t, 1 << HASH_BITS> table;
+  table.fill(-1);
+
+  if (src_size > MF_LIMIT) {
+    const uint8_t *match_limit = iend - LAST_LITERALS;
+    const uint8_t *ip = base;
+    while (ip < iend - MF_LIMIT) {
+      uint32_t sequence = Read32(ip);
+      size_t hash = Hash(sequence);
+      int32_t candidate = table[hash];
+      table[hash] = static_cast<int32_t>(ip - base);
+      if (candidate < 0 ||
+          static_cast<size_t>(ip - base - candidate) > MAX_OFFSET ||
+          Read32(base + candidate) != sequence) {
+        ip++;
+        continue;
+      }
+      const uint8_t *ref = base + candidate;
+      size_t length = MIN_MATCH;
+      while (ip + length < match_limit && ref[length] == ip[length]) {
+        length++;
+      }
+      if (!WriteSequence(anchor, static_cast<size_t>(ip - anchor),
+                         static_cast<size_t>(ip - ref), length, &op, oend)) {
+        return 0;
+      }
+      ip += length;
+      anchor = ip;
+    }
+  }
+  if (!WriteSequence(anchor, static_cast<size_t>(iend - anchor), 0, 0, &op,
+                     oend)) {
+    return 0;
+  }
+  return static_cast<size_t>(op - reinterpret_cast<uint8_t *>(dst));
+}
+
+auto CompressedPageStore::Decompress(const char *src, size_t src_size,
+                                     char *dst, size_t dst_size) -> bool {
+  const auto *ip = reinterpret_cast<const uint8_t *>(src);
+  const uint8_t *iend = ip + src_size;
+  auto *base = reinterpret_cast<uint8_t *>(dst);
+  uint8_t *op = base;
+  const uint8_t *oend = base + dst_size;
+  while (ip < iend) {
+    uint8_t token = *ip++;
+    size_t literals = token >> 4;
+    if (literals == 15 && !ReadLength(&literals, &ip, iend)) {
+      return false;
+    }
+    if (static_cast<size_t>(iend - ip) < literals ||
+        static_cast<size_t>(oend - op) < literals) {
+      return false;
+    }
+    memcpy(op, ip, literals);
+    ip += literals;
+    op += literals;
+    if (ip == iend) {
+      // the last sequence has no match
+      break;
+    }
+    if (iend - ip < 2) {
+      return false;
+    }
+    size_t offset = ip[0] | static_cast<size_t>(ip[1]) << 8;
+    ip += 2;
+    size_t length = token & 15;
+    if (length == 15 && !ReadLength(&length, &ip, iend)) {
+      return false;
+    }
+    length += MIN_MATCH;
+    if (offset == 0 || offset > static_cast<size_t>(op - base) ||
+        static_cast<size_t>(oend - op) < length) {
+      return false;
+    }
+    // the match may overlap the bytes it produces, copy byte by byte
+    const uint8_t *ref = op - offset;
+    for (size_t i = 0; i < length; ++i) {
+      op[i] = ref[i];
+    }
+    op += length;
+  }
+  return op == oend;
+}
+
+/**
+ * Opens the map file and rebuilds the free extents from the extents in use
+ */
+CompressedPageStore::CompressedPageStore(const std::string &map_file,
+                                         PageCompression compression,
+                                         bool durable)
+    : durable_(durable), free_extents_(SECTORS_PER_PAGE + 1) {
+  map_fd_ = open(map_file.c_str(), O_RDWR | O_CREAT, 0644);
+  if (map_fd_ < 0) {
+    throw Exception("can't open page map file");
+  }
+  struct stat stat_buf;
+  if (fstat(map_fd_, &stat_buf) != 0) {
+    throw Exception("can't stat page map file");
+  }
+  PageExtent header;
+  if (stat_buf.st_size < static_cast<off_t>(sizeof(header))) {
+    header = {MAP_FILE_MAGIC, static_cast<uint16_t>(compression), 0};
+    if (pwrite(map_fd_, &header, sizeof(header), 0) !=
+        static_cast<ssize_t>(sizeof(header))) {
+      throw Exception("can't write page map file");
+    }
+    return;
+  }
+  if (pread(map_fd_, &header, sizeof(header), 0) !=
+          static_cast<ssize_t>(sizeof(header)) ||
+      header.sector_ != MAP_FILE_MAGIC ||
+      header.length_ != static_cast<uint16_t>(PageCompression::LZ4)) {
+    throw Exception("bad page map file");
+  }
+  extents_.resize(static_cast<size_t>(stat_buf.st_size) / sizeof(PageExtent) -
+                  1);
+  auto bytes = static_cast<ssize_t>(extents_.size() * sizeof(PageExtent));
+  if (pread(map_fd_, extents_.data(), bytes, sizeof(header)) != bytes) {
+    throw Exception("can't read page map file");
+  }
+
+  std::vector<std::pair<uint32_t, uint32_t>> used;
+  for (const auto &extent : extents_) {
+    if (extent.length_ != 0) {
+      used.emplace_back(extent.sector_, extent.sector_ + extent.sectors_);
+      page_bytes_ += BUSTUB_PAGE_SIZE;
+      stored_bytes_ += extent.sectors_ * COMPRESSION_SECTOR_SIZE;
+    }
+  }
+  std::sort(used.begin(), used.end());
+  for (auto [first, end] : used) {
+    if (first > end_sector_) {
+      FreeExtent(end_sector_, first - end_sector_);
+    }
+    end_sector_ = std::max(end_sector_, end);
+  }
+}
+
+CompressedPageStore::~CompressedPageStore() {
+  if (map_fd_ >= 0) {
+    close(map_fd_);
+  }
+}
+
+auto CompressedPageStore::Exists(const std::string &map_file) -> bool {
+  struct stat stat_buf;
+  return stat(map_file.c_str(), &stat_buf) == 0 &&
+         stat_buf.st_size >= static_cast<off_t>(sizeof(PageExtent));
+}
+
+auto CompressedPageStore::AllocateExtent(size_t sectors) -> uint32_t {
+  for (size_t size = sectors; size <= SECTORS_PER_PAGE; ++size) {
+    if (free_extents_[size].empty()) {
+      continue;
+    }
+    uint32_t sector = free_extents_[size].back();
+    free_extents_[size].pop_back();
+    if (size > sectors) {
+      FreeExtent(sector + static_cast<uint32_t>(sectors), size - sectors);
+    }
+    return sector;
+  }
+  uint32_t sector = end_sector_;
+  end_sector_ += static_cast<uint32_t>(sectors);
+  return sector;
+}
+
+void CompressedPageStore::FreeExtent(uint32_t sector, size_t sectors) {
+  // free extents are not merged, larger holes are kept as raw page sized ones
+  while (sectors > 0) {
+    size_t size = std::min(sectors, SECTORS_PER_PAGE);
+    free_extents_[size].push_back(sector);
+    sector += static_cast<uint32_t>(size);
+    sectors -= size;
+  }
+}
+
+auto CompressedPageStore::WriteEntries(
+    std::vector<std::pair<page_id_t, PageExtent>> entries) -> bool {
+  // the last entry of a page wins
+  std::stable_sort(
+      entries.begin(), entries.end(),
+      [](const auto &a, const auto &b) { return a.first < b.first; });
+  std::vector<PageExtent> run;
+  size_t first = 0;
+  while (first < entries.size()) {
+    run.clear();
+    page_id_t start = entries[first].first;
+    size_t end = first;
+    while (end < entries.size() &&
+           entries[end].first <= start + static_cast<page_id_t>(run.size())) {
+      if (entries[end].first == start + static_cast<page_id_t>(run.size())) {
+        run.push_back(entries[end].second);
+      } else {
+        run.back() = entries[end].second;
+      }
+      end++;
+    }
+    auto offset = static_cast<off_t>(start + 1) * sizeof(PageExtent);
+    auto bytes = static_cast<ssize_t>(run.size() * sizeof(PageExtent));
+    ssize_t rc;
+    do {
+      rc = pwrite(map_fd_, run.data(), bytes, offset);
+    } while (rc < 0 && errno == EINTR);
+    if (rc != bytes) {
+      return false;
+    }
+    first = end;
+  }
+  return true;
+}
+
+/**
+ * Compress a page into a buffer of whole sectors and write it to a new
+ * extent. A durable store only writes the map entry once Sync made the data
+ * durable, and only reuses the old extent once the entry is durable, so a
+ * crash leaves the map pointing at either an old or the new page.
+ */
+auto CompressedPageStore::WritePage(int db_fd, page_id_t page_id,
+                                    const char *page_data) -> bool {
+  char buffer[BUSTUB_PAGE_SIZE];
+  // a page that doesn't save a sector is stored raw and read without a copy
+  size_t length = Compress(page_data, BUSTUB_PAGE_SIZE, buffer,
+                           BUSTUB_PAGE_SIZE - COMPRESSION_SECTOR_SIZE);
+  const char *data = buffer;
+  if (length == 0) {
+    length = BUSTUB_PAGE_SIZE;
+    data = page_data;
+  }
+  size_t sectors =
+      (length + COMPRESSION_SECTOR_SIZE - 1) / COMPRESSION_SECTOR_SIZE;
+  if (data == buffer) {
+    memset(buffer + length, 0, sectors * COMPRESSION_SECTOR_SIZE - length);
+  }
+
+  PageExtent extent{0, static_cast<uint16_t>(length),
+                    static_cast<uint16_t>(sectors)};
+  {
+    std::scoped_lock latch(latch_);
+    extent.sector_ = AllocateExtent(sectors);
+  }
+
+  auto offset = static_cast<off_t>(extent.sector_) * COMPRESSION_SECTOR_SIZE;
+  size_t done = 0;
+  while (done < sectors * COMPRESSION_SECTOR_SIZE) {
+    ssize_t rc = pwrite(db_fd, data + done,
+                        sectors * COMPRESSION_SECTOR_SIZE - done,
+                        offset + static_cast<off_t>(done));
+    if (rc < 0 && errno == EINTR) {
+      continue;
+    }
+    if (rc <= 0) {
+      LOG_DEBUG("I/O error while writing");
+      std::scoped_lock latch(latch_);
+      FreeExtent(extent.sector_, sectors);
+      return false;
+    }
+    done += static_cast<size_t>(rc);
+  }
+  if (!durable_ && !WriteEntries({{page_id, extent}})) {
+    LOG_DEBUG("I/O error while writing page map");
+    std::scoped_lock latch(latch_);
+    FreeExtent(extent.sector_, sectors);
+    return false;
+  }
+
+  bool sync = false;
+  {
+    std::scoped_lock latch(latch_);
+    if (static_cast<size_t>(page_id) >= extents_.size()) {
+      extents_.resize(page_id + 1, PageExtent{0, 0, 0});
+    }
+    PageExtent old_extent = extents_[page_id];
+    extents_[page_id] = extent;
+    if (old_extent.length_ == 0) {
+      page_bytes_ += BUSTUB_PAGE_SIZE;
+    } else if (!durable_) {
+      FreeExtent(old_extent.sector_, old_extent.sectors_);
+    } else {
+      // the durable map may still point at the old extent
+      unsynced_extents_.push_back(old_extent);
+    }
+    if (durable_) {
+      pending_entries_.emplace_back(page_id, extent);
+      sync = pending_entries_.size() >= MAX_PENDING_ENTRIES;
+    }
+    stored_bytes_ += sectors * COMPRESSION_SECTOR_SIZE;
+    stored_bytes_ -= old_extent.sectors_ * COMPRESSION_SECTOR_SIZE;
+  }
+  if (sync) {
+    // without syncs from DiskManager the pending entries would pile up
+    Sync(db_fd);
+  }
+  return true;
+}
+
+/**
+ * Read the extent of a page and decompress it
+ */
+auto CompressedPageStore::ReadPage(int db_fd, page_id_t page_id,
+                                   char *page_data) -> bool {
+  PageExtent extent{0, 0, 0};
+  {
+    std::scoped_lock latch(latch_);
+    if (static_cast<size_t>(page_id) < extents_.size()) {
+      extent = extents_[page_id];
+    }
+  }
+  if (extent.length_ == 0) {
+    memset(page_data, 0, BUSTUB_PAGE_SIZE);
+    return true;
+  }
+  char buffer[BUSTUB_PAGE_SIZE];
+  bool raw = extent.length_ == BUSTUB_PAGE_SIZE;
+  char *target = raw ? page_data : buffer;
+  auto offset = static_cast<off_t>(extent.sector_) * COMPRESSION_SECTOR_SIZE;
+  size_t done = 0;
+  while (done < extent.length_) {
+    ssize_t rc = pread(db_fd, target + done, extent.length_ - done,
+                       offset + static_cast<off_t>(done));
+    if (rc < 0 && errno == EINTR) {
+      continue;
+    }
+    if (rc <= 0) {
+      LOG_DEBUG("I/O error while reading");
+      return false;
+    }
+    done += static_cast<size_t>(rc);
+  }
+  if (!raw &&
+      !Decompress(buffer, extent.length_, page_data, BUSTUB_PAGE_SIZE)) {
+    LOG_DEBUG("corrupt compressed page");
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Make the database file durable, then write the pending map entries and make
+ * the map file durable, then reuse the extents of the pages that were
+ * rewritten before
+ */
+void CompressedPageStore::Sync(int db_fd) {
+  std::scoped_lock sync_latch(sync_latch_);
+  std::vector<std::pair<page_id_t, PageExtent>> entries;
+  std::vector<PageExtent> replaced;
+  {
+    std::scoped_lock latch(latch_);
+    entries.swap(pending_entries_);
+    replaced.swap(unsynced_extents_);
+  }
+  if (entries.empty() && replaced.empty()) {
+    return;
+  }
+  // the pages of these entries were written before they were queued
+  if (fdatasync(db_fd) != 0 || !WriteEntries(entries) ||
+      fdatasync(map_fd_) != 0) {
+    LOG_DEBUG("I/O error while syncing page map");
+    std::scoped_lock latch(latch_);
+    entries.insert(entries.end(), pending_entries_.begin(),
+                   pending_entries_.end());
+    pending_entries_.swap(entries);
+    unsynced_extents_.insert(unsynced_extents_.end(), replaced.begin(),
+                             replaced.end());
+    return;
+  }
+  std::scoped_lock latch(latch_);
+  for (const auto &extent : replaced) {
+    FreeExtent(extent.sector_, extent.sectors_);
+  }
+}
+
+auto CompressedPageStore::GetNumPages() -> page_id_t {
+  std::scoped_lock latch(latch_);
+  return static_cast<page_id_t>(extents_.size());
+}
+
+auto CompressedPageStore::GetCompressionRatio() -> double {
+  std::scoped_lock latch(latch_);
+  if (stored_bytes_ == 0) {
+    return 1.0;
+  }
+  return static_cast<double>(page_bytes_) /
+         static_cast<double>(stored_bytes_);
+}
+
+} // namespace bustub
@@ -10,17 +10,26 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
 #include <cassert>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
 #include <cstring>
+#include <fcntl.h>
 #include <iostream>
+#include <memory>
 #include <mutex> // NOLINT
 #include <string>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <thread> // NOLINT
+#include <unistd.h>
 
 #include "common/exception.h"
 #include "common/logger.h"
 #include "common/macros.h"
+#include "common/util/crc32c.h"
 #include "storage/disk/disk_manager.h"
 
 namespace bustub {
@@ -31,13 +40,17 @@ static char *buffer_used;
  * Constructor: open/create a single database file & log file
  * @input db_file: database file name
  */
-DiskManager::DiskManager(const std::string &db_file) : file_name_(db_file) {
+DiskManager::DiskManager(const std::string &db_file, bool direct_io,
+                         SyncPolicy sync_policy, PageCompression compression,
+                         bool doublewrite)
+    : file_name_(db_file), sync_policy_(sync_policy) {
   std::string::size_type n = file_name_.rfind('.');
   if (n == std::string::npos) {
     LOG_DEBUG("wrong file format");
     return;
   }
   log_name_ = file_name_.substr(0, n) + ".log";
+  fsm_name_ = file_name_.substr(0, n) + ".fsm";
 
   log_io_.open(log_name_,
                std::ios::binary | std::ios::in | std::ios::app | std::ios::out);
@@ -52,28 +65,115 @@ DiskManager::DiskManager(const std::string &db_file) : file_name_(db_file) {
     }
   }
 
-  std::scoped_lock scoped_db_io_latch(db_io_latch_);
-  db_io_.open(db_file, std::ios::binary | std::ios::in | std::ios::out);
-  // directory or file does not exist
-  if (!db_io_.is_open()) {
-    db_io_.clear();
-    // create a new file
-    db_io_.open(db_file, std::ios::binary | std::ios::trunc | std::ios::out |
-                             std::ios::in);
-    if (!db_io_.is_open()) {
+  // a database that was created compressed stays compressed
+  std::string map_name = file_name_.substr(0, n) + ".pmap";
+  if (compression != PageCompression::NONE ||
+      CompressedPageStore::Exists(map_name)) {
+    // without syncs the map entries are written right away
+    compressed_store_ = std::make_unique<CompressedPageStore>(
+        map_name, compression,
+        sync_policy != SyncPolicy::NONE || doublewrite);
+    // compressed extents are smaller than the blocks O_DIRECT works in
+    direct_io = false;
+  }
+
+#ifdef O_DIRECT
+  if (direct_io) {
+    db_fd_ = open(db_file.c_str(), O_RDWR | O_CREAT | O_DIRECT, 0644);
+    direct_io_ = db_fd_ >= 0;
+    if (db_fd_ < 0 && errno == EINVAL) {
+      LOG_DEBUG("O_DIRECT not supported, using buffered I/O");
+    }
+  }
+#endif
+  if (db_fd_ < 0) {
+    db_fd_ = open(db_file.c_str(), O_RDWR | O_CREAT, 0644);
+    if (db_fd_ < 0) {
       throw Exception("can't open db file");
     }
   }
+  struct stat stat_buf;
+  if (compressed_store_ != nullptr) {
+    num_pages_ = compressed_store_->GetNumPages();
+  } else if (fstat(db_fd_, &stat_buf) == 0) {
+    num_pages_ = static_cast<page_id_t>(
+        (stat_buf.st_size + BUSTUB_PAGE_SIZE - 1) / BUSTUB_PAGE_SIZE);
+  }
+
+  // the checksums and staged pages left next to an empty database file
+  // belong to some other database
+  bool new_database = num_pages_ == 0;
+  std::string checksum_name = file_name_.substr(0, n) + ".crc";
+  checksum_fd_ = open(checksum_name.c_str(),
+                      O_RDWR | O_CREAT | (new_database ? O_TRUNC : 0), 0644);
+  if (checksum_fd_ < 0) {
+    throw Exception("can't open checksum file");
+  }
+  if (fstat(checksum_fd_, &stat_buf) == 0 && stat_buf.st_size > 0) {
+    checksums_.resize(static_cast<size_t>(stat_buf.st_size) /
+                      sizeof(uint32_t));
+    auto bytes = static_cast<ssize_t>(checksums_.size() * sizeof(uint32_t));
+    if (pread(checksum_fd_, checksums_.data(), bytes, 0) != bytes) {
+      throw Exception("can't read checksum file");
+    }
+  }
+
+  if (doublewrite) {
+    doublewrite_ =
+        std::make_unique<DoublewriteBuffer>(file_name_.substr(0, n) + ".dwb");
+    if (new_database) {
+      doublewrite_->Clear();
+    } else {
+      RepairTornPages();
+    }
+  }
+
+  std::scoped_lock scoped_fsm_io_latch(fsm_io_latch_);
+  fsm_io_.open(fsm_name_, std::ios::binary | std::ios::in | std::ios::out);
+  if (!fsm_io_.is_open()) {
+    fsm_io_.clear();
+    fsm_io_.open(fsm_name_, std::ios::binary | std::ios::trunc | std::ios::out |
+                                std::ios::in);
+    if (!fsm_io_.is_open()) {
+      throw Exception("can't open free space map file");
+    }
+  }
   buffer_used = nullptr;
 }
 
+DiskManager::~DiskManager() {
+  if (compressed_store_ != nullptr && db_fd_ >= 0) {
+    compressed_store_->Sync(db_fd_);
+  }
+  if (db_fd_ >= 0) {
+    close(db_fd_);
+  }
+  if (checksum_fd_ >= 0) {
+    close(checksum_fd_);
+  }
+}
+
 /**
  * Close all file streams
  */
 void DiskManager::ShutDown() {
+  if (compressed_store_ != nullptr && db_fd_ >= 0) {
+    // write the map entries still kept in memory
+    compressed_store_->Sync(db_fd_);
+  }
+  if (db_fd_ >= 0) {
+    close(db_fd_);
+    db_fd_ = -1;
+  }
+  if (checksum_fd_ >= 0) {
+    close(checksum_fd_);
+    checksum_fd_ = -1;
+  }
+  compressed_store_.reset();
+  doublewrite_.reset();
   {
-    std::scoped_lock scoped_db_io_latch(db_io_latch_);
-    db_io_.close();
+    std::scoped_lock scoped_fsm_io_latch(fsm_io_latch_);
+    fsm_io_.close();
   }
   log_io_.close();
 }
@@ -82,50 +182,433 @@ void DiskManager::ShutDown() {
  * Write the contents of the specified page into disk file
  */
 void DiskManager::WritePage(page_id_t page_id, const char *page_data) {
-  std::scoped_lock scoped_db_io_latch(db_io_latch_);
-  size_t offset = static_cast<size_t>(page_id) * BUSTUB_PAGE_SIZE;
-  // set write cursor to offset
   num_writes_ += 1;
-  db_io_.seekp(offset);
-  db_io_.write(page_data, BUSTUB_PAGE_SIZE);
-  // check for I/O error
-  if (db_io_.bad()) {
-    LOG_DEBUG("I/O error while writing");
+  if (doublewrite_ != nullptr) {
+    WriteThroughDoublewrite({{page_id, page_data}});
     return;
   }
-  // needs to flush to keep disk file in sync
-  db_io_.flush();
+  WritePageToFile(page_id, page_data);
 }
 
 /**
  * Read the contents of the specified page into the given memory area
  */
-void DiskManager::ReadPage(page_id_t page_id, char *page_data) {
-  std::scoped_lock scoped_db_io_latch(db_io_latch_);
-  int offset = page_id * BUSTUB_PAGE_SIZE;
-  // check if read beyond file length
-  if (offset > GetFileSize(file_name_)) {
-    LOG_DEBUG("I/O error reading past end of file");
-    // std::cerr << "I/O error while reading" << std::endl;
-  } else {
-    // set read cursor to offset
-    db_io_.seekp(offset);
-    db_io_.read(page_data, BUSTUB_PAGE_SIZE);
-    if (db_io_.bad()) {
+auto DiskManager::ReadPage(page_id_t page_id, char *page_data) -> bool {
+  return ReadPageFromFile(page_id, page_data);
+}
+
+/**
+ * Returns a page-aligned buffer of the calling thread for direct I/O on
+ * unaligned pages
+ */
+static auto BounceBuffer() -> char * {
+  thread_local std::unique_ptr<char, decltype(&free)> buffer(
+      static_cast<char *>(aligned_alloc(BUSTUB_PAGE_SIZE, BUSTUB_PAGE_SIZE)),
+      &free);
+  return buffer.get();
+}
+
+static auto IsAligned(const char *data) -> bool {
+  return reinterpret_cast<uintptr_t>(data) % BUSTUB_PAGE_SIZE == 0;
+}
+
+/**
+ * Write a whole page at its offset, retrying short writes
+ */
+auto DiskManager::WritePageToFile(page_id_t page_id, const char *page_data)
+    -> bool {
+  return WritePageToFile(page_id, page_data,
+                         Crc32c::Compute(page_data, BUSTUB_PAGE_SIZE));
+}
+
+auto DiskManager::WritePageToFile(page_id_t page_id, const char *page_data,
+                                  uint32_t checksum) -> bool {
+  if (!WritePageData(page_id, page_data)) {
+    return false;
+  }
+  RecordChecksum(page_id, checksum);
+  PageWritten(page_id);
+  return true;
+}
+
+auto DiskManager::WritePageData(page_id_t page_id, const char *page_data)
+    -> bool {
+  if (compressed_store_ != nullptr) {
+    return compressed_store_->WritePage(db_fd_, page_id, page_data);
+  }
+  if (direct_io_ && !IsAligned(page_data)) {
+    char *buffer = BounceBuffer();
+    memcpy(buffer, page_data, BUSTUB_PAGE_SIZE);
+    page_data = buffer;
+  }
+  auto offset = static_cast<off_t>(page_id) * BUSTUB_PAGE_SIZE;
+  size_t done = 0;
+  while (done < BUSTUB_PAGE_SIZE) {
+    ssize_t rc = pwrite(db_fd_, page_data + done, BUSTUB_PAGE_SIZE - done,
+                        offset + static_cast<off_t>(done));
+    if (rc < 0 && errno == EINTR) {
+      continue;
+    }
+    if (rc <= 0) {
+      LOG_DEBUG("I/O error while writing");
+      return false;
+    }
+    done += static_cast<size_t>(rc);
+  }
+  return true;
+}
+
+/**
+ * Read a whole page at its offset, the part past the end of the file reads
+ * as zeros
+ */
+auto DiskManager::ReadPageFromFile(page_id_t page_id, char *page_data)
+    -> bool {
+  if (page_id >= num_pages_) {
+    memset(page_data, 0, BUSTUB_PAGE_SIZE);
+    return true;
+  }
+  if (compressed_store_ != nullptr) {
+    return compressed_store_->ReadPage(db_fd_, page_id, page_data) &&
+           VerifyChecksum(page_id, page_data);
+  }
+  char *target = page_data;
+  if (direct_io_ && !IsAligned(page_data)) {
+    target = BounceBuffer();
+  }
+  auto offset = static_cast<off_t>(page_id) * BUSTUB_PAGE_SIZE;
+  size_t done = 0;
+  while (done < BUSTUB_PAGE_SIZE) {
+    ssize_t rc = pread(db_fd_, target + done, BUSTUB_PAGE_SIZE - done,
+                       offset + static_cast<off_t>(done));
+    if (rc < 0 && errno == EINTR) {
+      continue;
+    }
+    if (rc < 0) {
       LOG_DEBUG("I/O error while reading");
+      return false;
+    }
+    if (rc == 0) {
+      memset(target + done, 0, BUSTUB_PAGE_SIZE - done);
+      break;
+    }
+    done += static_cast<size_t>(rc);
+  }
+  if (target != page_data) {
+    memcpy(page_data, target, BUSTUB_PAGE_SIZE);
+  }
+  return VerifyChecksum(page_id, page_data);
+}
+
+/**
+ * Remember the checksum of a page just written, in memory and in the
+ * checksum file
+ */
+void DiskManager::RecordChecksum(page_id_t page_id, uint32_t checksum) {
+  RecordChecksums({{page_id, checksum}});
+}
+
+/**
+ * Remember the checksums of pages just written, in memory and in the
+ * checksum file with one write per run of adjacent pages
+ */
+void DiskManager::RecordChecksums(
+    std::vector<std::pair<page_id_t, uint32_t>> checksums) {
+  if (checksums.empty()) {
+    return;
+  }
+  std::sort(checksums.begin(), checksums.end(),
+            [](const auto &a, const auto &b) { return a.first < b.first; });
+  // the latch keeps the file in the order the checksums were recorded in
+  std::scoped_lock scoped_checksum_latch(checksum_latch_);
+  if (static_cast<size_t>(checksums.back().first) >= checksums_.size()) {
+    checksums_.resize(checksums.back().first + 1, 0);
+  }
+  for (const auto &[page_id, checksum] : checksums) {
+    checksums_[page_id] = checksum;
+  }
+  if (checksum_fd_ < 0) {
+    return;
+  }
+  size_t first = 0;
+  while (first < checksums.size()) {
+    size_t end = first + 1;
+    while (end < checksums.size() &&
+           checksums[end].first <= checksums[end - 1].first + 1) {
+      end++;
+    }
+    page_id_t start = checksums[first].first;
+    auto bytes = static_cast<size_t>(checksums[end - 1].first - start + 1) *
+                 sizeof(uint32_t);
+    auto offset = static_cast<off_t>(start) * sizeof(uint32_t);
+    ssize_t rc;
+    do {
+      rc = pwrite(checksum_fd_, &checksums_[start], bytes, offset);
+    } while (rc < 0 && errno == EINTR);
+    if (rc != static_cast<ssize_t>(bytes)) {
+      LOG_DEBUG("I/O error while writing checksums");
+    }
+    first = end;
+  }
+}
+
+/**
+ * Compare the checksum of a page just read with the one recorded when it
+ * was written
+ */
+auto DiskManager::VerifyChecksum(page_id_t page_id, const char *page_data)
+    -> bool {
+  uint32_t expected = 0;
+  {
+    std::scoped_lock scoped_checksum_latch(checksum_latch_);
+    if (static_cast<size_t>(page_id) < checksums_.size()) {
+      expected = checksums_[page_id];
+    }
+  }
+  // written before checksums were kept, or never
+  if (expected == 0 ||
+      Crc32c::Compute(page_data, BUSTUB_PAGE_SIZE) == expected) {
+    return true;
+  }
+  checksum_failures_++;
+  if (doublewrite_ == nullptr) {
+    // a crash may have torn the write of the checksum rather than the page,
+    // nothing could repair either
+    LOG_WARN("checksum mismatch on page %d", page_id);
+    return true;
+  }
+  LOG_ERROR("checksum mismatch on page %d", page_id);
+  return false;
+}
+
+/**
+ * Write the pages staged in the doublewrite buffer in place again where the
+ * page in the file doesn't match its checksum
+ */
+void DiskManager::RepairTornPages() {
+  auto page = std::make_unique<char[]>(BUSTUB_PAGE_SIZE);
+  doublewrite_->Recover([this, &page](page_id_t page_id, const char *copy) {
+    uint32_t expected = 0;
+    if (static_cast<size_t>(page_id) < checksums_.size()) {
+      expected = checksums_[page_id];
+    }
+    // an unknown checksum means the page was never written in full
+    if (expected != 0 && ReadPageFromFile(page_id, page.get())) {
       return;
     }
-    // if file ends before reading BUSTUB_PAGE_SIZE
-    int read_count = db_io_.gcount();
-    if (read_count < BUSTUB_PAGE_SIZE) {
-      LOG_DEBUG("Read less than a page");
-      db_io_.clear();
-      // std::cerr << "Read less than a page" << std::endl;
-      memset(page_data + read_count, 0, BUSTUB_PAGE_SIZE - read_count);
+    LOG_INFO("repairing page %d from the doublewrite buffer", page_id);
+    WritePageToFile(page_id, copy);
+    repaired_pages_++;
+  });
+  if (repaired_pages_ > 0) {
+    SyncFiles();
+  }
+  doublewrite_->Clear();
+}
+
+/**
+ * Stage batches of pages in the doublewrite buffer, then write them in place
+ * and make them durable before the next batch overwrites the buffer
+ */
+void DiskManager::WriteThroughDoublewrite(std::vector<PageWrite> pages) {
+  std::scoped_lock scoped_doublewrite_latch(doublewrite_latch_);
+  for (size_t first = 0; first < pages.size(); first += DOUBLEWRITE_PAGES) {
+    size_t end = std::min(first + DOUBLEWRITE_PAGES, pages.size());
+    std::vector<PageWrite> batch(pages.begin() + first, pages.begin() + end);
+    if (!doublewrite_->Stage(batch)) {
+      LOG_DEBUG("can't stage pages, writing them without a copy");
     }
+    WritePagesInPlace(std::move(batch));
+    SyncFiles();
   }
 }
 
+void DiskManager::SyncFiles() {
+  if (compressed_store_ != nullptr) {
+    // syncs the database file before the map entries pointing into it
+    compressed_store_->Sync(db_fd_);
+  } else {
+    fdatasync(db_fd_);
+  }
+  if (checksum_fd_ >= 0) {
+    fdatasync(checksum_fd_);
+  }
+}
+
+/**
+ * Write a batch of pages, coalescing adjacent ones into one pwritev
+ */
+void DiskManager::WritePages(std::vector<PageWrite> pages) {
+  if (db_fd_ < 0) {
+    // the pages are kept somewhere else than in a db file
+    for (const auto &[page_id, page_data] : pages) {
+      WritePage(page_id, page_data);
+    }
+    return;
+  }
+  num_writes_ += static_cast<int>(pages.size());
+  if (doublewrite_ != nullptr) {
+    WriteThroughDoublewrite(std::move(pages));
+    return;
+  }
+  WritePagesInPlace(std::move(pages));
+}
+
+void DiskManager::WritePagesInPlace(std::vector<PageWrite> pages) {
+  std::sort(pages.begin(), pages.end(),
+            [](const PageWrite &a, const PageWrite &b) {
+              return a.first < b.first;
+            });
+  std::vector<std::pair<page_id_t, uint32_t>> checksums;
+  checksums.reserve(pages.size());
+  auto written = [&checksums](const PageWrite &page) {
+    checksums.emplace_back(page.first,
+                           Crc32c::Compute(page.second, BUSTUB_PAGE_SIZE));
+  };
+  if (compressed_store_ != nullptr) {
+    // compressed pages don't live at their offsets
+    for (const auto &page : pages) {
+      if (WritePageData(page.first, page.second)) {
+        written(page);
+      }
+    }
+    RecordChecksums(std::move(checksums));
+    if (!pages.empty()) {
+      PageWritten(pages.back().first);
+    }
+    return;
+  }
+  std::vector<iovec> iov;
+  size_t first = 0;
+  while (first < pages.size()) {
+    // a run of adjacent pages, with direct I/O only aligned ones
+    iov.clear();
+    size_t end = first;
+    while (end < pages.size() && iov.size() < static_cast<size_t>(IOV_MAX) &&
+           (end == first || pages[end].first == pages[end - 1].first + 1) &&
+           (!direct_io_ || IsAligned(pages[end].second))) {
+      iov.push_back({const_cast<char *>(pages[end].second), BUSTUB_PAGE_SIZE});
+      end++;
+    }
+    if (iov.empty()) {
+      if (WritePageData(pages[first].first, pages[first].second)) {
+        written(pages[first]);
+      }
+      first++;
+      continue;
+    }
+    auto offset = static_cast<off_t>(pages[first].first) * BUSTUB_PAGE_SIZE;
+    ssize_t rc;
+    do {
+      rc = pwritev(db_fd_, iov.data(), static_cast<int>(iov.size()), offset);
+    } while (rc < 0 && errno == EINTR);
+    size_t done = rc < 0 ? 0 : static_cast<size_t>(rc) / BUSTUB_PAGE_SIZE;
+    for (size_t i = first; i < first + done; ++i) {
+      written(pages[i]);
+    }
+    // a short write leaves the rest of the run to page-sized writes
+    for (size_t i = first + done; i < end; ++i) {
+      if (WritePageData(pages[i].first, pages[i].second)) {
+        written(pages[i]);
+      }
+    }
+    first = end;
+  }
+  RecordChecksums(std::move(checksums));
+  if (!pages.empty()) {
+    PageWritten(pages.back().first);
+  }
+}
+
+void DiskManager::PageWritten(page_id_t page_id) {
+  page_id_t num_pages = num_pages_;
+  while (num_pages <= page_id &&
+         !num_pages_.compare_exchange_weak(num_pages, page_id + 1)) {
+  }
+  if (sync_policy_ == SyncPolicy::EVERY_WRITE && doublewrite_ == nullptr) {
+    SyncFiles();
+  }
+}
+
+/**
+ * Make written pages durable if the sync policy asks for it
+ */
+void DiskManager::SyncPages() {
+  if (sync_policy_ == SyncPolicy::ON_SYNC && db_fd_ >= 0) {
+    SyncFiles();
+  }
+}
+
+/**
+ * Write a page right away, there is no queue to submit from
+ */
+void DiskManager::WritePageAsync(page_id_t page_id, const char *page_data,
+                                 IoCallback callback) {
+  WritePage(page_id, page_data);
+  callback(true);
+}
+
+/**
+ * Read a page right away, there is no queue to submit from
+ */
+void DiskManager::ReadPageAsync(page_id_t page_id, char *page_data,
+                                IoCallback callback) {
+  callback(ReadPage(page_id, page_data));
+}
+
+/**
+ * Write a page of the free-space map into the map file
+ */
+void DiskManager::WriteMapPage(page_id_t map_page_id, const char *page_data) {
+  std::scoped_lock scoped_fsm_io_latch(fsm_io_latch_);
+  if (!fsm_io_.is_open()) {
+    return;
+  }
+  fsm_io_.seekp(static_cast<size_t>(map_page_id) * BUSTUB_PAGE_SIZE);
+  fsm_io_.write(page_data, BUSTUB_PAGE_SIZE);
+  if (fsm_io_.bad()) {
+    LOG_DEBUG("I/O error while writing free space map");
+    return;
+  }
+  fsm_io_.flush();
+}
+
+/**
+ * Read a page of the free-space map, false if the map file doesn't hold it
+ */
+auto DiskManager::ReadMapPage(page_id_t map_page_id, char *page_data) -> bool {
+  std::scoped_lock scoped_fsm_io_latch(fsm_io_latch_);
+  if (!fsm_io_.is_open()) {
+    return false;
+  }
+  auto offset = static_cast<int>(map_page_id * BUSTUB_PAGE_SIZE);
+  if (offset + BUSTUB_PAGE_SIZE > GetFileSize(fsm_name_)) {
+    return false;
+  }
+  fsm_io_.seekg(offset);
+  fsm_io_.read(page_data, BUSTUB_PAGE_SIZE);
+  if (fsm_io_.bad() || fsm_io_.gcount() < BUSTUB_PAGE_SIZE) {
+    LOG_DEBUG("I/O error while reading free space map");
+    fsm_io_.clear();
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Returns how much smaller compression makes the written pages
+ */
+auto DiskManager::GetCompressionRatio() -> double {
+  return compressed_store_ == nullptr
+             ? 1.0
+             : compressed_store_->GetCompressionRatio();
+}
+
+/**
+ * Returns the number of pages the database file spans
+ */
+auto DiskManager::GetNumPages() -> page_id_t { return num_pages_; }
+
 /**
  * Write the contents of the log into disk file
  * Only return when sync is done, and only perform sequence write
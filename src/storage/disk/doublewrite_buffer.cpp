@@ -0,0 +1,114 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// doublewrite_buffer.cpp
+//
+// Identification: src/storage/disk/doublewrite_buffer.cpp
+//
+// Copyright (c) 2015-2023, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/disk/doublewrite_buffer.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "common/exception.h"
+#include "common/logger.h"
+#include "common/util/crc32c.h"
+
+namespace bustub {
+
+/** First 4 bytes of a staged header page, "BPDW". */
+static constexpr uint32_t DOUBLEWRITE_MAGIC = 0x57445042;
+
+DoublewriteBuffer::DoublewriteBuffer(const std::string &file) {
+  fd_ = open(file.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd_ < 0) {
+    throw Exception("can't open doublewrite file");
+  }
+}
+
+DoublewriteBuffer::~DoublewriteBuffer() {
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+}
+
+/**
+ * Write the header and the copies in one go, the header tells a torn copy
+ * by its checksum
+ */
+auto DoublewriteBuffer::Stage(const std::vector<PageCopy> &pages) -> bool {
+  BUSTUB_ASSERT(pages.size() <= DOUBLEWRITE_PAGES,
+                "doublewrite: batch too large");
+  alignas(uint64_t) char header_page[BUSTUB_PAGE_SIZE] = {};
+  auto *header = reinterpret_cast<Header *>(header_page);
+  header->magic_ = DOUBLEWRITE_MAGIC;
+  header->num_pages_ = static_cast<uint32_t>(pages.size());
+  std::vector<iovec> iov;
+  iov.push_back({header_page, BUSTUB_PAGE_SIZE});
+  for (size_t i = 0; i < pages.size(); ++i) {
+    header->entries_[i] = {pages[i].first,
+                           Crc32c::Compute(pages[i].second, BUSTUB_PAGE_SIZE)};
+    iov.push_back({const_cast<char *>(pages[i].second), BUSTUB_PAGE_SIZE});
+  }
+  header->checksum_ =
+      Crc32c::Compute(reinterpret_cast<const char *>(header->entries_),
+                      pages.size() * sizeof(Entry));
+
+  size_t total = iov.size() * BUSTUB_PAGE_SIZE;
+  ssize_t rc;
+  do {
+    rc = pwritev(fd_, iov.data(), static_cast<int>(iov.size()), 0);
+  } while (rc < 0 && errno == EINTR);
+  if (rc != static_cast<ssize_t>(total)) {
+    LOG_DEBUG("I/O error while writing doublewrite buffer");
+    return false;
+  }
+  return fdatasync(fd_) == 0;
+}
+
+auto DoublewriteBuffer::Recover(
+    const std::function<void(page_id_t, const char *)> &repair) -> size_t {
+  alignas(uint64_t) char header_page[BUSTUB_PAGE_SIZE];
+  if (pread(fd_, header_page, BUSTUB_PAGE_SIZE, 0) != BUSTUB_PAGE_SIZE) {
+    return 0;
+  }
+  auto *header = reinterpret_cast<Header *>(header_page);
+  if (header->magic_ != DOUBLEWRITE_MAGIC ||
+      header->num_pages_ > DOUBLEWRITE_PAGES ||
+      header->checksum_ !=
+          Crc32c::Compute(reinterpret_cast<const char *>(header->entries_),
+                          header->num_pages_ * sizeof(Entry))) {
+    return 0;
+  }
+  auto copy = std::make_unique<char[]>(BUSTUB_PAGE_SIZE);
+  size_t intact = 0;
+  for (uint32_t i = 0; i < header->num_pages_; ++i) {
+    auto offset = static_cast<off_t>(i + 1) * BUSTUB_PAGE_SIZE;
+    if (pread(fd_, copy.get(), BUSTUB_PAGE_SIZE, offset) != BUSTUB_PAGE_SIZE ||
+        Crc32c::Compute(copy.get(), BUSTUB_PAGE_SIZE) !=
+            header->entries_[i].checksum_) {
+      continue;
+    }
+    repair(header->entries_[i].page_id_, copy.get());
+    intact++;
+  }
+  return intact;
+}
+
+void DoublewriteBuffer::Clear() {
+  char header_page[BUSTUB_PAGE_SIZE] = {};
+  if (pwrite(fd_, header_page, BUSTUB_PAGE_SIZE, 0) == BUSTUB_PAGE_SIZE) {
+    fdatasync(fd_);
+  }
+}
+
+} // namespace bustub
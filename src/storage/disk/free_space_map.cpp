@@ -0,0 +1,151 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// free_space_map.cpp
+//
+// Identification: src/storage/disk/free_space_map.cpp
+//
+// Copyright (c) 2015-2023, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/disk/free_space_map.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace bustub {
+
+FreeSpaceMap::FreeSpaceMap(DiskManager *disk_manager, size_t num_shards)
+    : disk_manager_(disk_manager), num_shards_(num_shards) {
+  BUSTUB_ASSERT(num_shards > 0, "free space map: no shards");
+  for (size_t shard = 0; shard < num_shards; ++shard) {
+    shard_hint_.push_back(static_cast<page_id_t>(shard));
+  }
+  MapPage map_page;
+  page_id_t num_disk_pages = disk_manager_->GetNumPages();
+  std::vector<page_id_t> lost_ranges;
+  for (page_id_t map_page_id = 0;
+       disk_manager_->ReadMapPage(map_page_id, reinterpret_cast<char *>(&map_page)); ++map_page_id) {
+    size_t first_word = map_page_id * WORDS_PER_MAP_PAGE;
+    words_.resize(first_word + WORDS_PER_MAP_PAGE, 0);
+    dirty_.resize(map_page_id + 1, false);
+    if (map_page.magic_ != MAP_PAGE_MAGIC) {
+      // a torn or foreign map page, whatever the file holds in its range is assumed in use
+      lost_ranges.push_back(map_page_id);
+      continue;
+    }
+    std::copy(map_page.words_, map_page.words_ + WORDS_PER_MAP_PAGE, words_.begin() + first_word);
+    end_ = std::max(end_, map_page.end_);
+  }
+  for (page_id_t map_page_id : lost_ranges) {
+    auto first = static_cast<page_id_t>(map_page_id * BITS_PER_MAP_PAGE);
+    auto last = std::min(num_disk_pages, static_cast<page_id_t>(first + BITS_PER_MAP_PAGE));
+    for (page_id_t page_id = first; page_id < last; ++page_id) {
+      SetBit(page_id, true);
+    }
+  }
+  // pages allocated after the map was last flushed have been written to the file, if at all
+  for (page_id_t page_id = end_; page_id < num_disk_pages; ++page_id) {
+    SetBit(page_id, true);
+  }
+}
+
+auto FreeSpaceMap::TestBit(page_id_t page_id) const -> bool {
+  auto word = static_cast<size_t>(page_id) / 64;
+  return word < words_.size() && (words_[word] >> (page_id % 64) & 1) != 0;
+}
+
+void FreeSpaceMap::SetBit(page_id_t page_id, bool allocated) {
+  auto word = static_cast<size_t>(page_id) / 64;
+  if (word >= words_.size()) {
+    if (!allocated) {
+      return;
+    }
+    words_.resize(std::max(word + 1, 2 * words_.size()), 0);
+  }
+  uint64_t mask = static_cast<uint64_t>(1) << (page_id % 64);
+  words_[word] = allocated ? words_[word] | mask : words_[word] & ~mask;
+  size_t map_page_id = word / WORDS_PER_MAP_PAGE;
+  if (map_page_id >= dirty_.size()) {
+    dirty_.resize(map_page_id + 1, false);
+  }
+  dirty_[map_page_id] = true;
+  if (allocated) {
+    end_ = std::max(end_, page_id + 1);
+  }
+}
+
+auto FreeSpaceMap::AllocatePage(size_t shard) -> page_id_t {
+  std::scoped_lock lock(latch_);
+  BUSTUB_ASSERT(shard < num_shards_, "free space map: invalid shard");
+  page_id_t page_id = shard_hint_[shard];
+  while (TestBit(page_id)) {
+    page_id += static_cast<page_id_t>(num_shards_);
+  }
+  SetBit(page_id, true);
+  shard_hint_[shard] = page_id + static_cast<page_id_t>(num_shards_);
+  return page_id;
+}
+
+auto FreeSpaceMap::AllocateExtent(size_t num_pages) -> page_id_t {
+  std::scoped_lock lock(latch_);
+  BUSTUB_ASSERT(num_pages > 0, "free space map: empty extent");
+  while (TestBit(extent_hint_)) {
+    extent_hint_++;
+  }
+  page_id_t first = extent_hint_;
+  size_t length = 0;
+  while (length < num_pages) {
+    if (TestBit(first + static_cast<page_id_t>(length))) {
+      first += static_cast<page_id_t>(length) + 1;
+      length = 0;
+    } else {
+      length++;
+    }
+  }
+  for (size_t i = 0; i < num_pages; ++i) {
+    SetBit(first + static_cast<page_id_t>(i), true);
+  }
+  if (first == extent_hint_) {
+    extent_hint_ += static_cast<page_id_t>(num_pages);
+  }
+  return first;
+}
+
+void FreeSpaceMap::DeallocatePage(page_id_t page_id) {
+  std::scoped_lock lock(latch_);
+  if (page_id < 0 || !TestBit(page_id)) {
+    return;
+  }
+  SetBit(page_id, false);
+  auto &shard_hint = shard_hint_[static_cast<size_t>(page_id) % num_shards_];
+  shard_hint = std::min(shard_hint, page_id);
+  extent_hint_ = std::min(extent_hint_, page_id);
+}
+
+auto FreeSpaceMap::IsAllocated(page_id_t page_id) -> bool {
+  std::scoped_lock lock(latch_);
+  return page_id >= 0 && TestBit(page_id);
+}
+
+void FreeSpaceMap::Flush() {
+  std::scoped_lock lock(latch_);
+  MapPage map_page;
+  for (size_t map_page_id = 0; map_page_id < dirty_.size(); ++map_page_id) {
+    if (!dirty_[map_page_id]) {
+      continue;
+    }
+    size_t first_word = map_page_id * WORDS_PER_MAP_PAGE;
+    memset(&map_page, 0, sizeof(map_page));
+    map_page.magic_ = MAP_PAGE_MAGIC;
+    map_page.end_ = end_;
+    size_t num_words = std::min(WORDS_PER_MAP_PAGE, words_.size() - std::min(words_.size(), first_word));
+    std::copy(words_.begin() + first_word, words_.begin() + first_word + num_words, map_page.words_);
+    disk_manager_->WriteMapPage(static_cast<page_id_t>(map_page_id), reinterpret_cast<const char *>(&map_page));
+    dirty_[map_page_id] = false;
+  }
+}
+
+} // namespace bustub
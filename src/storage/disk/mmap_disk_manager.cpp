@@ -0,0 +1,135 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// mmap_disk_manager.cpp
+//
+// Identification: src/storage/disk/mmap_disk_manager.cpp
+//
+// Copyright (c) 2015-2023, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/disk/mmap_disk_manager.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "common/exception.h"
+#include "common/logger.h"
+
+namespace bustub {
+
+MmapDiskManager::MmapDiskManager(const std::string &db_file, bool zero_copy)
+    : zero_copy_(zero_copy) {
+  file_name_ = db_file;
+  std::string::size_type n = file_name_.rfind('.');
+  if (n != std::string::npos) {
+    if (CompressedPageStore::Exists(file_name_.substr(0, n) + ".pmap")) {
+      throw Exception("can't map a compressed db file");
+    }
+    fsm_name_ = file_name_.substr(0, n) + ".fsm";
+    // a missing map file only means the map is rebuilt from the file size
+    fsm_io_.open(fsm_name_, std::ios::binary | std::ios::in);
+  }
+
+  db_fd_ = open(db_file.c_str(), O_RDONLY);
+  if (db_fd_ < 0) {
+    throw Exception("can't open db file");
+  }
+  struct stat stat_buf;
+  if (fstat(db_fd_, &stat_buf) != 0) {
+    throw Exception("can't stat db file");
+  }
+  num_pages_ = static_cast<page_id_t>(
+      (stat_buf.st_size + BUSTUB_PAGE_SIZE - 1) / BUSTUB_PAGE_SIZE);
+  // a partial page at the end is left to pread, touching a mapped page past
+  // the end of the file would fault
+  mapped_pages_ =
+      static_cast<page_id_t>(stat_buf.st_size / BUSTUB_PAGE_SIZE);
+  if (mapped_pages_ == 0) {
+    return;
+  }
+  void *mapping =
+      mmap(nullptr, static_cast<size_t>(mapped_pages_) * BUSTUB_PAGE_SIZE,
+           PROT_READ, MAP_SHARED, db_fd_, 0);
+  if (mapping == MAP_FAILED) {
+    LOG_DEBUG("mmap failed, reading with pread");
+    mapped_pages_ = 0;
+    return;
+  }
+  mapping_ = static_cast<char *>(mapping);
+}
+
+MmapDiskManager::~MmapDiskManager() {
+  if (mapping_ != nullptr) {
+    munmap(mapping_, static_cast<size_t>(mapped_pages_) * BUSTUB_PAGE_SIZE);
+  }
+}
+
+/**
+ * Data pages of a read-only file are never written. The buffer pool doesn't
+ * dirty pages of a read-only disk manager, but it may still flush clean ones,
+ * possibly while evicting, where throwing would strand the frame.
+ */
+void MmapDiskManager::WritePage(page_id_t page_id,
+                                [[maybe_unused]] const char *page_data) {
+  LOG_WARN("dropping write of page %d to a read-only db file", page_id);
+}
+
+/**
+ * Copy a page out of the mapping
+ */
+auto MmapDiskManager::ReadPage(page_id_t page_id, char *page_data) -> bool {
+  if (page_id >= 0 && page_id < mapped_pages_) {
+    memcpy(page_data,
+           mapping_ + static_cast<size_t>(page_id) * BUSTUB_PAGE_SIZE,
+           BUSTUB_PAGE_SIZE);
+    return true;
+  }
+  return ReadPageFromFile(page_id, page_data);
+}
+
+void MmapDiskManager::WritePages(std::vector<PageWrite> pages) {
+  for (const auto &[page_id, page_data] : pages) {
+    WritePage(page_id, page_data);
+  }
+}
+
+void MmapDiskManager::WriteMapPage(
+    [[maybe_unused]] page_id_t map_page_id,
+    [[maybe_unused]] const char *page_data) {}
+
+auto MmapDiskManager::GetMappedPage(page_id_t page_id) -> const char * {
+  if (!zero_copy_ || page_id < 0 || page_id >= mapped_pages_) {
+    return nullptr;
+  }
+  return mapping_ + static_cast<size_t>(page_id) * BUSTUB_PAGE_SIZE;
+}
+
+/**
+ * Ask the kernel to read the range ahead and to expect it in order
+ */
+void MmapDiskManager::AdviseSequentialRead(page_id_t first_page_id,
+                                           size_t count) {
+  if (first_page_id < 0 || first_page_id >= mapped_pages_) {
+    return;
+  }
+  auto end = std::min(static_cast<size_t>(mapped_pages_),
+                      static_cast<size_t>(first_page_id) + count);
+  // madvise wants the start aligned to the OS page size, which may be larger
+  // than a database page
+  auto os_page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  size_t begin = static_cast<size_t>(first_page_id) * BUSTUB_PAGE_SIZE;
+  begin -= begin % os_page_size;
+  size_t length = end * BUSTUB_PAGE_SIZE - begin;
+  madvise(mapping_ + begin, length, MADV_SEQUENTIAL);
+  madvise(mapping_ + begin, length, MADV_WILLNEED);
+}
+
+} // namespace bustub
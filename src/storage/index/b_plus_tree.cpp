@@ -1,5 +1,8 @@
+#include <cmath>
+#include <cstring>
 #include <sstream>
 #include <string>
+#include <type_traits>
 
 #include "common/config.h"
 #include "common/exception.h"
@@ -14,13 +17,23 @@ namespace bustub {
 
 INDEX_TEMPLATE_ARGUMENTS
 BPLUSTREE_TYPE::BPlusTree(std::string name, page_id_t header_page_id, BufferPoolManager *buffer_pool_manager,
-                          const KeyComparator &comparator, int leaf_max_size, int internal_max_size)
+                          const KeyComparator &comparator, int leaf_max_size, int internal_max_size,
+                          IndexPageFormat page_format)
     : index_name_(std::move(name)),
       bpm_(buffer_pool_manager),
       comparator_(std::move(comparator)),
       leaf_max_size_(leaf_max_size),
       internal_max_size_(internal_max_size),
+      page_format_(page_format),
       header_page_id_(header_page_id) {
+  // truncated keys still compare right with memcmp, but not as Values
+  if (page_format_ == IndexPageFormat::COMPRESSED && !comparator_.IsNormalized()) {
+    throw Exception(ExceptionType::INVALID, "compressed B+ tree pages need normalized keys");
+  }
+  if (BTREE_SWIP_ROWS > 0) {
+    swip_rows_ = std::min(static_cast<size_t>(BTREE_SWIP_ROWS), bpm_->GetPoolSize());
+    swips_ = std::make_unique<std::atomic<Page *>[]>(swip_rows_ * (internal_max_size_ + 1));
+  }
   WritePageGuard guard = bpm_->FetchPageWrite(header_page_id_);
   auto root_page = guard.AsMut<BPlusTreeHeaderPage>();
   root_page->root_page_id_ = INVALID_PAGE_ID;
@@ -36,6 +49,15 @@ auto BPLUSTREE_TYPE::IsEmpty() const -> bool {
   const auto root_page = guard.As<BPlusTreeHeaderPage>();
   return root_page->root_page_id_ == INVALID_PAGE_ID;
 }
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::ChildSwip(page_id_t page_id, int index) -> std::atomic<Page *> * {
+  if (swip_rows_ == 0 || index < 0 || index > internal_max_size_) {
+    return nullptr;
+  }
+  size_t row = static_cast<size_t>(page_id) % swip_rows_;
+  return &swips_[row * (internal_max_size_ + 1) + index];
+}
+
 /*****************************************************************************
  * SEARCH
  *****************************************************************************/
@@ -56,28 +78,14 @@ auto BPLUSTREE_TYPE::GetValue(const KeyType &key, std::vector<ValueType> *result
     if (header_page_id_ == INVALID_PAGE_ID) {
       return false;
     }
-    ReadPageGuard header_guard = bpm_->FetchPageRead(header_page_id_);
-    const auto *header_page = header_guard.As<BPlusTreeHeaderPage>();
-    page_id_t root_page_id = header_page->root_page_id_;
-    if (root_page_id == INVALID_PAGE_ID) {
+    // the header and the inner nodes are read without latches, only the leaf is read-latched; whenever a writer got
+    // in the way the descent starts over
+    ReadPageGuard leaf_guard;
+    if (!FindLeafOptimistic(key, &leaf_guard)) {
       return false;
     }
-    ReadPageGuard pg_guard = bpm_->FetchPageRead(root_page_id);
-    header_guard.Drop();
-    const auto *b_page = pg_guard.As<class BPlusTreePage>();
-    // loop and found value
-    while (!b_page->IsLeafPage()) {
-      const auto *bi_page = reinterpret_cast<const InternalPage *>(b_page);
-      int i = bi_page->GetIndexLargerThanKey(1, key, comparator_);
-      auto n_pid = static_cast<page_id_t>(bi_page->ValueAt(i - 1));
-      if (n_pid == INVALID_PAGE_ID) {
-        return false;
-      }
-      pg_guard = bpm_->FetchPageRead(n_pid);
-      b_page = pg_guard.As<class BPlusTreePage>();
-    }
     // get leaf node
-    const auto *bl_page = reinterpret_cast<const LeafPage *>(b_page);
+    const auto *bl_page = leaf_guard.As<LeafPage>();
     int i = 0;
     if (bl_page->GetIndexEqualToKey(i, key, comparator_)) {
       result->emplace_back(bl_page->ValueAt(i));
@@ -90,6 +98,55 @@ auto BPLUSTREE_TYPE::GetValue(const KeyType &key, std::vector<ValueType> *result
   return false;
 }
 
+INDEX_TEMPLATE_ARGUMENTS
+template <class LeafGuard>
+auto BPLUSTREE_TYPE::FindLeafOptimistic(const KeyType &key, LeafGuard *leaf_guard) -> bool {
+  while (true) {
+    OptimisticReadGuard header_guard = bpm_->FetchPageOptimistic(header_page_id_);
+    page_id_t root_page_id = header_guard.As<BPlusTreeHeaderPage>()->root_page_id_;
+    if (!header_guard.Validate()) {
+      continue;
+    }
+    if (root_page_id == INVALID_PAGE_ID) {
+      return false;
+    }
+    OptimisticReadGuard pg_guard = bpm_->FetchPageOptimistic(root_page_id, &root_swip_);
+    // the page is still the root only if the header didn't change meanwhile
+    if (!header_guard.Validate()) {
+      continue;
+    }
+    header_guard.Drop();
+    bool restart = false;
+    while (!restart) {
+      const auto *b_page = pg_guard.As<BPlusTreePage>();
+      if (b_page->IsLeafPage()) {
+        // the leaf is used under its latch, the upgrade also confirms that the page was a leaf all along
+        bool upgraded = false;
+        if constexpr (std::is_same_v<LeafGuard, WritePageGuard>) {
+          upgraded = pg_guard.UpgradeWrite(leaf_guard);
+        } else {
+          upgraded = pg_guard.UpgradeRead(leaf_guard);
+        }
+        if (upgraded) {
+          return true;
+        }
+        break;
+      }
+      const auto *bi_page = reinterpret_cast<const InternalPage *>(b_page);
+      int i = bi_page->GetIndexLargerThanKey(1, key, comparator_);
+      auto n_pid = static_cast<page_id_t>(bi_page->ValueAt(i - 1));
+      // never follow a child pointer that may be torn
+      if (!pg_guard.Validate()) {
+        break;
+      }
+      OptimisticReadGuard child_guard = bpm_->FetchPageOptimistic(n_pid, ChildSwip(pg_guard.PageId(), i - 1));
+      // the child covers the key only if the parent didn't change before the child's version was taken
+      restart = !pg_guard.Validate();
+      pg_guard = std::move(child_guard);
+    }
+  }
+}
+
 /*****************************************************************************
  * INSERTION
  *****************************************************************************/
@@ -108,10 +165,39 @@ auto BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value, Transact
   ss << thread_id << " insert:" << key << ", " << value  << "max internal size" << internal_max_size_ << "leaf max size"
      << leaf_max_size_<< std::endl;
   LOG_DEBUG("%s", ss.str().c_str());
+  if (header_page_id_ == INVALID_PAGE_ID) {
+    return false;
+  }
+  // most inserts land in a leaf with room to spare and don't need to hold anything but the leaf
+  if (auto inserted = InsertOptimistic(key, value, txn); inserted.has_value()) {
+    return *inserted;
+  }
+  return InsertPessimistic(key, value, txn);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::InsertOptimistic(const KeyType &key, const ValueType &value, Transaction *txn)
+    -> std::optional<bool> {
+  WritePageGuard leaf_guard;
+  if (!FindLeafOptimistic(key, &leaf_guard)) {
+    return std::nullopt;
+  }
+  const auto *bl_page = leaf_guard.As<LeafPage>();
+  int i = bl_page->GetIndexLargerThanKey(0, key, comparator_);
+  if (i > 0 && comparator_(bl_page->KeyAt(i - 1), key) == 0) {
+    return false;
+  }
+  // a full leaf splits, which changes its parent
+  if (!bl_page->HasRoomFor(key)) {
+    return std::nullopt;
+  }
+  leaf_guard.AsMut<LeafPage>()->InsertKeyAndValueAt(i, key, value);
+  return true;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::InsertPessimistic(const KeyType &key, const ValueType &value, Transaction *txn) -> bool {
   try {
-    if (header_page_id_ == INVALID_PAGE_ID) {
-      return false;
-    }
     WritePageGuard header_guard = bpm_->FetchPageWrite(header_page_id_);
     auto *header_page = header_guard.AsMut<BPlusTreeHeaderPage>();
     page_id_t root_page_id = header_page->root_page_id_;
@@ -127,7 +213,7 @@ auto BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value, Transact
       header_page->root_page_id_ = pid;
       // get addr and init the page
       auto *bl_page = guard.AsMut<LeafPage>();
-      bl_page->Init(leaf_max_size_);
+      bl_page->Init(leaf_max_size_, page_format_);
       // size++, set next page id(no need), change array_
       bl_page->InsertKeyAndValueAt(0, key, value);
       BUSTUB_ASSERT(bl_page->GetSize() == 1, "make new root page error");
@@ -138,7 +224,7 @@ auto BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value, Transact
     Context ctx;
     ctx.header_page_ = std::move(header_guard);
     ctx.root_page_id_ = root_page_id;
-    WritePageGuard guard = bpm_->FetchPageWrite(root_page_id);
+    WritePageGuard guard = bpm_->FetchPageWrite(root_page_id, &root_swip_);
     auto *b_page = guard.AsMut<class BPlusTreePage>();
     ctx.write_set_.push_back(std::move(guard));
 
@@ -151,9 +237,9 @@ auto BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value, Transact
         return false;
       }
       // record sth
-      guard = bpm_->FetchPageWrite(n_pid);
+      guard = bpm_->FetchPageWrite(n_pid, ChildSwip(ctx.write_set_.back().PageId(), i - 1));
       b_page = guard.AsMut<class BPlusTreePage>();
-      // can safely insert
+      // can safely insert, a compressed page below its max size has room for any key
       if (b_page->GetSize() < b_page->GetMaxSize()) {
         ctx.write_set_.clear();
         ctx.header_page_ = std::nullopt;
@@ -187,7 +273,7 @@ auto BPLUSTREE_TYPE::InsertLeafPage(Context &ctx, MappingType &mapping, bool &ne
       return false;
     }
     // can insert directly
-    if (b_page->GetSize() < b_page->GetMaxSize()) {
+    if (b_page->HasRoomFor(mapping.first)) {
       b_page->InsertKeyAndValueAt(i, mapping.first, mapping.second);  // {key, rid}
       return true;
     }
@@ -196,58 +282,22 @@ auto BPLUSTREE_TYPE::InsertLeafPage(Context &ctx, MappingType &mapping, bool &ne
     BasicPageGuard new_page_guard = bpm_->NewPageGuarded(&new_page_id);
     BUSTUB_ASSERT(new_page_id != -1, "new page error in insert leaf page");
     auto *new_page = new_page_guard.AsMut<LeafPage>();
-    new_page->Init(leaf_max_size_);
-
-    if (b_page->GetMaxSize() % 2) {
-      int mid_idx = b_page->GetMaxSize() / 2 + 1;
-      KeyType mid_key = b_page->KeyAt(mid_idx);
-      if (i <= mid_idx) {
-        KeyType record_key = b_page->KeyAt(b_page->GetMaxSize() - 1);
-        ValueType record_value = b_page->ValueAt(b_page->GetMaxSize() - 1);
-        // b_page equal max_size
-
-        b_page->InsertKeyAndValueAt(i, mapping.first, mapping.second);
-        mid_key = b_page->KeyAt(mid_idx);
-        int mv_len = b_page->GetMaxSize() - mid_idx;
-        new_page->MemMove(b_page, mid_idx, 0, mv_len);
-        new_page->IncreaseSize(mv_len);
+    new_page->Init(leaf_max_size_, page_format_);
 
-        new_page->InsertKeyAndValueAt(b_page->GetMaxSize() - mid_idx, record_key, record_value);
-      } else {
-        int mv_len = b_page->GetMaxSize() - mid_idx;
-        new_page->MemMove(b_page, mid_idx, 0, mv_len);
-        new_page->IncreaseSize(mv_len);
-
-        new_page->InsertKeyAndValueAt(i - mid_idx, mapping.first, mapping.second);
-      }
-      b_page->IncreaseSize(mid_idx - b_page->GetMaxSize());
-      BUSTUB_ASSERT(new_page->GetSize() == b_page->GetSize(), "new page size should equal ori page size");
-      ctx.last_page_id_ = guard.PageId();
-      new_page->SetNextPageId(b_page->GetNextPageId());
-      b_page->SetNextPageId(new_page_guard.PageId());
-      ctx.last_insert_page_ = std::move(guard);
-      return InsertInternalPage(ctx, mid_key, new_page_guard.PageId(), need_split_root, txn);
+    // the lower half of the pairs with the new one stays, the upper half moves to the new page
+    std::vector<MappingType> pairs;
+    pairs.reserve(b_page->GetSize() + 1);
+    for (int j = 0; j < b_page->GetSize(); ++j) {
+      pairs.emplace_back(b_page->KeyAt(j), b_page->ValueAt(j));
     }
-    // b_page->GetMaxSize() % 2 == 0
-    int mid_idx = b_page->GetMaxSize() / 2;
-    KeyType mid_key = b_page->KeyAt(mid_idx);
-    if (i <= mid_idx) {
-      KeyType record_key = b_page->KeyAt(b_page->GetMaxSize() - 1);
-      ValueType record_value = b_page->ValueAt(b_page->GetMaxSize() - 1);
-      b_page->InsertKeyAndValueAt(i, mapping.first, mapping.second);
-      mid_key = b_page->KeyAt(mid_idx);
-      int mv_len = b_page->GetMaxSize() - mid_idx;
-      new_page->MemMove(b_page, mid_idx, 0, mv_len);
-      new_page->IncreaseSize(mv_len);
-      new_page->InsertKeyAndValueAt(b_page->GetMaxSize() - mid_idx, record_key, record_value);
-    } else {
-      int mv_len = b_page->GetMaxSize() - mid_idx;
-      new_page->MemMove(b_page, mid_idx, 0, mv_len);
-      new_page->IncreaseSize(mv_len);
-      new_page->InsertKeyAndValueAt(i - mid_idx, mapping.first, mapping.second);
+    pairs.insert(pairs.begin() + i, mapping);
+    int mid_idx = static_cast<int>(pairs.size()) / 2;
+    b_page->SetKeysAndValues(pairs.data(), mid_idx);
+    new_page->SetKeysAndValues(pairs.data() + mid_idx, static_cast<int>(pairs.size()) - mid_idx);
+    KeyType mid_key = pairs[mid_idx].first;
+    if (page_format_ == IndexPageFormat::COMPRESSED) {
+      mid_key = SeparatorKey(pairs[mid_idx - 1].first, pairs[mid_idx].first);
     }
-    b_page->IncreaseSize(mid_idx - b_page->GetMaxSize());
-    BUSTUB_ASSERT(new_page->GetSize() == b_page->GetSize() + 1, "new page size minus 1 should equal ori page size");
     ctx.last_page_id_ = guard.PageId();
     new_page->SetNextPageId(b_page->GetNextPageId());
     b_page->SetNextPageId(new_page_guard.PageId());
@@ -274,7 +324,7 @@ auto BPLUSTREE_TYPE::InsertInternalPage(Context &ctx, const KeyType &key, page_i
         BasicPageGuard root_guard = bpm_->NewPageGuarded(&new_root_page_id);
         BUSTUB_ASSERT(new_root_page_id != -1, "new page error in insert leaf page");
         auto *root_page = root_guard.AsMut<InternalPage>();
-        root_page->Init(internal_max_size_);
+        root_page->Init(internal_max_size_, page_format_);
         BUSTUB_ASSERT(root_page->GetSize() == 1, "init root size must equal 2");
         root_page->SetValueAt(0, ctx.last_page_id_);
         root_page->InsertKeyAndValueAt(1, key, value);
@@ -296,7 +346,7 @@ auto BPLUSTREE_TYPE::InsertInternalPage(Context &ctx, const KeyType &key, page_i
       return false;
     }
     // can insert directly
-    if (b_page->GetSize() < b_page->GetMaxSize()) {
+    if (b_page->HasRoomFor(key)) {
       b_page->InsertKeyAndValueAt(i, key, value);  // {key, rid}
       need_split_root = false;
       return true;
@@ -306,67 +356,21 @@ auto BPLUSTREE_TYPE::InsertInternalPage(Context &ctx, const KeyType &key, page_i
     BasicPageGuard new_internal_page_guard = bpm_->NewPageGuarded(&new_page_id);
     BUSTUB_ASSERT(new_page_id != -1, "new page error in insert leaf page");
     auto *new_page = new_internal_page_guard.AsMut<InternalPage>();
-    new_page->Init(internal_max_size_);
-
-    // tricky: i and mid_idx who is larger
-    if (b_page->GetMaxSize() % 2) {
-      int mid_idx = b_page->GetMaxSize() / 2 + 1;
-      KeyType mid_key = b_page->KeyAt(mid_idx);
-      page_id_t mid_value = b_page->ValueAt(mid_idx);
-      if (i <= mid_idx) {
-        KeyType record_key = b_page->KeyAt(b_page->GetMaxSize() - 1);
-        page_id_t record_value = b_page->ValueAt(b_page->GetMaxSize() - 1);
-        b_page->InsertKeyAndValueAt(i, key, value);
-        mid_key = b_page->KeyAt(mid_idx);
-        mid_value = b_page->ValueAt(mid_idx);
-        int mv_len = b_page->GetMaxSize() - mid_idx - 1;
-        new_page->MemMove(b_page, mid_idx + 1, 1, mv_len);
-        new_page->IncreaseSize(mv_len);
+    new_page->Init(internal_max_size_, page_format_);
 
-        new_page->InsertKeyAndValueAt(b_page->GetMaxSize() - mid_idx, record_key, record_value);
-      } else {
-        int mv_len = b_page->GetMaxSize() - mid_idx - 1;
-        new_page->MemMove(b_page, mid_idx + 1, 1, mv_len);
-        new_page->IncreaseSize(mv_len);
-
-        new_page->InsertKeyAndValueAt(i - mid_idx, key, value);
-      }
-      b_page->IncreaseSize(mid_idx - b_page->GetMaxSize());
-      new_page->SetValueAt(0, mid_value);
-      BUSTUB_ASSERT(new_page->GetSize() == b_page->GetSize(), "new page size should equal ori page size");
-      ctx.last_page_id_ = guard.PageId();
-      ctx.last_insert_page_ = std::move(guard);
-      return InsertInternalPage(ctx, mid_key, new_internal_page_guard.PageId(), need_split_root, txn);
+    // the upper half of the children moves to the new page, the key of its first child moves up
+    std::vector<std::pair<KeyType, page_id_t>> pairs;
+    pairs.reserve(b_page->GetSize() + 1);
+    for (int j = 0; j < b_page->GetSize(); ++j) {
+      pairs.emplace_back(b_page->KeyAt(j), b_page->ValueAt(j));
     }
-    // b_page->GetMaxSize() % 2 == 0
-    BUSTUB_ASSERT(b_page->GetMaxSize() % 2 == 0, "maxsize % 2 should euqal 0");
-    int mid_idx = b_page->GetMaxSize() / 2;
-    KeyType mid_key = b_page->KeyAt(mid_idx);
-    page_id_t mid_value = b_page->ValueAt(mid_idx);
-    if (i <= mid_idx) {
-      KeyType record_key = b_page->KeyAt(b_page->GetMaxSize() - 1);
-      page_id_t record_value = b_page->ValueAt(b_page->GetMaxSize() - 1);
-      b_page->InsertKeyAndValueAt(i, key, value);
-      mid_key = b_page->KeyAt(mid_idx);
-      mid_value = b_page->ValueAt(mid_idx);
-      int mv_len = b_page->GetMaxSize() - mid_idx - 1;
-      new_page->MemMove(b_page, mid_idx + 1, 1, mv_len);
-      new_page->IncreaseSize(mv_len);
-
-      new_page->InsertKeyAndValueAt(b_page->GetMaxSize() - mid_idx, record_key, record_value);
-    } else {
-      int mv_len = b_page->GetMaxSize() - mid_idx - 1;
-      new_page->MemMove(b_page, mid_idx + 1, 1, mv_len);
-      new_page->IncreaseSize(mv_len);
-
-      new_page->InsertKeyAndValueAt(i - mid_idx, key, value);
-    }
-    b_page->IncreaseSize(mid_idx - b_page->GetMaxSize());
-    new_page->SetValueAt(0, mid_value);
-    BUSTUB_ASSERT(new_page->GetSize() == b_page->GetSize() + 1, "new page size plus 1 should equal ori page size");
+    pairs.insert(pairs.begin() + i, std::make_pair(key, value));
+    int mid_idx = static_cast<int>(pairs.size()) / 2;
+    b_page->SetKeysAndValues(pairs.data(), mid_idx);
+    new_page->SetKeysAndValues(pairs.data() + mid_idx, static_cast<int>(pairs.size()) - mid_idx);
     ctx.last_page_id_ = guard.PageId();
     ctx.last_insert_page_ = std::move(guard);
-    return InsertInternalPage(ctx, mid_key, new_internal_page_guard.PageId(), need_split_root, txn);
+    return InsertInternalPage(ctx, pairs[mid_idx].first, new_internal_page_guard.PageId(), need_split_root, txn);
   } catch (std::exception &e) {
     std::cout << e.what() << "in insert internal page" << std::endl;
     throw e;
@@ -374,6 +378,170 @@ auto BPLUSTREE_TYPE::InsertInternalPage(Context &ctx, const KeyType &key, page_i
   return false;
 }
 
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::SeparatorKey(const KeyType &left, const KeyType &right) -> KeyType {
+  // right, cut after the first byte in which it differs from left
+  KeyType separator = right;
+  const auto *left_bytes = reinterpret_cast<const char *>(&left);
+  auto *bytes = reinterpret_cast<char *>(&separator);
+  size_t size = 0;
+  while (size < sizeof(KeyType) && bytes[size] == left_bytes[size]) {
+    ++size;
+  }
+  if (size + 1 < sizeof(KeyType)) {
+    memset(bytes + size + 1, 0, sizeof(KeyType) - size - 1);
+  }
+  return separator;
+}
+
+/*****************************************************************************
+ * BULK LOAD
+ *****************************************************************************/
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::BulkLoadNodes(size_t num_entries, int max_size, double fill_factor) -> size_t {
+  auto per_node = std::clamp<size_t>(std::lround(max_size * fill_factor), 1, max_size);
+  auto max_node = static_cast<size_t>(max_size);
+  return std::max({static_cast<size_t>(1), num_entries / per_node, (num_entries + max_node - 1) / max_node});
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+template <class PageType, class PairType>
+auto BPLUSTREE_TYPE::BulkLoadSizes(const std::vector<PairType> &entries, const PageType *scratch,
+                                   double fill_factor) const -> std::vector<int> {
+  std::vector<int> sizes;
+  if (!scratch->IsCompressed()) {
+    // spread the entries evenly so that the last node isn't left almost empty
+    size_t num_nodes = BulkLoadNodes(entries.size(), scratch->GetMaxSize(), fill_factor);
+    for (size_t i = 0; i < num_nodes; ++i) {
+      sizes.push_back(static_cast<int>(entries.size() / num_nodes + (i < entries.size() % num_nodes ? 1 : 0)));
+    }
+    return sizes;
+  }
+  // the more entries a node takes, the fewer fit, so the most that fit are found by bisection
+  auto most_that_fit = [&entries, scratch, fill_factor](size_t next) {
+    const PairType *node = entries.data() + next;
+    int high = static_cast<int>(std::min(entries.size() - next, static_cast<size_t>(2 * scratch->GetMaxSize() - 1)));
+    int low = std::min(2, high);
+    while (low < high) {
+      int size = (low + high + 1) / 2;
+      if (size <= scratch->CapacityFor(node, size) * fill_factor) {
+        low = size;
+      } else {
+        high = size - 1;
+      }
+    }
+    return low;
+  };
+  // count the nodes filling them up takes, then spread the entries evenly over that many
+  size_t num_nodes = 0;
+  for (size_t next = 0; next < entries.size(); num_nodes++) {
+    next += most_that_fit(next);
+  }
+  for (size_t next = 0; next < entries.size();) {
+    // a node whose keys take more room than the ones before gets fewer entries, the nodes after it make up for that
+    size_t nodes_left = std::max<size_t>(num_nodes - std::min(num_nodes, sizes.size()), 1);
+    auto even = static_cast<int>((entries.size() - next + nodes_left - 1) / nodes_left);
+    int size = std::min(even, most_that_fit(next));
+    sizes.push_back(size);
+    next += size;
+  }
+  return sizes;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::BulkLoad(const std::vector<MappingType> &pairs, double fill_factor) -> bool {
+  if (header_page_id_ == INVALID_PAGE_ID) {
+    return false;
+  }
+  for (size_t i = 1; i < pairs.size(); ++i) {
+    if (comparator_(pairs[i - 1].first, pairs[i].first) >= 0) {
+      return false;
+    }
+  }
+  fill_factor = std::clamp(fill_factor, 0.5, 1.0);
+  // writers wait on the header until the tree is complete, readers find it empty until then
+  WritePageGuard header_guard = bpm_->FetchPageWrite(header_page_id_);
+  auto *header_page = header_guard.AsMut<BPlusTreeHeaderPage>();
+  if (header_page->root_page_id_ != INVALID_PAGE_ID) {
+    return false;
+  }
+  if (pairs.empty()) {
+    return true;
+  }
+
+  // the leaves are consecutive page ids, so a leaf knows its next page id before it exists and only one page is
+  // pinned at a time
+  std::vector<char> scratch(BUSTUB_PAGE_SIZE);
+  auto *scratch_leaf = reinterpret_cast<LeafPage *>(scratch.data());
+  scratch_leaf->Init(leaf_max_size_, page_format_);
+  std::vector<int> sizes = BulkLoadSizes(pairs, scratch_leaf, fill_factor);
+  size_t num_leaves = sizes.size();
+  page_id_t first_leaf = bpm_->AllocateExtent(num_leaves);
+  // every extent allocated so far, handed back with the nodes built in it if a node can't be created
+  std::vector<std::pair<page_id_t, size_t>> extents{{first_leaf, num_leaves}};
+  auto abandon = [this, &extents] {
+    for (auto [first, count] : extents) {
+      for (size_t i = 0; i < count; ++i) {
+        bpm_->DeletePage(first + static_cast<page_id_t>(i));
+      }
+    }
+    return false;
+  };
+  // first key and page id of every node of the last level built
+  std::vector<std::pair<KeyType, page_id_t>> level;
+  level.reserve(num_leaves);
+  size_t next = 0;
+  for (size_t i = 0; i < num_leaves; ++i) {
+    auto page_id = first_leaf + static_cast<page_id_t>(i);
+    Page *page = bpm_->NewPageAt(page_id);
+    if (page == nullptr) {
+      LOG_DEBUG("b_plus_tree: no frame for a bulk-loaded leaf");
+      return abandon();
+    }
+    BasicPageGuard guard(bpm_, page);
+    auto *leaf = guard.AsMut<LeafPage>();
+    leaf->Init(leaf_max_size_, page_format_);
+    leaf->SetKeysAndValues(pairs.data() + next, sizes[i]);
+    leaf->SetNextPageId(i + 1 < num_leaves ? page_id + 1 : INVALID_PAGE_ID);
+    KeyType first_key = pairs[next].first;
+    if (page_format_ == IndexPageFormat::COMPRESSED && next > 0) {
+      first_key = SeparatorKey(pairs[next - 1].first, pairs[next].first);
+    }
+    level.emplace_back(first_key, page_id);
+    next += sizes[i];
+  }
+
+  auto *scratch_node = reinterpret_cast<InternalPage *>(scratch.data());
+  scratch_node->Init(internal_max_size_, page_format_);
+  while (level.size() > 1) {
+    sizes = BulkLoadSizes(level, scratch_node, fill_factor);
+    size_t num_nodes = sizes.size();
+    page_id_t first_node = bpm_->AllocateExtent(num_nodes);
+    extents.emplace_back(first_node, num_nodes);
+    std::vector<std::pair<KeyType, page_id_t>> parents;
+    parents.reserve(num_nodes);
+    next = 0;
+    for (size_t i = 0; i < num_nodes; ++i) {
+      auto page_id = first_node + static_cast<page_id_t>(i);
+      Page *page = bpm_->NewPageAt(page_id);
+      if (page == nullptr) {
+        LOG_DEBUG("b_plus_tree: no frame for a bulk-loaded inner node");
+        return abandon();
+      }
+      BasicPageGuard guard(bpm_, page);
+      auto *node = guard.AsMut<InternalPage>();
+      node->Init(internal_max_size_, page_format_);
+      // the key of the first child is never read, the node's own first key goes to its parent instead
+      node->SetKeysAndValues(level.data() + next, sizes[i]);
+      parents.emplace_back(level[next].first, page_id);
+      next += sizes[i];
+    }
+    level = std::move(parents);
+  }
+  header_page->root_page_id_ = level[0].second;
+  return true;
+}
+
 /*****************************************************************************
  * REMOVE
  *****************************************************************************/
@@ -391,10 +559,36 @@ void BPLUSTREE_TYPE::Remove(const KeyType &key, Transaction *txn) {
   ss << thread_id<< " remove:" << key  << "max internal size" << internal_max_size_ << "leaf max size" << leaf_max_size_
      << std::endl;
   LOG_DEBUG("%s", ss.str().c_str());
+  if (header_page_id_ == INVALID_PAGE_ID) {
+    return;
+  }
+  if (!RemoveOptimistic(key, txn)) {
+    RemovePessimistic(key, txn);
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::RemoveOptimistic(const KeyType &key, Transaction *txn) -> bool {
+  WritePageGuard leaf_guard;
+  if (!FindLeafOptimistic(key, &leaf_guard)) {
+    return true;
+  }
+  const auto *bl_page = leaf_guard.As<LeafPage>();
+  int i = 0;
+  if (!bl_page->GetIndexEqualToKey(i, key, comparator_)) {
+    return true;
+  }
+  // a leaf at its min size merges or borrows from a sibling, and the root leaf may vanish
+  if (bl_page->GetSize() <= bl_page->GetMinSize()) {
+    return false;
+  }
+  leaf_guard.AsMut<LeafPage>()->DeleteKeyAndValueAt(i);
+  return true;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::RemovePessimistic(const KeyType &key, Transaction *txn) {
   try {
-    if (header_page_id_ == INVALID_PAGE_ID) {
-      return;
-    }
     WritePageGuard header_guard = bpm_->FetchPageWrite(header_page_id_);
     auto *header_page = header_guard.AsMut<BPlusTreeHeaderPage>();
     page_id_t root_page_id = header_page->root_page_id_;
@@ -405,7 +599,7 @@ void BPLUSTREE_TYPE::Remove(const KeyType &key, Transaction *txn) {
     // bool need_merge_root = true;
     ctx.header_page_ = std::move(header_guard);
     ctx.root_page_id_ = root_page_id;
-    WritePageGuard guard = bpm_->FetchPageWrite(root_page_id);
+    WritePageGuard guard = bpm_->FetchPageWrite(root_page_id, &root_swip_);
     auto *b_page = guard.AsMut<class BPlusTreePage>();
     ctx.write_set_.push_back(std::move(guard));
     // find to the leaf page
@@ -418,7 +612,7 @@ void BPLUSTREE_TYPE::Remove(const KeyType &key, Transaction *txn) {
         return;
       }
       // record sth
-      guard = bpm_->FetchPageWrite(n_pid);
+      guard = bpm_->FetchPageWrite(n_pid, ChildSwip(ctx.write_set_.back().PageId(), i - 1));
       b_page = guard.AsMut<class BPlusTreePage>();
       // can safely delete
       if (b_page->GetSize() > b_page->GetMinSize()) {  // delete can't cause root change
@@ -490,8 +684,10 @@ void BPLUSTREE_TYPE::DeleteInternalPage(Context &ctx, Transaction *txn) {
     return;
   }
   BUSTUB_ASSERT(i != b_page->GetSize(), "should found this child");
+  // borrowing changes a key of the parent, which may not fit into a compressed page, so compressed pages only merge
+  bool can_borrow = page_format_ == IndexPageFormat::PLAIN;
   // find left child and get its size
-  if (i > 0) {
+  if (can_borrow && i > 0) {
     WritePageGuard l_guard = bpm_->FetchPageWrite(b_page->ValueAt(i - 1));
     WritePageGuard ori_guard = bpm_->FetchPageWrite(ctx.last_page_id_);
     auto *ori_page = ori_guard.AsMut<BPlusTreePage>();
@@ -503,12 +699,12 @@ void BPLUSTREE_TYPE::DeleteInternalPage(Context &ctx, Transaction *txn) {
         KeyType record_key = l_leaf->KeyAt(l_leaf->GetSize() - 1);
         ValueType record_value = l_leaf->ValueAt(l_leaf->GetSize() - 1);
         l_leaf->IncreaseSize(-1);
-        b_page->SetKeyAt(i, std::move(record_key));
+        b_page->SetKeyAt(i, record_key);
         auto *ori_leaf_page = ori_guard.AsMut<LeafPage>();
         BUSTUB_ASSERT(ori_page->IsLeafPage(), "ori_page should be a leaf page");
         BUSTUB_ASSERT(-1 != ctx.last_index_, "last_index_ is need delete index");
         ori_leaf_page->DeleteKeyAndValueAt(ctx.last_index_);
-        ori_leaf_page->InsertKeyAndValueAt(0, KeyType(), record_value);
+        ori_leaf_page->InsertKeyAndValueAt(0, record_key, record_value);
       } else {
         BUSTUB_ASSERT(l_page->IsInternalPage(), "l_page must be internal page");
         auto *l_internal = reinterpret_cast<InternalPage *>(l_page);
@@ -532,7 +728,7 @@ void BPLUSTREE_TYPE::DeleteInternalPage(Context &ctx, Transaction *txn) {
     }  // l_page size > minsize
   }    // i > 0
   // get from right guy
-  if (i < b_page->GetSize() - 1) {  // i = 0
+  if (can_borrow && i < b_page->GetSize() - 1) {  // i = 0
     WritePageGuard r_guard = bpm_->FetchPageWrite(b_page->ValueAt(i + 1));
     WritePageGuard ori_guard = bpm_->FetchPageWrite(ctx.last_page_id_);
     auto *ori_page = ori_guard.AsMut<BPlusTreePage>();
@@ -575,78 +771,73 @@ void BPLUSTREE_TYPE::DeleteInternalPage(Context &ctx, Transaction *txn) {
   WritePageGuard ori_guard = bpm_->FetchPageWrite(ctx.last_page_id_);
   auto *ori_page = ori_guard.AsMut<BPlusTreePage>();
   WritePageGuard neighbour_guard;
+  // an underfull compressed page stays as it is if it has no sibling or their keys don't fit into one page
+  auto keep_underfull = [&]() {
+    if (ori_page->IsLeafPage()) {
+      reinterpret_cast<LeafPage *>(ori_page)->DeleteKeyAndValueAt(ctx.last_index_);
+    } else {
+      reinterpret_cast<InternalPage *>(ori_page)->DeleteKeyAndValueAt(ctx.last_index_);
+    }
+  };
+  if (b_page->GetSize() == 1) {
+    keep_underfull();
+    return;
+  }
   if (i > 0) {
     neighbour_guard = bpm_->FetchPageWrite(b_page->ValueAt(i - 1));
   } else {
     neighbour_guard = bpm_->FetchPageWrite(b_page->ValueAt(i + 1));
   }
-  auto *neighbour_page = neighbour_guard.AsMut<BPlusTreePage>();
-  // merge leaf page
+  // the right page of the two merges into the left one
+  WritePageGuard &left_guard = i > 0 ? neighbour_guard : ori_guard;
+  WritePageGuard &right_guard = i > 0 ? ori_guard : neighbour_guard;
   if (ori_page->IsLeafPage()) {
-    // move ori to left neighbour
-    auto *ori_leaf_page = reinterpret_cast<LeafPage *>(ori_page);
-    auto *neighbour_leaf_page = reinterpret_cast<LeafPage *>(neighbour_page);
-    if (i > 0) {
-      int start_idx = ori_leaf_page->GetSize();
-      for (int i = 0; i < ori_leaf_page->GetSize(); ++i) {
-        neighbour_leaf_page->InsertKeyAndValueAt(i + start_idx, ori_leaf_page->KeyAt(i), ori_leaf_page->ValueAt(i));
-      }
-      neighbour_leaf_page->DeleteKeyAndValueAt(ctx.last_index_ + start_idx);
-      neighbour_leaf_page->SetNextPageId(ori_leaf_page->GetNextPageId());
-      ctx.merged_page_id_ = neighbour_guard.PageId();
-      ctx.deleted_page_id_ = ori_guard.PageId();  // FIXED: add real delete
-      ori_guard.Drop();
-      if (!bpm_->DeletePage(ctx.deleted_page_id_)) {  // FIXED: add real delete
-        LOG_DEBUG("Deleting page failed");
+    auto *left_page = left_guard.AsMut<LeafPage>();
+    const auto *right_page = right_guard.As<LeafPage>();
+    std::vector<MappingType> pairs;
+    pairs.reserve(left_page->GetSize() + right_page->GetSize());
+    for (int j = 0; j < left_page->GetSize(); ++j) {
+      if (i > 0 || j != ctx.last_index_) {
+        pairs.emplace_back(left_page->KeyAt(j), left_page->ValueAt(j));
       }
-    } else {  // i = 0
-      int start_idx = neighbour_leaf_page->GetSize();
-      for (int i = 0; i < neighbour_leaf_page->GetSize(); ++i) {
-        ori_leaf_page->InsertKeyAndValueAt(i + start_idx, neighbour_leaf_page->KeyAt(i),
-                                           neighbour_leaf_page->ValueAt(i));
-      }
-      ori_leaf_page->DeleteKeyAndValueAt(ctx.last_index_);
-      ori_leaf_page->SetNextPageId(neighbour_leaf_page->GetNextPageId());
-      ctx.merged_page_id_ = ori_guard.PageId();
-      ctx.deleted_page_id_ = neighbour_guard.PageId();  // FIXED: add real delete
-      neighbour_guard.Drop();
-      if (!bpm_->DeletePage(ctx.deleted_page_id_)) {  // FIXED: add real delete
-        LOG_DEBUG("Deleting page failed");
+    }
+    for (int j = 0; j < right_page->GetSize(); ++j) {
+      if (i == 0 || j != ctx.last_index_) {
+        pairs.emplace_back(right_page->KeyAt(j), right_page->ValueAt(j));
       }
     }
+    auto size = static_cast<int>(pairs.size());
+    if (size > left_page->CapacityFor(pairs.data(), size)) {
+      keep_underfull();
+      return;
+    }
+    left_page->SetKeysAndValues(pairs.data(), size);
+    left_page->SetNextPageId(right_page->GetNextPageId());
   } else {
-    auto *ori_internal_page = reinterpret_cast<InternalPage *>(ori_page);
-    auto *neighbour_internal_page = reinterpret_cast<InternalPage *>(neighbour_page);
-    ori_internal_page->DeleteKeyAndValueAt(ctx.last_index_);
-    KeyType mid_key = b_page->KeyAt(i);
-    if (i > 0) {
-      int start_idx = neighbour_internal_page->GetSize();
-      neighbour_internal_page->InsertKeyAndValueAt(start_idx, mid_key, ori_internal_page->ValueAt(0));
-      for (int i = 1; i < ori_internal_page->GetSize(); ++i) {
-        neighbour_internal_page->InsertKeyAndValueAt(start_idx + i, ori_internal_page->KeyAt(i),
-                                                     ori_internal_page->ValueAt(i));
-      }
-      ctx.merged_page_id_ = neighbour_guard.PageId();
-      ctx.deleted_page_id_ = ori_guard.PageId();  // FIXED: add real delete
-      ori_guard.Drop();
-      if (!bpm_->DeletePage(ctx.deleted_page_id_)) {  // FIXED: add real delete
-        LOG_DEBUG("Deleting page failed");
-      }
-    } else {  // i = 0
-      mid_key = b_page->KeyAt(1);
-      int start_idx = ori_internal_page->GetSize();
-      ori_internal_page->InsertKeyAndValueAt(start_idx, mid_key, neighbour_internal_page->ValueAt(0));
-      for (int i = 1; i < neighbour_internal_page->GetSize(); ++i) {
-        ori_internal_page->InsertKeyAndValueAt(start_idx + i, neighbour_internal_page->KeyAt(i),
-                                               neighbour_internal_page->ValueAt(i));
-      }
-      ctx.merged_page_id_ = ori_guard.PageId();
-      ctx.deleted_page_id_ = neighbour_guard.PageId();  // FIXED: add real delete
-      neighbour_guard.Drop();
-      if (!bpm_->DeletePage(ctx.deleted_page_id_)) {  // FIXED: add real delete
-        LOG_DEBUG("Deleting page failed");
-      }
+    reinterpret_cast<InternalPage *>(ori_page)->DeleteKeyAndValueAt(ctx.last_index_);
+    auto *left_page = left_guard.AsMut<InternalPage>();
+    const auto *right_page = right_guard.As<InternalPage>();
+    // the key of the right page in the parent comes down in front of its first child
+    std::vector<std::pair<KeyType, page_id_t>> pairs;
+    pairs.reserve(left_page->GetSize() + right_page->GetSize());
+    for (int j = 0; j < left_page->GetSize(); ++j) {
+      pairs.emplace_back(left_page->KeyAt(j), left_page->ValueAt(j));
     }
+    pairs.emplace_back(b_page->KeyAt(i == 0 ? 1 : i), right_page->ValueAt(0));
+    for (int j = 1; j < right_page->GetSize(); ++j) {
+      pairs.emplace_back(right_page->KeyAt(j), right_page->ValueAt(j));
+    }
+    auto size = static_cast<int>(pairs.size());
+    if (size > left_page->CapacityFor(pairs.data(), size)) {
+      return;
+    }
+    left_page->SetKeysAndValues(pairs.data(), size);
+  }
+  ctx.merged_page_id_ = left_guard.PageId();
+  ctx.deleted_page_id_ = right_guard.PageId();  // FIXED: add real delete
+  right_guard.Drop();
+  if (!bpm_->DeletePage(ctx.deleted_page_id_)) {  // FIXED: add real delete
+    LOG_DEBUG("Deleting page failed");
   }
   ctx.last_page_id_ = guard.PageId();
   ctx.last_index_ = (i == 0 ? 1 : i);
@@ -715,8 +906,11 @@ auto BPLUSTREE_TYPE::Begin() -> INDEXITERATOR_TYPE {
     }
     // get leaf node
     auto *bl_page = reinterpret_cast<LeafPage *>(b_page);
+    // the iterator keeps its own pin on the leaf once the latch is released
+    BasicPageGuard leaf_guard = bpm_->FetchPageBasic(pg_guard.PageId(), AccessType::Scan);
     pg_guard.Drop();
-    return INDEXITERATOR_TYPE(0, std::move(bl_page->GetSize()), reinterpret_cast<uint64_t>(this), bpm_, bl_page);
+    return INDEXITERATOR_TYPE(0, std::move(bl_page->GetSize()), reinterpret_cast<uint64_t>(this), bpm_, bl_page,
+                              std::move(leaf_guard));
   } catch (const std::exception &e) {
     std::cout << e.what() << "in begin" << std::endl;
     throw e;
@@ -769,7 +963,10 @@ auto BPLUSTREE_TYPE::Begin(const KeyType &key) -> INDEXITERATOR_TYPE {
     // TODO(hksong): change it to binary search
     int i = 0;
     if (bl_page->GetIndexEqualToKey(i, key, comparator_)) {
-      return INDEXITERATOR_TYPE(i, std::move(bl_page->GetSize()), reinterpret_cast<uint64_t>(this), bpm_, bl_page);
+      BasicPageGuard leaf_guard = bpm_->FetchPageBasic(pg_guard.PageId(), AccessType::Scan);
+      pg_guard.Drop();
+      return INDEXITERATOR_TYPE(i, std::move(bl_page->GetSize()), reinterpret_cast<uint64_t>(this), bpm_, bl_page,
+                                std::move(leaf_guard));
     }
   } catch (const std::exception &e) {
     std::cout << e.what() << "in begin(key)" << std::endl;
@@ -11,19 +11,28 @@
 
 #include "storage/index/b_plus_tree_index.h"
 
+#include <algorithm>
+
 namespace bustub {
 /*
  * Constructor
  */
 INDEX_TEMPLATE_ARGUMENTS
 BPLUSTREE_INDEX_TYPE::BPlusTreeIndex(std::unique_ptr<IndexMetadata> &&metadata,
-                                     BufferPoolManager *buffer_pool_manager)
-    : Index(std::move(metadata)), comparator_(GetMetadata()->GetKeySchema()) {
+                                     BufferPoolManager *buffer_pool_manager,
+                                     IndexPageFormat page_format)
+    : Index(std::move(metadata)),
+      comparator_(GetMetadata()->GetKeySchema(), KeyEncoding::NORMALIZED) {
   page_id_t header_page_id;
   buffer_pool_manager->NewPage(&header_page_id);
   container_ = std::make_shared<BPlusTree<KeyType, ValueType, KeyComparator>>(
       GetMetadata()->GetName(), header_page_id, buffer_pool_manager,
-      comparator_);
+      comparator_,
+      (BUSTUB_PAGE_SIZE - LEAF_PAGE_HEADER_SIZE) /
+          sizeof(std::pair<KeyType, ValueType>),
+      (BUSTUB_PAGE_SIZE - INTERNAL_PAGE_HEADER_SIZE) /
+          sizeof(std::pair<KeyType, page_id_t>),
+      page_format);
 }
 
 INDEX_TEMPLATE_ARGUMENTS
@@ -31,7 +40,7 @@ auto BPLUSTREE_INDEX_TYPE::InsertEntry(const Tuple &key, RID rid,
                                        Transaction *transaction) -> bool {
   // construct insert index key
   KeyType index_key;
-  index_key.SetFromKey(key);
+  index_key.SetFromKey(key, GetKeySchema());
 
   return container_->Insert(index_key, rid, transaction);
 }
@@ -41,7 +50,7 @@ void BPLUSTREE_INDEX_TYPE::DeleteEntry(const Tuple &key, RID rid,
                                        Transaction *transaction) {
   // construct delete index key
   KeyType index_key;
-  index_key.SetFromKey(key);
+  index_key.SetFromKey(key, GetKeySchema());
 
   container_->Remove(index_key, transaction);
 }
@@ -51,11 +60,33 @@ void BPLUSTREE_INDEX_TYPE::ScanKey(const Tuple &key, std::vector<RID> *result,
                                    Transaction *transaction) {
   // construct scan index key
   KeyType index_key;
-  index_key.SetFromKey(key);
+  index_key.SetFromKey(key, GetKeySchema());
 
   container_->GetValue(index_key, result, transaction);
 }
 
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_INDEX_TYPE::BulkLoad(std::vector<MappingType> *entries,
+                                    Transaction *transaction) {
+  std::stable_sort(entries->begin(), entries->end(),
+                   [this](const MappingType &a, const MappingType &b) {
+                     return comparator_(a.first, b.first) < 0;
+                   });
+  auto same_key = [this](const MappingType &a, const MappingType &b) {
+    return comparator_(a.first, b.first) == 0;
+  };
+  entries->erase(std::unique(entries->begin(), entries->end(), same_key),
+                 entries->end());
+  if (container_->BulkLoad(*entries)) {
+    return;
+  }
+  // the tree already has entries, or the pool had no frame for a node and the load was undone; insert them one by
+  // one
+  for (const auto &[key, rid] : *entries) {
+    container_->Insert(key, rid, transaction);
+  }
+}
+
 INDEX_TEMPLATE_ARGUMENTS
 auto BPLUSTREE_INDEX_TYPE::GetBeginIterator() -> INDEXITERATOR_TYPE {
   return container_->Begin();
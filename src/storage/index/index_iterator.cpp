@@ -13,12 +13,20 @@ namespace bustub {
  */
 INDEX_TEMPLATE_ARGUMENTS
 INDEXITERATOR_TYPE::IndexIterator(int idx, int max_idx_per_page, uint64_t uuid, BufferPoolManager *bpm,
-                                  LeafPage *start_page)
-    : idx_(idx), max_idx_per_page_(max_idx_per_page), uuid_(uuid), bpm_(bpm), cur_page_(start_page) {
+                                  const LeafPage *start_page, BasicPageGuard start_guard)
+    : idx_(idx),
+      max_idx_per_page_(max_idx_per_page),
+      uuid_(uuid),
+      bpm_(bpm),
+      cur_page_(start_page),
+      cur_guard_(std::move(start_guard)),
+      read_ahead_(bpm) {
   if (nullptr == start_page) {
     is_end_page_ = true;
     end_node_ = MappingType(KeyType(), ValueType());
+    return;
   }
+  SkipFinishedPages();
 }
 
 INDEX_TEMPLATE_ARGUMENTS
@@ -45,21 +53,29 @@ auto INDEXITERATOR_TYPE::operator++() -> INDEXITERATOR_TYPE & {
   if (is_end_page_) {
     return *this;
   }
-  if (++idx_ < max_idx_per_page_) {
-    return *this;
-  }
-  page_id_t next_page = cur_page_->GetNextPageId();
-  if (next_page == INVALID_PAGE_ID) {
-    is_end_page_ = true;
-    return *this;
-  }
-  idx_ = 0;
-  WritePageGuard guard = bpm_->FetchPageWrite(next_page);
-  cur_page_ = reinterpret_cast<LeafPage *>(guard.AsMut<LeafPage *>());
-  max_idx_per_page_ = cur_page_->GetSize();
+  ++idx_;
+  SkipFinishedPages();
   return *this;
 }
 
+INDEX_TEMPLATE_ARGUMENTS
+void INDEXITERATOR_TYPE::SkipFinishedPages() {
+  // a compressed tree may keep empty leaves, see BPlusTree::DeleteInternalPage
+  while (idx_ >= max_idx_per_page_) {
+    page_id_t next_page = cur_page_->GetNextPageId();
+    if (next_page == INVALID_PAGE_ID) {
+      is_end_page_ = true;
+      return;
+    }
+    idx_ = 0;
+    read_ahead_.Advance(next_page);
+    // a range scan must not push the tree's inner pages out of the pool
+    cur_guard_ = bpm_->FetchPageBasic(next_page, AccessType::Scan);
+    cur_page_ = cur_guard_.As<LeafPage>();
+    max_idx_per_page_ = cur_page_->GetSize();
+  }
+}
+
 template class IndexIterator<GenericKey<4>, RID, GenericComparator<4>>;
 
 template class IndexIterator<GenericKey<8>, RID, GenericComparator<8>>;
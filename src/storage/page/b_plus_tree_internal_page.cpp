@@ -9,6 +9,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 
@@ -25,12 +26,13 @@ namespace bustub {
  * Including set page type, set current size, and set max page size
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Init(int max_size) {
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Init(int max_size, IndexPageFormat format) {
   if (max_size > 255 || max_size < 0) {
     LOG_DEBUG("page size should less than 256");
     BUSTUB_ASSERT(1, "error occured");
   }
   SetPageType(IndexPageType::INTERNAL_PAGE);
+  SetCompressed(format == IndexPageFormat::COMPRESSED);
   SetSize(1);
   SetMaxSize(max_size);
 }
@@ -39,16 +41,43 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Init(int max_size) {
  * array offset)
  */
 INDEX_TEMPLATE_ARGUMENTS
-auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::KeyAt(int index) const -> KeyType { return array_[index].first; }
+auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::KeyAt(int index) const -> KeyType {
+  if (IsCompressed()) {
+    KeyType key;
+    ReadCompressedKey(Data(), index, reinterpret_cast<char *>(&key), sizeof(KeyType), sizeof(ValueType));
+    return key;
+  }
+  return array_[index].first;
+}
 
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_INTERNAL_PAGE_TYPE::SetKeyAt(int index, const KeyType &key) { array_[index].first = key; }
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::SetKeyAt(int index, const KeyType &key) {
+  if (IsCompressed()) {
+    // the first key is never read
+    if (index > 0) {
+      SetCompressedKey(Data(), 1, index, reinterpret_cast<const char *>(&key), sizeof(KeyType), sizeof(ValueType));
+    }
+    return;
+  }
+  array_[index].first = key;
+}
 
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_INTERNAL_PAGE_TYPE::SetValueAt(int index, const ValueType &value) { array_[index].second = value; }
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::SetValueAt(int index, const ValueType &value) {
+  if (IsCompressed()) {
+    WriteCompressedValue(Data(), index, reinterpret_cast<const char *>(&value), sizeof(ValueType));
+    return;
+  }
+  array_[index].second = value;
+}
 
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::InsertKeyAndValueAt(int index, const KeyType &key, const ValueType &value) {
+  if (IsCompressed()) {
+    InsertCompressedPair(Data(), 1, index, reinterpret_cast<const char *>(&key), sizeof(KeyType),
+                         reinterpret_cast<const char *>(&value), sizeof(ValueType));
+    return;
+  }
   if (index >= 1 && index <= GetSize() && GetSize() < GetMaxSize()) {
     std::memmove(reinterpret_cast<char *>(&array_[index + 1]), reinterpret_cast<char *>(&array_[index]),
                  (GetSize() - index) * sizeof(array_[0]));
@@ -63,16 +92,16 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::InsertKeyAndValueAt(int index, const KeyTyp
 
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::DeleteKeyAndValueAt(int index) {
-  if (index >= 0 && index < GetSize()) {
-    if (GetSize() != INTERNAL_PAGE_SIZE) {
-      std::memmove(reinterpret_cast<char *>(&array_[index]), reinterpret_cast<char *>(&array_[index + 1]),
-                   (GetSize() - index - 1) * sizeof(array_[0]));
-    } else {
-      std::memmove(reinterpret_cast<char *>(&array_[index]), reinterpret_cast<char *>(&array_[index + 1]),
-                   (GetSize() - index - 2) * sizeof(array_[0]));
-    }
-    IncreaseSize(-1);
+  if (index < 0 || index >= GetSize()) {
+    return;
+  }
+  if (IsCompressed()) {
+    DeleteCompressedPair(Data(), index, sizeof(ValueType));
+    return;
   }
+  std::memmove(reinterpret_cast<char *>(&array_[index]), reinterpret_cast<char *>(&array_[index + 1]),
+               (GetSize() - index - 1) * sizeof(array_[0]));
+  IncreaseSize(-1);
 }
 /*
  * Helper method to get the value associated with input "index"(a.k.a array
@@ -80,9 +109,46 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::DeleteKeyAndValueAt(int index) {
  */
 INDEX_TEMPLATE_ARGUMENTS
 auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::ValueAt(int index) const -> ValueType {
+  if (IsCompressed()) {
+    ValueType value;
+    ReadCompressedValue(Data(), index, reinterpret_cast<char *>(&value), sizeof(ValueType));
+    return value;
+  }
   return array_[index].second;  // TODO(hksong): may need be changed to index + 1
 }
 
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::HasRoomFor(const KeyType &key) const -> bool {
+  if (IsCompressed()) {
+    KeyLayout layout = LayoutWith(Data(), 1, reinterpret_cast<const char *>(&key), sizeof(KeyType));
+    return GetSize() < CompressedCapacity(Data(), layout, sizeof(ValueType));
+  }
+  return GetSize() < GetMaxSize();
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::CapacityFor(const MappingType *pairs, int size) const -> int {
+  if (IsCompressed()) {
+    return CompressedCapacity(Data(), LayoutOfPairs(pairs, 1, size), sizeof(ValueType));
+  }
+  return GetMaxSize();
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::SetKeysAndValues(const MappingType *pairs, int size) {
+  if (!IsCompressed()) {
+    std::copy(pairs, pairs + size, array_);
+    SetSize(size);
+    return;
+  }
+  ResetKeyLayout(Data(), LayoutOfPairs(pairs, 1, size), reinterpret_cast<const char *>(&pairs[size > 1 ? 1 : 0].first));
+  SetSize(size);
+  for (int i = 0; i < size; ++i) {
+    WriteCompressedKey(Data(), i, reinterpret_cast<const char *>(&pairs[i].first), sizeof(ValueType));
+    WriteCompressedValue(Data(), i, reinterpret_cast<const char *>(&pairs[i].second), sizeof(ValueType));
+  }
+}
+
 // valuetype for internalNode should be page id_t
 template class BPlusTreeInternalPage<GenericKey<4>, page_id_t, GenericComparator<4>>;
 template class BPlusTreeInternalPage<GenericKey<8>, page_id_t, GenericComparator<8>>;
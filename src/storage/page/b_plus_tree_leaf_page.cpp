@@ -9,6 +9,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
 #include <sstream>
 
 #include "common/exception.h"
@@ -28,12 +29,13 @@ namespace bustub {
  * max size
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_LEAF_PAGE_TYPE::Init(int max_size) {
+void B_PLUS_TREE_LEAF_PAGE_TYPE::Init(int max_size, IndexPageFormat format) {
   if (max_size > 255 || max_size < 0) {
     LOG_DEBUG("page size should less than 256");
     BUSTUB_ASSERT(1, "error occured");
   }
   SetPageType(IndexPageType::LEAF_PAGE);
+  SetCompressed(format == IndexPageFormat::COMPRESSED);
   SetSize(0);
   next_page_id_ = INVALID_PAGE_ID;
   SetMaxSize(max_size);
@@ -53,19 +55,50 @@ void B_PLUS_TREE_LEAF_PAGE_TYPE::SetNextPageId(page_id_t next_page_id) { next_pa
  * array offset)
  */
 INDEX_TEMPLATE_ARGUMENTS
-auto B_PLUS_TREE_LEAF_PAGE_TYPE::KeyAt(int index) const -> KeyType { return array_[index].first; }
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::KeyAt(int index) const -> KeyType {
+  if (IsCompressed()) {
+    KeyType key;
+    ReadCompressedKey(Data(), index, reinterpret_cast<char *>(&key), sizeof(KeyType), sizeof(ValueType));
+    return key;
+  }
+  return array_[index].first;
+}
 
 INDEX_TEMPLATE_ARGUMENTS
-auto B_PLUS_TREE_LEAF_PAGE_TYPE::ValueAt(int index) const -> ValueType { return array_[index].second; }
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::ValueAt(int index) const -> ValueType {
+  if (IsCompressed()) {
+    ValueType value;
+    ReadCompressedValue(Data(), index, reinterpret_cast<char *>(&value), sizeof(ValueType));
+    return value;
+  }
+  return array_[index].second;
+}
 
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_LEAF_PAGE_TYPE::SetKeyAt(int index, const KeyType &key) { array_[index].first = key; }
+void B_PLUS_TREE_LEAF_PAGE_TYPE::SetKeyAt(int index, const KeyType &key) {
+  if (IsCompressed()) {
+    SetCompressedKey(Data(), 0, index, reinterpret_cast<const char *>(&key), sizeof(KeyType), sizeof(ValueType));
+    return;
+  }
+  array_[index].first = key;
+}
 
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_LEAF_PAGE_TYPE::SetValueAt(int index, const ValueType &value) { array_[index].second = value; }
+void B_PLUS_TREE_LEAF_PAGE_TYPE::SetValueAt(int index, const ValueType &value) {
+  if (IsCompressed()) {
+    WriteCompressedValue(Data(), index, reinterpret_cast<const char *>(&value), sizeof(ValueType));
+    return;
+  }
+  array_[index].second = value;
+}
 
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_LEAF_PAGE_TYPE::InsertKeyAndValueAt(int index, const KeyType &key, const ValueType &value) {
+  if (IsCompressed()) {
+    InsertCompressedPair(Data(), 0, index, reinterpret_cast<const char *>(&key), sizeof(KeyType),
+                         reinterpret_cast<const char *>(&value), sizeof(ValueType));
+    return;
+  }
   if (index >= 0 && index <= GetSize() && GetSize() < GetMaxSize()) {
     std::memmove(reinterpret_cast<char *>(&array_[index + 1]), reinterpret_cast<char *>(&array_[index]),
                  (GetSize() - index) * sizeof(array_[0]));
@@ -80,15 +113,47 @@ void B_PLUS_TREE_LEAF_PAGE_TYPE::InsertKeyAndValueAt(int index, const KeyType &k
 
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_LEAF_PAGE_TYPE::DeleteKeyAndValueAt(int index) {
-  if (index >= 0 && index < GetSize()) {
-    if (GetSize() != LEAF_PAGE_SIZE) {
-      std::memmove(reinterpret_cast<char *>(&array_[index]), reinterpret_cast<char *>(&array_[index + 1]),
-                   (GetSize() - index - 1) * sizeof(array_[0]));
-    } else {
-      std::memmove(reinterpret_cast<char *>(&array_[index]), reinterpret_cast<char *>(&array_[index + 1]),
-                   (GetSize() - index - 2) * sizeof(array_[0]));
-    }
-    IncreaseSize(-1);
+  if (index < 0 || index >= GetSize()) {
+    return;
+  }
+  if (IsCompressed()) {
+    DeleteCompressedPair(Data(), index, sizeof(ValueType));
+    return;
+  }
+  std::memmove(reinterpret_cast<char *>(&array_[index]), reinterpret_cast<char *>(&array_[index + 1]),
+               (GetSize() - index - 1) * sizeof(array_[0]));
+  IncreaseSize(-1);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::HasRoomFor(const KeyType &key) const -> bool {
+  if (IsCompressed()) {
+    KeyLayout layout = LayoutWith(Data(), 0, reinterpret_cast<const char *>(&key), sizeof(KeyType));
+    return GetSize() < CompressedCapacity(Data(), layout, sizeof(ValueType));
+  }
+  return GetSize() < GetMaxSize();
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::CapacityFor(const MappingType *pairs, int size) const -> int {
+  if (IsCompressed()) {
+    return CompressedCapacity(Data(), LayoutOfPairs(pairs, 0, size), sizeof(ValueType));
+  }
+  return GetMaxSize();
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::SetKeysAndValues(const MappingType *pairs, int size) {
+  if (!IsCompressed()) {
+    std::copy(pairs, pairs + size, array_);
+    SetSize(size);
+    return;
+  }
+  ResetKeyLayout(Data(), LayoutOfPairs(pairs, 0, size), reinterpret_cast<const char *>(&pairs[0].first));
+  SetSize(size);
+  for (int i = 0; i < size; ++i) {
+    WriteCompressedKey(Data(), i, reinterpret_cast<const char *>(&pairs[i].first), sizeof(ValueType));
+    WriteCompressedValue(Data(), i, reinterpret_cast<const char *>(&pairs[i].second), sizeof(ValueType));
   }
 }
 
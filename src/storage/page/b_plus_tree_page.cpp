@@ -11,6 +11,14 @@
 
 #include "storage/page/b_plus_tree_page.h"
 
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define BUSTUB_SEARCH_AVX2
+#include <immintrin.h>
+#endif
+
 namespace bustub {
 
 /*
@@ -46,4 +54,266 @@ auto BPlusTreePage::GetMinSize() const -> int {
   return max_size_ / 2;
 }
 
+static_assert(sizeof(BPlusTreePage) == 12, "the layout of a compressed page fits into the 12-byte header");
+
+auto BPlusTreePage::IsCompressed() const -> bool { return compressed_; }
+
+/** Keys left after the halving steps of SearchIntegerKey, which are counted instead. */
+static constexpr int INTEGER_SEARCH_WINDOW = 8;
+
+/** Flips the order of unsigned integers into that of signed ones. */
+static constexpr uint64_t SIGN_BIT = 1ULL << 63;
+
+/** Load an integer key, shifted up so that integers of every width compare as int64. */
+static inline auto LoadIntegerKey(const char *data, size_t width, bool big_endian) -> int64_t {
+  uint64_t value = 0;
+  memcpy(&value, data, width);
+  if (big_endian) {
+    return static_cast<int64_t>(__builtin_bswap64(value) ^ SIGN_BIT);
+  }
+  return static_cast<int64_t>(value << (64 - 8 * width));
+}
+
+static auto CountIntegerKeys(const char *keys, size_t stride, int n, size_t width, bool big_endian, int64_t key,
+                             bool upper) -> int {
+  int count = 0;
+  for (int i = 0; i < n; ++i) {
+    int64_t probe = LoadIntegerKey(keys + i * stride, width, big_endian);
+    count += static_cast<int>(upper ? probe <= key : probe < key);
+  }
+  return count;
+}
+
+#if defined(BUSTUB_SEARCH_AVX2)
+/** CountIntegerKeys four keys at a time. A key is gathered as 8 bytes, which stay within its key-value pair. */
+__attribute__((target("avx2"))) static auto CountIntegerKeysAvx2(const char *keys, size_t stride, int n, size_t width,
+                                                                  bool big_endian, int64_t key, bool upper) -> int {
+  auto step = static_cast<int64_t>(stride);
+  const __m256i offsets = _mm256_set_epi64x(3 * step, 2 * step, step, 0);
+  const __m128i shift = _mm_cvtsi64_si128(static_cast<int64_t>(64 - 8 * width));
+  // reverses the bytes of every 64-bit lane
+  const __m256i reverse = _mm256_set_epi8(8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13,
+                                          14, 15, 0, 1, 2, 3, 4, 5, 6, 7);
+  // keeps the width bytes of a big-endian key, which are at the top after reversing
+  const __m256i mask = _mm256_sll_epi64(_mm256_set1_epi64x(-1), shift);
+  const __m256i sign = _mm256_set1_epi64x(static_cast<int64_t>(SIGN_BIT));
+  const __m256i target = _mm256_set1_epi64x(key);
+  int count = 0;
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256i probes =
+        _mm256_i64gather_epi64(reinterpret_cast<const long long *>(keys + i * stride), offsets, 1);  // NOLINT
+    if (big_endian) {
+      probes = _mm256_xor_si256(_mm256_and_si256(_mm256_shuffle_epi8(probes, reverse), mask), sign);
+    } else {
+      probes = _mm256_sll_epi64(probes, shift);
+    }
+    // probe <= key is !(probe > key), probe < key is key > probe
+    __m256i greater = upper ? _mm256_cmpgt_epi64(probes, target) : _mm256_cmpgt_epi64(target, probes);
+    int matches = __builtin_popcount(_mm256_movemask_pd(_mm256_castsi256_pd(greater)));
+    count += upper ? 4 - matches : matches;
+  }
+  return count + CountIntegerKeys(keys + i * stride, stride, n - i, width, big_endian, key, upper);
+}
+#endif
+
+auto BPlusTreePage::UsesAvx2Search() -> bool {
+#if defined(BUSTUB_SEARCH_AVX2)
+  static const bool supported = __builtin_cpu_supports("avx2") != 0;
+  return supported;
+#else
+  return false;
+#endif
+}
+
+auto BPlusTreePage::SearchIntegerKey(const char *keys, size_t stride, int begin, int end, const char *key,
+                                     size_t width, bool big_endian, bool upper) -> int {
+  int64_t target = LoadIntegerKey(key, width, big_endian);
+  int n = end - begin;
+  if (n <= 0) {
+    return begin;
+  }
+  while (n > INTEGER_SEARCH_WINDOW) {
+    int half = n / 2;
+    int64_t probe = LoadIntegerKey(keys + (begin + half) * stride, width, big_endian);
+    begin += half * static_cast<int>(upper ? probe <= target : probe < target);
+    n -= half;
+  }
+  const char *window = keys + begin * stride;
+#if defined(BUSTUB_SEARCH_AVX2)
+  if (UsesAvx2Search()) {
+    return begin + CountIntegerKeysAvx2(window, stride, n, width, big_endian, target, upper);
+  }
+#endif
+  return begin + CountIntegerKeys(window, stride, n, width, big_endian, target, upper);
+}
+
+/*****************************************************************************
+ * COMPRESSED FORMAT
+ *****************************************************************************/
+void BPlusTreePage::SetCompressed(bool compressed) {
+  compressed_ = compressed;
+  prefix_size_ = 0;
+  suffix_size_ = 0;
+}
+
+auto BPlusTreePage::SignificantSize(const char *key, size_t key_size) -> size_t {
+  while (key_size > 0 && key[key_size - 1] == 0) {
+    --key_size;
+  }
+  return key_size;
+}
+
+auto BPlusTreePage::LayoutOf(const char *first, const char *last, size_t significant_size) -> KeyLayout {
+  // sorted keys share what the first and the last one share
+  size_t prefix_size = 0;
+  while (prefix_size < significant_size && first[prefix_size] == last[prefix_size]) {
+    ++prefix_size;
+  }
+  return {prefix_size, significant_size - prefix_size};
+}
+
+auto BPlusTreePage::LayoutWith(const char *data, int first, const char *key, size_t key_size) const -> KeyLayout {
+  size_t significant_size = SignificantSize(key, key_size);
+  if (GetSize() <= first) {
+    return {significant_size, 0};
+  }
+  size_t prefix_size = 0;
+  while (prefix_size < prefix_size_ && key[prefix_size] == data[prefix_size]) {
+    ++prefix_size;
+  }
+  significant_size = std::max<size_t>(significant_size, prefix_size_ + suffix_size_);
+  return {prefix_size, significant_size - prefix_size};
+}
+
+auto BPlusTreePage::CompressedCapacity(const char *data, KeyLayout layout, size_t value_size) const -> int {
+  auto space = static_cast<size_t>(BUSTUB_PAGE_SIZE - (data - reinterpret_cast<const char *>(this)));
+  if (layout.prefix_size_ >= space) {
+    return 0;
+  }
+  size_t fit = (space - layout.prefix_size_) / (layout.suffix_size_ + value_size);
+  return static_cast<int>(std::min<size_t>(fit, std::max(2 * max_size_ - 1, 0)));
+}
+
+void BPlusTreePage::ResetKeyLayout(char *data, KeyLayout layout, const char *prefix) {
+  prefix_size_ = layout.prefix_size_;
+  suffix_size_ = layout.suffix_size_;
+  if (prefix_size_ > 0) {
+    memcpy(data, prefix, prefix_size_);
+  }
+}
+
+void BPlusTreePage::ChangeKeyLayout(char *data, KeyLayout layout, const char *prefix, size_t value_size) {
+  char old_data[BUSTUB_PAGE_SIZE];
+  size_t old_stride = suffix_size_ + value_size;
+  memcpy(old_data, data, CompressedOffset(value_size, GetSize()));
+  size_t stride = layout.suffix_size_ + value_size;
+  for (int i = 0; i < GetSize(); ++i) {
+    const char *old_pair = old_data + prefix_size_ + i * old_stride;
+    char *pair = data + layout.prefix_size_ + i * stride;
+    // byte j of the key is in the old prefix, the old suffix or one of the zeros after it
+    for (size_t j = layout.prefix_size_; j < layout.prefix_size_ + layout.suffix_size_; ++j) {
+      char byte = 0;
+      if (j < prefix_size_) {
+        byte = old_data[j];
+      } else if (j < prefix_size_ + suffix_size_) {
+        byte = old_pair[j - prefix_size_];
+      }
+      pair[j - layout.prefix_size_] = byte;
+    }
+    memcpy(pair + layout.suffix_size_, old_pair + suffix_size_, value_size);
+  }
+  ResetKeyLayout(data, layout, prefix);
+}
+
+void BPlusTreePage::ReadCompressedKey(const char *data, int index, char *key, size_t key_size,
+                                      size_t value_size) const {
+  memcpy(key, data, prefix_size_);
+  memcpy(key + prefix_size_, data + CompressedOffset(value_size, index), suffix_size_);
+  memset(key + prefix_size_ + suffix_size_, 0, key_size - prefix_size_ - suffix_size_);
+}
+
+void BPlusTreePage::WriteCompressedKey(char *data, int index, const char *key, size_t value_size) const {
+  memcpy(data + CompressedOffset(value_size, index), key + prefix_size_, suffix_size_);
+}
+
+void BPlusTreePage::SetCompressedKey(char *data, int first, int index, const char *key, size_t key_size,
+                                     size_t value_size) {
+  KeyLayout layout = LayoutWith(data, first, key, key_size);
+  if (layout.prefix_size_ != prefix_size_ || layout.suffix_size_ != suffix_size_) {
+    ChangeKeyLayout(data, layout, key, value_size);
+  }
+  WriteCompressedKey(data, index, key, value_size);
+}
+
+void BPlusTreePage::ReadCompressedValue(const char *data, int index, char *value, size_t value_size) const {
+  // an optimistic reader may see a torn header or an index found with another one, read the header once and stay
+  // within the page, the reader validates the page before using the value
+  size_t suffix_size = suffix_size_;
+  size_t offset = prefix_size_ + static_cast<size_t>(index) * (suffix_size + value_size) + suffix_size;
+  auto space = static_cast<size_t>(BUSTUB_PAGE_SIZE - (data - reinterpret_cast<const char *>(this)));
+  memcpy(value, data + std::min(offset, space - value_size), value_size);
+}
+
+void BPlusTreePage::WriteCompressedValue(char *data, int index, const char *value, size_t value_size) const {
+  memcpy(data + CompressedOffset(value_size, index) + suffix_size_, value, value_size);
+}
+
+void BPlusTreePage::InsertCompressedPair(char *data, int first, int index, const char *key, size_t key_size,
+                                         const char *value, size_t value_size) {
+  KeyLayout layout = LayoutWith(data, first, key, key_size);
+  BUSTUB_ASSERT(GetSize() < CompressedCapacity(data, layout, value_size), "no room for the pair");
+  if (layout.prefix_size_ != prefix_size_ || layout.suffix_size_ != suffix_size_) {
+    ChangeKeyLayout(data, layout, key, value_size);
+  }
+  size_t stride = suffix_size_ + value_size;
+  char *pair = data + CompressedOffset(value_size, index);
+  memmove(pair + stride, pair, (GetSize() - index) * stride);
+  WriteCompressedKey(data, index, key, value_size);
+  WriteCompressedValue(data, index, value, value_size);
+  IncreaseSize(1);
+}
+
+void BPlusTreePage::DeleteCompressedPair(char *data, int index, size_t value_size) {
+  size_t stride = suffix_size_ + value_size;
+  char *pair = data + CompressedOffset(value_size, index);
+  memmove(pair, pair + stride, (GetSize() - index - 1) * stride);
+  IncreaseSize(-1);
+}
+
+auto BPlusTreePage::SearchCompressedKey(const char *data, int begin, int end, const char *key, size_t key_size,
+                                        size_t value_size, bool upper) const -> int {
+  // an optimistic reader may see a torn header, which must not take it out of the page
+  size_t prefix_size = std::min<size_t>(prefix_size_, key_size);
+  size_t suffix_size = std::min<size_t>(suffix_size_, key_size - prefix_size);
+  size_t stride = suffix_size + value_size;
+  auto space = static_cast<size_t>(BUSTUB_PAGE_SIZE - (data - reinterpret_cast<const char *>(this)));
+  end = std::min(end, static_cast<int>((space - prefix_size) / stride));
+  if (end <= begin) {
+    return begin;
+  }
+  int cmp = memcmp(key, data, prefix_size);
+  if (cmp != 0) {
+    return cmp < 0 ? begin : end;
+  }
+  // a key that matches up to the end of its suffix is less than a key with more non-zero bytes after that
+  if (SignificantSize(key, key_size) > prefix_size + suffix_size) {
+    upper = true;
+  }
+  const char *pairs = data + prefix_size;
+  const char *suffix = key + prefix_size;
+  if (suffix_size > 0 && suffix_size <= sizeof(uint64_t) && stride >= sizeof(uint64_t)) {
+    return SearchIntegerKey(pairs, stride, begin, end, suffix, suffix_size, true, upper);
+  }
+  int n = end - begin;
+  while (n > 1) {
+    int half = n / 2;
+    cmp = memcmp(pairs + (begin + half) * stride, suffix, suffix_size);
+    begin += half * static_cast<int>(upper ? cmp <= 0 : cmp < 0);
+    n -= half;
+  }
+  cmp = memcmp(pairs + begin * stride, suffix, suffix_size);
+  return begin + static_cast<int>(upper ? cmp <= 0 : cmp < 0);
+}
+
 }  // namespace bustub
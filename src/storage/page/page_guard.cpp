@@ -92,4 +92,56 @@ void WritePageGuard::Drop() {
 
 WritePageGuard::~WritePageGuard() { this->Drop(); }  // NOLINT
 
+OptimisticReadGuard::OptimisticReadGuard(BufferPoolManager *bpm, Page *page) : guard_(bpm, page) {
+  if (nullptr == page) {
+    return;
+  }
+  version_ = page->GetVersion();
+  if ((version_ & 1) != 0) {
+    // a writer holds the page, wait for it on the latch rather than spinning
+    page->RLatch();
+    version_ = page->GetVersion();
+    page->RUnlatch();
+  }
+}
+
+OptimisticReadGuard::OptimisticReadGuard(OptimisticReadGuard &&that) noexcept = default;
+
+auto OptimisticReadGuard::operator=(OptimisticReadGuard &&that) noexcept -> OptimisticReadGuard & {
+  if (this != &that) {
+    this->guard_ = std::move(that.guard_);
+    this->version_ = that.version_;
+  }
+  return *this;
+}
+
+void OptimisticReadGuard::Drop() { guard_.Drop(); }
+
+OptimisticReadGuard::~OptimisticReadGuard() { this->Drop(); }  // NOLINT
+
+auto OptimisticReadGuard::UpgradeRead(ReadPageGuard *guard) -> bool {
+  guard_.page_->RLatch();
+  if (!guard_.page_->ValidateVersion(version_)) {
+    guard_.page_->RUnlatch();
+    Drop();
+    return false;
+  }
+  guard->Drop();
+  guard->guard_ = std::move(guard_);
+  return true;
+}
+
+auto OptimisticReadGuard::UpgradeWrite(WritePageGuard *guard) -> bool {
+  guard_.page_->WLatch();
+  // taking the write latch bumped the version once
+  if (!guard_.page_->ValidateVersion(version_ + 1)) {
+    guard_.page_->WUnlatch();
+    Drop();
+    return false;
+  }
+  guard->Drop();
+  guard->guard_ = std::move(guard_);
+  return true;
+}
+
 }  // namespace bustub
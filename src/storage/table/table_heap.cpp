@@ -28,7 +28,7 @@ namespace bustub {
 
 TableHeap::TableHeap(BufferPoolManager *bpm) : bpm_(bpm) {
   // Initialize the first table page.
-  auto guard = bpm->NewPageGuarded(&first_page_id_);
+  auto guard = BasicPageGuard{bpm_, NewTablePage(&first_page_id_)};
   last_page_id_ = first_page_id_;
   auto first_page = guard.AsMut<TablePage>();
   BUSTUB_ASSERT(first_page != nullptr,
@@ -37,6 +37,25 @@ TableHeap::TableHeap(BufferPoolManager *bpm) : bpm_(bpm) {
   first_page->Init();
 }
 
+TableHeap::~TableHeap() {
+  for (page_id_t page_id = extent_next_; page_id < extent_end_; ++page_id) {
+    bpm_->DeletePage(page_id);
+  }
+}
+
+auto TableHeap::NewTablePage(page_id_t *page_id) -> Page * {
+  if (extent_next_ == extent_end_) {
+    extent_next_ = bpm_->AllocateExtent(TABLE_HEAP_EXTENT_PAGES);
+    extent_end_ = extent_next_ + TABLE_HEAP_EXTENT_PAGES;
+  }
+  Page *page = bpm_->NewPageAt(extent_next_);
+  if (page == nullptr) {
+    return nullptr;
+  }
+  *page_id = extent_next_++;
+  return page;
+}
+
 auto TableHeap::InsertTuple(const TupleMeta &meta, const Tuple &tuple,
                             LockManager *lock_mgr, Transaction *txn,
                             table_oid_t oid) -> std::optional<RID> {
@@ -54,7 +73,7 @@ auto TableHeap::InsertTuple(const TupleMeta &meta, const Tuple &tuple,
                   "tuple is too large, cannot insert");
 
     page_id_t next_page_id = INVALID_PAGE_ID;
-    auto npg = bpm_->NewPage(&next_page_id);
+    auto npg = NewTablePage(&next_page_id);
     BUSTUB_ENSURE(next_page_id != INVALID_PAGE_ID, "cannot allocate page");
 
     page->SetNextPageId(next_page_id);
@@ -97,8 +116,8 @@ void TableHeap::UpdateTupleMeta(const TupleMeta &meta, RID rid) {
   page->UpdateTupleMeta(meta, rid);
 }
 
-auto TableHeap::GetTuple(RID rid) -> std::pair<TupleMeta, Tuple> {
-  auto page_guard = bpm_->FetchPageRead(rid.GetPageId());
+auto TableHeap::GetTuple(RID rid, AccessType access_type) -> std::pair<TupleMeta, Tuple> {
+  auto page_guard = bpm_->FetchPageRead(rid.GetPageId(), access_type);
   auto page = page_guard.As<TablePage>();
   auto [meta, tuple] = page->GetTuple(rid);
   tuple.rid_ = rid;
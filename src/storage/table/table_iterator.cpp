@@ -21,10 +21,11 @@
 namespace bustub {
 
 TableIterator::TableIterator(TableHeap *table_heap, RID rid, RID stop_at_rid)
-    : table_heap_(table_heap), rid_(rid), stop_at_rid_(stop_at_rid) {
+    : table_heap_(table_heap), rid_(rid), stop_at_rid_(stop_at_rid), read_ahead_(table_heap->bpm_) {
+  read_ahead_.Advance(rid_.GetPageId());
   // If the rid doesn't correspond to a tuple (i.e., the table has just been
   // initialized), then we set rid_ to invalid.
-  auto page_guard = table_heap_->bpm_->FetchPageRead(rid_.GetPageId());
+  auto page_guard = table_heap_->bpm_->FetchPageRead(rid_.GetPageId(), AccessType::Scan);
   auto page = page_guard.As<TablePage>();
   if (rid_.GetSlotNum() >= page->GetNumTuples()) {
     rid_ = RID{INVALID_PAGE_ID, 0};
@@ -32,7 +33,7 @@ TableIterator::TableIterator(TableHeap *table_heap, RID rid, RID stop_at_rid)
 }
 
 auto TableIterator::GetTuple() -> std::pair<TupleMeta, Tuple> {
-  return table_heap_->GetTuple(rid_);
+  return table_heap_->GetTuple(rid_, AccessType::Scan);
 }
 
 auto TableIterator::GetRID() -> RID { return rid_; }
@@ -42,7 +43,7 @@ auto TableIterator::IsEnd() -> bool {
 }
 
 auto TableIterator::operator++() -> TableIterator & {
-  auto page_guard = table_heap_->bpm_->FetchPageRead(rid_.GetPageId());
+  auto page_guard = table_heap_->bpm_->FetchPageRead(rid_.GetPageId(), AccessType::Scan);
   auto page = page_guard.As<TablePage>();
   auto next_tuple_id = rid_.GetSlotNum() + 1;
 
@@ -67,6 +68,7 @@ auto TableIterator::operator++() -> TableIterator & {
     // if next page is invalid, RID is set to invalid page; otherwise, it's the
     // first tuple in that page.
     rid_ = RID{next_page_id, 0};
+    read_ahead_.Advance(next_page_id);
   }
 
   page_guard.Drop();
@@ -12,10 +12,13 @@
 
 #include <cassert>
 #include <cstdlib>
+#include <cstring>
 #include <sstream>
 #include <string>
 #include <vector>
 
+#include "common/exception.h"
+#include "common/macros.h"
 #include "storage/table/tuple.h"
 
 namespace bustub {
@@ -79,6 +82,97 @@ auto Tuple::KeyFromTuple(const Schema &schema, const Schema &key_schema,
   return {values, &key_schema};
 }
 
+/** Write the low width bytes of value, most significant first. */
+static auto AppendBigEndian(uint64_t value, uint32_t width, char *storage,
+                            uint32_t size, uint32_t offset) -> uint32_t {
+  if (width > size - offset) {
+    // a truncated key would compare equal to every key sharing its prefix
+    throw Exception(ExceptionType::OUT_OF_RANGE,
+                    "key does not fit in " + std::to_string(size) +
+                        " bytes once normalized");
+  }
+  for (uint32_t i = 0; i < width; i++) {
+    storage[offset++] = static_cast<char>(value >> (8 * (width - 1 - i)));
+  }
+  return offset;
+}
+
+/** Write a signed integer with its sign bit flipped, so that negative numbers
+ * sort before positive ones. */
+static auto AppendSigned(int64_t value, uint32_t width, char *storage,
+                         uint32_t size, uint32_t offset) -> uint32_t {
+  uint64_t flipped = static_cast<uint64_t>(value) ^ (1ULL << (8 * width - 1));
+  return AppendBigEndian(flipped, width, storage, size, offset);
+}
+
+/*
+ * Normalized key format, column after column:
+ * - integers and booleans: big-endian with the sign bit flipped
+ * - decimals: big-endian IEEE 754 bits, all of them flipped if negative and
+ *   only the sign bit otherwise
+ * - timestamps: big-endian
+ * - varchars: a null prefix, 0 for NULL and 1 otherwise, then the characters
+ *   with every 0 written as 0 1, ended by 0 0
+ * Fixed-size types keep their NULL in the value itself (e.g. BUSTUB_INT32_NULL)
+ * and need no null prefix, so a key of one BIGINT still fits in 8 bytes.
+ * A key that doesn't fit in size bytes throws OUT_OF_RANGE, the rest of
+ * storage is zeroed.
+ */
+void Tuple::NormalizeKeyTo(const Schema *key_schema, char *storage,
+                           uint32_t size) const {
+  memset(storage, 0, size);
+  uint32_t offset = 0;
+  for (uint32_t i = 0; i < key_schema->GetColumnCount(); i++) {
+    Value value = GetValue(key_schema, i);
+    switch (value.GetTypeId()) {
+    case TypeId::BOOLEAN:
+    case TypeId::TINYINT:
+      offset = AppendSigned(value.GetAs<int8_t>(), 1, storage, size, offset);
+      break;
+    case TypeId::SMALLINT:
+      offset = AppendSigned(value.GetAs<int16_t>(), 2, storage, size, offset);
+      break;
+    case TypeId::INTEGER:
+      offset = AppendSigned(value.GetAs<int32_t>(), 4, storage, size, offset);
+      break;
+    case TypeId::BIGINT:
+      offset = AppendSigned(value.GetAs<int64_t>(), 8, storage, size, offset);
+      break;
+    case TypeId::DECIMAL: {
+      auto bits = value.GetAs<uint64_t>();
+      bits = (bits >> 63) != 0 ? ~bits : bits ^ (1ULL << 63);
+      offset = AppendBigEndian(bits, 8, storage, size, offset);
+      break;
+    }
+    case TypeId::TIMESTAMP:
+      offset =
+          AppendBigEndian(value.GetAs<uint64_t>(), 8, storage, size, offset);
+      break;
+    case TypeId::VARCHAR: {
+      if (value.IsNull()) {
+        offset = AppendBigEndian(0, 1, storage, size, offset);
+        break;
+      }
+      offset = AppendBigEndian(1, 1, storage, size, offset);
+      // the length counts the terminating '\0'
+      uint32_t length = value.GetLength() > 0 ? value.GetLength() - 1 : 0;
+      const char *data = value.GetData();
+      for (uint32_t j = 0; j < length; j++) {
+        offset = AppendBigEndian(static_cast<uint8_t>(data[j]), 1, storage,
+                                 size, offset);
+        if (data[j] == '\0') {
+          offset = AppendBigEndian(1, 1, storage, size, offset);
+        }
+      }
+      offset = AppendBigEndian(0, 2, storage, size, offset);
+      break;
+    }
+    default:
+      UNREACHABLE("cannot normalize a key of this type");
+    }
+  }
+}
+
 auto Tuple::GetDataPtr(const Schema *schema, const uint32_t column_idx) const
     -> const char * {
   assert(schema);
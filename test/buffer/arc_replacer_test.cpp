@@ -0,0 +1,83 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// arc_replacer_test.cpp
+//
+// Identification: test/buffer/arc_replacer_test.cpp
+//
+// Copyright (c) 2015-2023, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <cstdio>
+#include <thread> // NOLINT
+#include <vector>
+
+#include "buffer/arc_replacer.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+TEST(ArcReplacerTest, SampleTest) {
+  ArcReplacer arc_replacer(4);
+
+  // Scenario: load pages 10-13 into frames 0-3, then read 10 and 11 again.
+  // Now T1 holds [2, 3] and T2 holds [0, 1].
+  for (int i = 0; i < 4; ++i) {
+    arc_replacer.SetPage(i, 10 + i);
+    arc_replacer.RecordAccess(i);
+    arc_replacer.SetEvictable(i, true);
+  }
+  arc_replacer.RecordAccess(0);
+  arc_replacer.RecordAccess(1);
+  ASSERT_EQ(4, arc_replacer.Size());
+
+  // Scenario: T1 is above its target size 0, page 12 goes to B1.
+  int value;
+  ASSERT_TRUE(arc_replacer.Evict(&value));
+  ASSERT_EQ(2, value);
+  ASSERT_EQ(3, arc_replacer.Size());
+
+  // Scenario: page 12 comes back. The B1 hit grows the target of T1 to 1 and
+  // the page goes to T2, which is now [0, 1, 2].
+  arc_replacer.SetPage(2, 12);
+  arc_replacer.RecordAccess(2);
+  arc_replacer.SetEvictable(2, true);
+
+  // Scenario: T1 = [3] is at its target, so T2 gives up page 10 to B2.
+  ASSERT_TRUE(arc_replacer.Evict(&value));
+  ASSERT_EQ(0, value);
+
+  // Scenario: a new page 20 enters T1 = [3, 0], which is above its target.
+  arc_replacer.SetPage(0, 20);
+  arc_replacer.RecordAccess(0);
+  arc_replacer.SetEvictable(0, true);
+  ASSERT_TRUE(arc_replacer.Evict(&value));
+  ASSERT_EQ(3, value);
+
+  // Scenario: page 10 comes back. The B2 hit shrinks the target of T1 to 0.
+  // T1 = [0], T2 = [1, 2, 3].
+  arc_replacer.SetPage(3, 10);
+  arc_replacer.RecordAccess(3);
+  arc_replacer.SetEvictable(3, true);
+
+  // Scenario: T1 is above target but its only frame is pinned, so the victim
+  // comes from T2. A scan passing over frame 2 doesn't refresh it.
+  arc_replacer.SetEvictable(0, false);
+  arc_replacer.RecordAccess(2, AccessType::Scan);
+  ASSERT_TRUE(arc_replacer.Evict(&value));
+  ASSERT_EQ(1, value);
+  ASSERT_TRUE(arc_replacer.Evict(&value));
+  ASSERT_EQ(2, value);
+
+  // Scenario: removed frames are forgotten, pinned frames are never evicted.
+  arc_replacer.Remove(3);
+  ASSERT_FALSE(arc_replacer.Evict(&value));
+  ASSERT_EQ(0, arc_replacer.Size());
+  arc_replacer.SetEvictable(0, true);
+  ASSERT_TRUE(arc_replacer.Evict(&value));
+  ASSERT_EQ(0, value);
+}
+
+} // namespace bustub
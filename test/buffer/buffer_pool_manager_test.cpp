@@ -11,12 +11,20 @@
 //===----------------------------------------------------------------------===//
 
 #include "buffer/buffer_pool_manager.h"
+#include "buffer/read_ahead.h"
 
 #include <cstdio>
+#include <memory>
 #include <random>
+#include <set>
 #include <string>
+#include <thread>  // NOLINT
+#include <vector>
 
+#include "fmt/format.h"
 #include "gtest/gtest.h"
+#include "storage/disk/async_disk_manager.h"
+#include "storage/disk/disk_manager_memory.h"
 
 namespace bustub {
 
@@ -94,11 +102,586 @@ TEST(BufferPoolManagerTest, BinaryDataTest) {
   // Shutdown the disk manager and remove the temporary file we created.
   disk_manager->ShutDown();
   remove("test.db");
+  remove("test.fsm");
+  remove("test.crc");
 
   delete bpm;
   delete disk_manager;
 }
 
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerTest, ShardedTest) {
+  const size_t buffer_pool_size = 16;
+  const size_t num_instances = 4;
+  const size_t k = 2;
+
+  auto disk_manager = std::make_unique<DiskManagerUnlimitedMemory>();
+  auto bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager.get(), k, nullptr, num_instances);
+  EXPECT_EQ(buffer_pool_size, bpm->GetPoolSize());
+  EXPECT_EQ(num_instances, bpm->GetNumInstances());
+
+  // Scenario: New pages are spread over the instances, so the whole pool can
+  // be filled and every page id is handed out only once.
+  std::set<page_id_t> page_ids;
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    page_id_t page_id;
+    auto *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), BUSTUB_PAGE_SIZE, "page %d", page_id);
+    EXPECT_TRUE(page_ids.insert(page_id).second);
+  }
+  page_id_t page_id_temp;
+  EXPECT_EQ(nullptr, bpm->NewPage(&page_id_temp));
+
+  // Scenario: After unpinning, every page can be evicted and read back through
+  // the instance that owns it.
+  for (auto page_id : page_ids) {
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id_temp));
+    EXPECT_TRUE(bpm->UnpinPage(page_id_temp, false));
+  }
+  for (auto page_id : page_ids) {
+    auto *page = bpm->FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(0, strcmp(page->GetData(), fmt::format("page {}", page_id).c_str()));
+    EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerTest, ReplacerTypeTest) {
+  const size_t buffer_pool_size = 8;
+  const size_t num_pages = 32;
+
+  for (auto replacer_type : {ReplacerType::LRUK, ReplacerType::LRU, ReplacerType::CLOCK, ReplacerType::ARC}) {
+    auto disk_manager = std::make_unique<DiskManagerUnlimitedMemory>();
+    auto bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager.get(), 2, nullptr, 2,
+                                                   replacer_type);
+
+    // Scenario: every policy gives up unpinned frames, so more pages than
+    // frames can be created and read back, with scans and lookups mixed.
+    std::vector<page_id_t> page_ids;
+    for (size_t i = 0; i < num_pages; ++i) {
+      page_id_t page_id;
+      auto *page = bpm->NewPage(&page_id);
+      ASSERT_NE(nullptr, page);
+      snprintf(page->GetData(), BUSTUB_PAGE_SIZE, "page %d", page_id);
+      EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+      page_ids.push_back(page_id);
+    }
+    for (size_t round = 0; round < 3; ++round) {
+      for (size_t i = 0; i < num_pages; ++i) {
+        auto access_type = i % 3 == 0 ? AccessType::Get : AccessType::Scan;
+        auto *page = bpm->FetchPage(page_ids[i], access_type);
+        ASSERT_NE(nullptr, page);
+        EXPECT_EQ(0, strcmp(page->GetData(), fmt::format("page {}", page_ids[i]).c_str()));
+        EXPECT_TRUE(bpm->UnpinPage(page_ids[i], false));
+      }
+    }
+
+    // Scenario: pinned pages are never chosen as victims.
+    for (size_t i = 0; i < buffer_pool_size; ++i) {
+      ASSERT_NE(nullptr, bpm->FetchPage(page_ids[i]));
+    }
+    page_id_t page_id_temp;
+    EXPECT_EQ(nullptr, bpm->NewPage(&page_id_temp));
+    EXPECT_EQ(nullptr, bpm->FetchPage(page_ids[buffer_pool_size]));
+    for (size_t i = 0; i < buffer_pool_size; ++i) {
+      EXPECT_TRUE(bpm->UnpinPage(page_ids[i], false));
+    }
+    EXPECT_TRUE(bpm->DeletePage(page_ids[0]));
+  }
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerTest, FlushTest) {
+  const size_t buffer_pool_size = 16;
+
+  auto disk_manager = std::make_unique<DiskManagerUnlimitedMemory>();
+  auto bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager.get(), 2, nullptr, 2);
+  std::vector<page_id_t> page_ids;
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    page_id_t page_id;
+    auto *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), BUSTUB_PAGE_SIZE, "page %d", page_id);
+    EXPECT_TRUE(bpm->UnpinPage(page_id, i % 2 == 0));
+    page_ids.push_back(page_id);
+  }
+
+  // Scenario: FlushAllPages only writes the dirty pages, and only once.
+  EXPECT_EQ(0, disk_manager->GetNumPageWrites());
+  bpm->FlushAllPages();
+  EXPECT_EQ(buffer_pool_size / 2, disk_manager->GetNumPageWrites());
+  bpm->FlushAllPages();
+  EXPECT_EQ(buffer_pool_size / 2, disk_manager->GetNumPageWrites());
+
+  // Scenario: once more frames than the high watermark are dirty, the
+  // background flusher writes them back down to the low watermark, without
+  // touching pinned pages.
+  ASSERT_NE(nullptr, bpm->FetchPage(page_ids[0]));
+  for (auto page_id : page_ids) {
+    ASSERT_NE(nullptr, bpm->FetchPage(page_id));
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+  uint64_t writes = disk_manager->GetNumPageWrites();
+  bpm->StartBackgroundFlush(0.5, 0.0);
+  for (int i = 0; i < 1000 && disk_manager->GetNumPageWrites() < writes + buffer_pool_size - 1; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  EXPECT_EQ(writes + buffer_pool_size - 1, disk_manager->GetNumPageWrites());
+  EXPECT_TRUE(bpm->UnpinPage(page_ids[0], false));
+  bpm->FlushAllPages();
+  EXPECT_EQ(writes + buffer_pool_size, disk_manager->GetNumPageWrites());
+  for (auto page_id : page_ids) {
+    auto *page = bpm->FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(0, strcmp(page->GetData(), fmt::format("page {}", page_id).c_str()));
+    EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerTest, PrefetchTest) {
+  const size_t buffer_pool_size = 32;
+  const size_t num_pages = 64;
+
+  auto disk_manager = std::make_unique<DiskManagerUnlimitedMemory>();
+  auto bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager.get(), 2, nullptr, 2);
+  std::vector<page_id_t> page_ids;
+  for (size_t i = 0; i < num_pages; ++i) {
+    page_id_t page_id;
+    auto *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), BUSTUB_PAGE_SIZE, "page %d", page_id);
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+    page_ids.push_back(page_id);
+  }
+  auto wait_for_reads = [&disk_manager](uint64_t reads) {
+    for (int i = 0; i < 1000 && disk_manager->GetNumReads() < reads; ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return disk_manager->GetNumReads();
+  };
+
+  // Scenario: prefetching is a no-op until the prefetch threads are started.
+  bpm->PrefetchPages(0, 8);
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_EQ(0, disk_manager->GetNumReads());
+
+  // Scenario: prefetched pages are read once, and fetching them afterwards hits.
+  bpm->StartPrefetch();
+  bpm->PrefetchPages(0, 8);
+  EXPECT_EQ(8, wait_for_reads(8));
+  for (page_id_t page_id = 0; page_id < 8; ++page_id) {
+    auto *page = bpm->FetchPage(page_id, AccessType::Scan);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(0, strcmp(page->GetData(), fmt::format("page {}", page_id).c_str()));
+    EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+  EXPECT_EQ(8, disk_manager->GetNumReads());
+
+  // Scenario: pages that were never allocated are not read.
+  bpm->PrefetchPages(num_pages, 8);
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_EQ(8, disk_manager->GetNumReads());
+
+  // Scenario: read-ahead prefetches the pages ahead of a scan following
+  // consecutive page ids, so that only the first pages of the scan miss.
+  ReadAhead read_ahead(bpm.get());
+  uint64_t misses = 0;
+  for (page_id_t page_id = 16; page_id < 40; ++page_id) {
+    read_ahead.Advance(page_id);
+    // let the prefetch threads settle
+    uint64_t reads;
+    do {
+      reads = disk_manager->GetNumReads();
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    } while (reads != disk_manager->GetNumReads());
+    auto *page = bpm->FetchPage(page_id, AccessType::Scan);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(0, strcmp(page->GetData(), fmt::format("page {}", page_id).c_str()));
+    EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+    if (disk_manager->GetNumReads() > reads) {
+      misses++;
+    }
+  }
+  EXPECT_EQ(READ_AHEAD_TRIGGER + 1, misses);
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerTest, AsyncPrefetchTest) {
+  const size_t buffer_pool_size = 32;
+  const page_id_t num_pages = 16;
+  remove("test.db");
+  remove("test.fsm");
+  remove("test.crc");
+
+  auto disk_manager = std::make_unique<AsyncDiskManager>("test.db");
+  auto bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager.get(), 2, nullptr, 2);
+  for (page_id_t i = 0; i < num_pages; ++i) {
+    page_id_t page_id;
+    auto *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), BUSTUB_PAGE_SIZE, "page %d", page_id);
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+  bpm->FlushAllPages();
+  bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager.get(), 2, nullptr, 2);
+
+  // Scenario: a batch of prefetches is read asynchronously, fetching the pages afterwards hits.
+  bpm->StartPrefetch(1);
+  bpm->PrefetchPages(0, num_pages);
+  BufferPoolStats stats;
+  for (int i = 0; i < 1000 && stats.read_latency_.GetCount() < static_cast<uint64_t>(num_pages); ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    stats.Reset();
+    bpm->CollectStats(&stats);
+  }
+  EXPECT_EQ(num_pages, stats.read_latency_.GetCount());
+  for (page_id_t page_id = 0; page_id < num_pages; ++page_id) {
+    auto *page = bpm->FetchPage(page_id, AccessType::Scan);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(fmt::format("page {}", page_id), std::string(page->GetData()));
+    EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+  stats.Reset();
+  bpm->CollectStats(&stats);
+  EXPECT_EQ(0, stats.misses_);
+
+  bpm.reset();
+  disk_manager->ShutDown();
+  disk_manager.reset();
+  remove("test.db");
+  remove("test.fsm");
+  remove("test.crc");
+  remove("test.log");
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerTest, ConcurrentMissTest) {
+  const size_t buffer_pool_size = 4;
+  const int num_pages = 16;
+  const int num_threads = 8;
+
+  auto disk_manager = std::make_unique<DiskManagerUnlimitedMemory>();
+  auto bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager.get(), 2);
+  for (int i = 0; i < num_pages; ++i) {
+    page_id_t page_id;
+    auto *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), BUSTUB_PAGE_SIZE, "page %d", page_id);
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+  disk_manager->SetLatency(1);
+
+  // Scenario: Threads missing on the same pages at the same time, while dirty
+  // victims are written back, must all observe the data of the page they asked for.
+  std::vector<std::thread> threads;
+  std::atomic<int> mismatches{0};
+  for (int tid = 0; tid < num_threads; ++tid) {
+    threads.emplace_back([&bpm, &mismatches, tid] {
+      for (int i = 0; i < num_pages * 2; ++i) {
+        page_id_t page_id = (i + tid / 2) % num_pages;
+        auto *page = bpm->FetchPage(page_id);
+        if (page == nullptr) {
+          continue;
+        }
+        if (strcmp(page->GetData(), fmt::format("page {}", page_id).c_str()) != 0) {
+          mismatches++;
+        }
+        bpm->UnpinPage(page_id, i % 3 == 0);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(0, mismatches);
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerTest, ConcurrentHitTest) {
+  const size_t buffer_pool_size = 8;
+  const int num_hot_pages = 4;
+  const int num_cold_pages = 32;
+  const int num_threads = 8;
+
+  auto disk_manager = std::make_unique<DiskManagerUnlimitedMemory>();
+  auto bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager.get(), 2);
+  for (int i = 0; i < num_hot_pages + num_cold_pages; ++i) {
+    page_id_t page_id;
+    auto *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), BUSTUB_PAGE_SIZE, "page %d", page_id);
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+
+  // Scenario: Threads hitting a few hot pages without the latch race with threads
+  // that keep evicting frames by reading cold pages. Every fetched page must hold
+  // its own data and stay pinned until it is unpinned.
+  std::vector<std::thread> threads;
+  std::atomic<int> mismatches{0};
+  for (int tid = 0; tid < num_threads; ++tid) {
+    threads.emplace_back([&bpm, &mismatches, tid] {
+      for (int i = 0; i < 500; ++i) {
+        page_id_t page_id = tid % 2 == 0 ? (i + tid) % num_hot_pages : num_hot_pages + (i + tid) % num_cold_pages;
+        auto *page = bpm->FetchPage(page_id);
+        if (page == nullptr) {
+          continue;
+        }
+        if (page->GetPageId() != page_id ||
+            strcmp(page->GetData(), fmt::format("page {}", page_id).c_str()) != 0) {
+          mismatches++;
+        }
+        std::this_thread::yield();
+        if (page->GetPageId() != page_id) {
+          mismatches++;
+        }
+        EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(0, mismatches);
+
+  // Every pin has been dropped, so the whole pool can be turned over again.
+  for (int i = 0; i < num_hot_pages + num_cold_pages; ++i) {
+    auto *page = bpm->FetchPage(i);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(1, page->GetPinCount());
+    EXPECT_TRUE(bpm->UnpinPage(i, false));
+  }
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerTest, HitHistoryTest) {
+  const size_t buffer_pool_size = 3;
+
+  auto disk_manager = std::make_unique<DiskManagerUnlimitedMemory>();
+  auto bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager.get(), 2);
+  std::vector<page_id_t> page_ids;
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    page_id_t page_id;
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+    page_ids.push_back(page_id);
+  }
+
+  // Scenario: Hits on resident pages take no latch, but the replacer still sees every one of them at the time it
+  // happened. Page 0 is hit twice and page 1 once, so page 2 is the only page with an infinite k-distance.
+  for (int i : {0, 0, 1}) {
+    ASSERT_NE(nullptr, bpm->FetchPage(page_ids[i]));
+    EXPECT_TRUE(bpm->UnpinPage(page_ids[i], false));
+  }
+  page_id_t pinned_page_id;
+  ASSERT_NE(nullptr, bpm->NewPage(&pinned_page_id));
+
+  // Scenario: Of pages 0 and 1, the second to last access of page 1 is older, so it goes next.
+  page_id_t page_id;
+  ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+  EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+  bpm->ResetStats();
+  ASSERT_NE(nullptr, bpm->FetchPage(page_ids[0]));
+  EXPECT_TRUE(bpm->UnpinPage(page_ids[0], false));
+  BufferPoolStats stats;
+  bpm->CollectStats(&stats);
+  EXPECT_EQ(1, stats.hits_);
+  EXPECT_EQ(0, stats.misses_);
+
+  // Scenario: A pinned page is never evicted. Once unpinned, its frame is evictable again.
+  for (size_t i = 0; i < buffer_pool_size - 1; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+  }
+  EXPECT_EQ(nullptr, bpm->NewPage(&page_id));
+  EXPECT_TRUE(bpm->UnpinPage(pinned_page_id, false));
+  EXPECT_NE(nullptr, bpm->NewPage(&page_id));
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerTest, SwipTest) {
+  const size_t buffer_pool_size = 4;
+
+  auto disk_manager = std::make_unique<DiskManagerUnlimitedMemory>();
+  auto bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager.get(), 2);
+  std::vector<page_id_t> page_ids;
+  for (size_t i = 0; i < 2 * buffer_pool_size; ++i) {
+    page_id_t page_id;
+    auto *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), BUSTUB_PAGE_SIZE, "page %d", page_id);
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+    page_ids.push_back(page_id);
+  }
+
+  // Scenario: The first fetch through an empty swip points it at the frame, the next one pins that frame directly.
+  std::atomic<Page *> swip{nullptr};
+  auto *page = bpm->FetchPage(page_ids[0], &swip);
+  ASSERT_NE(nullptr, page);
+  EXPECT_EQ(page, swip.load());
+  EXPECT_TRUE(bpm->UnpinPage(page_ids[0], false));
+  EXPECT_EQ(page, bpm->FetchPage(page_ids[0], &swip));
+  EXPECT_EQ(1, page->GetPinCount());
+  EXPECT_TRUE(bpm->UnpinPage(page_ids[0], false));
+
+  // Scenario: Once the page is evicted, the stale swip is noticed and repointed.
+  for (size_t i = 1; i < page_ids.size(); ++i) {
+    ASSERT_NE(nullptr, bpm->FetchPage(page_ids[i]));
+    EXPECT_TRUE(bpm->UnpinPage(page_ids[i], false));
+  }
+  page = bpm->FetchPage(page_ids[0], &swip);
+  ASSERT_NE(nullptr, page);
+  EXPECT_EQ(page_ids[0], page->GetPageId());
+  EXPECT_EQ(0, strcmp(page->GetData(), fmt::format("page {}", page_ids[0]).c_str()));
+  EXPECT_EQ(page, swip.load());
+
+  // Scenario: A swip pointing at the frame of another page is ignored.
+  swip = page;
+  auto *other = bpm->FetchPage(page_ids[1], &swip);
+  ASSERT_NE(nullptr, other);
+  EXPECT_EQ(page_ids[1], other->GetPageId());
+  EXPECT_NE(page, other);
+  EXPECT_EQ(1, page->GetPinCount());
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerTest, StatsTest) {
+  const size_t buffer_pool_size = 4;
+
+  auto disk_manager = std::make_unique<DiskManagerUnlimitedMemory>();
+  auto bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager.get(), 2, nullptr, 2);
+  std::vector<page_id_t> page_ids;
+  for (size_t i = 0; i < 2 * buffer_pool_size; ++i) {
+    page_id_t page_id;
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+    page_ids.push_back(page_id);
+  }
+  BufferPoolStats stats;
+  bpm->CollectStats(&stats);
+  EXPECT_EQ(0, stats.hits_ + stats.misses_);
+  EXPECT_EQ(buffer_pool_size, stats.evictions_);
+  EXPECT_EQ(buffer_pool_size, stats.write_backs_);
+
+  // Scenario: fetches of resident pages count as hits, the others as misses timed by the read histogram.
+  bpm->ResetStats();
+  for (auto it = page_ids.rbegin(); it != page_ids.rend(); ++it) {
+    ASSERT_NE(nullptr, bpm->FetchPage(*it));
+    EXPECT_TRUE(bpm->UnpinPage(*it, false));
+  }
+  stats.Reset();
+  bpm->CollectStats(&stats);
+  EXPECT_EQ(buffer_pool_size, stats.hits_);
+  EXPECT_EQ(buffer_pool_size, stats.misses_);
+  EXPECT_DOUBLE_EQ(0.5, stats.GetHitRate());
+  EXPECT_EQ(buffer_pool_size, stats.read_latency_.GetCount());
+  EXPECT_EQ(stats.misses_, bpm->GetInstanceStats(0).misses_ + bpm->GetInstanceStats(1).misses_);
+  auto lines = bpm->StatsToString();
+  EXPECT_EQ(0, lines.rfind("pool: hits=4 misses=4", 0)) << lines;
+  EXPECT_NE(std::string::npos, lines.find("shard 1: "));
+
+  // Scenario: histogram percentiles are upper bounds of power-of-two buckets.
+  LatencyHistogram histogram;
+  EXPECT_EQ(0, histogram.GetPercentile(0.5));
+  for (int64_t ns : {0, 3, 100, 100, 5000}) {
+    histogram.Record(std::chrono::nanoseconds(ns));
+  }
+  EXPECT_EQ(5, histogram.GetCount());
+  EXPECT_EQ(1040, histogram.GetMean());
+  EXPECT_EQ(127, histogram.GetPercentile(0.5));
+  EXPECT_EQ(8191, histogram.GetPercentile(1.0));
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerTest, ResizeTest) {
+  const size_t buffer_pool_size = 4;
+
+  auto disk_manager = std::make_unique<DiskManagerUnlimitedMemory>();
+  auto bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager.get(), 2, nullptr, 2,
+                                                 ReplacerType::LRUK, 16);
+  EXPECT_EQ(16, bpm->GetMaxPoolSize());
+  EXPECT_FALSE(bpm->Resize(1));
+  EXPECT_FALSE(bpm->Resize(17));
+  EXPECT_EQ(buffer_pool_size, bpm->GetPoolSize());
+
+  // Scenario: after growing, as many pages as the new size can be pinned at once.
+  ASSERT_TRUE(bpm->Resize(12));
+  EXPECT_EQ(12, bpm->GetPoolSize());
+  std::vector<page_id_t> page_ids;
+  for (size_t i = 0; i < 12; ++i) {
+    page_id_t page_id;
+    auto *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), BUSTUB_PAGE_SIZE, "page %d", page_id);
+    page_ids.push_back(page_id);
+  }
+  for (page_id_t page_id : page_ids) {
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+
+  // Scenario: shrinking writes the dirty pages of the dropped frames back, their data stays readable.
+  ASSERT_TRUE(bpm->Resize(buffer_pool_size));
+  EXPECT_EQ(buffer_pool_size, bpm->GetPoolSize());
+  for (page_id_t page_id : page_ids) {
+    auto *page = bpm->FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(fmt::format("page {}", page_id), std::string(page->GetData()));
+    EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+
+  // Scenario: after shrinking, no more pages than the new size can be pinned at once.
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    ASSERT_NE(nullptr, bpm->FetchPage(page_ids[i]));
+  }
+  EXPECT_EQ(nullptr, bpm->FetchPage(page_ids[buffer_pool_size]));
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    EXPECT_TRUE(bpm->UnpinPage(page_ids[i], false));
+  }
+
+  // Scenario: the pool can be resized while other threads fetch pages.
+  std::atomic<bool> done{false};
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < 4; ++t) {
+    threads.emplace_back([&bpm, &page_ids, &done, t]() {
+      std::mt19937 gen(t);
+      while (!done) {
+        page_id_t page_id = page_ids[gen() % page_ids.size()];
+        auto *page = bpm->FetchPage(page_id);
+        if (page != nullptr) {
+          EXPECT_EQ(fmt::format("page {}", page_id), std::string(page->GetData()));
+          EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+        }
+      }
+    });
+  }
+  for (size_t size : {16, 2, 9, 4, 12, 3}) {
+    ASSERT_TRUE(bpm->Resize(size));
+  }
+  done = true;
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(3, bpm->GetPoolSize());
+
+  // Scenario: without a maximum size, the pool can shrink and grow back, but not beyond its initial size.
+  bpm->FlushAllPages();
+  bpm.reset();
+  bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager.get(), 2);
+  EXPECT_EQ(buffer_pool_size, bpm->GetMaxPoolSize());
+  EXPECT_FALSE(bpm->Resize(buffer_pool_size + 1));
+  ASSERT_TRUE(bpm->Resize(1));
+  ASSERT_TRUE(bpm->Resize(buffer_pool_size));
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    auto *page = bpm->FetchPage(page_ids[i]);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(fmt::format("page {}", page_ids[i]), std::string(page->GetData()));
+  }
+}
+
 // NOLINTNEXTLINE
 TEST(BufferPoolManagerTest, DISABLED_SampleTest) {
   const std::string db_name = "test.db";
@@ -153,6 +736,8 @@ TEST(BufferPoolManagerTest, DISABLED_SampleTest) {
   // Shutdown the disk manager and remove the temporary file we created.
   disk_manager->ShutDown();
   remove("test.db");
+  remove("test.fsm");
+  remove("test.crc");
 
   delete bpm;
   delete disk_manager;
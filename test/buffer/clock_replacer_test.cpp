@@ -19,45 +19,72 @@
 
 namespace bustub {
 
-TEST(ClockReplacerTest, DISABLED_SampleTest) {
+TEST(ClockReplacerTest, SampleTest) {
   ClockReplacer clock_replacer(7);
 
-  // Scenario: unpin six elements, i.e. add them to the replacer.
-  clock_replacer.Unpin(1);
-  clock_replacer.Unpin(2);
-  clock_replacer.Unpin(3);
-  clock_replacer.Unpin(4);
-  clock_replacer.Unpin(5);
-  clock_replacer.Unpin(6);
-  clock_replacer.Unpin(1);
+  // Scenario: add six frames to the replacer, frame 1 is accessed twice.
+  for (int i = 1; i <= 6; ++i) {
+    clock_replacer.RecordAccess(i);
+    clock_replacer.SetEvictable(i, true);
+  }
+  clock_replacer.RecordAccess(1);
   EXPECT_EQ(6, clock_replacer.Size());
 
-  // Scenario: get three victims from the clock.
+  // Scenario: get three victims from the clock. The first sweep only clears
+  // the reference bits.
   int value;
-  clock_replacer.Victim(&value);
+  clock_replacer.Evict(&value);
   EXPECT_EQ(1, value);
-  clock_replacer.Victim(&value);
+  clock_replacer.Evict(&value);
   EXPECT_EQ(2, value);
-  clock_replacer.Victim(&value);
+  clock_replacer.Evict(&value);
   EXPECT_EQ(3, value);
 
-  // Scenario: pin elements in the replacer.
-  // Note that 3 has already been victimized, so pinning 3 should have no
-  // effect.
-  clock_replacer.Pin(3);
-  clock_replacer.Pin(4);
+  // Scenario: pin frame 4. Note that 3 has already been evicted, so removing
+  // 3 should have no effect.
+  clock_replacer.Remove(3);
+  clock_replacer.SetEvictable(4, false);
   EXPECT_EQ(2, clock_replacer.Size());
 
-  // Scenario: unpin 4. We expect that the reference bit of 4 will be set to 1.
-  clock_replacer.Unpin(4);
+  // Scenario: access and unpin 4. We expect that the reference bit of 4 will
+  // be set to 1.
+  clock_replacer.RecordAccess(4);
+  clock_replacer.SetEvictable(4, true);
 
   // Scenario: continue looking for victims. We expect these victims.
-  clock_replacer.Victim(&value);
+  clock_replacer.Evict(&value);
   EXPECT_EQ(5, value);
-  clock_replacer.Victim(&value);
+  clock_replacer.Evict(&value);
   EXPECT_EQ(6, value);
-  clock_replacer.Victim(&value);
+  clock_replacer.Evict(&value);
   EXPECT_EQ(4, value);
+  EXPECT_FALSE(clock_replacer.Evict(&value));
+}
+
+TEST(ClockReplacerTest, ScanTest) {
+  ClockReplacer clock_replacer(4);
+
+  // Scenario: frames 0 and 1 are read by lookups, 2 and 3 by a scan, which
+  // also passes over frame 0.
+  clock_replacer.RecordAccess(0);
+  clock_replacer.RecordAccess(1);
+  clock_replacer.RecordAccess(2, AccessType::Scan);
+  clock_replacer.RecordAccess(3, AccessType::Scan);
+  clock_replacer.RecordAccess(0, AccessType::Scan);
+  for (int i = 0; i < 4; ++i) {
+    clock_replacer.SetEvictable(i, true);
+  }
+
+  // Scenario: the scanned frames go on the first sweep.
+  int value;
+  clock_replacer.Evict(&value);
+  EXPECT_EQ(2, value);
+  clock_replacer.Evict(&value);
+  EXPECT_EQ(3, value);
+  clock_replacer.Evict(&value);
+  EXPECT_EQ(0, value);
+  clock_replacer.Evict(&value);
+  EXPECT_EQ(1, value);
 }
 
 } // namespace bustub
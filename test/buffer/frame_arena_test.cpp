@@ -0,0 +1,74 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// frame_arena_test.cpp
+//
+// Identification: test/buffer/frame_arena_test.cpp
+//
+// Copyright (c) 2015-2023, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <cstdint>
+#include <cstring>
+#include <set>
+
+#include "buffer/frame_arena.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+TEST(FrameArenaTest, FramesTest) {
+  // Scenario: a pool large enough for huge pages, and a tiny one.
+  for (size_t num_frames : {FrameArena::HUGE_PAGE_SIZE / BUSTUB_PAGE_SIZE + 3, static_cast<size_t>(3)}) {
+    FrameArena arena(num_frames);
+    Page *frames = arena.GetFrames();
+    std::set<char *> data;
+    for (size_t i = 0; i < num_frames; ++i) {
+      char *frame_data = frames[i].GetData();
+      EXPECT_EQ(INVALID_PAGE_ID, frames[i].GetPageId());
+      EXPECT_EQ(0, frames[i].GetPinCount());
+      // every frame starts out zeroed and owns its own BUSTUB_PAGE_SIZE bytes
+      EXPECT_EQ(0, frame_data[0]);
+      EXPECT_EQ(0, frame_data[BUSTUB_PAGE_SIZE - 1]);
+      memset(frame_data, static_cast<int>(i % 128), BUSTUB_PAGE_SIZE);
+      EXPECT_TRUE(data.insert(frame_data).second);
+#ifdef BUSTUB_PAGE_ARENA
+      // the arena is one contiguous run of page-aligned frames
+      EXPECT_EQ(0, reinterpret_cast<uintptr_t>(frame_data) % BUSTUB_PAGE_SIZE);
+      EXPECT_EQ(frames[0].GetData() + i * BUSTUB_PAGE_SIZE, frame_data);
+#endif
+    }
+    for (size_t i = 0; i < num_frames; ++i) {
+      EXPECT_EQ(static_cast<char>(i % 128), frames[i].GetData()[BUSTUB_PAGE_SIZE - 1]);
+    }
+  }
+}
+
+TEST(FrameArenaTest, CommitTest) {
+  const size_t num_frames = 8;
+  FrameArena arena(num_frames, true);
+  Page *frames = arena.GetFrames();
+
+  // Scenario: the pool uses the first half of an arena that can grow, then grows into the rest.
+  arena.Commit(0, num_frames / 2);
+  for (size_t i = 0; i < num_frames / 2; ++i) {
+    EXPECT_EQ(0, frames[i].GetData()[0]);
+    memset(frames[i].GetData(), 1, BUSTUB_PAGE_SIZE);
+  }
+  arena.Commit(0, num_frames);
+  for (size_t i = 0; i < num_frames; ++i) {
+    EXPECT_EQ(i < num_frames / 2 ? 1 : 0, frames[i].GetData()[BUSTUB_PAGE_SIZE - 1]);
+  }
+
+  // Scenario: released frames come back zeroed when the pool grows again.
+  arena.Release(2, num_frames - 2);
+  arena.Commit(2, num_frames - 2);
+  for (size_t i = 0; i < num_frames; ++i) {
+    EXPECT_EQ(i < 2 ? 1 : 0, frames[i].GetData()[0]);
+    EXPECT_EQ(INVALID_PAGE_ID, frames[i].GetPageId());
+  }
+}
+
+}  // namespace bustub
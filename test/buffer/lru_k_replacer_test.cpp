@@ -99,4 +99,115 @@ TEST(LRUKReplacerTest, SampleTest) {
   ASSERT_EQ(false, lru_replacer.Evict(&value));
   ASSERT_EQ(0, lru_replacer.Size());
 }
+
+TEST(LRUKReplacerTest, LargePoolTest) {
+  const size_t num_frames = 100000;
+  LRUKReplacer lru_replacer(num_frames, 2);
+
+  // Scenario: every frame is accessed once, then the first half again. The
+  // second half keeps +inf k-distance and is evicted first in LRU order, then
+  // the first half in order of their 2nd most recent access.
+  for (size_t i = 0; i < num_frames; ++i) {
+    lru_replacer.RecordAccess(i);
+    lru_replacer.SetEvictable(i, true);
+  }
+  for (size_t i = 0; i < num_frames / 2; ++i) {
+    lru_replacer.RecordAccess(i);
+  }
+  ASSERT_EQ(num_frames, lru_replacer.Size());
+
+  // Scenario: pinned frames are skipped and removed frames are forgotten.
+  lru_replacer.SetEvictable(num_frames / 2, false);
+  lru_replacer.Remove(num_frames / 2 + 1);
+  ASSERT_EQ(num_frames - 2, lru_replacer.Size());
+
+  int value;
+  for (size_t i = num_frames / 2 + 2; i < num_frames; ++i) {
+    ASSERT_TRUE(lru_replacer.Evict(&value));
+    ASSERT_EQ(i, value);
+  }
+  for (size_t i = 0; i < num_frames / 2; ++i) {
+    ASSERT_TRUE(lru_replacer.Evict(&value));
+    ASSERT_EQ(i, value);
+  }
+  ASSERT_FALSE(lru_replacer.Evict(&value));
+  ASSERT_EQ(0, lru_replacer.Size());
+}
+
+TEST(LRUKReplacerTest, ScanResistanceTest) {
+  LRUKReplacer lru_replacer(6, 2);
+
+  // Scenario: frames 0-2 hold the working set, each accessed twice.
+  for (int i = 0; i < 3; ++i) {
+    lru_replacer.RecordAccess(i);
+    lru_replacer.RecordAccess(i);
+    lru_replacer.SetEvictable(i, true);
+  }
+  // Scenario: a scan brings in frames 3-5, then passes over frame 0 again.
+  // Frame 4 is hit by a point lookup afterwards and gets promoted.
+  for (int i = 3; i < 6; ++i) {
+    lru_replacer.RecordAccess(i, AccessType::Scan);
+    lru_replacer.SetEvictable(i, true);
+  }
+  lru_replacer.RecordAccess(0, AccessType::Scan);
+  lru_replacer.RecordAccess(4, AccessType::Get);
+  ASSERT_EQ(6, lru_replacer.Size());
+
+  // Scan-only frames go first, oldest first. The promoted frame has +inf
+  // k-distance, then the working set follows unaffected by the scan.
+  int value;
+  lru_replacer.Evict(&value);
+  ASSERT_EQ(3, value);
+  lru_replacer.Evict(&value);
+  ASSERT_EQ(5, value);
+  lru_replacer.Evict(&value);
+  ASSERT_EQ(4, value);
+  lru_replacer.Evict(&value);
+  ASSERT_EQ(0, value);
+  lru_replacer.Evict(&value);
+  ASSERT_EQ(1, value);
+  lru_replacer.Evict(&value);
+  ASSERT_EQ(2, value);
+  ASSERT_EQ(0, lru_replacer.Size());
+}
+
+TEST(LRUKReplacerTest, BatchedAccessTest) {
+  LRUKReplacer lru_replacer(4, 2);
+
+  for (int i = 0; i < 3; ++i) {
+    lru_replacer.RecordAccess(i);
+    lru_replacer.SetEvictable(i, true);
+  }
+  // Scenario: accesses buffered away from the replacer arrive late and out of
+  // order. Their timestamps count, not the time they are reported at. Frame 3
+  // is not tracked, so its access is dropped.
+  size_t t1 = lru_replacer.Now();
+  size_t t2 = lru_replacer.Now();
+  size_t t3 = lru_replacer.Now();
+  size_t t4 = lru_replacer.Now();
+  lru_replacer.RecordAccesses(
+      {{0, AccessType::Get, t3}, {1, AccessType::Get, t1}, {3, AccessType::Get, t2}, {0, AccessType::Get, t4}});
+  lru_replacer.RecordAccesses({{1, AccessType::Get, t2}});
+  ASSERT_EQ(3, lru_replacer.Size());
+
+  // Frame 2 keeps +inf k-distance, then frame 1 has the older second to last
+  // access.
+  int value;
+  lru_replacer.Evict(&value);
+  ASSERT_EQ(2, value);
+  lru_replacer.Evict(&value);
+  ASSERT_EQ(1, value);
+  lru_replacer.Evict(&value);
+  ASSERT_EQ(0, value);
+  ASSERT_FALSE(lru_replacer.Evict(&value));
+
+  // Scenario: only frames that are tracked are updated, and the last update
+  // decides.
+  lru_replacer.UpdateEvictable(3, [](frame_id_t) { return true; });
+  ASSERT_EQ(0, lru_replacer.Size());
+  lru_replacer.RecordAccess(3);
+  lru_replacer.UpdateEvictable(3, [](frame_id_t) { return true; });
+  lru_replacer.UpdateEvictable(3, [](frame_id_t) { return false; });
+  ASSERT_EQ(0, lru_replacer.Size());
+}
 } // namespace bustub
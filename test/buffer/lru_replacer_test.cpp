@@ -19,45 +19,69 @@
 
 namespace bustub {
 
-TEST(LRUReplacerTest, DISABLED_SampleTest) {
+TEST(LRUReplacerTest, SampleTest) {
   LRUReplacer lru_replacer(7);
 
-  // Scenario: unpin six elements, i.e. add them to the replacer.
-  lru_replacer.Unpin(1);
-  lru_replacer.Unpin(2);
-  lru_replacer.Unpin(3);
-  lru_replacer.Unpin(4);
-  lru_replacer.Unpin(5);
-  lru_replacer.Unpin(6);
-  lru_replacer.Unpin(1);
+  // Scenario: add six frames to the replacer.
+  for (int i = 1; i <= 6; ++i) {
+    lru_replacer.RecordAccess(i);
+    lru_replacer.SetEvictable(i, true);
+  }
   EXPECT_EQ(6, lru_replacer.Size());
 
   // Scenario: get three victims from the lru.
   int value;
-  lru_replacer.Victim(&value);
+  lru_replacer.Evict(&value);
   EXPECT_EQ(1, value);
-  lru_replacer.Victim(&value);
+  lru_replacer.Evict(&value);
   EXPECT_EQ(2, value);
-  lru_replacer.Victim(&value);
+  lru_replacer.Evict(&value);
   EXPECT_EQ(3, value);
 
-  // Scenario: pin elements in the replacer.
-  // Note that 3 has already been victimized, so pinning 3 should have no
-  // effect.
-  lru_replacer.Pin(3);
-  lru_replacer.Pin(4);
+  // Scenario: pin frame 4. Note that 3 has already been evicted, so removing
+  // 3 should have no effect.
+  lru_replacer.Remove(3);
+  lru_replacer.SetEvictable(4, false);
   EXPECT_EQ(2, lru_replacer.Size());
 
-  // Scenario: unpin 4. We expect that the reference bit of 4 will be set to 1.
-  lru_replacer.Unpin(4);
+  // Scenario: access and unpin 4, which makes it the most recently used frame.
+  lru_replacer.RecordAccess(4);
+  lru_replacer.SetEvictable(4, true);
 
   // Scenario: continue looking for victims. We expect these victims.
-  lru_replacer.Victim(&value);
+  lru_replacer.Evict(&value);
   EXPECT_EQ(5, value);
-  lru_replacer.Victim(&value);
+  lru_replacer.Evict(&value);
   EXPECT_EQ(6, value);
-  lru_replacer.Victim(&value);
+  lru_replacer.Evict(&value);
   EXPECT_EQ(4, value);
+  EXPECT_FALSE(lru_replacer.Evict(&value));
+}
+
+TEST(LRUReplacerTest, ScanTest) {
+  LRUReplacer lru_replacer(4);
+
+  // Scenario: frames 0 and 1 are read by lookups, 2 and 3 by a scan, which
+  // also passes over frame 0.
+  lru_replacer.RecordAccess(0);
+  lru_replacer.RecordAccess(1);
+  lru_replacer.RecordAccess(2, AccessType::Scan);
+  lru_replacer.RecordAccess(3, AccessType::Scan);
+  lru_replacer.RecordAccess(0, AccessType::Scan);
+  for (int i = 0; i < 4; ++i) {
+    lru_replacer.SetEvictable(i, true);
+  }
+
+  // Scenario: scanned frames enter at the cold end, the scan doesn't refresh 0.
+  int value;
+  lru_replacer.Evict(&value);
+  EXPECT_EQ(3, value);
+  lru_replacer.Evict(&value);
+  EXPECT_EQ(2, value);
+  lru_replacer.Evict(&value);
+  EXPECT_EQ(0, value);
+  lru_replacer.Evict(&value);
+  EXPECT_EQ(1, value);
 }
 
 } // namespace bustub
@@ -0,0 +1,95 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// page_table_test.cpp
+//
+// Identification: test/buffer/page_table_test.cpp
+//
+// Copyright (c) 2015-2023, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <atomic>
+#include <map>
+#include <random>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "buffer/page_table.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+TEST(PageTableTest, SampleTest) {
+  const size_t num_frames = 64;
+  PageTable table(num_frames);
+  std::map<page_id_t, frame_id_t> expected;
+  std::mt19937 gen(15445);
+
+  // Scenario: random inserts and erases of page ids sharing a stride, as the
+  // pages of one instance do, keep the table in line with a reference map.
+  for (int i = 0; i < 10000; ++i) {
+    page_id_t page_id = static_cast<page_id_t>(gen() % 256) * 4 + 1;
+    frame_id_t frame_id = -1;
+    if (expected.count(page_id) > 0) {
+      ASSERT_TRUE(table.Erase(page_id));
+      expected.erase(page_id);
+    } else if (expected.size() < num_frames) {
+      table.Insert(page_id, static_cast<frame_id_t>(i % num_frames));
+      expected[page_id] = static_cast<frame_id_t>(i % num_frames);
+    }
+    ASSERT_EQ(expected.size(), table.Size());
+    for (auto [mapped_page_id, mapped_frame_id] : expected) {
+      ASSERT_TRUE(table.Find(mapped_page_id, &frame_id));
+      ASSERT_EQ(mapped_frame_id, frame_id);
+    }
+  }
+  EXPECT_FALSE(table.Erase(-1));
+
+  size_t visited = 0;
+  table.ForEach([&expected, &visited](page_id_t page_id, frame_id_t frame_id) {
+    EXPECT_EQ(expected[page_id], frame_id);
+    visited++;
+  });
+  EXPECT_EQ(expected.size(), visited);
+}
+
+TEST(PageTableTest, ConcurrentFindTest) {
+  const size_t num_frames = 16;
+  PageTable table(num_frames);
+  // the stable pages are never touched by the writer and must always be found
+  for (page_id_t page_id = 0; page_id < 8; ++page_id) {
+    table.Insert(page_id, page_id);
+  }
+
+  // Scenario: readers look up the stable pages while a writer keeps moving
+  // other pages in and out, shifting entries around them.
+  std::atomic<bool> done{false};
+  std::atomic<int> misses{0};
+  std::vector<std::thread> readers;
+  for (int tid = 0; tid < 4; ++tid) {
+    readers.emplace_back([&table, &done, &misses] {
+      while (!done) {
+        for (page_id_t page_id = 0; page_id < 8; ++page_id) {
+          frame_id_t frame_id = -1;
+          if (!table.Find(page_id, &frame_id) || frame_id != page_id) {
+            misses++;
+          }
+        }
+      }
+    });
+  }
+  for (int i = 0; i < 20000; ++i) {
+    page_id_t page_id = 8 + i % 8;
+    table.Insert(page_id, 8);
+    table.Erase(page_id);
+  }
+  done = true;
+  for (auto &reader : readers) {
+    reader.join();
+  }
+  EXPECT_EQ(0, misses);
+}
+
+}  // namespace bustub
@@ -0,0 +1,45 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// crc32c_test.cpp
+//
+// Identification: test/common/crc32c_test.cpp
+//
+// Copyright (c) 2015-2023, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "common/config.h"
+#include "common/util/crc32c.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+// NOLINTNEXTLINE
+TEST(Crc32cTest, SampleTest) {
+  // Scenario: the check value of CRC-32C, and of 32 zero bytes (RFC 3720).
+  EXPECT_EQ(0xe3069283, Crc32c::Compute("123456789", 9));
+  std::vector<char> zeros(32, 0);
+  EXPECT_EQ(0x8a9136aa, Crc32c::Compute(zeros.data(), zeros.size()));
+  EXPECT_EQ(0, Crc32c::Compute(nullptr, 0));
+
+  // Scenario: a checksum can be extended piece by piece, at any split.
+  std::mt19937 rng(3);
+  std::vector<char> data(BUSTUB_PAGE_SIZE + 13);
+  for (auto &byte : data) {
+    byte = static_cast<char>(rng());
+  }
+  uint32_t whole = Crc32c::Compute(data.data(), data.size());
+  for (size_t split : {0, 1, 7, 8, 100, 4096}) {
+    uint32_t crc = Crc32c::Compute(data.data(), split);
+    EXPECT_EQ(whole, Crc32c::Compute(data.data() + split, data.size() - split,
+                                     crc));
+  }
+}
+
+} // namespace bustub
@@ -52,6 +52,8 @@ TEST(HashTablePageTest, DISABLED_DirectoryPageSampleTest) {
   bpm->UnpinPage(directory_page_id, true);
   disk_manager->ShutDown();
   remove("test.db");
+  remove("test.fsm");
+  remove("test.crc");
   delete disk_manager;
   delete bpm;
 }
@@ -111,6 +113,8 @@ TEST(HashTablePageTest, DISABLED_BucketPageSampleTest) {
   bpm->UnpinPage(bucket_page_id, true);
   disk_manager->ShutDown();
   remove("test.db");
+  remove("test.fsm");
+  remove("test.crc");
   delete disk_manager;
   delete bpm;
 }
@@ -114,6 +114,8 @@ TEST(HashTableTest, DISABLED_SampleTest) {
 
   disk_manager->ShutDown();
   remove("test.db");
+  remove("test.fsm");
+  remove("test.crc");
   delete disk_manager;
   delete bpm;
 }
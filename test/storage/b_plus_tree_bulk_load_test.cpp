@@ -0,0 +1,192 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// b_plus_tree_bulk_load_test.cpp
+//
+// Identification: test/storage/b_plus_tree_bulk_load_test.cpp
+//
+// Copyright (c) 2015-2023, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <cstdio>
+#include <utility>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "storage/disk/disk_manager_memory.h"
+#include "storage/index/b_plus_tree.h"
+#include "test_util.h" // NOLINT
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+using bustub::DiskManagerUnlimitedMemory;
+using BulkLoadTree = BPlusTree<GenericKey<8>, RID, GenericComparator<8>>;
+using BulkLoadLeafPage =
+    BPlusTreeLeafPage<GenericKey<8>, RID, GenericComparator<8>>;
+using BulkLoadInternalPage =
+    BPlusTreeInternalPage<GenericKey<8>, page_id_t, GenericComparator<8>>;
+
+static auto MakePairs(int64_t num_keys)
+    -> std::vector<std::pair<GenericKey<8>, RID>> {
+  std::vector<std::pair<GenericKey<8>, RID>> pairs(num_keys);
+  for (int64_t key = 0; key < num_keys; ++key) {
+    pairs[key].first.SetFromInteger(key);
+    pairs[key].second.Set(static_cast<int32_t>(key >> 32),
+                          static_cast<uint32_t>(key & 0xFFFFFFFF));
+  }
+  return pairs;
+}
+
+TEST(BPlusTreeTests, BulkLoadTest) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  auto disk_manager = std::make_unique<DiskManagerUnlimitedMemory>();
+  auto *bpm = new BufferPoolManager(50, disk_manager.get());
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  BulkLoadTree tree("foo_pk", header_page->GetPageId(), bpm, comparator, 10,
+                    10);
+  auto *transaction = new Transaction(0);
+
+  const int64_t num_keys = 10000;
+  ASSERT_TRUE(tree.BulkLoad(MakePairs(num_keys), 0.8));
+
+  std::vector<RID> rids;
+  GenericKey<8> index_key;
+  for (int64_t key = 0; key < num_keys; ++key) {
+    rids.clear();
+    index_key.SetFromInteger(key);
+    ASSERT_TRUE(tree.GetValue(index_key, &rids));
+    ASSERT_EQ(rids.size(), 1);
+    EXPECT_EQ(rids[0].GetSlotNum(), key);
+  }
+
+  // walk down to the first leaf, the leaves are filled to the fill factor and
+  // lie on consecutive page ids
+  page_id_t leaf_id = tree.GetRootPageId();
+  while (true) {
+    ReadPageGuard guard = bpm->FetchPageRead(leaf_id);
+    const auto *page = guard.As<BPlusTreePage>();
+    if (page->IsLeafPage()) {
+      break;
+    }
+    if (leaf_id != tree.GetRootPageId()) {
+      EXPECT_GE(page->GetSize(), 8);
+    }
+    leaf_id = guard.As<BulkLoadInternalPage>()->ValueAt(0);
+  }
+  int64_t num_leaves = 0;
+  int64_t next_key = 0;
+  while (leaf_id != INVALID_PAGE_ID) {
+    ReadPageGuard guard = bpm->FetchPageRead(leaf_id);
+    const auto *leaf = guard.As<BulkLoadLeafPage>();
+    EXPECT_EQ(leaf->GetSize(), 8);
+    for (int i = 0; i < leaf->GetSize(); ++i) {
+      EXPECT_EQ(leaf->ValueAt(i).GetSlotNum(), next_key++);
+    }
+    page_id_t next_leaf_id = leaf->GetNextPageId();
+    EXPECT_TRUE(next_leaf_id == INVALID_PAGE_ID ||
+                next_leaf_id == leaf_id + 1);
+    leaf_id = next_leaf_id;
+    num_leaves++;
+  }
+  EXPECT_EQ(num_leaves, num_keys / 8);
+  EXPECT_EQ(next_key, num_keys);
+
+  // the tree keeps working as usual
+  for (int64_t key = num_keys; key < num_keys + 1000; ++key) {
+    index_key.SetFromInteger(key);
+    RID rid(0, static_cast<uint32_t>(key));
+    ASSERT_TRUE(tree.Insert(index_key, rid, transaction));
+  }
+  for (int64_t key = 0; key < num_keys; key += 2) {
+    index_key.SetFromInteger(key);
+    tree.Remove(index_key, transaction);
+  }
+  int64_t current_key = 1;
+  for (auto iterator = tree.Begin(); iterator != tree.End(); ++iterator) {
+    EXPECT_EQ((*iterator).second.GetSlotNum(), current_key);
+    current_key += current_key + 2 <= num_keys ? 2 : 1;
+  }
+  EXPECT_EQ(current_key, num_keys + 1000);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete transaction;
+  delete bpm;
+}
+
+TEST(BPlusTreeTests, BulkLoadRejectTest) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  auto disk_manager = std::make_unique<DiskManagerUnlimitedMemory>();
+  auto *bpm = new BufferPoolManager(50, disk_manager.get());
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  BulkLoadTree tree("foo_pk", header_page->GetPageId(), bpm, comparator);
+
+  // keys must be strictly increasing
+  auto pairs = MakePairs(100);
+  std::swap(pairs[10], pairs[20]);
+  EXPECT_FALSE(tree.BulkLoad(pairs));
+  pairs = MakePairs(100);
+  pairs[11].first = pairs[10].first;
+  EXPECT_FALSE(tree.BulkLoad(pairs));
+  EXPECT_TRUE(tree.IsEmpty());
+
+  // a single leaf is the root
+  ASSERT_TRUE(tree.BulkLoad(MakePairs(100)));
+  {
+    ReadPageGuard guard = bpm->FetchPageRead(tree.GetRootPageId());
+    EXPECT_TRUE(guard.As<BPlusTreePage>()->IsLeafPage());
+    EXPECT_EQ(guard.As<BPlusTreePage>()->GetSize(), 100);
+  }
+
+  // only an empty tree can be bulk-loaded
+  EXPECT_FALSE(tree.BulkLoad(MakePairs(10)));
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete bpm;
+}
+
+TEST(BPlusTreeTests, BulkLoadNoFrameTest) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  auto disk_manager = std::make_unique<DiskManagerUnlimitedMemory>();
+  const size_t pool_size = 4;
+  auto *bpm = new BufferPoolManager(pool_size, disk_manager.get());
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  BulkLoadTree tree("foo_pk", header_page->GetPageId(), bpm, comparator, 10,
+                    10);
+
+  // with every frame pinned the load fails, hands its page ids back and
+  // leaves the tree empty
+  std::vector<page_id_t> pinned;
+  for (size_t i = 1; i < pool_size; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    pinned.push_back(page_id);
+  }
+  EXPECT_FALSE(tree.BulkLoad(MakePairs(1000)));
+  EXPECT_TRUE(tree.IsEmpty());
+  for (page_id_t id : pinned) {
+    bpm->UnpinPage(id, false);
+  }
+  ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+  EXPECT_EQ(pinned.back() + 1, page_id);
+  bpm->UnpinPage(page_id, false);
+
+  // once a frame is free the load goes through
+  ASSERT_TRUE(tree.BulkLoad(MakePairs(1000)));
+  EXPECT_FALSE(tree.IsEmpty());
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete bpm;
+}
+
+} // namespace bustub
@@ -0,0 +1,336 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// b_plus_tree_compressed_test.cpp
+//
+// Identification: test/storage/b_plus_tree_compressed_test.cpp
+//
+// Copyright (c) 2015-2023, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "common/exception.h"
+#include "storage/disk/disk_manager_memory.h"
+#include "storage/index/b_plus_tree.h"
+#include "test_util.h" // NOLINT
+#include "type/value_factory.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+using CompressedTree = BPlusTree<GenericKey<16>, RID, GenericComparator<16>>;
+using CompressedLeafPage =
+    BPlusTreeLeafPage<GenericKey<16>, RID, GenericComparator<16>>;
+using CompressedInternalPage =
+    BPlusTreeInternalPage<GenericKey<16>, page_id_t, GenericComparator<16>>;
+
+/** Pairs of a plain page of GenericKey<16>. */
+static constexpr int LEAF_MAX_SIZE =
+    (BUSTUB_PAGE_SIZE - LEAF_PAGE_HEADER_SIZE) /
+    sizeof(std::pair<GenericKey<16>, RID>);
+static constexpr int INTERNAL_MAX_SIZE =
+    (BUSTUB_PAGE_SIZE - INTERNAL_PAGE_HEADER_SIZE) /
+    sizeof(std::pair<GenericKey<16>, page_id_t>);
+
+static auto MakeKey(const Schema *key_schema, std::pair<int32_t, int32_t> xy)
+    -> GenericKey<16> {
+  GenericKey<16> key;
+  key.SetFromKey(Tuple({ValueFactory::GetIntegerValue(xy.first),
+                        ValueFactory::GetIntegerValue(xy.second)},
+                       key_schema),
+                 key_schema);
+  return key;
+}
+
+static auto MakeRid(std::pair<int32_t, int32_t> xy) -> RID {
+  return {xy.first, static_cast<uint32_t>(xy.second)};
+}
+
+/** @return the levels and the leaves of a tree */
+static auto CountPages(BufferPoolManager *bpm, page_id_t root_page_id)
+    -> std::pair<int, int> {
+  int levels = 1;
+  page_id_t page_id = root_page_id;
+  while (true) {
+    ReadPageGuard guard = bpm->FetchPageRead(page_id);
+    if (guard.As<BPlusTreePage>()->IsLeafPage()) {
+      break;
+    }
+    page_id = guard.As<CompressedInternalPage>()->ValueAt(0);
+    levels++;
+  }
+  int leaves = 0;
+  while (page_id != INVALID_PAGE_ID) {
+    ReadPageGuard guard = bpm->FetchPageRead(page_id);
+    page_id = guard.As<CompressedLeafPage>()->GetNextPageId();
+    leaves++;
+  }
+  return {levels, leaves};
+}
+
+TEST(BPlusTreeCompressedTest, PageTest) {
+  auto key_schema = ParseCreateStatement("x int,y int");
+  GenericComparator<16> comparator(key_schema.get(), KeyEncoding::NORMALIZED);
+
+  // the keys share their first bytes, and those of y that are multiples of
+  // 256 end in zeros
+  std::vector<std::pair<int32_t, int32_t>> values;
+  for (int32_t x = 7; x <= 8; ++x) {
+    for (int32_t y = 0; y < 90 * 128; y += 128) {
+      values.emplace_back(x, y);
+    }
+  }
+  ASSERT_GT(static_cast<int>(values.size()), LEAF_MAX_SIZE);
+  auto shuffled = values;
+  std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(15445));
+
+  std::vector<char> buffer(BUSTUB_PAGE_SIZE);
+  auto *page = reinterpret_cast<CompressedLeafPage *>(buffer.data());
+  page->Init(LEAF_MAX_SIZE, IndexPageFormat::COMPRESSED);
+  for (auto xy : shuffled) {
+    auto key = MakeKey(key_schema.get(), xy);
+    ASSERT_TRUE(page->HasRoomFor(key));
+    page->InsertKeyAndValueAt(page->GetIndexLargerThanKey(0, key, comparator),
+                              key, MakeRid(xy));
+  }
+  ASSERT_EQ(page->GetSize(), static_cast<int>(values.size()));
+
+  auto check = [&]() {
+    for (int i = 0; i < static_cast<int>(values.size()); ++i) {
+      auto key = MakeKey(key_schema.get(), values[i]);
+      ASSERT_EQ(memcmp(page->KeyAt(i).data_, key.data_, sizeof(key.data_)), 0);
+      EXPECT_EQ(page->ValueAt(i), MakeRid(values[i]));
+    }
+    for (int32_t x = 6; x <= 9; ++x) {
+      for (int32_t y = -300; y < 91 * 128; y += 64) {
+        for (auto probe : {std::make_pair(x, y), std::make_pair(x, y + 1)}) {
+          auto key = MakeKey(key_schema.get(), probe);
+          auto upper = std::upper_bound(values.begin(), values.end(), probe) -
+                       values.begin();
+          ASSERT_EQ(page->GetIndexLargerThanKey(0, key, comparator), upper);
+          int index = 0;
+          bool found = std::binary_search(values.begin(), values.end(), probe);
+          ASSERT_EQ(page->GetIndexEqualToKey(index, key, comparator), found);
+          if (found) {
+            EXPECT_EQ(values[index], probe);
+          }
+        }
+      }
+    }
+  };
+  check();
+
+  // the layout stays as it is, only the pairs move
+  for (int i = 0; i < 40; ++i) {
+    page->DeleteKeyAndValueAt(i * 3);
+    values.erase(values.begin() + i * 3);
+  }
+  check();
+
+  // an internal page leaves its first key out
+  std::vector<std::pair<GenericKey<16>, page_id_t>> children;
+  int size = static_cast<int>(values.size());
+  for (int i = 0; i < size; ++i) {
+    children.emplace_back(MakeKey(key_schema.get(), values[i]), i);
+  }
+  children[0].first = MakeKey(key_schema.get(), {-1000, -1000});
+  auto *internal = reinterpret_cast<CompressedInternalPage *>(buffer.data());
+  internal->Init(LEAF_MAX_SIZE, IndexPageFormat::COMPRESSED);
+  ASSERT_LE(size, internal->CapacityFor(children.data(), size));
+  internal->SetKeysAndValues(children.data(), size);
+  for (int i = 1; i < size; ++i) {
+    auto key = MakeKey(key_schema.get(), values[i]);
+    ASSERT_EQ(internal->GetIndexLargerThanKey(1, key, comparator), i + 1);
+    EXPECT_EQ(internal->ValueAt(i), i);
+  }
+
+  // an optimistic reader may find an index with one layout and read its value
+  // with a wider one, which must stay within the page
+  for (int i : {size, BUSTUB_PAGE_SIZE / 4, -1}) {
+    [[maybe_unused]] page_id_t torn = internal->ValueAt(i);
+  }
+}
+
+TEST(BPlusTreeCompressedTest, InsertRemoveTest) {
+  auto key_schema = ParseCreateStatement("x int,y int");
+  GenericComparator<16> comparator(key_schema.get(), KeyEncoding::NORMALIZED);
+  auto disk_manager = std::make_unique<DiskManagerUnlimitedMemory>();
+  auto bpm = std::make_unique<BufferPoolManager>(50, disk_manager.get());
+  page_id_t plain_header_id;
+  page_id_t header_id;
+  bpm->NewPage(&plain_header_id);
+  bpm->NewPage(&header_id);
+  CompressedTree plain("plain", plain_header_id, bpm.get(), comparator);
+  CompressedTree tree("compressed", header_id, bpm.get(), comparator,
+                      LEAF_MAX_SIZE, INTERNAL_MAX_SIZE,
+                      IndexPageFormat::COMPRESSED);
+
+  std::vector<std::pair<int32_t, int32_t>> values;
+  for (int32_t x = 0; x < 40; ++x) {
+    for (int32_t y = 0; y < 500; ++y) {
+      values.emplace_back(x * 1000, y);
+    }
+  }
+  auto shuffled = values;
+  std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(15445));
+  for (auto xy : shuffled) {
+    ASSERT_TRUE(plain.Insert(MakeKey(key_schema.get(), xy), MakeRid(xy)));
+    ASSERT_TRUE(tree.Insert(MakeKey(key_schema.get(), xy), MakeRid(xy)));
+  }
+  EXPECT_FALSE(tree.Insert(MakeKey(key_schema.get(), values[0]), RID()));
+
+  // more keys per page make for fewer leaves
+  auto [plain_levels, plain_leaves] =
+      CountPages(bpm.get(), plain.GetRootPageId());
+  auto [levels, leaves] = CountPages(bpm.get(), tree.GetRootPageId());
+  EXPECT_LE(levels, plain_levels);
+  EXPECT_LT(leaves * 3, plain_leaves * 2);
+
+  std::vector<RID> rids;
+  for (auto xy : values) {
+    rids.clear();
+    ASSERT_TRUE(tree.GetValue(MakeKey(key_schema.get(), xy), &rids));
+    ASSERT_EQ(rids.size(), 1);
+    EXPECT_EQ(rids[0], MakeRid(xy));
+  }
+  size_t i = 0;
+  for (auto iter = tree.Begin(); !iter.IsEnd(); ++iter, ++i) {
+    ASSERT_LT(i, values.size());
+    EXPECT_EQ((*iter).second, MakeRid(values[i]));
+  }
+  EXPECT_EQ(i, values.size());
+
+  // remove three quarters of the keys, underfull pages merge or stay
+  std::vector<std::pair<int32_t, int32_t>> kept;
+  for (size_t j = 0; j < shuffled.size(); ++j) {
+    if (j % 4 == 0) {
+      kept.push_back(shuffled[j]);
+      continue;
+    }
+    tree.Remove(MakeKey(key_schema.get(), shuffled[j]), nullptr);
+    rids.clear();
+    ASSERT_FALSE(tree.GetValue(MakeKey(key_schema.get(), shuffled[j]), &rids));
+  }
+  std::sort(kept.begin(), kept.end());
+  for (auto xy : kept) {
+    rids.clear();
+    ASSERT_TRUE(tree.GetValue(MakeKey(key_schema.get(), xy), &rids));
+  }
+  i = 0;
+  for (auto iter = tree.Begin(); !iter.IsEnd(); ++iter, ++i) {
+    ASSERT_LT(i, kept.size());
+    EXPECT_EQ((*iter).second, MakeRid(kept[i]));
+  }
+  EXPECT_EQ(i, kept.size());
+
+  for (auto xy : kept) {
+    tree.Remove(MakeKey(key_schema.get(), xy), nullptr);
+  }
+  EXPECT_TRUE(tree.Begin().IsEnd());
+  for (auto xy : kept) {
+    ASSERT_TRUE(tree.Insert(MakeKey(key_schema.get(), xy), MakeRid(xy)));
+  }
+  i = 0;
+  for (auto iter = tree.Begin(); !iter.IsEnd(); ++iter, ++i) {
+    ASSERT_LT(i, kept.size());
+    EXPECT_EQ((*iter).second, MakeRid(kept[i]));
+  }
+  EXPECT_EQ(i, kept.size());
+}
+
+TEST(BPlusTreeCompressedTest, BulkLoadTest) {
+  auto key_schema = ParseCreateStatement("x int,y int");
+  GenericComparator<16> comparator(key_schema.get(), KeyEncoding::NORMALIZED);
+  auto disk_manager = std::make_unique<DiskManagerUnlimitedMemory>();
+  auto bpm = std::make_unique<BufferPoolManager>(50, disk_manager.get());
+  page_id_t plain_header_id;
+  page_id_t header_id;
+  bpm->NewPage(&plain_header_id);
+  bpm->NewPage(&header_id);
+  CompressedTree plain("plain", plain_header_id, bpm.get(), comparator);
+  CompressedTree tree("compressed", header_id, bpm.get(), comparator,
+                      LEAF_MAX_SIZE, INTERNAL_MAX_SIZE,
+                      IndexPageFormat::COMPRESSED);
+
+  std::vector<std::pair<int32_t, int32_t>> values;
+  std::vector<std::pair<GenericKey<16>, RID>> pairs;
+  for (int32_t x = 0; x < 100; ++x) {
+    for (int32_t y = 0; y < 300; ++y) {
+      values.emplace_back(x, y * 7);
+      pairs.emplace_back(MakeKey(key_schema.get(), values.back()),
+                         MakeRid(values.back()));
+    }
+  }
+  ASSERT_TRUE(plain.BulkLoad(pairs, 1.0));
+  ASSERT_TRUE(tree.BulkLoad(pairs, 1.0));
+  auto [plain_levels, plain_leaves] =
+      CountPages(bpm.get(), plain.GetRootPageId());
+  auto [levels, leaves] = CountPages(bpm.get(), tree.GetRootPageId());
+  EXPECT_LE(levels, plain_levels);
+  EXPECT_LT(leaves * 3, plain_leaves * 2);
+
+  // the entries are spread evenly over the leaves, the last one isn't left
+  // almost empty
+  page_id_t leaf_id = tree.GetRootPageId();
+  while (true) {
+    ReadPageGuard guard = bpm->FetchPageRead(leaf_id);
+    if (guard.As<BPlusTreePage>()->IsLeafPage()) {
+      break;
+    }
+    leaf_id = guard.As<CompressedInternalPage>()->ValueAt(0);
+  }
+  int min_size = static_cast<int>(pairs.size());
+  int max_size = 0;
+  while (leaf_id != INVALID_PAGE_ID) {
+    ReadPageGuard guard = bpm->FetchPageRead(leaf_id);
+    const auto *leaf = guard.As<CompressedLeafPage>();
+    min_size = std::min(min_size, leaf->GetSize());
+    max_size = std::max(max_size, leaf->GetSize());
+    leaf_id = leaf->GetNextPageId();
+  }
+  EXPECT_LE(max_size - min_size, 1);
+
+  std::vector<RID> rids;
+  for (auto xy : values) {
+    rids.clear();
+    ASSERT_TRUE(tree.GetValue(MakeKey(key_schema.get(), xy), &rids));
+    EXPECT_EQ(rids[0], MakeRid(xy));
+  }
+  // keys between the loaded ones go to the leaves the separators point to
+  for (int32_t x = 0; x < 100; x += 3) {
+    for (int32_t y = 1; y < 300 * 7; y += 7 * 13) {
+      ASSERT_TRUE(tree.Insert(MakeKey(key_schema.get(), {x, y}), RID(x, y)));
+      values.emplace_back(x, y);
+    }
+  }
+  std::sort(values.begin(), values.end());
+  size_t i = 0;
+  for (auto iter = tree.Begin(); !iter.IsEnd(); ++iter, ++i) {
+    ASSERT_LT(i, values.size());
+    EXPECT_EQ((*iter).second, MakeRid(values[i]));
+  }
+  EXPECT_EQ(i, values.size());
+}
+
+TEST(BPlusTreeCompressedTest, NeedsNormalizedKeysTest) {
+  auto key_schema = ParseCreateStatement("x int,y int");
+  GenericComparator<16> comparator(key_schema.get());
+  auto disk_manager = std::make_unique<DiskManagerUnlimitedMemory>();
+  auto bpm = std::make_unique<BufferPoolManager>(10, disk_manager.get());
+  page_id_t header_id;
+  bpm->NewPage(&header_id);
+  EXPECT_THROW(CompressedTree("compressed", header_id, bpm.get(), comparator,
+                              LEAF_MAX_SIZE, INTERNAL_MAX_SIZE,
+                              IndexPageFormat::COMPRESSED),
+               Exception);
+}
+
+} // namespace bustub
@@ -12,6 +12,9 @@
 
 #include <algorithm>
 #include <cstdio>
+#include <random>
+#include <utility>
+#include <vector>
 
 #include "buffer/buffer_pool_manager.h"
 #include "storage/disk/disk_manager_memory.h"
@@ -288,4 +291,65 @@ TEST(BPlusTreeTests, DeleteTest2) {
   delete transaction;
   delete bpm;
 }
+
+TEST(BPlusTreeTests, DeleteTest3) {
+  // create KeyComparator and index schema
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  auto disk_manager = std::make_unique<DiskManagerUnlimitedMemory>();
+  auto *bpm = new BufferPoolManager(50, disk_manager.get());
+  // create and fetch header_page
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  // create b+ tree with pages as large as they get, so that leaves fill up
+  // to their full capacity
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree(
+      "foo_pk", header_page->GetPageId(), bpm, comparator);
+  GenericKey<8> index_key;
+  RID rid;
+  // create transaction
+  auto *transaction = new Transaction(0);
+
+  // a leaf holds 255 pairs, every leaf starts out full
+  const int64_t num_keys = 255 * 80;
+  std::vector<std::pair<GenericKey<8>, RID>> pairs(num_keys);
+  for (int64_t key = 0; key < num_keys; ++key) {
+    pairs[key].first.SetFromInteger(key);
+    pairs[key].second.Set(0, key);
+  }
+  ASSERT_TRUE(tree.BulkLoad(pairs, 1.0));
+
+  // remove windows of keys, which borrows from and merges with siblings on
+  // both sides
+  std::vector<bool> removed(num_keys, false);
+  std::mt19937 gen(15445);
+  std::uniform_int_distribution<int64_t> dis(0, num_keys - 1);
+  for (int round = 0; round < 20; ++round) {
+    int64_t start = dis(gen);
+    for (int64_t key = start; key < std::min(start + 1000, num_keys);
+         key += 3) {
+      index_key.SetFromInteger(key);
+      tree.Remove(index_key, transaction);
+      removed[key] = true;
+    }
+  }
+
+  std::vector<RID> rids;
+  for (int64_t key = 0; key < num_keys; ++key) {
+    rids.clear();
+    index_key.SetFromInteger(key);
+    EXPECT_EQ(tree.GetValue(index_key, &rids), !removed[key]) << key;
+  }
+  int64_t size = 0;
+  for (auto iterator = tree.Begin(); iterator != tree.End(); ++iterator) {
+    EXPECT_FALSE(removed[(*iterator).second.GetSlotNum()]);
+    size++;
+  }
+  EXPECT_EQ(size, std::count(removed.begin(), removed.end(), false));
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete transaction;
+  delete bpm;
+}
 } // namespace bustub
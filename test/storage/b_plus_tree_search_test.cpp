@@ -0,0 +1,196 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// b_plus_tree_search_test.cpp
+//
+// Identification: test/storage/b_plus_tree_search_test.cpp
+//
+// Copyright (c) 2015-2023, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "storage/page/b_plus_tree_internal_page.h"
+#include "storage/page/b_plus_tree_leaf_page.h"
+#include "test_util.h" // NOLINT
+#include "type/value_factory.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+/**
+ * Fill a page with the keys, which are written as integers of the given type,
+ * and check every search against std::lower_bound and std::upper_bound.
+ */
+template <typename PageType, typename IntType, size_t KeySize>
+static void CheckIntegerSearch(const std::string &column_type, int max_size) {
+  auto key_schema = ParseCreateStatement("a " + column_type);
+  GenericComparator<KeySize> comparator(key_schema.get());
+  ASSERT_EQ(comparator.GetIntegerKeyWidth(), sizeof(IntType));
+
+  std::mt19937 gen(15445);
+  std::uniform_int_distribution<int64_t> dis(
+      std::numeric_limits<IntType>::min() + 1,
+      std::numeric_limits<IntType>::max());
+  std::vector<IntType> values;
+  for (int i = 0; i < max_size; ++i) {
+    values.push_back(static_cast<IntType>(dis(gen)));
+  }
+  std::sort(values.begin(), values.end());
+  values.erase(std::unique(values.begin(), values.end()), values.end());
+
+  auto make_key = [](IntType value) {
+    GenericKey<KeySize> key;
+    memset(key.data_, 0, KeySize);
+    memcpy(key.data_, &value, sizeof(value));
+    return key;
+  };
+
+  std::vector<char> buffer(BUSTUB_PAGE_SIZE);
+  auto *page = reinterpret_cast<PageType *>(buffer.data());
+  page->Init(max_size);
+  // the first key of an internal page is not used
+  int first = page->IsLeafPage() ? 0 : 1;
+  page->SetSize(first + static_cast<int>(values.size()));
+  for (size_t i = 0; i < values.size(); ++i) {
+    page->SetKeyAt(first + static_cast<int>(i), make_key(values[i]));
+  }
+
+  std::vector<IntType> probes = values;
+  for (int i = 0; i < 200; ++i) {
+    probes.push_back(static_cast<IntType>(dis(gen)));
+  }
+  probes.push_back(std::numeric_limits<IntType>::min() + 1);
+  probes.push_back(std::numeric_limits<IntType>::max());
+  for (auto probe : probes) {
+    auto key = make_key(probe);
+    auto upper = std::upper_bound(values.begin(), values.end(), probe) -
+                 values.begin() + first;
+    ASSERT_EQ(page->GetIndexLargerThanKey(first, key, comparator), upper)
+        << probe;
+    auto lower = std::lower_bound(values.begin(), values.end(), probe);
+    int index = first;
+    bool found = lower != values.end() && *lower == probe;
+    ASSERT_EQ(page->GetIndexEqualToKey(index, key, comparator), found)
+        << probe;
+    if (found) {
+      EXPECT_EQ(index, lower - values.begin() + first);
+    }
+  }
+}
+
+TEST(BPlusTreeSearchTest, IntegerKeyTest) {
+  using LeafPage8 = BPlusTreeLeafPage<GenericKey<8>, RID, GenericComparator<8>>;
+  using InternalPage8 =
+      BPlusTreeInternalPage<GenericKey<8>, page_id_t, GenericComparator<8>>;
+  using LeafPage4 = BPlusTreeLeafPage<GenericKey<4>, RID, GenericComparator<4>>;
+  CheckIntegerSearch<LeafPage8, int64_t, 8>("bigint", 255);
+  CheckIntegerSearch<InternalPage8, int64_t, 8>("bigint", 255);
+  CheckIntegerSearch<LeafPage8, int32_t, 8>("int", 200);
+  CheckIntegerSearch<LeafPage4, int32_t, 4>("int", 200);
+  CheckIntegerSearch<LeafPage8, int16_t, 8>("smallint", 100);
+  // windows smaller than a full AVX2 step
+  CheckIntegerSearch<LeafPage8, int64_t, 8>("bigint", 3);
+  CheckIntegerSearch<LeafPage8, int64_t, 8>("bigint", 1);
+}
+
+TEST(BPlusTreeSearchTest, NormalizedKeyTest) {
+  // normalized keys of up to 8 bytes are searched as big-endian integers
+  auto key_schema = ParseCreateStatement("a int,b int");
+  GenericComparator<8> comparator(key_schema.get(), KeyEncoding::NORMALIZED);
+  ASSERT_EQ(comparator.GetIntegerKeyWidth(), 8);
+
+  std::vector<std::pair<int32_t, int32_t>> values;
+  for (int32_t a = -10; a < 10; ++a) {
+    for (int32_t b = -300; b < 300; b += 50) {
+      values.emplace_back(a * 1000003, b);
+    }
+  }
+  auto make_key = [&key_schema](std::pair<int32_t, int32_t> value) {
+    GenericKey<8> key;
+    key.SetFromKey(Tuple({ValueFactory::GetIntegerValue(value.first),
+                          ValueFactory::GetIntegerValue(value.second)},
+                         key_schema.get()),
+                   key_schema.get());
+    return key;
+  };
+
+  std::vector<char> buffer(BUSTUB_PAGE_SIZE);
+  auto *page = reinterpret_cast<
+      BPlusTreeLeafPage<GenericKey<8>, RID, GenericComparator<8>> *>(
+      buffer.data());
+  page->Init(static_cast<int>(values.size()));
+  page->SetSize(static_cast<int>(values.size()));
+  for (size_t i = 0; i < values.size(); ++i) {
+    page->SetKeyAt(static_cast<int>(i), make_key(values[i]));
+  }
+
+  for (int32_t a = -11; a < 11; ++a) {
+    for (int32_t b = -301; b < 301; b += 19) {
+      auto probe = std::make_pair(a * 1000003, b);
+      auto upper = std::upper_bound(values.begin(), values.end(), probe) -
+                   values.begin();
+      ASSERT_EQ(page->GetIndexLargerThanKey(0, make_key(probe), comparator),
+                upper);
+      int index = 0;
+      bool found = std::binary_search(values.begin(), values.end(), probe);
+      ASSERT_EQ(page->GetIndexEqualToKey(index, make_key(probe), comparator),
+                found);
+    }
+  }
+}
+
+TEST(BPlusTreeSearchTest, CompositeKeyTest) {
+  // keys of two columns go through the comparator
+  auto key_schema = ParseCreateStatement("a bigint,b bigint");
+  GenericComparator<16> comparator(key_schema.get());
+  ASSERT_EQ(comparator.GetIntegerKeyWidth(), 0);
+
+  std::vector<std::pair<int64_t, int64_t>> values;
+  for (int64_t a = -5; a < 5; ++a) {
+    for (int64_t b = -3; b < 3; b += 2) {
+      values.emplace_back(a, b);
+    }
+  }
+  auto make_key = [](std::pair<int64_t, int64_t> value) {
+    GenericKey<16> key;
+    memcpy(key.data_, &value.first, sizeof(int64_t));
+    memcpy(key.data_ + sizeof(int64_t), &value.second, sizeof(int64_t));
+    return key;
+  };
+
+  std::vector<char> buffer(BUSTUB_PAGE_SIZE);
+  auto *page = reinterpret_cast<
+      BPlusTreeLeafPage<GenericKey<16>, RID, GenericComparator<16>> *>(
+      buffer.data());
+  page->Init(100);
+  page->SetSize(static_cast<int>(values.size()));
+  for (size_t i = 0; i < values.size(); ++i) {
+    page->SetKeyAt(static_cast<int>(i), make_key(values[i]));
+  }
+
+  for (int64_t a = -6; a < 6; ++a) {
+    for (int64_t b = -4; b < 4; ++b) {
+      auto probe = std::make_pair(a, b);
+      auto upper = std::upper_bound(values.begin(), values.end(), probe) -
+                   values.begin();
+      ASSERT_EQ(page->GetIndexLargerThanKey(0, make_key(probe), comparator),
+                upper);
+      int index = 0;
+      bool found =
+          std::binary_search(values.begin(), values.end(), probe);
+      ASSERT_EQ(page->GetIndexEqualToKey(index, make_key(probe), comparator),
+                found);
+      if (found) {
+        EXPECT_EQ(values[index], probe);
+      }
+    }
+  }
+}
+
+} // namespace bustub
@@ -0,0 +1,167 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// compressed_page_store_test.cpp
+//
+// Identification: test/storage/compressed_page_store_test.cpp
+//
+// Copyright (c) 2015-2023, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+#include "storage/disk/compressed_page_store.h"
+#include "storage/disk/disk_manager.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+class CompressedPageStoreTest : public ::testing::Test {
+protected:
+  void SetUp() override { RemoveFiles(); }
+
+  void TearDown() override { RemoveFiles(); }
+
+  static void RemoveFiles() {
+    for (const auto *file : {"test.db", "test.fsm", "test.log", "test.pmap"}) {
+      remove(file);
+    }
+  }
+};
+
+// NOLINTNEXTLINE
+TEST_F(CompressedPageStoreTest, CodecTest) {
+  std::mt19937 rng(42);
+  std::vector<char> page(BUSTUB_PAGE_SIZE);
+  std::vector<char> compressed(2 * BUSTUB_PAGE_SIZE);
+  std::vector<char> out(BUSTUB_PAGE_SIZE);
+
+  // Scenario: sparse, repetitive and random pages round-trip.
+  for (int fill = 0; fill <= 100; fill += 25) {
+    std::fill(page.begin(), page.end(), 0);
+    size_t used = BUSTUB_PAGE_SIZE * fill / 100;
+    for (size_t i = 0; i < used; ++i) {
+      page[BUSTUB_PAGE_SIZE - 1 - i] = static_cast<char>(rng() % 4);
+    }
+    size_t length = CompressedPageStore::Compress(
+        page.data(), page.size(), compressed.data(), compressed.size());
+    ASSERT_NE(0, length);
+    if (fill <= 50) {
+      EXPECT_LT(length, BUSTUB_PAGE_SIZE * 3 / 4);
+    }
+    ASSERT_TRUE(CompressedPageStore::Decompress(compressed.data(), length,
+                                                out.data(), out.size()));
+    EXPECT_EQ(page, out);
+    // a truncated block is rejected rather than read past
+    EXPECT_FALSE(CompressedPageStore::Decompress(compressed.data(), length - 1,
+                                                 out.data(), out.size()));
+  }
+  for (auto &byte : page) {
+    byte = static_cast<char>(rng());
+  }
+  size_t length = CompressedPageStore::Compress(
+      page.data(), page.size(), compressed.data(), compressed.size());
+  ASSERT_NE(0, length);
+  ASSERT_TRUE(CompressedPageStore::Decompress(compressed.data(), length,
+                                              out.data(), out.size()));
+  EXPECT_EQ(page, out);
+
+  // Scenario: output that doesn't fit is reported.
+  EXPECT_EQ(0, CompressedPageStore::Compress(page.data(), page.size(),
+                                             compressed.data(),
+                                             BUSTUB_PAGE_SIZE / 2));
+}
+
+// NOLINTNEXTLINE
+TEST_F(CompressedPageStoreTest, DiskManagerTest) {
+  std::mt19937 rng(7);
+  const page_id_t num_pages = 32;
+  std::vector<std::vector<char>> pages(num_pages,
+                                       std::vector<char>(BUSTUB_PAGE_SIZE));
+  auto fill = [&rng](std::vector<char> *page, size_t used) {
+    std::fill(page->begin(), page->end(), 0);
+    for (size_t i = 0; i < used; ++i) {
+      (*page)[i] = static_cast<char>(rng());
+    }
+  };
+  char buf[BUSTUB_PAGE_SIZE];
+  {
+    DiskManager dm("test.db", false, SyncPolicy::ON_SYNC,
+                   PageCompression::LZ4);
+    ASSERT_TRUE(dm.UsesCompression());
+    EXPECT_EQ(1.0, dm.GetCompressionRatio());
+    for (page_id_t i = 0; i < num_pages; ++i) {
+      fill(&pages[i], i % 4 == 0 ? BUSTUB_PAGE_SIZE : 200);
+      dm.WritePage(i, pages[i].data());
+    }
+    EXPECT_EQ(num_pages, dm.GetNumPages());
+    EXPECT_GT(dm.GetCompressionRatio(), 2.0);
+
+    // Scenario: pages that grow or shrink move to new extents, and every page
+    // reads back as written.
+    fill(&pages[1], BUSTUB_PAGE_SIZE);
+    dm.WritePage(1, pages[1].data());
+    fill(&pages[4], 10);
+    dm.WritePage(4, pages[4].data());
+    std::vector<DiskManager::PageWrite> writes;
+    for (page_id_t i : {9, 8}) {
+      fill(&pages[i], 1000);
+      writes.emplace_back(i, pages[i].data());
+    }
+    dm.WritePages(writes);
+    for (page_id_t i = 0; i < num_pages; ++i) {
+      dm.ReadPage(i, buf);
+      EXPECT_EQ(0, std::memcmp(buf, pages[i].data(), BUSTUB_PAGE_SIZE));
+    }
+    dm.ReadPage(num_pages + 5, buf);
+    EXPECT_EQ(0, buf[0]);
+    dm.SyncPages();
+    dm.ShutDown();
+  }
+
+  // Scenario: the database stays compressed when reopened without asking for
+  // it, and its free extents are reused before the file grows.
+  struct stat stat_buf;
+  ASSERT_EQ(0, stat("test.db", &stat_buf));
+  off_t size = stat_buf.st_size;
+  EXPECT_LT(size, num_pages * BUSTUB_PAGE_SIZE / 2);
+  DiskManager dm("test.db");
+  ASSERT_TRUE(dm.UsesCompression());
+  EXPECT_EQ(num_pages, dm.GetNumPages());
+  EXPECT_GT(dm.GetCompressionRatio(), 2.0);
+  for (page_id_t i = 0; i < num_pages; ++i) {
+    dm.ReadPage(i, buf);
+    EXPECT_EQ(0, std::memcmp(buf, pages[i].data(), BUSTUB_PAGE_SIZE));
+  }
+  fill(&pages[2], 100);
+  dm.WritePage(2, pages[2].data());
+  dm.ReadPage(2, buf);
+  EXPECT_EQ(0, std::memcmp(buf, pages[2].data(), BUSTUB_PAGE_SIZE));
+  dm.ShutDown();
+  ASSERT_EQ(0, stat("test.db", &stat_buf));
+  EXPECT_EQ(size, stat_buf.st_size);
+
+  // Scenario: map entries kept in memory until a sync are written on shut
+  // down, and a store that never syncs writes them right away.
+  {
+    DiskManager unsynced("test.db", false, SyncPolicy::NONE);
+    unsynced.ReadPage(2, buf);
+    EXPECT_EQ(0, std::memcmp(buf, pages[2].data(), BUSTUB_PAGE_SIZE));
+    fill(&pages[3], 300);
+    unsynced.WritePage(3, pages[3].data());
+    unsynced.ShutDown();
+  }
+  DiskManager reopened("test.db");
+  reopened.ReadPage(3, buf);
+  EXPECT_EQ(0, std::memcmp(buf, pages[3].data(), BUSTUB_PAGE_SIZE));
+  reopened.ShutDown();
+}
+
+} // namespace bustub
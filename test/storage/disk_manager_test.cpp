@@ -10,10 +10,24 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <chrono> // NOLINT
+#include <condition_variable> // NOLINT
+#include <cstdlib>
 #include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <mutex> // NOLINT
+#include <string>
+#include <thread> // NOLINT
+#include <unistd.h>
+#include <vector>
 
+#include "buffer/buffer_pool_manager.h"
 #include "common/exception.h"
+#include "storage/disk/async_disk_manager.h"
 #include "storage/disk/disk_manager.h"
+#include "storage/disk/doublewrite_buffer.h"
+#include "storage/disk/mmap_disk_manager.h"
 #include "gtest/gtest.h"
 
 namespace bustub {
@@ -23,13 +37,19 @@ protected:
   // This function is called before every test.
   void SetUp() override {
     remove("test.db");
+    remove("test.fsm");
     remove("test.log");
+    remove("test.crc");
+    remove("test.dwb");
   }
 
   // This function is called after every test.
   void TearDown() override {
     remove("test.db");
+    remove("test.fsm");
     remove("test.log");
+    remove("test.crc");
+    remove("test.dwb");
   };
 };
 
@@ -55,6 +75,316 @@ TEST_F(DiskManagerTest, ReadWritePageTest) {
   dm.ShutDown();
 }
 
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, DirectIoTest) {
+  std::string db_file("test.db");
+  auto aligned = std::unique_ptr<char, decltype(&free)>(
+      static_cast<char *>(aligned_alloc(BUSTUB_PAGE_SIZE, BUSTUB_PAGE_SIZE)),
+      &free);
+  // one byte off a page boundary
+  std::vector<char> unaligned_storage(2 * BUSTUB_PAGE_SIZE);
+  char *unaligned = unaligned_storage.data();
+  if (reinterpret_cast<uintptr_t>(unaligned) % BUSTUB_PAGE_SIZE == 0) {
+    unaligned++;
+  }
+  char buf[BUSTUB_PAGE_SIZE];
+  {
+    auto dm = DiskManager(db_file, true, SyncPolicy::EVERY_WRITE);
+    EXPECT_EQ(0, dm.GetNumPages());
+
+    // Scenario: aligned and unaligned buffers are both written and read back.
+    std::memset(aligned.get(), 'a', BUSTUB_PAGE_SIZE);
+    std::memset(unaligned, 'u', BUSTUB_PAGE_SIZE);
+    dm.WritePage(0, aligned.get());
+    dm.WritePage(3, unaligned);
+    EXPECT_EQ(4, dm.GetNumPages());
+    dm.ReadPage(3, aligned.get());
+    EXPECT_EQ(0, std::memcmp(aligned.get(), unaligned, BUSTUB_PAGE_SIZE));
+    dm.ReadPage(0, unaligned);
+    EXPECT_EQ(std::string(BUSTUB_PAGE_SIZE, 'a'),
+              std::string(unaligned, BUSTUB_PAGE_SIZE));
+
+    // Scenario: pages in a hole and past the end of the file read as zeros.
+    std::memset(buf, 'x', sizeof(buf));
+    dm.ReadPage(1, buf);
+    EXPECT_EQ(std::string(BUSTUB_PAGE_SIZE, '\0'),
+              std::string(buf, BUSTUB_PAGE_SIZE));
+    std::memset(buf, 'x', sizeof(buf));
+    dm.ReadPage(10, buf);
+    EXPECT_EQ(std::string(BUSTUB_PAGE_SIZE, '\0'),
+              std::string(buf, BUSTUB_PAGE_SIZE));
+    EXPECT_EQ(4, dm.GetNumPages());
+    dm.ShutDown();
+  }
+
+  // Scenario: the size of the file is picked up when it is opened again.
+  auto dm = DiskManager(db_file);
+  EXPECT_EQ(4, dm.GetNumPages());
+  dm.ReadPage(3, buf);
+  EXPECT_EQ(std::string(BUSTUB_PAGE_SIZE, 'u'),
+            std::string(buf, BUSTUB_PAGE_SIZE));
+  dm.SyncPages();
+  dm.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, WritePagesTest) {
+  const page_id_t num_pages = 12;
+  std::vector<std::vector<char>> data(num_pages,
+                                      std::vector<char>(BUSTUB_PAGE_SIZE));
+  for (page_id_t i = 0; i < num_pages; ++i) {
+    std::memset(data[i].data(), 'a' + i, BUSTUB_PAGE_SIZE);
+  }
+  char buf[BUSTUB_PAGE_SIZE] = {0};
+  std::string db_file("test.db");
+  DiskManager dm(db_file);
+
+  // Scenario: unsorted pages with gaps are written in adjacent runs.
+  std::vector<DiskManager::PageWrite> writes;
+  for (page_id_t i : {7, 2, 3, 11, 0, 4, 8}) {
+    writes.emplace_back(i, data[i].data());
+  }
+  dm.WritePages(writes);
+  EXPECT_EQ(7, dm.GetNumWrites());
+  EXPECT_EQ(12, dm.GetNumPages());
+  for (page_id_t i : {7, 2, 3, 11, 0, 4, 8}) {
+    dm.ReadPage(i, buf);
+    EXPECT_EQ(0, std::memcmp(buf, data[i].data(), BUSTUB_PAGE_SIZE));
+  }
+  dm.ReadPage(1, buf);
+  EXPECT_EQ(0, buf[0]);
+
+  // Scenario: an empty batch writes nothing.
+  dm.WritePages({});
+  EXPECT_EQ(7, dm.GetNumWrites());
+  dm.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, MmapReadPageTest) {
+  const page_id_t num_pages = 8;
+  char buf[BUSTUB_PAGE_SIZE] = {0};
+  char data[BUSTUB_PAGE_SIZE] = {0};
+  std::string db_file("test.db");
+  {
+    DiskManager dm(db_file);
+    for (page_id_t i = 0; i < num_pages; ++i) {
+      std::memset(data, 'a' + i, sizeof(data));
+      dm.WritePage(i, data);
+    }
+    dm.ShutDown();
+  }
+
+  // Scenario: pages are copied out of the mapping, past its end they are
+  // zeros, and writes to the file are dropped.
+  {
+    MmapDiskManager dm(db_file);
+    EXPECT_EQ(num_pages, dm.GetNumPages());
+    dm.ReadPage(3, buf);
+    std::memset(data, 'a' + 3, sizeof(data));
+    EXPECT_EQ(0, std::memcmp(buf, data, sizeof(buf)));
+    dm.ReadPage(num_pages + 2, buf);
+    EXPECT_EQ(0, buf[0]);
+    EXPECT_EQ(nullptr, dm.GetMappedPage(3));
+    ASSERT_TRUE(dm.IsReadOnly());
+    std::memset(data, 'z', sizeof(data));
+    dm.WritePage(3, data);
+    dm.ReadPage(3, buf);
+    EXPECT_EQ('a' + 3, buf[0]);
+    dm.AdviseSequentialRead(2, 100);
+  }
+
+  // Scenario: with zero copy, the buffer pool serves fetched pages straight
+  // from the mapping.
+  MmapDiskManager dm(db_file, true);
+  auto bpm = std::make_unique<BufferPoolManager>(2, &dm);
+  for (page_id_t i = 0; i < num_pages; ++i) {
+    auto guard = bpm->FetchPageRead(i);
+    ASSERT_EQ(dm.GetMappedPage(i), guard.GetData());
+    EXPECT_EQ('a' + i, guard.GetData()[BUSTUB_PAGE_SIZE - 1]);
+  }
+
+  // Scenario: the buffer pool refuses to create or dirty pages of the
+  // read-only file, and a refused dirty unpin still releases the frame.
+  page_id_t page_id;
+  EXPECT_EQ(nullptr, bpm->NewPage(&page_id));
+  {
+    // neither guard pins a frame, page 3 still finds one
+    auto guard = bpm->FetchPageWrite(1);
+    auto other = bpm->FetchPageWrite(2);
+    ASSERT_NE(nullptr, bpm->FetchPage(3));
+    EXPECT_TRUE(bpm->UnpinPage(3, false));
+  }
+  for (int round = 0; round < 2; ++round) {
+    for (page_id_t i : {3, 4}) {
+      ASSERT_NE(nullptr, bpm->FetchPage(i));
+      EXPECT_FALSE(bpm->UnpinPage(i, true));
+    }
+  }
+  bpm->FlushAllPages();
+  bpm.reset();
+}
+
+/** Overwrite part of a page in the database file behind the disk manager. */
+static void ClobberPage(const std::string &db_file, page_id_t page_id,
+                        const char *data, size_t size) {
+  int fd = open(db_file.c_str(), O_WRONLY);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(static_cast<ssize_t>(size),
+            pwrite(fd, data, size,
+                   static_cast<off_t>(page_id) * BUSTUB_PAGE_SIZE));
+  close(fd);
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, ChecksumTest) {
+  char buf[BUSTUB_PAGE_SIZE] = {0};
+  char data[BUSTUB_PAGE_SIZE] = {0};
+  std::vector<std::vector<char>> pages(4, std::vector<char>(BUSTUB_PAGE_SIZE));
+  std::string db_file("test.db");
+  {
+    DiskManager dm(db_file);
+    std::vector<DiskManager::PageWrite> writes;
+    for (page_id_t i = 0; i < 4; ++i) {
+      std::memset(pages[i].data(), 'a' + i, BUSTUB_PAGE_SIZE);
+      writes.emplace_back(i, pages[i].data());
+    }
+    dm.WritePages(writes);
+    dm.ShutDown();
+  }
+
+  // Scenario: a page changed behind the disk manager's back fails its
+  // checksum, the others still read fine after a restart. Without a
+  // doublewrite buffer the mismatch is counted but the read goes through.
+  ClobberPage(db_file, 2, "xyz", 3);
+  DiskManager dm(db_file);
+  EXPECT_TRUE(dm.ReadPage(1, buf));
+  EXPECT_EQ(0, std::memcmp(buf, pages[1].data(), sizeof(buf)));
+  EXPECT_EQ(0, dm.GetNumChecksumFailures());
+  EXPECT_TRUE(dm.ReadPage(2, buf));
+  EXPECT_EQ(1, dm.GetNumChecksumFailures());
+
+  // Scenario: rewriting the page makes it whole again.
+  std::memset(data, 'c', sizeof(data));
+  dm.WritePage(2, data);
+  dm.ReadPage(2, buf);
+  EXPECT_EQ(1, dm.GetNumChecksumFailures());
+  dm.ShutDown();
+
+  // Scenario: with a doublewrite buffer a page that fails its checksum fails
+  // the read.
+  ClobberPage(db_file, 2, "xyz", 3);
+  DiskManager checked(db_file, false, SyncPolicy::ON_SYNC,
+                      PageCompression::NONE, true);
+  EXPECT_FALSE(checked.ReadPage(2, buf));
+  EXPECT_EQ(1, checked.GetNumChecksumFailures());
+  checked.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, BufferPoolChecksumTest) {
+  const size_t pool_size = 4;
+  std::string db_file("test.db");
+  {
+    DiskManager dm(db_file, false, SyncPolicy::ON_SYNC, PageCompression::NONE,
+                   true);
+    auto bpm = std::make_unique<BufferPoolManager>(pool_size, &dm);
+    for (page_id_t i = 0; i < 4; ++i) {
+      page_id_t page_id;
+      auto *page = bpm->NewPage(&page_id);
+      ASSERT_NE(nullptr, page);
+      std::memset(page->GetData(), 'a' + page_id, BUSTUB_PAGE_SIZE);
+      EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+    }
+    bpm->FlushAllPages();
+    bpm.reset();
+    dm.ShutDown();
+  }
+
+  // Scenario: fetching a page that fails its checksum, or fetching it after a
+  // prefetch failed, comes back empty instead of handing out the page.
+  ClobberPage(db_file, 2, "xyz", 3);
+  DiskManager dm(db_file, false, SyncPolicy::ON_SYNC, PageCompression::NONE,
+                 true);
+  auto bpm = std::make_unique<BufferPoolManager>(pool_size, &dm);
+  EXPECT_EQ(nullptr, bpm->FetchPage(2));
+  EXPECT_EQ(1, dm.GetNumChecksumFailures());
+  bpm->StartPrefetch(1);
+  bpm->PrefetchPages(2, 1);
+  for (int i = 0; i < 1000 && dm.GetNumChecksumFailures() < 2; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  EXPECT_EQ(2, dm.GetNumChecksumFailures());
+  EXPECT_EQ(nullptr, bpm->FetchPage(2));
+
+  // Scenario: the failed reads left no frame behind, the whole pool can be
+  // pinned at once.
+  for (page_id_t page_id : {0, 1, 3}) {
+    auto *page = bpm->FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ('a' + page_id, page->GetData()[BUSTUB_PAGE_SIZE - 1]);
+  }
+  page_id_t page_id;
+  ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+  for (page_id_t id : {0, 1, 3, page_id}) {
+    EXPECT_TRUE(bpm->UnpinPage(id, false));
+  }
+  bpm.reset();
+  dm.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, DoublewriteTest) {
+  char buf[BUSTUB_PAGE_SIZE] = {0};
+  std::vector<std::vector<char>> old_pages(8,
+                                           std::vector<char>(BUSTUB_PAGE_SIZE));
+  std::vector<std::vector<char>> new_pages = old_pages;
+  for (size_t i = 0; i < old_pages.size(); ++i) {
+    std::memset(old_pages[i].data(), 'a' + static_cast<int>(i),
+                BUSTUB_PAGE_SIZE);
+    std::memset(new_pages[i].data(), 'A' + static_cast<int>(i),
+                BUSTUB_PAGE_SIZE);
+  }
+  std::string db_file("test.db");
+  {
+    DiskManager dm(db_file, false, SyncPolicy::ON_SYNC, PageCompression::NONE,
+                   true);
+    ASSERT_TRUE(dm.UsesDoublewrite());
+    std::vector<DiskManager::PageWrite> writes;
+    for (page_id_t i = 0; i < 8; ++i) {
+      writes.emplace_back(i, old_pages[i].data());
+    }
+    dm.WritePages(writes);
+    EXPECT_EQ(8, dm.GetNumWrites());
+    dm.ShutDown();
+  }
+
+  // Scenario: a crash tore page 3 while it was written in place, page 5 was
+  // staged but never written. Reopening repairs page 3 from its staged copy
+  // and leaves the intact page 5 alone.
+  {
+    DoublewriteBuffer buffer("test.dwb");
+    ASSERT_TRUE(buffer.Stage({{3, new_pages[3].data()},
+                              {5, new_pages[5].data()}}));
+  }
+  ClobberPage(db_file, 3, new_pages[3].data(), BUSTUB_PAGE_SIZE / 2);
+  DiskManager dm(db_file, false, SyncPolicy::ON_SYNC, PageCompression::NONE,
+                 true);
+  EXPECT_EQ(1, dm.GetNumRepairedPages());
+  dm.ReadPage(3, buf);
+  EXPECT_EQ(0, std::memcmp(buf, new_pages[3].data(), BUSTUB_PAGE_SIZE));
+  dm.ReadPage(5, buf);
+  EXPECT_EQ(0, std::memcmp(buf, old_pages[5].data(), BUSTUB_PAGE_SIZE));
+  EXPECT_EQ(1, dm.GetNumChecksumFailures());
+  dm.ShutDown();
+
+  // Scenario: the staged pages are forgotten once repaired.
+  DiskManager reopened(db_file, false, SyncPolicy::ON_SYNC,
+                       PageCompression::NONE, true);
+  EXPECT_EQ(0, reopened.GetNumRepairedPages());
+  reopened.ShutDown();
+}
+
 // NOLINTNEXTLINE
 TEST_F(DiskManagerTest, ReadWriteLogTest) {
   char buf[16] = {0};
@@ -77,4 +407,73 @@ TEST_F(DiskManagerTest, ThrowBadFileTest) {
   EXPECT_THROW(DiskManager("dev/null\\/foo/bar/baz/test.db"), Exception);
 }
 
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, AsyncReadWritePageTest) {
+  const page_id_t num_pages = 200;
+  std::mutex latch;
+  std::condition_variable cv;
+  page_id_t completed = 0;
+  bool all_ok = true;
+  auto callback = [&](bool ok) {
+    std::scoped_lock lock(latch);
+    all_ok = all_ok && ok;
+    completed++;
+    cv.notify_all();
+  };
+  auto wait_for = [&](page_id_t count) {
+    std::unique_lock lock(latch);
+    cv.wait(lock, [&] { return completed == count; });
+    completed = 0;
+  };
+
+  for (auto backend : {IoBackend::AUTO, IoBackend::THREAD_POOL}) {
+    remove("test.db");
+    auto dm = std::make_unique<AsyncDiskManager>("test.db", backend, 8);
+    EXPECT_NE(IoBackend::AUTO, dm->GetBackend());
+    if (backend == IoBackend::THREAD_POOL) {
+      EXPECT_EQ(IoBackend::THREAD_POOL, dm->GetBackend());
+    }
+
+    // Scenario: more writes than the queue depth are queued, they complete
+    // once submitted.
+    std::vector<std::vector<char>> data(num_pages,
+                                        std::vector<char>(BUSTUB_PAGE_SIZE));
+    for (page_id_t i = 0; i < num_pages; ++i) {
+      snprintf(data[i].data(), BUSTUB_PAGE_SIZE, "page %d", i);
+      dm->WritePageAsync(i, data[i].data(), callback);
+    }
+    dm->SubmitIo();
+    wait_for(num_pages);
+    EXPECT_TRUE(all_ok);
+    EXPECT_EQ(num_pages, dm->GetNumPages());
+
+    // Scenario: asynchronous and blocking reads see the written pages, reads
+    // past the end yield zeros.
+    std::vector<std::vector<char>> buf(
+        num_pages + 1, std::vector<char>(BUSTUB_PAGE_SIZE, 'x'));
+    for (page_id_t i = 0; i <= num_pages; ++i) {
+      dm->ReadPageAsync(i, buf[i].data(), callback);
+    }
+    dm->SubmitIo();
+    wait_for(num_pages + 1);
+    EXPECT_TRUE(all_ok);
+    for (page_id_t i = 0; i < num_pages; ++i) {
+      EXPECT_EQ(0,
+                std::memcmp(buf[i].data(), data[i].data(), BUSTUB_PAGE_SIZE));
+    }
+    EXPECT_EQ(std::vector<char>(BUSTUB_PAGE_SIZE, 0), buf[num_pages]);
+    char page[BUSTUB_PAGE_SIZE];
+    dm->ReadPage(num_pages - 1, page);
+    EXPECT_EQ(0,
+              std::memcmp(page, data[num_pages - 1].data(), BUSTUB_PAGE_SIZE));
+
+    // Scenario: requests still queued when the disk manager goes away are
+    // completed first.
+    dm->WritePageAsync(0, data[1].data(), callback);
+    dm.reset();
+    EXPECT_EQ(1, completed);
+    completed = 0;
+  }
+}
+
 } // namespace bustub
@@ -0,0 +1,116 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// free_space_map_test.cpp
+//
+// Identification: test/storage/free_space_map_test.cpp
+//
+// Copyright (c) 2015-2023, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <cstring>
+#include <memory>
+
+#include "buffer/buffer_pool_manager.h"
+#include "storage/disk/disk_manager_memory.h"
+#include "storage/disk/free_space_map.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+// NOLINTNEXTLINE
+TEST(FreeSpaceMapTest, SampleTest) {
+  auto disk_manager = std::make_unique<DiskManagerUnlimitedMemory>();
+  FreeSpaceMap map(disk_manager.get(), 2);
+
+  // Scenario: every shard gets the lowest free page ids of its own.
+  EXPECT_EQ(0, map.AllocatePage(0));
+  EXPECT_EQ(1, map.AllocatePage(1));
+  EXPECT_EQ(2, map.AllocatePage(0));
+  EXPECT_EQ(4, map.AllocatePage(0));
+  EXPECT_TRUE(map.IsAllocated(2));
+  EXPECT_FALSE(map.IsAllocated(3));
+  EXPECT_FALSE(map.IsAllocated(-1));
+
+  // Scenario: extents are contiguous and skip allocated page ids.
+  EXPECT_EQ(5, map.AllocateExtent(3));
+  EXPECT_EQ(3, map.AllocateExtent(1));
+  for (page_id_t page_id = 0; page_id < 8; ++page_id) {
+    EXPECT_TRUE(map.IsAllocated(page_id));
+  }
+
+  // Scenario: freed page ids are handed out again, lowest first.
+  map.DeallocatePage(6);
+  map.DeallocatePage(2);
+  map.DeallocatePage(2);
+  EXPECT_FALSE(map.IsAllocated(2));
+  EXPECT_EQ(2, map.AllocatePage(0));
+  EXPECT_EQ(6, map.AllocatePage(0));
+  EXPECT_EQ(8, map.AllocatePage(0));
+  EXPECT_EQ(9, map.AllocateExtent(2));
+
+  // Scenario: an extent larger than a map page spans map pages.
+  page_id_t first = map.AllocateExtent(FreeSpaceMap::BITS_PER_MAP_PAGE);
+  EXPECT_EQ(11, first);
+  EXPECT_TRUE(map.IsAllocated(first + static_cast<page_id_t>(FreeSpaceMap::BITS_PER_MAP_PAGE) - 1));
+  EXPECT_EQ(first + static_cast<page_id_t>(FreeSpaceMap::BITS_PER_MAP_PAGE), map.AllocatePage(1));
+}
+
+// NOLINTNEXTLINE
+TEST(FreeSpaceMapTest, RestartTest) {
+  const size_t buffer_pool_size = 4;
+  auto disk_manager = std::make_unique<DiskManagerUnlimitedMemory>();
+  auto bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager.get());
+  page_id_t page_id;
+  for (page_id_t i = 0; i < 10; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    EXPECT_EQ(i, page_id);
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+  // page 5 has been evicted, deleting it only frees its id
+  EXPECT_TRUE(bpm->DeletePage(5));
+  EXPECT_TRUE(bpm->DeletePage(8));
+  bpm->FlushAllPages();
+
+  // Scenario: the deleted page ids survive a restart and are reused before the file grows.
+  bpm.reset();
+  bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager.get());
+  ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+  EXPECT_EQ(5, page_id);
+  EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+  EXPECT_EQ(8, page_id);
+  EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  bpm->FlushAllPages();
+
+  // Scenario: pages written after the map was last flushed are not handed out twice after a restart.
+  ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+  EXPECT_EQ(10, page_id);
+  EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+  EXPECT_TRUE(bpm->FlushPage(page_id));
+  bpm.reset();
+  bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager.get());
+  ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+  EXPECT_EQ(11, page_id);
+  EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+
+  // Scenario: the pages of an extent are created in place, unused ones are handed back.
+  page_id_t first = bpm->AllocateExtent(4);
+  EXPECT_EQ(12, first);
+  auto *page = bpm->NewPageAt(first + 1);
+  ASSERT_NE(nullptr, page);
+  EXPECT_EQ(first + 1, page->GetPageId());
+  EXPECT_TRUE(bpm->UnpinPage(first + 1, false));
+  for (page_id_t i = 0; i < 4; ++i) {
+    if (i != 1) {
+      EXPECT_TRUE(bpm->DeletePage(first + i));
+    }
+  }
+  ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+  EXPECT_EQ(first, page_id);
+  EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+}
+
+} // namespace bustub
@@ -0,0 +1,219 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// generic_key_test.cpp
+//
+// Identification: test/storage/generic_key_test.cpp
+//
+// Copyright (c) 2015-2023, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "common/exception.h"
+#include "storage/disk/disk_manager_memory.h"
+#include "storage/index/b_plus_tree_index.h"
+#include "test_util.h" // NOLINT
+#include "type/value_factory.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+static auto Sign(int cmp) -> int {
+  return static_cast<int>(cmp > 0) - static_cast<int>(cmp < 0);
+}
+
+/**
+ * Normalized keys of the rows must compare like the keys of the same rows
+ * compared as Values.
+ */
+template <size_t KeySize>
+static void CheckNormalizedOrder(const std::string &sql,
+                                 const std::vector<std::vector<Value>> &rows) {
+  auto key_schema = ParseCreateStatement(sql);
+  GenericComparator<KeySize> tuple_comparator(key_schema.get());
+  GenericComparator<KeySize> normalized_comparator(key_schema.get(),
+                                                   KeyEncoding::NORMALIZED);
+  std::vector<GenericKey<KeySize>> tuple_keys(rows.size());
+  std::vector<GenericKey<KeySize>> normalized_keys(rows.size());
+  for (size_t i = 0; i < rows.size(); i++) {
+    Tuple tuple(rows[i], key_schema.get());
+    tuple_keys[i].SetFromKey(tuple);
+    normalized_keys[i].SetFromKey(tuple, key_schema.get());
+  }
+  for (size_t i = 0; i < rows.size(); i++) {
+    for (size_t j = 0; j < rows.size(); j++) {
+      EXPECT_EQ(
+          Sign(normalized_comparator(normalized_keys[i], normalized_keys[j])),
+          Sign(tuple_comparator(tuple_keys[i], tuple_keys[j])))
+          << sql << " rows " << i << " and " << j;
+    }
+  }
+}
+
+TEST(GenericKeyTest, NormalizedOrderTest) {
+  std::vector<std::vector<Value>> rows;
+  for (int64_t v : std::vector<int64_t>{INT64_MIN + 1, -1000000000000, -256,
+                                       -1, 0, 1, 255, 256, 1000000000000,
+                                       INT64_MAX}) {
+    rows.push_back({ValueFactory::GetBigIntValue(v)});
+  }
+  CheckNormalizedOrder<8>("a bigint", rows);
+  CheckNormalizedOrder<16>("a bigint", rows);
+
+  rows.clear();
+  for (int32_t v : {INT32_MIN + 1, -65536, -1, 0, 1, 255, 65536, INT32_MAX}) {
+    rows.push_back({ValueFactory::GetIntegerValue(v)});
+  }
+  CheckNormalizedOrder<4>("a int", rows);
+  CheckNormalizedOrder<8>("a int", rows);
+
+  rows.clear();
+  for (int16_t v : {-32767, -300, -1, 0, 1, 300, 32767}) {
+    rows.push_back({ValueFactory::GetSmallIntValue(v)});
+  }
+  CheckNormalizedOrder<4>("a smallint", rows);
+
+  rows.clear();
+  for (double v : {-1e300, -1e10, -1.5, -0.25, 0.0, 0.25, 3.0, 1e300}) {
+    rows.push_back({ValueFactory::GetDecimalValue(v)});
+  }
+  CheckNormalizedOrder<8>("a double", rows);
+
+  rows.clear();
+  for (const std::string &v : {std::string(""), std::string("a"),
+                               std::string("a\0", 2), std::string("a\0b", 3),
+                               std::string("ab"), std::string("b"),
+                               std::string("Z"), std::string("\xff")}) {
+    rows.push_back({ValueFactory::GetVarcharValue(v)});
+  }
+  CheckNormalizedOrder<32>("a varchar(16)", rows);
+
+  // two integers fill a GenericKey<8>, which compares as one 64-bit integer
+  rows.clear();
+  for (int32_t a : {-7, 0, 7}) {
+    for (int32_t b : {INT32_MIN + 1, -1, 0, 1, INT32_MAX}) {
+      rows.push_back(
+          {ValueFactory::GetIntegerValue(a), ValueFactory::GetIntegerValue(b)});
+    }
+  }
+  CheckNormalizedOrder<8>("a int,b int", rows);
+
+  rows.clear();
+  for (const char *a : {"", "a", "ab"}) {
+    for (int32_t b : {-1, 0, 1}) {
+      rows.push_back({ValueFactory::GetVarcharValue(a),
+                      ValueFactory::GetIntegerValue(b)});
+    }
+  }
+  CheckNormalizedOrder<32>("a varchar(8),b int", rows);
+}
+
+TEST(GenericKeyTest, NormalizedNullTest) {
+  // NULL sorts first
+  auto key_schema = ParseCreateStatement("a int,b varchar(8)");
+  GenericComparator<16> comparator(key_schema.get(), KeyEncoding::NORMALIZED);
+  GenericKey<16> null_key;
+  GenericKey<16> min_key;
+  null_key.SetFromKey(
+      Tuple({ValueFactory::GetNullValueByType(TypeId::INTEGER),
+             ValueFactory::GetNullValueByType(TypeId::VARCHAR)},
+            key_schema.get()),
+      key_schema.get());
+  min_key.SetFromKey(Tuple({ValueFactory::GetIntegerValue(INT32_MIN + 1),
+                            ValueFactory::GetVarcharValue("")},
+                           key_schema.get()),
+                     key_schema.get());
+  EXPECT_LT(comparator(null_key, min_key), 0);
+  EXPECT_EQ(comparator(null_key, null_key), 0);
+
+  min_key.SetFromKey(
+      Tuple({ValueFactory::GetNullValueByType(TypeId::INTEGER),
+             ValueFactory::GetVarcharValue("")},
+            key_schema.get()),
+      key_schema.get());
+  EXPECT_LT(comparator(null_key, min_key), 0);
+}
+
+TEST(GenericKeyTest, NormalizedOverflowTest) {
+  // a key that doesn't fit is rejected rather than cut to a shared prefix
+  auto key_schema = ParseCreateStatement("a varchar(16)");
+  GenericKey<8> key;
+  key.SetFromKey(Tuple({ValueFactory::GetVarcharValue("abcde")},
+                       key_schema.get()),
+                 key_schema.get());
+  EXPECT_THROW(key.SetFromKey(Tuple({ValueFactory::GetVarcharValue("abcdef")},
+                                    key_schema.get()),
+                              key_schema.get()),
+               Exception);
+
+  key_schema = ParseCreateStatement("a bigint,b int");
+  EXPECT_THROW(key.SetFromKey(Tuple({ValueFactory::GetBigIntValue(1),
+                                     ValueFactory::GetIntegerValue(2)},
+                                    key_schema.get()),
+                              key_schema.get()),
+               Exception);
+}
+
+TEST(GenericKeyTest, NormalizedIndexTest) {
+  // both page formats order the index the same way
+  for (auto page_format :
+       {IndexPageFormat::PLAIN, IndexPageFormat::COMPRESSED}) {
+    auto schema = ParseCreateStatement("a int,b int,c bigint");
+    auto disk_manager = std::make_unique<DiskManagerUnlimitedMemory>();
+    auto bpm = std::make_unique<BufferPoolManager>(50, disk_manager.get());
+    // keyed by (b, a)
+    auto metadata = std::make_unique<IndexMetadata>(
+        "foo_pk", "foo", schema.get(), std::vector<uint32_t>{1, 0});
+    BPlusTreeIndex<GenericKey<8>, RID, GenericComparator<8>> index(
+        std::move(metadata), bpm.get(), page_format);
+
+    std::vector<std::pair<int32_t, int32_t>> keys;
+    for (int32_t a = -20; a < 20; a++) {
+      for (int32_t b = -20; b < 20; b++) {
+        keys.emplace_back(a * 7919 % 40, b * 104729 % 40);
+      }
+    }
+    for (size_t i = 0; i < keys.size(); i++) {
+      Tuple tuple({ValueFactory::GetIntegerValue(keys[i].first),
+                   ValueFactory::GetIntegerValue(keys[i].second),
+                   ValueFactory::GetBigIntValue(0)},
+                  schema.get());
+      auto key = tuple.KeyFromTuple(*schema, *index.GetKeySchema(),
+                                    index.GetKeyAttrs());
+      index.InsertEntry(key, RID(0, static_cast<uint32_t>(i)), nullptr);
+    }
+
+    for (size_t i = 0; i < keys.size(); i++) {
+      Tuple key({ValueFactory::GetIntegerValue(keys[i].second),
+                 ValueFactory::GetIntegerValue(keys[i].first)},
+                index.GetKeySchema());
+      std::vector<RID> result;
+      index.ScanKey(key, &result, nullptr);
+      ASSERT_EQ(result.size(), 1);
+      EXPECT_EQ(keys[result[0].GetSlotNum()], keys[i]);
+    }
+
+    std::vector<std::pair<int32_t, int32_t>> expected;
+    for (auto [a, b] : keys) {
+      expected.emplace_back(b, a);
+    }
+    std::sort(expected.begin(), expected.end());
+    expected.erase(std::unique(expected.begin(), expected.end()),
+                   expected.end());
+    size_t i = 0;
+    for (auto iter = index.GetBeginIterator(); !iter.IsEnd(); ++iter, ++i) {
+      ASSERT_LT(i, expected.size());
+      auto [a, b] = keys[(*iter).second.GetSlotNum()];
+      EXPECT_EQ(std::make_pair(b, a), expected[i]);
+    }
+    EXPECT_EQ(i, expected.size());
+  }
+}
+
+} // namespace bustub
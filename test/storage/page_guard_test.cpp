@@ -13,6 +13,7 @@
 #include <cstdio>
 #include <random>
 #include <string>
+#include <thread>  // NOLINT
 
 #include "buffer/buffer_pool_manager.h"
 #include "storage/disk/disk_manager_memory.h"
@@ -138,6 +139,86 @@ TEST(PageGuardTest, WriteTest) {
   disk_manager->ShutDown();
 }
 
+TEST(PageGuardTest, OptimisticReadTest) {
+  const size_t buffer_pool_size = 5;
+  const size_t k = 2;
+
+  auto disk_manager = std::make_shared<DiskManagerUnlimitedMemory>();
+  auto bpm = std::make_shared<BufferPoolManager>(buffer_pool_size,
+                                                 disk_manager.get(), k);
+
+  page_id_t page_id_temp;
+  auto *page0 = bpm->NewPage(&page_id_temp);
+  EXPECT_TRUE(bpm->UnpinPage(page_id_temp, false));
+
+  // an optimistic guard pins the page but takes no latch
+  {
+    auto optimistic_guard = bpm->FetchPageOptimistic(page_id_temp);
+    EXPECT_EQ(1, page0->GetPinCount());
+    auto writer_guard = bpm->FetchPageWrite(page_id_temp);
+    EXPECT_EQ(2, page0->GetPinCount());
+    // a writer that latched the page since invalidates the guard
+    writer_guard.Drop();
+    EXPECT_FALSE(optimistic_guard.Validate());
+  }
+  EXPECT_EQ(0, page0->GetPinCount());
+
+  // readers don't invalidate it, and the upgrade keeps the pin
+  {
+    auto optimistic_guard = bpm->FetchPageOptimistic(page_id_temp);
+    auto reader_guard = bpm->FetchPageRead(page_id_temp);
+    reader_guard.Drop();
+    EXPECT_TRUE(optimistic_guard.Validate());
+    ReadPageGuard upgraded_guard;
+    EXPECT_TRUE(optimistic_guard.UpgradeRead(&upgraded_guard));
+    EXPECT_EQ(page_id_temp, upgraded_guard.PageId());
+    EXPECT_EQ(1, page0->GetPinCount());
+  }
+  EXPECT_EQ(0, page0->GetPinCount());
+
+  // a failed upgrade drops the guard
+  {
+    auto optimistic_guard = bpm->FetchPageOptimistic(page_id_temp);
+    { auto writer_guard = bpm->FetchPageWrite(page_id_temp); }
+    ReadPageGuard upgraded_guard;
+    EXPECT_FALSE(optimistic_guard.UpgradeRead(&upgraded_guard));
+    EXPECT_EQ(0, page0->GetPinCount());
+  }
+
+  // the same goes for an upgrade to the write latch, which makes the page
+  // change for other optimistic readers
+  {
+    auto optimistic_guard = bpm->FetchPageOptimistic(page_id_temp);
+    auto other_guard = bpm->FetchPageOptimistic(page_id_temp);
+    WritePageGuard upgraded_guard;
+    EXPECT_TRUE(optimistic_guard.UpgradeWrite(&upgraded_guard));
+    EXPECT_EQ(page_id_temp, upgraded_guard.PageId());
+    EXPECT_EQ(2, page0->GetPinCount());
+    upgraded_guard.Drop();
+    EXPECT_FALSE(other_guard.Validate());
+    WritePageGuard other_upgraded_guard;
+    EXPECT_FALSE(other_guard.UpgradeWrite(&other_upgraded_guard));
+    EXPECT_EQ(0, page0->GetPinCount());
+  }
+
+  // a guard taken while a writer holds the page waits for the writer
+  {
+    auto writer_guard = bpm->FetchPageWrite(page_id_temp);
+    std::thread reader([&bpm, page_id_temp] {
+      auto optimistic_guard = bpm->FetchPageOptimistic(page_id_temp);
+      EXPECT_EQ('x', optimistic_guard.GetData()[0]);
+      EXPECT_TRUE(optimistic_guard.Validate());
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    writer_guard.GetDataMut()[0] = 'x';
+    writer_guard.Drop();
+    reader.join();
+  }
+
+  // Shutdown the disk manager and remove the temporary file we created.
+  disk_manager->ShutDown();
+}
+
 TEST(PageGuardTest, HHTest) {
   const std::string db_name = "test.db";
   const size_t buffer_pool_size = 5;
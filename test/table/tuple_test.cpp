@@ -57,6 +57,8 @@ TEST(TupleTest, DISABLED_TableHeapTest) {
 
   disk_manager->ShutDown();
   remove("test.db"); // remove db file
+  remove("test.fsm");
+  remove("test.crc");
   remove("test.log");
   delete table;
   delete buffer_pool_manager;
@@ -132,6 +132,7 @@ auto main(int argc, char **argv) -> int {
   delete transaction;
   delete disk_manager;
   remove("test.db");
+  remove("test.fsm");
   remove("test.log");
 
   return 0;
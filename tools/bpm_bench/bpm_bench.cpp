@@ -13,7 +13,7 @@
 #include "argparse/argparse.hpp"
 #include "binder/binder.h"
 #include "buffer/buffer_pool_manager.h"
-#include "buffer/lru_k_replacer.h"
+#include "buffer/replacer.h"
 #include "common/config.h"
 #include "common/exception.h"
 #include "common/util/string_util.h"
@@ -34,6 +34,7 @@ static const size_t BUSTUB_GET_THREAD = 8;
 static const size_t LRU_K_SIZE = 16;
 static const size_t BUSTUB_PAGE_CNT = 6400;
 static const size_t BUSTUB_BPM_SIZE = 64;
+static const size_t BUSTUB_SCALING_MAX_THREAD = 32;
 
 struct BpmTotalMetrics {
   uint64_t scan_cnt_{0};
@@ -52,18 +53,6 @@ struct BpmTotalMetrics {
     std::unique_lock<std::mutex> l(mutex_);
     get_cnt_ += get_cnt;
   }
-
-  void Report() {
-    auto now = ClockMs();
-    auto elsped = now - start_time_;
-    auto scan_per_sec = scan_cnt_ / static_cast<double>(elsped) * 1000;
-    auto get_per_sec = get_cnt_ / static_cast<double>(elsped) * 1000;
-
-    fmt::print("<<< BEGIN\n");
-    fmt::print("scan: {}\n", scan_per_sec);
-    fmt::print("get: {}\n", get_per_sec);
-    fmt::print(">>> END\n");
-  }
 };
 
 struct BpmMetrics {
@@ -100,42 +89,101 @@ struct BpmMetrics {
   }
 };
 
-// NOLINTNEXTLINE
-auto main(int argc, char **argv) -> int {
-  using bustub::AccessType;
-  using bustub::BufferPoolManager;
-  using bustub::DiskManagerUnlimitedMemory;
-  using bustub::page_id_t;
+using bustub::AccessType;
+using bustub::BufferPoolManager;
+using bustub::DiskManagerUnlimitedMemory;
+using bustub::page_id_t;
+using bustub::ReplacerType;
 
-  argparse::ArgumentParser program("bustub-bpm-bench");
-  program.add_argument("--duration").help("run bpm bench for n milliseconds");
-  program.add_argument("--latency").help("set disk latency to n milliseconds");
+/** Names accepted by --replacer. */
+static const std::vector<std::pair<std::string, ReplacerType>> BUSTUB_REPLACERS = {
+    {"lru-k", ReplacerType::LRUK}, {"lru", ReplacerType::LRU}, {"clock", ReplacerType::CLOCK}, {"arc", ReplacerType::ARC}};
 
-  try {
-    program.parse_args(argc, argv);
-  } catch (const std::runtime_error &err) {
-    std::cerr << err.what() << std::endl;
-    std::cerr << program;
-    return 1;
+void RunScanThread(size_t thread_id, size_t scan_thread_cnt, const std::vector<page_id_t> &page_ids,
+                   BufferPoolManager *bpm, uint64_t duration_ms, BpmTotalMetrics *total_metrics) {
+  BpmMetrics metrics(fmt::format("scan {:>2}", thread_id), duration_ms);
+  metrics.Begin();
+
+  size_t page_idx = BUSTUB_PAGE_CNT * thread_id / scan_thread_cnt;
+
+  while (!metrics.ShouldFinish()) {
+    auto *page = bpm->FetchPage(page_ids[page_idx], AccessType::Scan);
+    if (page == nullptr) {
+      continue;
+    }
+
+    char &ch = page->GetData()[page_idx % 1024];
+    page->WLatch();
+    ch += 1;
+    if (ch == 0) {
+      ch = 1;
+    }
+    page->WUnlatch();
+
+    bpm->UnpinPage(page->GetPageId(), true, AccessType::Scan);
+    page_idx = (page_idx + 1) % BUSTUB_PAGE_CNT;
+    metrics.Tick();
+    metrics.Report();
   }
 
-  uint64_t duration_ms = 30000;
-  if (program.present("--duration")) {
-    duration_ms = std::stoi(program.get("--duration"));
+  total_metrics->ReportScan(metrics.cnt_);
+}
+
+void RunGetThread(size_t thread_id, const std::vector<page_id_t> &page_ids, BufferPoolManager *bpm,
+                  uint64_t duration_ms, BpmTotalMetrics *total_metrics) {
+  std::random_device r;
+  std::default_random_engine gen(r());
+  zipfian_int_distribution<size_t> dist(0, BUSTUB_PAGE_CNT - 1, 0.8);
+
+  BpmMetrics metrics(fmt::format("get  {:>2}", thread_id), duration_ms);
+  metrics.Begin();
+
+  while (!metrics.ShouldFinish()) {
+    auto page_idx = dist(gen);
+    auto *page = bpm->FetchPage(page_ids[page_idx], AccessType::Get);
+    if (page == nullptr) {
+      continue;
+    }
+
+    page->RLatch();
+    char ch = page->GetData()[page_idx % 1024];
+    page->RUnlatch();
+    if (ch == 0) {
+      throw std::runtime_error("invalid data");
+    }
+
+    bpm->UnpinPage(page->GetPageId(), false, AccessType::Get);
+    metrics.Tick();
+    metrics.Report();
   }
 
-  uint64_t latency_ms = 0;
-  if (program.present("--latency")) {
-    latency_ms = std::stoi(program.get("--latency"));
+  total_metrics->ReportGet(metrics.cnt_);
+}
+
+/** Run scan_thread_cnt scan threads and get_thread_cnt get threads against bpm for duration_ms. */
+void RunWorkload(size_t scan_thread_cnt, size_t get_thread_cnt, const std::vector<page_id_t> &page_ids,
+                 BufferPoolManager *bpm, uint64_t duration_ms, BpmTotalMetrics *total_metrics) {
+  total_metrics->Begin();
+
+  std::vector<std::thread> threads;
+
+  for (size_t thread_id = 0; thread_id < scan_thread_cnt; thread_id++) {
+    threads.emplace_back(RunScanThread, thread_id, scan_thread_cnt, std::cref(page_ids), bpm, duration_ms,
+                         total_metrics);
   }
 
-  auto disk_manager = std::make_unique<DiskManagerUnlimitedMemory>();
-  auto bpm = std::make_unique<BufferPoolManager>(BUSTUB_BPM_SIZE, disk_manager.get(), LRU_K_SIZE);
-  std::vector<page_id_t> page_ids;
+  for (size_t thread_id = 0; thread_id < get_thread_cnt; thread_id++) {
+    threads.emplace_back(RunGetThread, thread_id, std::cref(page_ids), bpm, duration_ms, total_metrics);
+  }
 
-  fmt::print(stderr, "[info] total_page={}, duration_ms={}, latency_ms={}, lru_k_size={}, bpm_size={}\n",
-             BUSTUB_PAGE_CNT, duration_ms, latency_ms, LRU_K_SIZE, BUSTUB_BPM_SIZE);
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
 
+/** Create BUSTUB_PAGE_CNT pages in bpm and return their ids. */
+auto CreatePages(BufferPoolManager *bpm) -> std::vector<page_id_t> {
+  std::vector<page_id_t> page_ids;
   for (size_t i = 0; i < BUSTUB_PAGE_CNT; i++) {
     page_id_t page_id;
     auto *page = bpm->NewPage(&page_id);
@@ -148,85 +196,112 @@ auto main(int argc, char **argv) -> int {
     bpm->UnpinPage(page_id, true);
     page_ids.push_back(page_id);
   }
+  return page_ids;
+}
 
-  // enable disk latency after creating all pages
-  disk_manager->SetLatency(latency_ms);
-
-  fmt::print(stderr, "[info] benchmark start\n");
-
-  BpmTotalMetrics total_metrics;
-  total_metrics.Begin();
-
-  std::vector<std::thread> threads;
-
-  for (size_t thread_id = 0; thread_id < BUSTUB_SCAN_THREAD; thread_id++) {
-    threads.emplace_back(std::thread([thread_id, &page_ids, &bpm, duration_ms, &total_metrics] {
-      BpmMetrics metrics(fmt::format("scan {:>2}", thread_id), duration_ms);
-      metrics.Begin();
-
-      size_t page_idx = BUSTUB_PAGE_CNT * thread_id / BUSTUB_SCAN_THREAD;
-
-      while (!metrics.ShouldFinish()) {
-        auto *page = bpm->FetchPage(page_ids[page_idx], AccessType::Scan);
-        if (page == nullptr) {
-          continue;
-        }
-
-        char &ch = page->GetData()[page_idx % 1024];
-        page->WLatch();
-        ch += 1;
-        if (ch == 0) {
-          ch = 1;
-        }
-        page->WUnlatch();
-
-        bpm->UnpinPage(page->GetPageId(), true, AccessType::Scan);
-        page_idx = (page_idx + 1) % BUSTUB_PAGE_CNT;
-        metrics.Tick();
-        metrics.Report();
-      }
+// NOLINTNEXTLINE
+auto main(int argc, char **argv) -> int {
+  argparse::ArgumentParser program("bustub-bpm-bench");
+  program.add_argument("--duration").help("run bpm bench for n milliseconds");
+  program.add_argument("--latency").help("set disk latency to n milliseconds");
+  program.add_argument("--instances").help("split the buffer pool into n instances");
+  program.add_argument("--replacer")
+      .help("replacement policy: lru-k, lru, clock, arc, or all to run the workload once with each")
+      .default_value(std::string("lru-k"));
+  program.add_argument("--stats")
+      .help("dump the buffer pool counters after every run")
+      .default_value(false)
+      .implicit_value(true);
+  program.add_argument("--scaling")
+      .help("run the get workload with 1 to 32 threads, each round for --duration milliseconds")
+      .default_value(false)
+      .implicit_value(true);
 
-      total_metrics.ReportScan(metrics.cnt_);
-    }));
+  try {
+    program.parse_args(argc, argv);
+  } catch (const std::runtime_error &err) {
+    std::cerr << err.what() << std::endl;
+    std::cerr << program;
+    return 1;
   }
 
-  for (size_t thread_id = 0; thread_id < BUSTUB_GET_THREAD; thread_id++) {
-    threads.emplace_back(std::thread([thread_id, &page_ids, &bpm, duration_ms, &total_metrics] {
-      std::random_device r;
-      std::default_random_engine gen(r());
-      zipfian_int_distribution<size_t> dist(0, BUSTUB_PAGE_CNT - 1, 0.8);
-
-      BpmMetrics metrics(fmt::format("get  {:>2}", thread_id), duration_ms);
-      metrics.Begin();
-
-      while (!metrics.ShouldFinish()) {
-        auto page_idx = dist(gen);
-        auto *page = bpm->FetchPage(page_ids[page_idx], AccessType::Get);
-        if (page == nullptr) {
-          continue;
-        }
-
-        page->RLatch();
-        char ch = page->GetData()[page_idx % 1024];
-        page->RUnlatch();
-        if (ch == 0) {
-          throw std::runtime_error("invalid data");
-        }
+  uint64_t duration_ms = 30000;
+  if (program.present("--duration")) {
+    duration_ms = std::stoi(program.get("--duration"));
+  }
 
-        bpm->UnpinPage(page->GetPageId(), false, AccessType::Get);
-        metrics.Tick();
-        metrics.Report();
-      }
+  uint64_t latency_ms = 0;
+  if (program.present("--latency")) {
+    latency_ms = std::stoi(program.get("--latency"));
+  }
 
-      total_metrics.ReportGet(metrics.cnt_);
-    }));
+  size_t num_instances = 1;
+  if (program.present("--instances")) {
+    num_instances = std::stoi(program.get("--instances"));
   }
 
-  for (auto &thread : threads) {
-    thread.join();
+  auto replacer_name = program.get("--replacer");
+  std::vector<std::pair<std::string, ReplacerType>> replacers;
+  for (const auto &replacer : BUSTUB_REPLACERS) {
+    if (replacer_name == "all" || replacer_name == replacer.first) {
+      replacers.push_back(replacer);
+    }
+  }
+  if (replacers.empty()) {
+    std::cerr << "unknown replacer: " << replacer_name << std::endl;
+    std::cerr << program;
+    return 1;
   }
+  bool compare = replacers.size() > 1;
+
+  fmt::print(stderr,
+             "[info] total_page={}, duration_ms={}, latency_ms={}, lru_k_size={}, bpm_size={}, bpm_instances={}, "
+             "replacer={}\n",
+             BUSTUB_PAGE_CNT, duration_ms, latency_ms, LRU_K_SIZE, BUSTUB_BPM_SIZE, num_instances, replacer_name);
+
+  fmt::print("<<< BEGIN\n");
+  for (const auto &[name, replacer_type] : replacers) {
+    auto disk_manager = std::make_unique<DiskManagerUnlimitedMemory>();
+    auto bpm = std::make_unique<BufferPoolManager>(BUSTUB_BPM_SIZE, disk_manager.get(), LRU_K_SIZE, nullptr,
+                                                   num_instances, replacer_type);
+    auto page_ids = CreatePages(bpm.get());
+
+    // enable disk latency and start counting after creating all pages
+    disk_manager->SetLatency(latency_ms);
+    bpm->ResetStats();
+
+    fmt::print(stderr, "[info] benchmark start, replacer={}\n", name);
+
+    auto prefix = compare ? fmt::format("replacer={:<6} ", name) : std::string();
+    if (program.get<bool>("--scaling")) {
+      for (size_t thread_cnt = 1; thread_cnt <= BUSTUB_SCALING_MAX_THREAD; thread_cnt *= 2) {
+        BpmTotalMetrics total_metrics;
+        RunWorkload(0, thread_cnt, page_ids, bpm.get(), duration_ms, &total_metrics);
+        auto elsped = ClockMs() - total_metrics.start_time_;
+        fmt::print("{}threads={:<3} get: {}\n", prefix, thread_cnt,
+                   total_metrics.get_cnt_ / static_cast<double>(elsped) * 1000);
+      }
+      continue;
+    }
 
-  total_metrics.Report();
+    auto reads_before = disk_manager->GetNumReads();
+    BpmTotalMetrics total_metrics;
+    RunWorkload(BUSTUB_SCAN_THREAD, BUSTUB_GET_THREAD, page_ids, bpm.get(), duration_ms, &total_metrics);
+    auto elsped = ClockMs() - total_metrics.start_time_;
+    auto fetches = total_metrics.scan_cnt_ + total_metrics.get_cnt_;
+    auto misses = disk_manager->GetNumReads() - reads_before;
+    auto hit_rate = fetches == 0 ? 0.0 : 1.0 - static_cast<double>(misses) / static_cast<double>(fetches);
+    fmt::print("{}scan: {}\n", prefix, total_metrics.scan_cnt_ / static_cast<double>(elsped) * 1000);
+    fmt::print("{}get: {}\n", prefix, total_metrics.get_cnt_ / static_cast<double>(elsped) * 1000);
+    fmt::print("{}hit_rate: {:.4f}\n", prefix, hit_rate);
+    if (program.get<bool>("--stats")) {
+      std::istringstream stats(bpm->StatsToString());
+      for (std::string line; std::getline(stats, line);) {
+        fmt::print("{}{}\n", prefix, line);
+      }
+    }
+  }
+  fmt::print(">>> END\n");
 
   return 0;
 }
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <chrono>
 #include <iostream>
 #include <memory>
@@ -13,7 +14,7 @@
 #include "argparse/argparse.hpp"
 #include "binder/binder.h"
 #include "buffer/buffer_pool_manager.h"
-#include "buffer/lru_k_replacer.h"
+#include "buffer/replacer.h"
 #include "common/config.h"
 #include "common/exception.h"
 #include "common/rid.h"
@@ -57,16 +58,16 @@ struct BTreeTotalMetrics {
     read_cnt_ += get_cnt;
   }
 
-  void Report() {
+  void Report(const std::string &prefix, uint64_t disk_reads) {
     auto now = ClockMs();
     auto elsped = now - start_time_;
     auto write_per_sec = write_cnt_ / static_cast<double>(elsped) * 1000;
     auto read_per_sec = read_cnt_ / static_cast<double>(elsped) * 1000;
+    auto ops = write_cnt_ + read_cnt_;
 
-    fmt::print("<<< BEGIN\n");
-    fmt::print("write: {}\n", write_per_sec);
-    fmt::print("read: {}\n", read_per_sec);
-    fmt::print(">>> END\n");
+    fmt::print("{}write: {}\n", prefix, write_per_sec);
+    fmt::print("{}read: {}\n", prefix, read_per_sec);
+    fmt::print("{}disk_reads_per_op: {:.4f}\n", prefix, ops == 0 ? 0.0 : disk_reads / static_cast<double>(ops));
   }
 };
 
@@ -104,40 +105,28 @@ struct BTreeMetrics {
   }
 };
 
+using bustub::AccessType;
+using bustub::BufferPoolManager;
+using bustub::DiskManagerUnlimitedMemory;
+using bustub::page_id_t;
+using bustub::ReplacerType;
+
+/** Names accepted by --replacer. */
+static const std::vector<std::pair<std::string, ReplacerType>> BUSTUB_REPLACERS = {
+    {"lru-k", ReplacerType::LRUK}, {"lru", ReplacerType::LRU}, {"clock", ReplacerType::CLOCK}, {"arc", ReplacerType::ARC}};
+
 // These keys will be deleted and inserted again
 auto KeyWillVanish(size_t key) -> bool { return key % 7 == 0; }
 
 // These keys will be overwritten to a new value
 auto KeyWillChange(size_t key) -> bool { return key % 5 == 0; }
 
-// NOLINTNEXTLINE
-auto main(int argc, char **argv) -> int {
-  using bustub::AccessType;
-  using bustub::BufferPoolManager;
-  using bustub::DiskManagerUnlimitedMemory;
-  using bustub::page_id_t;
-
-  argparse::ArgumentParser program("bustub-btree-bench");
-  program.add_argument("--duration").help("run btree bench for n milliseconds");
-
-  try {
-    program.parse_args(argc, argv);
-  } catch (const std::runtime_error &err) {
-    std::cerr << err.what() << std::endl;
-    std::cerr << program;
-    return 1;
-  }
-
-  uint64_t duration_ms = 30000;
-  if (program.present("--duration")) {
-    duration_ms = std::stoi(program.get("--duration"));
-  }
-
+/** Load the tree into a fresh buffer pool using replacer_type and run the workload on it for duration_ms. */
+void RunBench(ReplacerType replacer_type, uint64_t duration_ms, bool zipfian, size_t write_threads,
+              const std::string &prefix) {
   auto disk_manager = std::make_unique<DiskManagerUnlimitedMemory>();
-  auto bpm = std::make_unique<BufferPoolManager>(BUSTUB_BPM_SIZE, disk_manager.get(), LRU_K_SIZE);
-
-  fmt::print(stderr, "[info] total_keys={}, duration_ms={}, lru_k_size={}, bpm_size={}\n", TOTAL_KEYS, duration_ms,
-             LRU_K_SIZE, BUSTUB_BPM_SIZE);
+  auto bpm = std::make_unique<BufferPoolManager>(BUSTUB_BPM_SIZE, disk_manager.get(), LRU_K_SIZE, nullptr, 1,
+                                                 replacer_type);
 
   auto key_schema = bustub::ParseCreateStatement("a bigint");
   bustub::GenericComparator<8> comparator(key_schema.get());
@@ -158,6 +147,7 @@ auto main(int argc, char **argv) -> int {
   }
 
   fmt::print(stderr, "[info] benchmark start\n");
+  auto reads_before = disk_manager->GetNumReads();
 
   BTreeTotalMetrics total_metrics;
   total_metrics.Begin();
@@ -165,7 +155,7 @@ auto main(int argc, char **argv) -> int {
   std::vector<std::thread> threads;
 
   for (size_t thread_id = 0; thread_id < BUSTUB_READ_THREAD; thread_id++) {
-    threads.emplace_back(std::thread([thread_id, &index, duration_ms, &total_metrics] {
+    threads.emplace_back(std::thread([thread_id, &index, duration_ms, zipfian, &total_metrics] {
       BTreeMetrics metrics(fmt::format("read  {:>2}", thread_id), duration_ms);
       metrics.Begin();
 
@@ -174,12 +164,13 @@ auto main(int argc, char **argv) -> int {
       std::random_device r;
       std::default_random_engine gen(r());
       std::uniform_int_distribution<size_t> dis(key_start, key_end - 1);
+      zipfian_int_distribution<size_t> zipf_dis(key_start, key_end - 1, 0.8);
 
       bustub::GenericKey<8> index_key;
       std::vector<bustub::RID> rids;
 
       while (!metrics.ShouldFinish()) {
-        auto base_key = dis(gen);
+        auto base_key = zipfian ? zipf_dis(gen) : dis(gen);
         size_t cnt = 0;
         for (auto key = base_key; key < key_end && cnt < KEY_MODIFY_RANGE; key++, cnt++) {
           rids.clear();
@@ -210,13 +201,13 @@ auto main(int argc, char **argv) -> int {
     }));
   }
 
-  for (size_t thread_id = 0; thread_id < BUSTUB_WRITE_THREAD; thread_id++) {
-    threads.emplace_back(std::thread([thread_id, &index, duration_ms, &total_metrics] {
+  for (size_t thread_id = 0; thread_id < write_threads; thread_id++) {
+    threads.emplace_back(std::thread([thread_id, &index, duration_ms, write_threads, &total_metrics] {
       BTreeMetrics metrics(fmt::format("write {:>2}", thread_id), duration_ms);
       metrics.Begin();
 
-      size_t key_start = TOTAL_KEYS / BUSTUB_WRITE_THREAD * thread_id;
-      size_t key_end = TOTAL_KEYS / BUSTUB_WRITE_THREAD * (thread_id + 1);
+      size_t key_start = TOTAL_KEYS / write_threads * thread_id;
+      size_t key_end = TOTAL_KEYS / write_threads * (thread_id + 1);
       std::random_device r;
       std::default_random_engine gen(r());
       std::uniform_int_distribution<size_t> dis(key_start, key_end - 1);
@@ -261,7 +252,65 @@ auto main(int argc, char **argv) -> int {
     thread.join();
   }
 
-  total_metrics.Report();
+  total_metrics.Report(prefix, disk_manager->GetNumReads() - reads_before);
+}
+
+// NOLINTNEXTLINE
+auto main(int argc, char **argv) -> int {
+  argparse::ArgumentParser program("bustub-btree-bench");
+  program.add_argument("--duration").help("run btree bench for n milliseconds");
+  program.add_argument("--replacer")
+      .help("replacement policy: lru-k, lru, clock, arc, or all to run the workload once with each")
+      .default_value(std::string("lru-k"));
+  program.add_argument("--zipfian")
+      .help("pick the keys of the read threads from a zipfian instead of a uniform distribution")
+      .default_value(false)
+      .implicit_value(true);
+  program.add_argument("--write-threads").help("run n threads inserting and removing keys");
+
+  try {
+    program.parse_args(argc, argv);
+  } catch (const std::runtime_error &err) {
+    std::cerr << err.what() << std::endl;
+    std::cerr << program;
+    return 1;
+  }
+
+  uint64_t duration_ms = 30000;
+  if (program.present("--duration")) {
+    duration_ms = std::stoi(program.get("--duration"));
+  }
+
+  auto replacer_name = program.get("--replacer");
+  std::vector<std::pair<std::string, ReplacerType>> replacers;
+  for (const auto &replacer : BUSTUB_REPLACERS) {
+    if (replacer_name == "all" || replacer_name == replacer.first) {
+      replacers.push_back(replacer);
+    }
+  }
+  if (replacers.empty()) {
+    std::cerr << "unknown replacer: " << replacer_name << std::endl;
+    std::cerr << program;
+    return 1;
+  }
+  bool zipfian = program.get<bool>("--zipfian");
+  size_t write_threads = BUSTUB_WRITE_THREAD;
+  if (program.present("--write-threads")) {
+    write_threads = std::max(std::stoi(program.get("--write-threads")), 1);
+  }
+
+  fmt::print(stderr,
+             "[info] total_keys={}, duration_ms={}, lru_k_size={}, bpm_size={}, replacer={}, zipfian={}, "
+             "write_threads={}\n",
+             TOTAL_KEYS, duration_ms, LRU_K_SIZE, BUSTUB_BPM_SIZE, replacer_name, zipfian, write_threads);
+
+  fmt::print("<<< BEGIN\n");
+  for (const auto &[name, replacer_type] : replacers) {
+    fmt::print(stderr, "[info] replacer={}\n", name);
+    RunBench(replacer_type, duration_ms, zipfian, write_threads,
+             replacers.size() > 1 ? fmt::format("replacer={:<6} ", name) : "");
+  }
+  fmt::print(">>> END\n");
 
   return 0;
 }